@@ -0,0 +1,117 @@
+#include "batch_prefetcher.h"
+
+#include <algorithm>
+#include <atomic>
+
+BatchPrefetcher::BatchPrefetcher(size_t itemCount, size_t batchSize, size_t itemElements, int ahead, int threads,
+    LoadItem load, Allocate allocate, Release release) : m_BatchCount(batchSize > 0 ? itemCount / batchSize : 0),
+    m_BatchSize(batchSize), m_ItemElements(itemElements), m_Load(load), m_Release(release),
+    m_Slots(std::max(ahead, 1) + 1), m_Held(-1), m_Consumed(0), m_Failed(false), m_Stop(false), m_Workers(threads)
+{
+  for (Slot& slot : m_Slots) {
+    size_t elements = batchSize * itemElements;
+    slot.data = allocate ? allocate(elements) : new float[elements];
+  }
+  if (!m_Release) {
+    m_Release = [](float* buffer) { delete[] buffer; };
+  }
+  m_Producer = std::thread(&BatchPrefetcher::produce, this);
+}
+
+BatchPrefetcher::~BatchPrefetcher()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stop = true;
+  }
+  m_Changed.notify_all();
+  m_Producer.join();
+  for (Slot& slot : m_Slots) {
+    m_Release(slot.data);
+  }
+}
+
+void
+BatchPrefetcher::produce()
+{
+  for (size_t batch = 0; batch < m_BatchCount; ++batch) {
+    // 等待一个既未就绪也未被使用方持有的缓冲区
+    Slot* slot = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_Changed.wait(lock, [&]() {
+        for (size_t s = 0; s < m_Slots.size() && slot == nullptr; ++s) {
+          if (m_Slots[s].batch < 0 && (long) s != m_Held) {
+            slot = &m_Slots[s];
+          }
+        }
+        return m_Stop || slot != nullptr;
+      });
+      if (m_Stop) {
+        return;
+      }
+    }
+
+    std::atomic<bool> ok(true);
+    float* data = slot->data;
+    m_Workers.run(m_BatchSize, [&](size_t item) {
+      if (ok && !m_Load(batch * m_BatchSize + item, data + item * m_ItemElements)) {
+        ok = false;
+      }
+    });
+
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if (!ok) {
+        m_Failed = true;
+      }
+      else {
+        slot->batch = batch;
+      }
+    }
+    m_Changed.notify_all();
+    if (!ok) {
+      return;
+    }
+  }
+}
+
+const float*
+BatchPrefetcher::next()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  // 上一个 batch 已用完，缓冲区交还给后台线程
+  if (m_Held >= 0) {
+    m_Slots[m_Held].batch = -1;
+    m_Held = -1;
+    m_Changed.notify_all();
+  }
+  if (m_Consumed >= m_BatchCount) {
+    return nullptr;
+  }
+
+  long wanted = m_Consumed;
+  long found = -1;
+  m_Changed.wait(lock, [&]() {
+    for (size_t s = 0; s < m_Slots.size(); ++s) {
+      if (m_Slots[s].batch == wanted) {
+        found = s;
+      }
+    }
+    return found >= 0 || m_Failed;
+  });
+  if (found < 0) {
+    return nullptr;
+  }
+
+  m_Held = found;
+  ++m_Consumed;
+  return m_Slots[found].data;
+}
+
+bool
+BatchPrefetcher::failed() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Failed;
+}
@@ -0,0 +1,67 @@
+#ifndef __BATCH_PREFETCHER_H__
+#define __BATCH_PREFETCHER_H__
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "worker_pool.h"
+
+// 有界的 batch 预取：后台线程按顺序准备后续 batch（每个 batch 内的样本在 threads 个常驻线程上并行加载），
+// 使用方处理当前 batch 时最多有 ahead 个 batch 已在准备。共有 ahead + 1 个主机缓冲区轮流使用
+class BatchPrefetcher {
+  public:
+    // 把第 item 个样本写入 data（itemElements 个 float），失败返回 false
+    typedef std::function<bool(size_t item, float* data)> LoadItem;
+    typedef std::function<float*(size_t elements)> Allocate;
+    typedef std::function<void(float* buffer)> Release;
+
+    // 不满一个 batch 的剩余样本丢弃；allocate/release 为空时使用 new[]/delete[]（校准器用于分配锁页内存）
+    BatchPrefetcher(size_t itemCount, size_t batchSize, size_t itemElements, int ahead, int threads, LoadItem load,
+        Allocate allocate = nullptr, Release release = nullptr);
+
+    ~BatchPrefetcher();
+
+    // 等待下一个 batch 就绪并返回其缓冲区，缓冲区在下一次调用 next 之前有效；
+    // 全部 batch 已取完或有样本加载失败时返回 nullptr
+    const float* next();
+
+    size_t batchCount() const { return m_BatchCount; }
+
+    // 已经通过 next 取出的 batch 数
+    size_t consumed() const { return m_Consumed; }
+
+    bool failed() const;
+
+  private:
+    BatchPrefetcher(const BatchPrefetcher&);
+    BatchPrefetcher& operator=(const BatchPrefetcher&);
+
+    void produce();
+
+    struct Slot
+    {
+      float* data {nullptr};
+      long batch {-1};            // 已就绪的 batch 序号，-1 表示空闲
+    };
+
+    const size_t m_BatchCount;
+    const size_t m_BatchSize;
+    const size_t m_ItemElements;
+    LoadItem m_Load;
+    Release m_Release;
+
+    std::vector<Slot> m_Slots;
+    long m_Held;                  // 使用方持有的缓冲区，-1 表示没有
+    size_t m_Consumed;
+    bool m_Failed;
+    bool m_Stop;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Changed;
+    WorkerPool m_Workers;
+    std::thread m_Producer;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include "batch_profiles.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+
+// 解析优化的 batch：1 到最大 batch 之间的整数，"max" 表示最大 batch
+bool
+parseOptBatch(const std::string& spec, uint32_t maxBatchSize, uint32_t& opt, std::string& error)
+{
+  size_t first = spec.find_first_not_of(" \t");
+  std::string s = first == std::string::npos ? "" : spec.substr(first, spec.find_last_not_of(" \t") + 1 - first);
+  if (s == "max") {
+    opt = maxBatchSize;
+    return true;
+  }
+  if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos) {
+    error = "\"" + spec + "\" is not a batch size";
+    return false;
+  }
+  errno = 0;
+  unsigned long value = strtoul(s.c_str(), nullptr, 10);
+  if (errno != 0 || value < 1 || value > maxBatchSize) {
+    error = "batch " + s + " must be between 1 and the max batch size " + std::to_string(maxBatchSize);
+    return false;
+  }
+  opt = value;
+  return true;
+}
+
+// 生成引擎唯一的优化 profile：[1, maxBatchSize]，TensorRT 按 optSpec 指定的 batch（默认为最大 batch）选择 kernel。
+// nvinfer 只使用 profile 0，也不会按每次推理的 batch 切换 profile，所以只能通过 kOPT 让常见的部分 batch 更快
+BatchProfile
+planBatchProfile(const std::string& optSpec, uint32_t maxBatchSize)
+{
+  BatchProfile profile;
+  profile.min = 1;
+  profile.opt = maxBatchSize;
+  profile.max = maxBatchSize;
+
+  std::string error;
+  if (!optSpec.empty() && !parseOptBatch(optSpec, maxBatchSize, profile.opt, error)) {
+    std::cerr << "Invalid BATCH_OPT: " << error << ", optimizing for batch " << maxBatchSize << std::endl;
+  }
+  return profile;
+}
+
+std::string
+batchProfileToString(const BatchProfile& profile)
+{
+  return "{min: " + std::to_string(profile.min) + ", opt: " + std::to_string(profile.opt) + ", max: " +
+      std::to_string(profile.max) + "}";
+}
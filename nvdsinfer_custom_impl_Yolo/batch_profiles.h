@@ -0,0 +1,20 @@
+#ifndef __BATCH_PROFILES_H__
+#define __BATCH_PROFILES_H__
+
+#include <string>
+#include <cstdint>
+
+struct BatchProfile
+{
+  uint32_t min {1};
+  uint32_t opt {1};
+  uint32_t max {1};
+};
+
+bool parseOptBatch(const std::string& spec, uint32_t maxBatchSize, uint32_t& opt, std::string& error);
+
+BatchProfile planBatchProfile(const std::string& optSpec, uint32_t maxBatchSize);
+
+std::string batchProfileToString(const BatchProfile& profile);
+
+#endif
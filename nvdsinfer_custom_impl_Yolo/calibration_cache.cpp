@@ -0,0 +1,224 @@
+#include "calibration_cache.h"
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "engine_cache.h"
+
+namespace {
+
+const char kMagic[8] = {'Y', 'O', 'L', 'O', 'C', 'A', 'L', 'B'};
+const uint32_t kVersion = 1;
+
+// 预处理的实现改变（结果不同）时增加，使旧缓存失效
+const uint32_t kPreprocessVersion = 1;
+
+struct CacheHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t key;
+  uint64_t itemElements;
+  uint64_t itemCount;
+  char padding[24];
+};
+
+static_assert(sizeof(CacheHeader) == 64, "calibration cache header must be 64 bytes");
+
+bool
+writeAll(int fd, const void* data, size_t size)
+{
+  const char* p = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = write(fd, p, size);
+    if (written <= 0) {
+      return false;
+    }
+    p += written;
+    size -= written;
+  }
+  return true;
+}
+
+}
+
+CalibrationCache::CalibrationCache() : m_Mapping(nullptr), m_MappingSize(0), m_Data(nullptr), m_ItemElements(0),
+    m_ItemCount(0)
+{
+}
+
+CalibrationCache::~CalibrationCache()
+{
+  close();
+}
+
+bool
+CalibrationCache::open(const std::string& filePath, uint64_t key, uint64_t itemElements, uint64_t itemCount)
+{
+  close();
+
+  int fd = ::open(filePath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  CacheHeader header;
+  if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < sizeof(header) ||
+      pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) {
+    ::close(fd);
+    return false;
+  }
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion || header.key != key ||
+      header.itemElements != itemElements || header.itemCount != itemCount ||
+      (uint64_t) st.st_size != sizeof(header) + itemCount * itemElements * sizeof(float)) {
+    ::close(fd);
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Could not map calibration cache " << filePath << std::endl;
+    return false;
+  }
+  // batch 按顺序读取，提前异步读入
+  madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+  madvise(mapping, st.st_size, MADV_WILLNEED);
+
+  m_Mapping = mapping;
+  m_MappingSize = st.st_size;
+  m_Data = reinterpret_cast<const float*>(static_cast<const char*>(mapping) + sizeof(header));
+  m_ItemElements = itemElements;
+  m_ItemCount = itemCount;
+  return true;
+}
+
+void
+CalibrationCache::close()
+{
+  if (m_Mapping != nullptr) {
+    munmap(m_Mapping, m_MappingSize);
+  }
+  m_Mapping = nullptr;
+  m_MappingSize = 0;
+  m_Data = nullptr;
+  m_ItemElements = 0;
+  m_ItemCount = 0;
+}
+
+CalibrationCacheWriter::CalibrationCacheWriter() : m_Fd(-1), m_ItemElements(0), m_ItemCount(0)
+{
+}
+
+CalibrationCacheWriter::~CalibrationCacheWriter()
+{
+  abort();
+}
+
+bool
+CalibrationCacheWriter::begin(const std::string& filePath, uint64_t key, uint64_t itemElements)
+{
+  abort();
+
+  m_FilePath = filePath;
+  m_TmpPath = filePath + ".tmp." + std::to_string(getpid()) + "." + std::to_string(syscall(SYS_gettid));
+  m_Fd = ::open(m_TmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (m_Fd < 0) {
+    std::cerr << "Could not create file " << m_TmpPath << std::endl;
+    return false;
+  }
+
+  // 图片数在 commit 时写入，未完成的文件不会被当作有效缓存
+  CacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.key = key;
+  header.itemElements = itemElements;
+  if (!writeAll(m_Fd, &header, sizeof(header))) {
+    std::cerr << "Could not write file " << m_TmpPath << std::endl;
+    abort();
+    return false;
+  }
+  m_ItemElements = itemElements;
+  m_ItemCount = 0;
+  return true;
+}
+
+bool
+CalibrationCacheWriter::append(const float* items, uint64_t count)
+{
+  if (m_Fd < 0) {
+    return false;
+  }
+  if (!writeAll(m_Fd, items, count * m_ItemElements * sizeof(float))) {
+    std::cerr << "Could not write file " << m_TmpPath << std::endl;
+    abort();
+    return false;
+  }
+  m_ItemCount += count;
+  return true;
+}
+
+bool
+CalibrationCacheWriter::commit()
+{
+  if (m_Fd < 0) {
+    return false;
+  }
+  bool ok = pwrite(m_Fd, &m_ItemCount, sizeof(m_ItemCount), offsetof(CacheHeader, itemCount)) ==
+      (ssize_t) sizeof(m_ItemCount);
+  ok = fsync(m_Fd) == 0 && ok;
+  ok = ::close(m_Fd) == 0 && ok;
+  m_Fd = -1;
+  if (!ok || rename(m_TmpPath.c_str(), m_FilePath.c_str()) != 0) {
+    std::cerr << "Could not commit file " << m_FilePath << std::endl;
+    unlink(m_TmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+void
+CalibrationCacheWriter::abort()
+{
+  if (m_Fd >= 0) {
+    ::close(m_Fd);
+    unlink(m_TmpPath.c_str());
+  }
+  m_Fd = -1;
+}
+
+bool
+calibrationCacheKey(const std::vector<std::string>& imagePaths, int channels, int height, int width,
+    float scaleFactor, const float* offsets, int inputFormat, int letterBox, int symmetricPadding, uint64_t& key)
+{
+  Hasher64 hasher;
+  hasher.update(&kPreprocessVersion, sizeof(kPreprocessVersion));
+  int values[6] = {channels, height, width, inputFormat, letterBox, symmetricPadding};
+  hasher.update(values, sizeof(values));
+  hasher.update(&scaleFactor, sizeof(scaleFactor));
+  hasher.update(offsets, 3 * sizeof(float));
+
+  // 图片内容以路径、修改时间和大小代替，不必为计算 key 读取全部图片
+  for (const std::string& imagePath : imagePaths) {
+    struct stat st;
+    if (stat(imagePath.c_str(), &st) != 0) {
+      return false;
+    }
+    int64_t fileInfo[2] = {(int64_t) st.st_mtime, (int64_t) st.st_size};
+    hasher.update(imagePath);
+    hasher.update(fileInfo, sizeof(fileInfo));
+  }
+  key = hasher.digest();
+  return true;
+}
@@ -0,0 +1,72 @@
+#ifndef __CALIBRATION_CACHE_H__
+#define __CALIBRATION_CACHE_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// 预处理后的校准输入缓存文件：64 字节文件头（魔数、版本、key、每张图片的 float 数、图片数），之后按图片顺序
+// 存放网络输入（CHW float）。key 由调用方根据图片列表和预处理参数计算，不一致时视为未命中
+class CalibrationCache {
+  public:
+    CalibrationCache();
+
+    ~CalibrationCache();
+
+    // 只读映射缓存文件，key、每张图片的大小和图片数都与参数一致时返回 true
+    bool open(const std::string& filePath, uint64_t key, uint64_t itemElements, uint64_t itemCount);
+
+    void close();
+
+    bool isOpen() const { return m_Mapping != nullptr; }
+
+    uint64_t itemCount() const { return m_ItemCount; }
+
+    // 从第 index 张图片开始的连续数据，batch 内的图片在文件中相邻
+    const float* items(uint64_t index) const { return m_Data + index * m_ItemElements; }
+
+  private:
+    CalibrationCache(const CalibrationCache&);
+    CalibrationCache& operator=(const CalibrationCache&);
+
+    void* m_Mapping;
+    uint64_t m_MappingSize;
+    const float* m_Data;
+    uint64_t m_ItemElements;
+    uint64_t m_ItemCount;
+};
+
+// 边校准边写缓存：数据依次追加到临时文件，commit 时写入图片数并重命名为目标文件；
+// 没有 commit（校准中途失败）的临时文件在 abort 或析构时删除
+class CalibrationCacheWriter {
+  public:
+    CalibrationCacheWriter();
+
+    ~CalibrationCacheWriter();
+
+    bool begin(const std::string& filePath, uint64_t key, uint64_t itemElements);
+
+    bool append(const float* items, uint64_t count);
+
+    bool commit();
+
+    void abort();
+
+    bool isActive() const { return m_Fd >= 0; }
+
+  private:
+    CalibrationCacheWriter(const CalibrationCacheWriter&);
+    CalibrationCacheWriter& operator=(const CalibrationCacheWriter&);
+
+    int m_Fd;
+    std::string m_FilePath;
+    std::string m_TmpPath;
+    uint64_t m_ItemElements;
+    uint64_t m_ItemCount;
+};
+
+// 校准缓存的 key：图片路径及其修改时间和大小、网络输入尺寸和全部预处理参数。读不到的图片返回 false
+bool calibrationCacheKey(const std::vector<std::string>& imagePaths, int channels, int height, int width,
+    float scaleFactor, const float* offsets, int inputFormat, int letterBox, int symmetricPadding, uint64_t& key);
+
+#endif
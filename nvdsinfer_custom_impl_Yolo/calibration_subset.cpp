@@ -0,0 +1,128 @@
+#include "calibration_subset.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "engine_cache.h"
+
+void
+DescriptorCache::load(const std::string& filePath, size_t descriptorSize)
+{
+  m_Entries.clear();
+  m_Changed = false;
+
+  std::ifstream file(filePath);
+  std::string line;
+  while (std::getline(file, line)) {
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos) {
+      continue;
+    }
+    std::istringstream values(line.substr(0, tab));
+    Entry entry;
+    values >> entry.mtime >> entry.size;
+    float value;
+    while (values >> value) {
+      entry.descriptor.push_back(value);
+    }
+    // 描述子的定义变了（长度不同）时整条作废
+    if (!values.eof() || entry.descriptor.size() != descriptorSize) {
+      continue;
+    }
+    m_Entries[line.substr(tab + 1)] = entry;
+  }
+}
+
+bool
+DescriptorCache::save(const std::string& filePath) const
+{
+  std::ostringstream data;
+  data.precision(std::numeric_limits<float>::max_digits10);
+  for (const std::pair<const std::string, Entry>& item : m_Entries) {
+    data << item.second.mtime << " " << item.second.size;
+    for (float value : item.second.descriptor) {
+      data << " " << value;
+    }
+    data << "\t" << item.first << "\n";
+  }
+  std::string text = data.str();
+  return writeFileAtomic(filePath, text.data(), text.size());
+}
+
+bool
+DescriptorCache::find(const std::string& imagePath, int64_t mtime, int64_t size, std::vector<float>& descriptor) const
+{
+  auto it = m_Entries.find(imagePath);
+  if (it == m_Entries.end() || it->second.mtime != mtime || it->second.size != size) {
+    return false;
+  }
+  descriptor = it->second.descriptor;
+  return true;
+}
+
+void
+DescriptorCache::put(const std::string& imagePath, int64_t mtime, int64_t size, const std::vector<float>& descriptor)
+{
+  Entry& entry = m_Entries[imagePath];
+  entry.mtime = mtime;
+  entry.size = size;
+  entry.descriptor = descriptor;
+  m_Changed = true;
+}
+
+static float
+squaredDistance(const std::vector<float>& a, const std::vector<float>& b)
+{
+  float sum = 0.0f;
+  for (size_t k = 0; k < a.size(); ++k) {
+    sum += (a[k] - b[k]) * (a[k] - b[k]);
+  }
+  return sum;
+}
+
+std::vector<size_t>
+farthestPointSample(const std::vector<std::vector<float>>& descriptors, size_t count)
+{
+  std::vector<size_t> valid;
+  for (size_t i = 0; i < descriptors.size(); ++i) {
+    if (!descriptors[i].empty()) {
+      valid.push_back(i);
+    }
+  }
+  if (valid.size() <= count) {
+    return valid;
+  }
+
+  std::vector<float> mean(descriptors[valid[0]].size(), 0.0f);
+  for (size_t i : valid) {
+    for (size_t k = 0; k < mean.size(); ++k) {
+      mean[k] += descriptors[i][k] / valid.size();
+    }
+  }
+
+  // minDistance[j]：valid[j] 到已选集合的最小距离，已选的为 -1
+  std::vector<float> minDistance(valid.size());
+  for (size_t j = 0; j < valid.size(); ++j) {
+    minDistance[j] = squaredDistance(descriptors[valid[j]], mean);
+  }
+  size_t next = std::min_element(minDistance.begin(), minDistance.end()) - minDistance.begin();
+  std::fill(minDistance.begin(), minDistance.end(), std::numeric_limits<float>::max());
+
+  std::vector<size_t> selected;
+  while (selected.size() < count) {
+    selected.push_back(valid[next]);
+    minDistance[next] = -1.0f;
+    const std::vector<float>& chosen = descriptors[valid[next]];
+    for (size_t j = 0; j < valid.size(); ++j) {
+      if (minDistance[j] >= 0.0f) {
+        minDistance[j] = std::min(minDistance[j], squaredDistance(descriptors[valid[j]], chosen));
+      }
+    }
+    next = std::max_element(minDistance.begin(), minDistance.end()) - minDistance.begin();
+  }
+
+  std::sort(selected.begin(), selected.end());
+  return selected;
+}
@@ -0,0 +1,39 @@
+#ifndef __CALIBRATION_SUBSET_H__
+#define __CALIBRATION_SUBSET_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// 校准图片描述子的缓存，按图片路径、修改时间和大小命中；文本文件每行为 "mtime size v0 v1 ...\t路径"
+class DescriptorCache {
+  public:
+    // 文件不存在或格式不对时从空缓存开始
+    void load(const std::string& filePath, size_t descriptorSize);
+
+    bool save(const std::string& filePath) const;
+
+    bool find(const std::string& imagePath, int64_t mtime, int64_t size, std::vector<float>& descriptor) const;
+
+    void put(const std::string& imagePath, int64_t mtime, int64_t size, const std::vector<float>& descriptor);
+
+    bool changed() const { return m_Changed; }
+
+  private:
+    struct Entry
+    {
+      int64_t mtime;
+      int64_t size;
+      std::vector<float> descriptor;
+    };
+
+    std::map<std::string, Entry> m_Entries;
+    bool m_Changed {false};
+};
+
+// 最远点采样：从最接近平均值的描述子开始，每次加入与已选集合最小欧氏距离最大的一个，直到 count 个；
+// 空描述子（读取失败的图片）不参与。返回按原顺序排列的下标
+std::vector<size_t> farthestPointSample(const std::vector<std::vector<float>>& descriptors, size_t count);
+
+#endif
@@ -1,14 +1,23 @@
 #include "calibrator.h"
 
+#include <cmath>
 #include <fstream>
-#include <iterator>
+#include <thread>
+
+#include <sys/stat.h>
+
+#include "calibration_subset.h"
+#include "engine_cache.h"
+#include "image_packing.h"
+#include "worker_pool.h"
 
 // INT8 校准器构造函数
 Int8EntropyCalibrator2::Int8EntropyCalibrator2(const int& batchSize, const int& channels, const int& height,
-    const int& width, const float& scaleFactor, const float* offsets, const int& inputFormat,
-    const std::string& imgPath, const std::string& calibTablePath) : batchSize(batchSize), inputC(channels),
-    inputH(height), inputW(width), scaleFactor(scaleFactor), offsets(offsets), inputFormat(inputFormat),
-    calibTablePath(calibTablePath), imageIndex(0)
+    const int& width, const float& scaleFactor, const float* offsets, const int& inputFormat, const int& letterBox,
+    const int& symmetricPadding, const std::string& imgPath, const std::string& calibTablePath,
+    const bool& readCalibTable) : batchSize(batchSize), inputC(channels), inputH(height), inputW(width),
+    letterBox(letterBox), symmetricPadding(symmetricPadding), scaleFactor(scaleFactor), offsets(offsets),
+    inputFormat(inputFormat), calibTablePath(calibTablePath), readCache(readCalibTable)
 {
   // 计算输入数据总大小
   inputCount = batchSize * channels * height * width;
@@ -20,8 +29,15 @@ Int8EntropyCalibrator2::Int8EntropyCalibrator2(const int& batchSize, const int&
         imgPaths.push_back(temp);
       }
   }
-  // 分配 batch 数据内存
-  batchData = new float[inputCount];
+  // INT8_CALIB_IMAGES 小于图片数时只用按多样性选出的子集校准（向上取整到 batch 的倍数）
+  if (getenv("INT8_CALIB_IMAGES")) {
+    size_t count = (std::max(atoi(getenv("INT8_CALIB_IMAGES")), 1) + batchSize - 1) / batchSize * batchSize;
+    if (count < imgPaths.size()) {
+      size_t total = imgPaths.size();
+      imgPaths = selectCalibrationImages(imgPaths, count, imgPath + ".descriptors");
+      std::cout << "Calibrating with " << imgPaths.size() << " of " << total << " images" << std::endl;
+    }
+  }
   // 在 GPU 上分配输入数据缓冲区
   CUDA_CHECK(cudaMalloc(&deviceInput, inputCount * sizeof(float)));
 }
@@ -29,10 +45,8 @@ Int8EntropyCalibrator2::Int8EntropyCalibrator2(const int& batchSize, const int&
 // 析构函数，释放 CUDA 资源和分配的内存
 Int8EntropyCalibrator2::~Int8EntropyCalibrator2()
 {
+  prefetcher.reset();
   CUDA_CHECK(cudaFree(deviceInput));
-  if (batchData) {
-    delete[] batchData;
-  }
 }
 
 // 获取 batch 大小
@@ -42,52 +56,111 @@ Int8EntropyCalibrator2::getBatchSize() const noexcept
   return batchSize;
 }
 
-// 读取 batch 数据并拷贝到 GPU
-bool
-Int8EntropyCalibrator2::getBatch(void** bindings, const char** names, int nbBindings) noexcept
+// 开始校准：INT8_CALIB_CACHE_DIR 中有相同图片和预处理参数的缓存时直接映射，否则解码和预处理图片并写入缓存
+void
+Int8EntropyCalibrator2::startBatches()
 {
-  if (imageIndex + batchSize > uint(imgPaths.size())) {
-    return false;
+  size_t imageElements = inputCount / batchSize;
+  batchCount = imgPaths.size() / batchSize;
+  calibrationStart = std::chrono::steady_clock::now();
+
+  std::string cachePath;
+  uint64_t key = 0;
+  if (getenv("INT8_CALIB_CACHE_DIR") && calibrationCacheKey(imgPaths, inputC, inputH, inputW, scaleFactor, offsets,
+      inputFormat, letterBox, symmetricPadding, key)) {
+    cachePath = std::string(getenv("INT8_CALIB_CACHE_DIR")) + "/calib_" + hashToString(key) + ".bin";
+    if (batchCache.open(cachePath, key, imageElements, batchCount * batchSize)) {
+      std::cout << "Using preprocessed calibration inputs from " << cachePath << std::endl;
+      return;
+    }
+    cacheWriter.begin(cachePath, key, imageElements);
   }
 
-  float* ptr = batchData;
-  for (size_t i = imageIndex; i < imageIndex + batchSize; ++i) {
-    // 读取图片
-    cv::Mat img = cv::imread(imgPaths[i]);
-    if (img.empty()){
-      std::cerr << "Failed to read image for calibration" << std::endl;
+  // INT8_CALIB_PREFETCH 为提前准备的 batch 数，主机缓冲区为锁页内存
+  int ahead = getenv("INT8_CALIB_PREFETCH") ? std::max(atoi(getenv("INT8_CALIB_PREFETCH")), 1) : 2;
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  BatchPrefetcher::LoadItem load = [this](size_t item, float* data) {
+    cv::Mat img = cv::imread(imgPaths[item]);
+    if (img.empty()) {
+      std::cerr << "Failed to read image for calibration: " << imgPaths[item] << std::endl;
       return false;
     }
-  
-    // 预处理图片
-    std::vector<float> inputData = prepareImage(img, inputC, inputH, inputW, scaleFactor, offsets, inputFormat);
-
-    size_t len = inputData.size();
-    memcpy(ptr, inputData.data(), len * sizeof(float));
-    ptr += inputData.size();
+    if (!preprocessImage(img, inputC, inputH, inputW, scaleFactor, offsets, inputFormat, letterBox, symmetricPadding,
+        data)) {
+      std::cerr << "Unexpected input size for calibration image " << imgPaths[item] << std::endl;
+      return false;
+    }
+    return true;
+  };
+  BatchPrefetcher::Allocate allocate = [](size_t elements) {
+    void* buffer = nullptr;
+    CUDA_CHECK(cudaMallocHost(&buffer, elements * sizeof(float)));
+    return static_cast<float*>(buffer);
+  };
+  BatchPrefetcher::Release release = [](float* buffer) {
+    CUDA_CHECK(cudaFreeHost(buffer));
+  };
+  prefetcher.reset(new BatchPrefetcher(imgPaths.size(), batchSize, imageElements, ahead, threads, load, allocate,
+      release));
+}
 
-    std::cout << "Load image: " << imgPaths[i] << std::endl;
-    std::cout << "Progress: " << (i + 1) * 100. / imgPaths.size() << "%" << std::endl;
+// 读取 batch 数据并拷贝到 GPU：使用缓存时直接取映射中的下一段，否则等待后台线程准备好的 batch
+bool
+Int8EntropyCalibrator2::getBatch(void** bindings, const char** names, int nbBindings) noexcept
+{
+  // 第一次取 batch 时才开始（使用校准表时 TensorRT 不会调用 getBatch）
+  if (!prefetcher && !batchCache.isOpen()) {
+    startBatches();
   }
 
-  imageIndex += batchSize;
+  const float* batch = nullptr;
+  if (batchCache.isOpen()) {
+    batch = batchIndex < batchCount ? batchCache.items(batchIndex * batchSize) : nullptr;
+  }
+  else {
+    batch = prefetcher->next();
+    // 全部 batch 都成功读取后缓存才生效
+    if (batch == nullptr && !prefetcher->failed() && cacheWriter.isActive() && cacheWriter.commit()) {
+      std::cout << "Saved preprocessed calibration inputs for later builds" << std::endl;
+    }
+    else if (batch == nullptr) {
+      cacheWriter.abort();
+    }
+    else if (cacheWriter.isActive()) {
+      cacheWriter.append(batch, batchSize);
+    }
+  }
+  if (batch == nullptr) {
+    return false;
+  }
+  ++batchIndex;
 
   // 将数据拷贝到 GPU
-  CUDA_CHECK(cudaMemcpy(deviceInput, batchData, inputCount * sizeof(float), cudaMemcpyHostToDevice));
+  CUDA_CHECK(cudaMemcpy(deviceInput, batch, inputCount * sizeof(float), cudaMemcpyHostToDevice));
   bindings[0] = deviceInput;
 
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - calibrationStart).count();
+  std::cout << "Calibration batch " << batchIndex << "/" << batchCount << " (" <<
+      batchIndex * batchSize / std::max(seconds, 1e-3) << " images/s)" << std::endl;
+
   return true;
 }
 
-// 读取校准缓存
+// 读取校准表，整个文件一次读入
 const void*
 Int8EntropyCalibrator2::readCalibrationCache(std::size_t &length) noexcept
 {
   calibrationCache.clear();
-  std::ifstream input(calibTablePath, std::ios::binary);
-  input >> std::noskipws;
+  std::ifstream input(calibTablePath, std::ios::binary | std::ios::ate);
   if (readCache && input.good()) {
-    std::copy(std::istream_iterator<char>(input), std::istream_iterator<char>(), std::back_inserter(calibrationCache));
+    std::streamoff size = input.tellg();
+    if (size > 0) {
+      calibrationCache.resize(size);
+      input.seekg(0);
+      if (!input.read(calibrationCache.data(), size)) {
+        calibrationCache.clear();
+      }
+    }
   }
   length = calibrationCache.size();
   return length ? calibrationCache.data() : nullptr;
@@ -132,12 +205,12 @@ prepareImage(cv::Mat& img, int inputC, int inputH, int inputW, float scaleFactor
   // 转换为 float 类型，并应用缩放因子
   out.convertTo(out, CV_32F, scaleFactor);
 
-  // 减去均值
+  // 减去均值（与 nvinfer 相同，为 scaleFactor * (x - offset)）
   if (inputFormat == 2) {
-    cv::subtract(out, cv::Scalar(offsets[0] / 255), out);
+    cv::subtract(out, cv::Scalar(offsets[0] * scaleFactor), out);
   }
   else {
-    cv::subtract(out, cv::Scalar(offsets[0] / 255, offsets[1] / 255, offsets[3] / 255), out);
+    cv::subtract(out, cv::Scalar(offsets[0] * scaleFactor, offsets[1] * scaleFactor, offsets[2] * scaleFactor), out);
   }
 
   // 将图片数据拆分到多个通道，并存入 float 数组
@@ -154,3 +227,129 @@ prepareImage(cv::Mat& img, int inputC, int inputH, int inputW, float scaleFactor
   return result;
 }
 
+bool
+preprocessImage(const cv::Mat& img, int inputC, int inputH, int inputW, float scaleFactor, const float* offsets,
+    int inputFormat, int letterBox, int symmetricPadding, float* output)
+{
+  // 灰度在缩放前转换（与 prepareImage 相同）；RGB 的通道交换与缩放可交换，放到打包时完成
+  cv::Mat image = img;
+  if (inputFormat == 2 && img.channels() == 3) {
+    cv::cvtColor(img, image, cv::COLOR_BGR2GRAY);
+  }
+  if (image.channels() != inputC || image.depth() != CV_8U) {
+    return false;
+  }
+
+  ImagePlacement placement;
+  placement.width = inputW;
+  placement.height = inputH;
+  cv::Mat resized = image;
+  if (letterBox) {
+    placement = letterboxPlacement(image.cols, image.rows, inputW, inputH, symmetricPadding);
+    if (image.cols != placement.width || image.rows != placement.height) {
+      cv::resize(image, resized, cv::Size(placement.width, placement.height), 0, 0, cv::INTER_CUBIC);
+    }
+  }
+  else if (image.cols != inputW || image.rows != inputH) {
+    float resizeFactor = std::max(inputW / (float) image.cols, inputH / (float) image.rows);
+    cv::resize(image, resized, cv::Size(0, 0), resizeFactor, resizeFactor, cv::INTER_CUBIC);
+    cv::Rect crop(cv::Point(0.5 * (resized.cols - inputW), 0.5 * (resized.rows - inputH)), cv::Size(inputW, inputH));
+    resized = resized(crop);
+  }
+
+  packImagePlanar(resized.data, resized.step, inputC, inputFormat == 0, inputW, inputH, placement, scaleFactor,
+      offsets, output);
+  return true;
+}
+
+std::vector<float>
+imageDescriptor(const cv::Mat& img)
+{
+  const int kSize = 64;
+  cv::Mat bgr;
+  if (img.channels() == 1) {
+    cv::cvtColor(img, bgr, cv::COLOR_GRAY2BGR);
+  }
+  else {
+    bgr = img;
+  }
+  cv::Mat small;
+  cv::resize(bgr, small, cv::Size(kSize, kSize), 0, 0, cv::INTER_AREA);
+  cv::Mat gray;
+  cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+
+  std::vector<float> descriptor(64 + 1 + 16, 0.0f);
+
+  // 颜色直方图取平方根后欧氏距离即 Hellinger 距离，范围 [0, sqrt(2)]
+  for (int y = 0; y < kSize; ++y) {
+    const cv::Vec3b* row = small.ptr<cv::Vec3b>(y);
+    for (int x = 0; x < kSize; ++x) {
+      descriptor[(row[x][0] >> 6) * 16 + (row[x][1] >> 6) * 4 + (row[x][2] >> 6)] += 1.0f;
+    }
+  }
+  for (int k = 0; k < 64; ++k) {
+    descriptor[k] = std::sqrt(descriptor[k] / (kSize * kSize));
+  }
+
+  cv::Mat edges;
+  cv::Canny(gray, edges, 50, 150);
+  descriptor[64] = (float) cv::countNonZero(edges) / (kSize * kSize);
+
+  // 亮度布局乘 0.25，使 16 个格子的最大距离与直方图相当
+  cv::Mat grid;
+  cv::resize(gray, grid, cv::Size(4, 4), 0, 0, cv::INTER_AREA);
+  for (int k = 0; k < 16; ++k) {
+    descriptor[65 + k] = grid.at<uchar>(k / 4, k % 4) / 255.0f * 0.25f;
+  }
+  return descriptor;
+}
+
+std::vector<std::string>
+selectCalibrationImages(const std::vector<std::string>& imagePaths, size_t count, const std::string& cachePath)
+{
+  size_t descriptorSize = imageDescriptor(cv::Mat(1, 1, CV_8UC3, cv::Scalar(0, 0, 0))).size();
+  DescriptorCache cache;
+  cache.load(cachePath, descriptorSize);
+
+  // 缓存中没有的图片以 1/4 分辨率解码后并行计算描述子
+  std::vector<std::vector<float>> descriptors(imagePaths.size());
+  std::vector<struct stat> stats(imagePaths.size());
+  std::vector<size_t> missing;
+  size_t cached = 0;
+  for (size_t i = 0; i < imagePaths.size(); ++i) {
+    if (stat(imagePaths[i].c_str(), &stats[i]) != 0) {
+      std::cerr << "Failed to read image for calibration: " << imagePaths[i] << std::endl;
+    }
+    else if (cache.find(imagePaths[i], stats[i].st_mtime, stats[i].st_size, descriptors[i])) {
+      ++cached;
+    }
+    else {
+      missing.push_back(i);
+    }
+  }
+  parallelFor(missing.size(), std::max(1u, std::thread::hardware_concurrency()), [&](size_t job) {
+    size_t i = missing[job];
+    cv::Mat img = cv::imread(imagePaths[i], cv::IMREAD_REDUCED_COLOR_4);
+    if (!img.empty()) {
+      descriptors[i] = imageDescriptor(img);
+    }
+  });
+  for (size_t i : missing) {
+    if (descriptors[i].empty()) {
+      std::cerr << "Failed to read image for calibration: " << imagePaths[i] << std::endl;
+      continue;
+    }
+    cache.put(imagePaths[i], stats[i].st_mtime, stats[i].st_size, descriptors[i]);
+  }
+  if (cache.changed() && !cache.save(cachePath)) {
+    std::cerr << "Could not write the calibration descriptor cache " << cachePath << std::endl;
+  }
+  std::cout << "Calibration image descriptors: " << cached << " cached, " <<
+      missing.size() << " computed" << std::endl;
+
+  std::vector<std::string> selected;
+  for (size_t i : farthestPointSample(descriptors, count)) {
+    selected.push_back(imagePaths[i]);
+  }
+  return selected;
+}
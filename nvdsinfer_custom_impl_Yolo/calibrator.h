@@ -6,12 +6,17 @@
 #ifndef CALIBRATOR_H
 #define CALIBRATOR_H
 
+#include <chrono>
+#include <memory>
 #include <vector>
 #include <cuda_runtime_api.h>
 
 #include "NvInfer.h"
 #include "opencv2/opencv.hpp"
 
+#include "batch_prefetcher.h"
+#include "calibration_cache.h"
+
 #define CUDA_CHECK(status) {                                                                                           \
   if (status != 0) {                                                                                                   \
     std::cout << "CUDA failure: " << cudaGetErrorString(status) << " in file " << __FILE__  << " at line "  <<         \
@@ -23,8 +28,9 @@
 class Int8EntropyCalibrator2 : public nvinfer1::IInt8EntropyCalibrator2 {
   public:
     Int8EntropyCalibrator2(const int& batchSize, const int& channels, const int& height, const int& width,
-        const float& scaleFactor, const float* offsets, const int& inputFormat, const std::string& imgPath,
-        const std::string& calibTablePath);
+        const float& scaleFactor, const float* offsets, const int& inputFormat, const int& letterBox,
+        const int& symmetricPadding, const std::string& imgPath, const std::string& calibTablePath,
+        const bool& readCalibTable = true);
 
     virtual ~Int8EntropyCalibrator2();
 
@@ -37,25 +43,45 @@ class Int8EntropyCalibrator2 : public nvinfer1::IInt8EntropyCalibrator2 {
     void writeCalibrationCache(const void* cache, size_t length) noexcept override;
 
   private:
+    void startBatches();
+
     int batchSize;
     int inputC;
     int inputH;
     int inputW;
     int letterBox;
+    int symmetricPadding;
     float scaleFactor;
     const float* offsets;
     int inputFormat;
     std::string calibTablePath;
-    size_t imageIndex;
     size_t inputCount;
     std::vector<std::string> imgPaths;
-    float* batchData {nullptr};
+    std::unique_ptr<BatchPrefetcher> prefetcher;
+    CalibrationCache batchCache;
+    CalibrationCacheWriter cacheWriter;
+    size_t batchCount {0};
+    size_t batchIndex {0};
+    std::chrono::steady_clock::time_point calibrationStart;
     void* deviceInput {nullptr};
-    bool readCache;
+    bool readCache {true};
     std::vector<char> calibrationCache;
 };
 
 std::vector<float> prepareImage(cv::Mat& img, int inputC, int inputH, int inputW, float scaleFactor,
     const float* offsets, int inputFormat);
 
+// 与 prepareImage 相同的预处理，缩放之后的颜色转换、归一化和 HWC 到 CHW 在一次遍历中直接写入 output；
+// letterBox 时按 maintain-aspect-ratio=1（symmetricPadding 对应 symmetric-padding）缩放和填充，否则等比放大后居中裁剪。
+// 图片通道数与 inputC 不符时返回 false
+bool preprocessImage(const cv::Mat& img, int inputC, int inputH, int inputW, float scaleFactor, const float* offsets,
+    int inputFormat, int letterBox, int symmetricPadding, float* output);
+
+// 校准图片的描述子：64x64 缩略图上的 4x4x4 BGR 直方图（取平方根）、Canny 边缘密度和 4x4 亮度布局
+std::vector<float> imageDescriptor(const cv::Mat& img);
+
+// 按描述子的多样性从 imagePaths 中选出 count 张（最远点采样），描述子缓存在 cachePath 中供下次使用
+std::vector<std::string> selectCalibrationImages(const std::vector<std::string>& imagePaths, size_t count,
+    const std::string& cachePath);
+
 #endif //CALIBRATOR_H
@@ -0,0 +1,63 @@
+#include "detection_publisher.h"
+
+DetectionPublisher::DetectionPublisher(size_t queueDepth, Publish publish) : m_Queue(queueDepth),
+    m_Publish(publish), m_Published(0), m_Waiting(false), m_Stop(false)
+{
+  m_Thread = std::thread(&DetectionPublisher::run, this);
+}
+
+DetectionPublisher::~DetectionPublisher()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stop = true;
+  }
+  m_Wake.notify_one();
+  m_Thread.join();
+}
+
+FrameDetections*
+DetectionPublisher::begin()
+{
+  FrameDetections* frame = m_Queue.acquire();
+  if (frame != nullptr) {
+    frame->count = 0;
+    frame->truncated = 0;
+  }
+  return frame;
+}
+
+void
+DetectionPublisher::commit(FrameDetections* frame)
+{
+  m_Queue.push(frame);
+  // 发布线程先置 m_Waiting 再检查队列，这里先入队再检查 m_Waiting，两侧的 fence 保证至少有一方看到对方
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_Waiting.load()) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Wake.notify_one();
+  }
+}
+
+void
+DetectionPublisher::run()
+{
+  while (true) {
+    FrameDetections* frame = m_Queue.pop();
+    if (frame != nullptr) {
+      m_Publish(*frame);
+      m_Queue.release(frame);
+      m_Published.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Waiting.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_Wake.wait(lock, [this]() { return m_Stop.load() || !m_Queue.empty(); });
+    m_Waiting.store(false);
+    if (m_Stop.load() && m_Queue.empty()) {
+      return;
+    }
+  }
+}
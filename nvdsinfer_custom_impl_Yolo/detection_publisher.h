@@ -0,0 +1,86 @@
+#ifndef __DETECTION_PUBLISHER_H__
+#define __DETECTION_PUBLISHER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+
+#include "drop_oldest_queue.h"
+
+// 一个检测目标，坐标为输出画面的像素
+struct DetectionRecord
+{
+  int32_t classId;
+  float confidence;
+  float left;
+  float top;
+  float width;
+  float height;
+  char label[48];               // obj_label，超长截断
+};
+
+// 一帧的全部检测结果，大小固定，超过 kMaxFrameDetections 的目标只计入 truncated
+struct FrameDetections
+{
+  static const uint32_t kMaxFrameDetections = 256;
+
+  uint64_t frameNumber;
+  uint64_t timestamp;           // 帧的 PTS（纳秒）
+  uint64_t systemTime;          // probe 处理该帧时的系统时间（CLOCK_REALTIME，纳秒）
+  uint32_t sourceId;
+  uint32_t count;
+  uint32_t truncated;
+  DetectionRecord objects[kMaxFrameDetections];
+
+  // 追加一个目标；已有 kMaxFrameDetections 个时只计入 truncated，返回 nullptr
+  DetectionRecord* add()
+  {
+    if (count == kMaxFrameDetections) {
+      ++truncated;
+      return nullptr;
+    }
+    return &objects[count++];
+  }
+};
+
+// 把 OSD probe 产生的逐帧检测结果交给独立的发布线程：probe 在预先分配的 FrameDetections 中填写后提交，
+// 不做任何分配或阻塞的调用；发布线程依次调用 publish。发布跟不上时丢弃最旧的帧，probe 永远不等待
+class DetectionPublisher {
+  public:
+    typedef std::function<void(const FrameDetections& frame)> Publish;
+
+    DetectionPublisher(size_t queueDepth, Publish publish);
+
+    // 发布完队列中剩余的帧后结束发布线程
+    ~DetectionPublisher();
+
+    // 以下两个函数只能在同一个线程（probe 所在的流线程）中调用。begin 返回 nullptr 时本帧不发布
+    FrameDetections* begin();
+
+    void commit(FrameDetections* frame);
+
+    uint64_t published() const { return m_Published.load(std::memory_order_relaxed); }
+
+    uint64_t dropped() const { return m_Queue.dropped(); }
+
+  private:
+    DetectionPublisher(const DetectionPublisher&);
+    DetectionPublisher& operator=(const DetectionPublisher&);
+
+    void run();
+
+    DropOldestQueue<FrameDetections> m_Queue;
+    Publish m_Publish;
+    std::atomic<uint64_t> m_Published;
+    // 发布线程没有数据可处理时才进入等待，probe 只在发布线程等待时加锁唤醒它
+    std::atomic<bool> m_Waiting;
+    std::atomic<bool> m_Stop;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::thread m_Thread;
+};
+
+#endif
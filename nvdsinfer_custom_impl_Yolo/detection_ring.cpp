@@ -0,0 +1,401 @@
+#include "detection_ring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace detection_ring;
+
+namespace {
+
+const char kMagic[8] = {'Y', 'O', 'L', 'O', 'D', 'E', 'T', '1'};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+    "the ring needs address-free (lock-free) atomics to be shared between processes");
+
+size_t
+slotsOffset()
+{
+  return (sizeof(Header) + sizeof(Slot) - 1) / sizeof(Slot) * sizeof(Slot);
+}
+
+size_t
+mappingSize(uint64_t capacity)
+{
+  return slotsOffset() + capacity * sizeof(Slot);
+}
+
+uint64_t
+monotonicUs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// 共享内存中的 futex 不能使用 FUTEX_PRIVATE_FLAG
+void
+futexWait(std::atomic<uint32_t>* word, uint32_t expected, int64_t timeoutUs)
+{
+  struct timespec timeout;
+  timeout.tv_sec = timeoutUs / 1000000;
+  timeout.tv_nsec = (timeoutUs % 1000000) * 1000;
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, timeoutUs < 0 ? nullptr : &timeout,
+      nullptr, 0);
+}
+
+void
+futexWakeAll(std::atomic<uint32_t>* word)
+{
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// 检查文件头并映射全部槽位；失败时 error 说明原因
+bool
+mapRing(int fd, const std::string& name, Header*& header, Slot*& slots, size_t& size, std::string& error)
+{
+  struct stat st;
+  Header probe;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header) ||
+      pread(fd, &probe, offsetof(Header, writeSequence), 0) != (ssize_t) offsetof(Header, writeSequence)) {
+    error = name + " is not a detection ring";
+    return false;
+  }
+  if (memcmp(probe.magic, kMagic, sizeof(kMagic)) != 0 || probe.version != kVersion ||
+      probe.recordSize != sizeof(DetectionShmRecord) || probe.capacity == 0 ||
+      (probe.capacity & (probe.capacity - 1)) != 0 || (size_t) st.st_size != mappingSize(probe.capacity)) {
+    error = name + " has an incompatible detection ring layout";
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    error = "could not map " + name + ": " + strerror(errno);
+    return false;
+  }
+  header = static_cast<Header*>(mapping);
+  slots = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + slotsOffset());
+  size = st.st_size;
+  return true;
+}
+
+}
+
+DetectionRingWriter::DetectionRingWriter() : m_Header(nullptr), m_Slots(nullptr), m_MappingSize(0), m_Sequence(0)
+{
+}
+
+DetectionRingWriter::~DetectionRingWriter()
+{
+  close();
+}
+
+bool
+DetectionRingWriter::open(const std::string& name, uint64_t capacity, std::string& error)
+{
+  close();
+
+  uint64_t rounded = 1;
+  while (rounded < std::max<uint64_t>(capacity, 2)) {
+    rounded <<= 1;
+  }
+
+  // 已有同样大小的环时直接接着写，已连接的读取方不受写入方重启的影响
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd >= 0) {
+    std::string mapError;
+    bool reuse = mapRing(fd, name, m_Header, m_Slots, m_MappingSize, mapError) && m_Header->capacity == rounded;
+    ::close(fd);
+    if (reuse) {
+      m_Sequence = m_Header->writeSequence.load(std::memory_order_acquire);
+      m_Name = name;
+      return true;
+    }
+    if (m_Header != nullptr) {
+      munmap(m_Header, m_MappingSize);
+      m_Header = nullptr;
+    }
+    // 大小不同或不是检测环：删除旧的名字后新建，仍映射着旧对象的读取方不会访问越界，重新打开后读新的环
+    shm_unlink(name.c_str());
+  }
+
+  fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+  if (fd < 0) {
+    error = "could not create shared memory " + name + ": " + strerror(errno);
+    return false;
+  }
+  m_MappingSize = mappingSize(rounded);
+  void* mapping = MAP_FAILED;
+  if (ftruncate(fd, m_MappingSize) == 0) {
+    mapping = mmap(nullptr, m_MappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (mapping == MAP_FAILED) {
+    error = "could not size shared memory " + name + ": " + strerror(errno);
+    ::close(fd);
+    shm_unlink(name.c_str());
+    m_MappingSize = 0;
+    return false;
+  }
+  ::close(fd);
+
+  // 新建的共享内存全为 0：序号、槽位和读取方都处于初始状态，最后写入魔数，之前打开的读取方会被拒绝
+  m_Header = static_cast<Header*>(mapping);
+  m_Slots = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + slotsOffset());
+  m_Header->version = kVersion;
+  m_Header->recordSize = sizeof(DetectionShmRecord);
+  m_Header->capacity = rounded;
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(m_Header->magic, kMagic, sizeof(kMagic));
+
+  m_Sequence = 0;
+  m_Name = name;
+  return true;
+}
+
+void
+DetectionRingWriter::close(bool unlinkName)
+{
+  if (m_Header != nullptr) {
+    munmap(m_Header, m_MappingSize);
+    if (unlinkName) {
+      shm_unlink(m_Name.c_str());
+    }
+  }
+  m_Header = nullptr;
+  m_Slots = nullptr;
+  m_MappingSize = 0;
+  m_Sequence = 0;
+}
+
+void
+DetectionRingWriter::writeRecord(const DetectionShmRecord& record)
+{
+  Slot& slot = m_Slots[m_Sequence & (m_Header->capacity - 1)];
+  uint64_t words[kRecordWords];
+  memcpy(words, &record, sizeof(record));
+
+  slot.sequence.store(2 * m_Sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (int i = 0; i < kRecordWords; ++i) {
+    slot.words[i].store(words[i], std::memory_order_relaxed);
+  }
+  slot.sequence.store(2 * m_Sequence + 2, std::memory_order_release);
+  ++m_Sequence;
+}
+
+void
+DetectionRingWriter::publish()
+{
+  m_Header->writeSequence.store(m_Sequence, std::memory_order_release);
+  // 读取方先增加 waiters 再读取 notify 和检查数据，这里先增加 notify 再检查 waiters，两者至少有一方看到对方
+  m_Header->notify.fetch_add(1);
+  if (m_Header->waiters.load() > 0) {
+    futexWakeAll(&m_Header->notify);
+  }
+}
+
+void
+DetectionRingWriter::write(const DetectionShmRecord* records, size_t count)
+{
+  if (m_Header == nullptr) {
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    writeRecord(records[i]);
+  }
+  publish();
+}
+
+void
+DetectionRingWriter::write(const FrameDetections& frame)
+{
+  if (m_Header == nullptr) {
+    return;
+  }
+  DetectionShmRecord record;
+  memset(&record, 0, sizeof(record));
+  record.frameNumber = frame.frameNumber;
+  record.timestamp = frame.timestamp;
+  record.systemTime = frame.systemTime;
+  record.sourceId = frame.sourceId;
+  record.count = std::min<uint32_t>(frame.count, UINT16_MAX);
+  if (frame.count == 0) {
+    writeRecord(record);
+  }
+  for (uint32_t i = 0; i < record.count; ++i) {
+    const DetectionRecord& object = frame.objects[i];
+    record.index = i;
+    record.classId = object.classId;
+    record.confidence = object.confidence;
+    record.left = object.left;
+    record.top = object.top;
+    record.width = object.width;
+    record.height = object.height;
+    strncpy(record.label, object.label, sizeof(record.label) - 1);
+    writeRecord(record);
+  }
+  publish();
+}
+
+std::vector<std::pair<int, uint64_t>>
+DetectionRingWriter::readers() const
+{
+  std::vector<std::pair<int, uint64_t>> result;
+  if (m_Header == nullptr) {
+    return result;
+  }
+  for (const ReaderSlot& reader : m_Header->readers) {
+    int pid = reader.pid.load(std::memory_order_acquire);
+    if (pid != 0) {
+      result.push_back(std::make_pair(pid, reader.sequence.load(std::memory_order_relaxed)));
+    }
+  }
+  return result;
+}
+
+DetectionRingReader::DetectionRingReader() : m_Header(nullptr), m_Slots(nullptr), m_MappingSize(0), m_ReaderSlot(-1),
+    m_Sequence(0), m_Lost(0)
+{
+}
+
+DetectionRingReader::~DetectionRingReader()
+{
+  close();
+}
+
+bool
+DetectionRingReader::open(const std::string& name, std::string& error, bool fromOldest)
+{
+  close();
+
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    error = "could not open shared memory " + name + ": " + strerror(errno);
+    return false;
+  }
+  bool mapped = mapRing(fd, name, m_Header, m_Slots, m_MappingSize, error);
+  ::close(fd);
+  if (!mapped) {
+    m_Header = nullptr;
+    return false;
+  }
+
+  uint64_t written = m_Header->writeSequence.load(std::memory_order_acquire);
+  m_Sequence = fromOldest && written > m_Header->capacity ? written - m_Header->capacity : fromOldest ? 0 : written;
+  m_Lost = 0;
+
+  // 注册读取方：占用空闲的位置，或已经退出的进程留下的位置
+  int pid = getpid();
+  for (int i = 0; i < kMaxReaders && m_ReaderSlot < 0; ++i) {
+    ReaderSlot& reader = m_Header->readers[i];
+    int32_t owner = reader.pid.load(std::memory_order_acquire);
+    if (owner != 0 && (kill(owner, 0) == 0 || errno != ESRCH)) {
+      continue;
+    }
+    if (reader.pid.compare_exchange_strong(owner, pid)) {
+      reader.sequence.store(m_Sequence, std::memory_order_relaxed);
+      m_ReaderSlot = i;
+    }
+  }
+  if (m_ReaderSlot < 0) {
+    error = name + " already has " + std::to_string(kMaxReaders) + " readers";
+    close();
+    return false;
+  }
+  return true;
+}
+
+void
+DetectionRingReader::close()
+{
+  if (m_Header != nullptr) {
+    if (m_ReaderSlot >= 0) {
+      m_Header->readers[m_ReaderSlot].pid.store(0, std::memory_order_release);
+    }
+    munmap(m_Header, m_MappingSize);
+  }
+  m_Header = nullptr;
+  m_Slots = nullptr;
+  m_MappingSize = 0;
+  m_ReaderSlot = -1;
+  m_Sequence = 0;
+}
+
+bool
+DetectionRingReader::tryRead(DetectionShmRecord& record)
+{
+  uint64_t capacity = m_Header->capacity;
+  while (true) {
+    uint64_t written = m_Header->writeSequence.load(std::memory_order_acquire);
+    if (m_Sequence >= written) {
+      return false;
+    }
+    // 落后超过一圈：跳到最旧的可用记录
+    if (written - m_Sequence > capacity) {
+      m_Lost += written - capacity - m_Sequence;
+      m_Sequence = written - capacity;
+    }
+
+    Slot& slot = m_Slots[m_Sequence & (capacity - 1)];
+    uint64_t expected = 2 * m_Sequence + 2;
+    uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    uint64_t words[kRecordWords];
+    for (int i = 0; i < kRecordWords; ++i) {
+      words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+    if (before == expected && after == expected) {
+      memcpy(&record, words, sizeof(record));
+      ++m_Sequence;
+      m_Header->readers[m_ReaderSlot].sequence.store(m_Sequence, std::memory_order_relaxed);
+      return true;
+    }
+    // 槽位序号小于要读的记录只会在环被重新创建后出现，这时没有可读的数据
+    if (before < expected && after < expected) {
+      return false;
+    }
+    // 读取期间被写入方覆盖，跳过这条后重新计算位置
+    m_Lost += 1;
+    m_Sequence += 1;
+  }
+}
+
+bool
+DetectionRingReader::read(DetectionShmRecord& record, int64_t timeoutUs, int spinUs)
+{
+  uint64_t start = monotonicUs();
+  while (true) {
+    if (tryRead(record)) {
+      return true;
+    }
+    uint64_t elapsed = monotonicUs() - start;
+    if (timeoutUs >= 0 && (int64_t) elapsed >= timeoutUs) {
+      return false;
+    }
+    if ((int64_t) elapsed < spinUs) {
+      continue;
+    }
+
+    // 先登记等待并记下 notify，再检查一次数据，之后的写入一定会改变 notify 并看到 waiters
+    m_Header->waiters.fetch_add(1);
+    uint32_t notify = m_Header->notify.load();
+    if (tryRead(record)) {
+      m_Header->waiters.fetch_sub(1);
+      return true;
+    }
+    futexWait(&m_Header->notify, notify, timeoutUs < 0 ? -1 : std::max<int64_t>(timeoutUs - elapsed, 0));
+    m_Header->waiters.fetch_sub(1);
+  }
+}
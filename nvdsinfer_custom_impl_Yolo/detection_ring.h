@@ -0,0 +1,150 @@
+#ifndef __DETECTION_RING_H__
+#define __DETECTION_RING_H__
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "detection_publisher.h"
+
+// 共享内存中的一条检测记录，每个目标一条；没有目标的帧写一条 count 为 0 的记录，表示该帧已处理
+struct DetectionShmRecord
+{
+  uint64_t frameNumber;
+  uint64_t timestamp;           // 帧的 PTS（纳秒）
+  uint64_t systemTime;          // probe 处理该帧时的系统时间（CLOCK_REALTIME，纳秒）
+  uint32_t sourceId;
+  uint16_t index;               // 帧内序号
+  uint16_t count;               // 帧内目标数，同一帧的记录连续写入
+  int32_t classId;
+  float confidence;
+  float left;
+  float top;
+  float width;
+  float height;
+  char label[40];
+};
+
+static_assert(sizeof(DetectionShmRecord) == 96, "DetectionShmRecord must stay 96 bytes");
+
+// POSIX 共享内存中的单生产者/多消费者环形缓冲（一个写入方、任意多个读取方进程），写入方从不等待读取方。
+// 每个槽位有自己的序号（seqlock）：写入前为 2 * seq + 1，写完为 2 * seq + 2，读取方复制后再次检查序号，
+// 序号变化说明读取期间被覆盖。读取方各自维护读到的序号，落后超过容量时跳到最旧的可用记录并计入 lost。
+// 读取方可以自旋，也可以在 futex 上等待新数据；写入方只在有读取方等待时才进行唤醒的系统调用
+namespace detection_ring {
+
+const uint32_t kVersion = 1;
+const int kMaxReaders = 16;
+const int kRecordWords = sizeof(DetectionShmRecord) / sizeof(uint64_t);
+
+struct ReaderSlot
+{
+  std::atomic<int32_t> pid;     // 0 表示空闲
+  std::atomic<uint64_t> sequence;
+  char padding[48];
+};
+
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  uint64_t capacity;            // 2 的幂
+  char padding0[40];
+  std::atomic<uint64_t> writeSequence;    // 已写完的记录数，即下一条记录的序号
+  char padding1[56];
+  std::atomic<uint32_t> notify;           // futex，每次写入后加 1
+  std::atomic<uint32_t> waiters;
+  char padding2[56];
+  ReaderSlot readers[kMaxReaders];
+};
+
+struct Slot
+{
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint64_t> words[kRecordWords];
+  char padding[128 - 8 - sizeof(DetectionShmRecord)];
+};
+
+static_assert(sizeof(Slot) == 128, "Slot must be 128 bytes");
+
+}
+
+class DetectionRingWriter {
+  public:
+    DetectionRingWriter();
+
+    ~DetectionRingWriter();
+
+    // 创建（或重新使用同样大小的）共享内存 name（如 "/yolo_detections"），capacity 向上取整为 2 的幂
+    bool open(const std::string& name, uint64_t capacity, std::string& error);
+
+    // 删除共享内存名，已经打开的读取方不受影响
+    void close(bool unlinkName = false);
+
+    bool isOpen() const { return m_Header != nullptr; }
+
+    // 写入一帧的全部记录后唤醒等待的读取方；只能在一个线程中调用
+    void write(const FrameDetections& frame);
+
+    void write(const DetectionShmRecord* records, size_t count);
+
+    // 已注册的读取方（pid 和下一条要读的序号），用于查看读取方的延迟
+    std::vector<std::pair<int, uint64_t>> readers() const;
+
+    uint64_t sequence() const { return m_Sequence; }
+
+  private:
+    DetectionRingWriter(const DetectionRingWriter&);
+    DetectionRingWriter& operator=(const DetectionRingWriter&);
+
+    void writeRecord(const DetectionShmRecord& record);
+
+    void publish();
+
+    detection_ring::Header* m_Header;
+    detection_ring::Slot* m_Slots;
+    size_t m_MappingSize;
+    uint64_t m_Sequence;
+    std::string m_Name;
+};
+
+class DetectionRingReader {
+  public:
+    DetectionRingReader();
+
+    ~DetectionRingReader();
+
+    // 打开写入方创建的共享内存并注册为读取方；fromOldest 为 false 时只读之后写入的记录
+    bool open(const std::string& name, std::string& error, bool fromOldest = false);
+
+    void close();
+
+    bool isOpen() const { return m_Header != nullptr; }
+
+    // 读取下一条记录，没有新记录时立即返回 false
+    bool tryRead(DetectionShmRecord& record);
+
+    // 读取下一条记录：先自旋 spinUs 微秒，再在 futex 上等待，最多等待 timeoutUs 微秒（< 0 为一直等待）
+    bool read(DetectionShmRecord& record, int64_t timeoutUs = -1, int spinUs = 20);
+
+    // 下一条要读的序号
+    uint64_t sequence() const { return m_Sequence; }
+
+    // 因落后被覆盖而跳过的记录数
+    uint64_t lost() const { return m_Lost; }
+
+  private:
+    DetectionRingReader(const DetectionRingReader&);
+    DetectionRingReader& operator=(const DetectionRingReader&);
+
+    detection_ring::Header* m_Header;
+    detection_ring::Slot* m_Slots;
+    size_t m_MappingSize;
+    int m_ReaderSlot;
+    uint64_t m_Sequence;
+    uint64_t m_Lost;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef __DROP_OLDEST_QUEUE_H__
+#define __DROP_OLDEST_QUEUE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// 单生产者/单消费者的无锁队列，元素为预先分配的 T，满时丢弃最旧的一个。
+// 生产者 acquire 取得一个空闲元素写入后 push；消费者 pop 取得最旧的元素，处理完 release 交还。
+// 队列中只传递元素下标：消费者以 CAS 推进 head 取走下标，生产者在队列满时以同样的 CAS 抢走最旧的下标，
+// 因此每个元素任何时刻只属于一方，元素本身不会被并发读写。共 capacity + 2 个元素（队列中最多 capacity 个，
+// 生产者和消费者各持有一个），生产者总能取得空闲元素
+template <typename T>
+class DropOldestQueue {
+  public:
+    explicit DropOldestQueue(size_t capacity) : m_Items(capacity + 2), m_Ring(capacity), m_Free(capacity + 2),
+        m_Head(0), m_Tail(0), m_FreeHead(0), m_FreeTail(0), m_Spare(-1), m_Dropped(0)
+    {
+      for (size_t i = 0; i < m_Items.size(); ++i) {
+        m_Free[i].store((uint32_t) i, std::memory_order_relaxed);
+      }
+      m_FreeTail.store(m_Items.size(), std::memory_order_relaxed);
+    }
+
+    // 生产者：取得一个可写的元素，内容为上次使用留下的值；只有消费者同时持有多个元素时才会返回 nullptr
+    T* acquire()
+    {
+      uint32_t index;
+      if (m_Spare >= 0) {
+        index = m_Spare;
+        m_Spare = -1;
+      }
+      else {
+        uint64_t head = m_FreeHead.load(std::memory_order_relaxed);
+        if (head == m_FreeTail.load(std::memory_order_acquire)) {
+          return nullptr;
+        }
+        index = m_Free[head % m_Free.size()].load(std::memory_order_relaxed);
+        m_FreeHead.store(head + 1, std::memory_order_release);
+      }
+      return &m_Items[index];
+    }
+
+    // 生产者：提交 acquire 得到的元素，队列满时丢弃最旧的元素
+    void push(T* item)
+    {
+      uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+      uint64_t head = m_Head.load(std::memory_order_acquire);
+      while (tail - head >= m_Ring.size()) {
+        uint32_t oldest = m_Ring[head % m_Ring.size()].load(std::memory_order_relaxed);
+        if (m_Head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+          m_Spare = oldest;
+          m_Dropped.fetch_add(1, std::memory_order_relaxed);
+          break;
+        }
+      }
+      m_Ring[tail % m_Ring.size()].store((uint32_t) (item - m_Items.data()), std::memory_order_relaxed);
+      m_Tail.store(tail + 1, std::memory_order_release);
+    }
+
+    // 消费者：取出最旧的元素，队列为空时返回 nullptr
+    T* pop()
+    {
+      uint64_t head = m_Head.load(std::memory_order_acquire);
+      while (head != m_Tail.load(std::memory_order_acquire)) {
+        uint32_t index = m_Ring[head % m_Ring.size()].load(std::memory_order_relaxed);
+        if (m_Head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+          return &m_Items[index];
+        }
+      }
+      return nullptr;
+    }
+
+    // 消费者：交还 pop 得到的元素
+    void release(T* item)
+    {
+      uint64_t tail = m_FreeTail.load(std::memory_order_relaxed);
+      m_Free[tail % m_Free.size()].store((uint32_t) (item - m_Items.data()), std::memory_order_relaxed);
+      m_FreeTail.store(tail + 1, std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+      return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_acquire);
+    }
+
+    // 因队列满被丢弃的元素数
+    uint64_t dropped() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+  private:
+    DropOldestQueue(const DropOldestQueue&);
+    DropOldestQueue& operator=(const DropOldestQueue&);
+
+    std::vector<T> m_Items;
+    std::vector<std::atomic<uint32_t>> m_Ring;
+    std::vector<std::atomic<uint32_t>> m_Free;
+    // 生产者和消费者各自修改的计数放在不同的缓存行
+    std::atomic<uint64_t> m_Head;
+    char m_HeadPadding[56];
+    std::atomic<uint64_t> m_Tail;
+    std::atomic<uint64_t> m_FreeHead;
+    char m_TailPadding[48];
+    std::atomic<uint64_t> m_FreeTail;
+    long m_Spare;                 // 生产者抢走的最旧元素，下次 acquire 直接使用
+    std::atomic<uint64_t> m_Dropped;
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "engine_builder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const int BACKGROUND_NICE = 19;
+
+EngineBuildScheduler::EngineBuildScheduler(const EngineCache& cache, const std::vector<std::string>& fallbackFiles,
+    const std::string& hotSwapPath) : m_Cache(cache), m_FallbackFiles(fallbackFiles), m_HotSwapPath(hotSwapPath)
+{
+}
+
+// 构建线程使用调度器的成员，销毁前必须等待它们结束（进程退出时也会等待未完成的后台构建）
+EngineBuildScheduler::~EngineBuildScheduler()
+{
+  if (!idle()) {
+    std::cout << "Waiting for the background engine build to finish" << std::endl;
+  }
+  wait();
+}
+
+std::map<std::string, std::string>
+EngineBuildScheduler::describe(const EngineRequest& request)
+{
+  std::map<std::string, std::string> meta;
+  meta["model"] = request.modelKey;
+  meta["precision"] = request.networkMode;
+  meta["batch"] = std::to_string(request.batchSize);
+  return meta;
+}
+
+// 元数据中的 batch；.meta 文件损坏或被手工修改时返回 false
+static bool
+entryBatch(const EngineCacheEntry& entry, unsigned long& batch)
+{
+  std::map<std::string, std::string>::const_iterator it = entry.meta.find("batch");
+  if (it == entry.meta.end() || !isdigit((unsigned char) it->second[0])) {
+    return false;
+  }
+  char* end = nullptr;
+  errno = 0;
+  batch = strtoul(it->second.c_str(), &end, 10);
+  return errno == 0 && *end == '\0' && batch > 0;
+}
+
+// 优先选择同一模型、batch 不小于请求值的缓存引擎（batch 越接近越好，其次精度相同、最近使用），
+// 没有时再使用配置的回退引擎文件
+bool
+EngineBuildScheduler::findFallback(const EngineRequest& request, std::string& enginePath) const
+{
+  std::vector<std::pair<unsigned long, EngineCacheEntry>> candidates;
+  for (const EngineCacheEntry& entry : m_Cache.list()) {
+    if (entry.key == request.key || entry.meta.count("model") == 0 || entry.meta.at("model") != request.modelKey) {
+      continue;
+    }
+    unsigned long batch;
+    if (!entryBatch(entry, batch) || batch < request.batchSize) {
+      continue;
+    }
+    candidates.push_back(std::make_pair(batch, entry));
+  }
+
+  if (!candidates.empty()) {
+    typedef std::pair<unsigned long, EngineCacheEntry> Candidate;
+    std::sort(candidates.begin(), candidates.end(), [&request](const Candidate& a, const Candidate& b) {
+      if (a.first != b.first) {
+        return a.first < b.first;
+      }
+      bool samePrecisionA = a.second.meta.count("precision") && a.second.meta.at("precision") == request.networkMode;
+      bool samePrecisionB = b.second.meta.count("precision") && b.second.meta.at("precision") == request.networkMode;
+      if (samePrecisionA != samePrecisionB) {
+        return samePrecisionA;
+      }
+      return a.second.lastUse > b.second.lastUse;
+    });
+    enginePath = candidates.front().second.path;
+    return true;
+  }
+
+  for (const std::string& fallbackFile : m_FallbackFiles) {
+    struct stat st;
+    if (stat(fallbackFile.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      enginePath = fallbackFile;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// 同一引擎在进程内和进程间（通过文件锁）只会有一个构建任务
+bool
+EngineBuildScheduler::buildAsync(const EngineRequest& request, BuildFunc build)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+
+  if (m_Building.count(request.key) > 0) {
+    return false;
+  }
+
+  std::string lockPath = lockFilePath(request.key);
+  int lockFd = -1;
+  while (true) {
+    lockFd = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (lockFd < 0) {
+      std::cerr << "Could not create build lock " << lockPath << std::endl;
+      return false;
+    }
+    if (flock(lockFd, LOCK_EX | LOCK_NB) != 0) {
+      std::cout << "Engine " << request.key << " is already being built by another process" << std::endl;
+      close(lockFd);
+      return false;
+    }
+    // 打开之后、加锁之前另一个进程可能已构建完成并删除了锁文件，此时锁住的是已删除的文件，需要重新打开
+    struct stat locked, current;
+    if (fstat(lockFd, &locked) == 0 && stat(lockPath.c_str(), &current) == 0 &&
+        locked.st_dev == current.st_dev && locked.st_ino == current.st_ino) {
+      break;
+    }
+    close(lockFd);
+  }
+
+  // 查找缓存之后、加锁之前另一个进程可能已完成同一引擎的构建
+  if (m_Cache.contains(request.key) || (request.storeKey && m_Cache.contains(request.storeKey()))) {
+    std::cout << "Engine " << request.key << " was built by another process, it will be used on the next restart"
+        << std::endl;
+    unlink(lockPath.c_str());
+    close(lockFd);
+    return false;
+  }
+
+  m_Building.insert(request.key);
+  m_Threads.push_back(std::thread(&EngineBuildScheduler::run, this, request, build, lockFd));
+  return true;
+}
+
+bool
+EngineBuildScheduler::isBuilding(const std::string& key) const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Building.count(key) > 0;
+}
+
+bool
+EngineBuildScheduler::idle() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Building.empty();
+}
+
+void
+EngineBuildScheduler::wait()
+{
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    threads.swap(m_Threads);
+  }
+  for (std::thread& thread : threads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+void
+EngineBuildScheduler::run(EngineRequest request, BuildFunc build, int lockFd)
+{
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), BACKGROUND_NICE);
+
+  std::cout << "Building engine " << request.key << " in background" << std::endl;
+
+  std::vector<char> blob;
+  bool success = false;
+  try {
+    success = build(blob) && !blob.empty();
+  }
+  catch (const std::exception& e) {
+    std::cerr << "Background engine build failed: " << e.what() << std::endl;
+  }
+
+  std::string key = request.storeKey ? request.storeKey() : request.key;
+  if (success && m_Cache.store(key, blob.data(), blob.size(), describe(request))) {
+    std::cout << "Background engine build complete, it will be used on the next restart: "
+        << m_Cache.enginePath(key) << std::endl;
+    if (!m_HotSwapPath.empty() && writeFileAtomic(m_HotSwapPath, blob.data(), blob.size())) {
+      std::cout << "Engine is ready for hot-swap: " << m_HotSwapPath << std::endl;
+    }
+  }
+  else {
+    std::cerr << "Background engine build failed: " << request.key << std::endl;
+  }
+
+  // 持有锁时删除锁文件，之后的进程会新建锁文件，并先在缓存中找到已构建的引擎
+  unlink(lockFilePath(request.key).c_str());
+  close(lockFd);
+
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Building.erase(request.key);
+}
+
+std::string
+EngineBuildScheduler::lockFilePath(const std::string& key) const
+{
+  return m_Cache.cacheDir() + "/" + key + ".lock";
+}
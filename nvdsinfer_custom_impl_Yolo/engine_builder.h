@@ -0,0 +1,62 @@
+#ifndef __ENGINE_BUILDER_H__
+#define __ENGINE_BUILDER_H__
+
+#include <set>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+#include "engine_cache.h"
+
+struct EngineRequest
+{
+  std::string key;
+  std::string modelKey;
+  std::string networkMode;
+  uint32_t batchSize {0};
+  // 构建完成后存入缓存时使用的键，为空时使用 key（隐式 INT8 的构建会写出校准表，键随之变化）
+  std::function<std::string()> storeKey;
+};
+
+// 异步引擎构建：启动时先使用回退引擎，目标引擎在低优先级后台线程中构建并写入缓存
+class EngineBuildScheduler {
+  public:
+    typedef std::function<bool(std::vector<char>& blob)> BuildFunc;
+
+    EngineBuildScheduler(const EngineCache& cache, const std::vector<std::string>& fallbackFiles,
+        const std::string& hotSwapPath);
+
+    // 等待正在进行的后台构建结束
+    ~EngineBuildScheduler();
+
+    static std::map<std::string, std::string> describe(const EngineRequest& request);
+
+    bool findFallback(const EngineRequest& request, std::string& enginePath) const;
+
+    bool buildAsync(const EngineRequest& request, BuildFunc build);
+
+    bool isBuilding(const std::string& key) const;
+
+    // 没有正在进行的构建
+    bool idle() const;
+
+    // 等待所有后台构建结束
+    void wait();
+
+    EngineCache& cache() { return m_Cache; }
+
+  private:
+    void run(EngineRequest request, BuildFunc build, int lockFd);
+
+    std::string lockFilePath(const std::string& key) const;
+
+    EngineCache m_Cache;
+    const std::vector<std::string> m_FallbackFiles;
+    const std::string m_HotSwapPath;
+
+    mutable std::mutex m_Mutex;
+    std::set<std::string> m_Building;
+    std::vector<std::thread> m_Threads;
+};
+
+#endif
@@ -0,0 +1,374 @@
+#include "engine_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <experimental/filesystem>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static const char* ENGINE_SUFFIX = ".engine";
+static const char* META_SUFFIX = ".meta";
+
+static inline uint64_t
+rotl64(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t
+read64(const unsigned char* p)
+{
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t
+read32(const unsigned char* p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint64_t
+xxhRound(uint64_t acc, uint64_t input)
+{
+  acc += input * PRIME64_2;
+  acc = rotl64(acc, 31);
+  return acc * PRIME64_1;
+}
+
+static inline uint64_t
+xxhMergeRound(uint64_t acc, uint64_t val)
+{
+  acc ^= xxhRound(0, val);
+  return acc * PRIME64_1 + PRIME64_4;
+}
+
+Hasher64::Hasher64(uint64_t seed) : m_TotalLength(0), m_BufferSize(0), m_Seed(seed)
+{
+  m_V[0] = seed + PRIME64_1 + PRIME64_2;
+  m_V[1] = seed + PRIME64_2;
+  m_V[2] = seed;
+  m_V[3] = seed - PRIME64_1;
+}
+
+void
+Hasher64::update(const void* data, size_t length)
+{
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const unsigned char* end = p + length;
+  m_TotalLength += length;
+
+  if (m_BufferSize + length < 32) {
+    memcpy(m_Buffer + m_BufferSize, p, length);
+    m_BufferSize += length;
+    return;
+  }
+
+  if (m_BufferSize > 0) {
+    size_t fill = 32 - m_BufferSize;
+    memcpy(m_Buffer + m_BufferSize, p, fill);
+    p += fill;
+    for (int i = 0; i < 4; ++i) {
+      m_V[i] = xxhRound(m_V[i], read64(m_Buffer + i * 8));
+    }
+    m_BufferSize = 0;
+  }
+
+  while (p + 32 <= end) {
+    for (int i = 0; i < 4; ++i) {
+      m_V[i] = xxhRound(m_V[i], read64(p + i * 8));
+    }
+    p += 32;
+  }
+
+  if (p < end) {
+    m_BufferSize = end - p;
+    memcpy(m_Buffer, p, m_BufferSize);
+  }
+}
+
+void
+Hasher64::update(const std::string& value)
+{
+  uint64_t length = value.size();
+  update(&length, sizeof(length));
+  update(value.data(), value.size());
+}
+
+// 分块读取文件并计算哈希
+bool
+Hasher64::updateFile(const std::string& filePath)
+{
+  std::ifstream file(filePath, std::ios::binary);
+  if (!file.good()) {
+    return false;
+  }
+
+  std::vector<char> chunk(1 << 20);
+  while (file) {
+    file.read(chunk.data(), chunk.size());
+    std::streamsize count = file.gcount();
+    if (count <= 0) {
+      break;
+    }
+    update(chunk.data(), count);
+  }
+  return true;
+}
+
+uint64_t
+Hasher64::digest() const
+{
+  uint64_t h;
+  if (m_TotalLength >= 32) {
+    h = rotl64(m_V[0], 1) + rotl64(m_V[1], 7) + rotl64(m_V[2], 12) + rotl64(m_V[3], 18);
+    for (int i = 0; i < 4; ++i) {
+      h = xxhMergeRound(h, m_V[i]);
+    }
+  }
+  else {
+    h = m_Seed + PRIME64_5;
+  }
+
+  h += m_TotalLength;
+
+  const unsigned char* p = m_Buffer;
+  const unsigned char* end = m_Buffer + m_BufferSize;
+  while (p + 8 <= end) {
+    h ^= xxhRound(0, read64(p));
+    h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+    h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= (*p) * PRIME64_5;
+    h = rotl64(h, 11) * PRIME64_1;
+    ++p;
+  }
+
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+std::string
+hashToString(uint64_t hash)
+{
+  char str[17];
+  snprintf(str, sizeof(str), "%016llx", static_cast<unsigned long long>(hash));
+  return std::string(str);
+}
+
+EngineCache::EngineCache(const std::string& cacheDir, uint64_t maxBytes) : m_CacheDir(cacheDir), m_MaxBytes(maxBytes)
+{
+  std::error_code ec;
+  std::experimental::filesystem::create_directories(m_CacheDir, ec);
+  if (ec) {
+    std::cerr << "Could not create engine cache directory " << m_CacheDir << ": " << ec.message() << std::endl;
+  }
+}
+
+std::string
+EngineCache::enginePath(const std::string& key) const
+{
+  return m_CacheDir + "/" + key + ENGINE_SUFFIX;
+}
+
+bool
+EngineCache::contains(const std::string& key) const
+{
+  struct stat st;
+  return stat(enginePath(key).c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// 读取缓存的引擎，并更新其访问时间用于 LRU 淘汰
+bool
+EngineCache::lookup(const std::string& key, std::vector<char>& data)
+{
+  std::string path = enginePath(key);
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.good()) {
+    return false;
+  }
+
+  std::streamsize size = file.tellg();
+  if (size <= 0) {
+    return false;
+  }
+  file.seekg(0, std::ios::beg);
+  data.resize(size);
+  if (!file.read(data.data(), size)) {
+    data.clear();
+    return false;
+  }
+
+  utimes(path.c_str(), nullptr);
+  return true;
+}
+
+// 先写入临时文件并 fsync，再 rename 到最终路径，保证读者永远不会看到写了一半的文件
+bool
+writeFileAtomic(const std::string& filePath, const void* data, size_t size)
+{
+  std::string tmpPath = filePath + ".tmp." + std::to_string(getpid()) + "." + std::to_string(syscall(SYS_gettid));
+
+  int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    std::cerr << "Could not create file " << tmpPath << std::endl;
+    return false;
+  }
+
+  const char* p = static_cast<const char*>(data);
+  size_t left = size;
+  while (left > 0) {
+    ssize_t written = write(fd, p, left);
+    if (written <= 0) {
+      std::cerr << "Could not write file " << tmpPath << std::endl;
+      close(fd);
+      unlink(tmpPath.c_str());
+      return false;
+    }
+    p += written;
+    left -= written;
+  }
+
+  if (fsync(fd) != 0 || close(fd) != 0 || rename(tmpPath.c_str(), filePath.c_str()) != 0) {
+    std::cerr << "Could not commit file " << filePath << std::endl;
+    unlink(tmpPath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+std::string
+EngineCache::metaPath(const std::string& key) const
+{
+  return m_CacheDir + "/" + key + META_SUFFIX;
+}
+
+// 元数据（模型键、精度、batch）先于引擎写入，这样任何可见的引擎都带有完整的元数据
+bool
+EngineCache::store(const std::string& key, const void* data, size_t size,
+    const std::map<std::string, std::string>& meta)
+{
+  if (!meta.empty()) {
+    std::string metaText;
+    for (const auto& kv : meta) {
+      metaText += kv.first + "=" + kv.second + "\n";
+    }
+    if (!writeFileAtomic(metaPath(key), metaText.data(), metaText.size())) {
+      return false;
+    }
+  }
+
+  if (!writeFileAtomic(enginePath(key), data, size)) {
+    return false;
+  }
+
+  evict(key);
+  return true;
+}
+
+std::vector<EngineCacheEntry>
+EngineCache::list() const
+{
+  std::vector<EngineCacheEntry> entries;
+
+  DIR* dir = opendir(m_CacheDir.c_str());
+  if (dir == nullptr) {
+    return entries;
+  }
+
+  size_t suffixLength = strlen(ENGINE_SUFFIX);
+  struct dirent* ent;
+  while ((ent = readdir(dir)) != nullptr) {
+    std::string name = ent->d_name;
+    if (name.size() <= suffixLength || name.compare(name.size() - suffixLength, suffixLength, ENGINE_SUFFIX) != 0) {
+      continue;
+    }
+
+    EngineCacheEntry entry;
+    entry.key = name.substr(0, name.size() - suffixLength);
+    entry.path = m_CacheDir + "/" + name;
+
+    struct stat st;
+    if (stat(entry.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+      continue;
+    }
+    entry.size = st.st_size;
+    entry.lastUse = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+
+    std::ifstream metaFile(metaPath(entry.key));
+    std::string line;
+    while (std::getline(metaFile, line)) {
+      size_t pos = line.find('=');
+      if (pos != std::string::npos) {
+        entry.meta[line.substr(0, pos)] = line.substr(pos + 1);
+      }
+    }
+
+    entries.push_back(entry);
+  }
+  closedir(dir);
+
+  std::sort(entries.begin(), entries.end(), [](const EngineCacheEntry& a, const EngineCacheEntry& b) {
+    return a.lastUse < b.lastUse;
+  });
+
+  return entries;
+}
+
+// 删除最久未使用的引擎直到缓存总大小不超过上限，返回释放的字节数
+uint64_t
+EngineCache::evict(const std::string& keepKey)
+{
+  std::vector<EngineCacheEntry> entries = list();
+
+  uint64_t total = 0;
+  for (const EngineCacheEntry& entry : entries) {
+    total += entry.size;
+  }
+
+  uint64_t freed = 0;
+  for (const EngineCacheEntry& entry : entries) {
+    if (total <= m_MaxBytes) {
+      break;
+    }
+    if (entry.key == keepKey) {
+      continue;
+    }
+    if (unlink(entry.path.c_str()) == 0) {
+      unlink(metaPath(entry.key).c_str());
+      std::cout << "Evicted cached engine " << entry.path << std::endl;
+      total -= entry.size;
+      freed += entry.size;
+    }
+  }
+
+  return freed;
+}
@@ -0,0 +1,71 @@
+#ifndef __ENGINE_CACHE_H__
+#define __ENGINE_CACHE_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// 流式 64 位哈希 (XXH64)，用于计算引擎缓存的内容地址
+class Hasher64 {
+  public:
+    Hasher64(uint64_t seed = 0);
+
+    void update(const void* data, size_t length);
+
+    // 先写入长度再写入内容，避免相邻字段拼接产生歧义
+    void update(const std::string& value);
+
+    bool updateFile(const std::string& filePath);
+
+    uint64_t digest() const;
+
+  private:
+    uint64_t m_V[4];
+    uint64_t m_TotalLength;
+    unsigned char m_Buffer[32];
+    size_t m_BufferSize;
+    uint64_t m_Seed;
+};
+
+std::string hashToString(uint64_t hash);
+
+bool writeFileAtomic(const std::string& filePath, const void* data, size_t size);
+
+struct EngineCacheEntry
+{
+  std::string key;
+  std::string path;
+  uint64_t size {0};
+  int64_t lastUse {0};
+  std::map<std::string, std::string> meta;
+};
+
+// 以输入内容哈希为键的 TensorRT 引擎缓存目录，写入为原子操作，按最近使用时间淘汰
+class EngineCache {
+  public:
+    EngineCache(const std::string& cacheDir, uint64_t maxBytes);
+
+    std::string enginePath(const std::string& key) const;
+
+    bool contains(const std::string& key) const;
+
+    bool lookup(const std::string& key, std::vector<char>& data);
+
+    bool store(const std::string& key, const void* data, size_t size,
+        const std::map<std::string, std::string>& meta = std::map<std::string, std::string>());
+
+    std::vector<EngineCacheEntry> list() const;
+
+    uint64_t evict(const std::string& keepKey = "");
+
+    const std::string& cacheDir() const { return m_CacheDir; }
+
+  private:
+    std::string metaPath(const std::string& key) const;
+
+    const std::string m_CacheDir;
+    const uint64_t m_MaxBytes;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "half_float.h"
+
+#include <cstring>
+
+uint16_t
+floatToHalf(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  uint16_t sign = (bits >> 16) & 0x8000;
+  uint32_t exponent = (bits >> 23) & 0xff;
+  uint32_t mantissa = bits & 0x7fffff;
+
+  if (exponent == 0xff) {
+    // 无穷大保持不变，NaN 保留最高位使其仍为 quiet NaN
+    return sign | 0x7c00 | (mantissa != 0 ? 0x200 | (mantissa >> 13) : 0);
+  }
+
+  int halfExponent = (int) exponent - 127 + 15;
+  if (halfExponent >= 0x1f) {
+    return sign | 0x7c00;
+  }
+
+  if (halfExponent <= 0) {
+    // 次正规数：把隐含的 1 加回尾数后右移，移出 11 位以上时舍入结果为 0
+    if (halfExponent < -10) {
+      return sign;
+    }
+    mantissa |= 0x800000;
+    int shift = 14 - halfExponent;
+    uint32_t half = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t midpoint = 1u << (shift - 1);
+    if (remainder > midpoint || (remainder == midpoint && (half & 1))) {
+      ++half;
+    }
+    return sign | half;
+  }
+
+  // 尾数进位到指数时结果仍正确，进位到 0x7c00 即为无穷大
+  uint32_t half = ((uint32_t) halfExponent << 10) | (mantissa >> 13);
+  uint32_t remainder = mantissa & 0x1fff;
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+    ++half;
+  }
+  return sign | half;
+}
+
+float
+halfToFloat(uint16_t value)
+{
+  uint32_t sign = (uint32_t) (value & 0x8000) << 16;
+  uint32_t exponent = (value >> 10) & 0x1f;
+  uint32_t mantissa = value & 0x3ff;
+
+  uint32_t bits;
+  if (exponent == 0x1f) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  }
+  else if (exponent != 0) {
+    bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+  else if (mantissa == 0) {
+    bits = sign;
+  }
+  else {
+    // 次正规数规格化
+    exponent = 127 - 15 + 1;
+    while ((mantissa & 0x400) == 0) {
+      mantissa <<= 1;
+      --exponent;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+  }
+
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+void
+convertToHalf(const float* values, int64_t count, uint16_t* halves)
+{
+  for (int64_t i = 0; i < count; ++i) {
+    halves[i] = floatToHalf(values[i]);
+  }
+}
@@ -0,0 +1,14 @@
+#ifndef __HALF_FLOAT_H__
+#define __HALF_FLOAT_H__
+
+#include <cstdint>
+
+// IEEE 754 binary16 与 float 的转换，与 TensorRT/CUDA 的 __float2half_rn 相同：就近舍入、中间值取偶数，
+// 超出范围为无穷大，过小的值得到次正规数或 0，NaN 保持为 NaN
+uint16_t floatToHalf(float value);
+
+float halfToFloat(uint16_t value);
+
+void convertToHalf(const float* values, int64_t count, uint16_t* halves);
+
+#endif
@@ -0,0 +1,190 @@
+#include "image_packing.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PACK_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+#define PACK_SSE2 1
+#endif
+
+namespace {
+
+#ifdef PACK_SSE2
+// 16 个 uint8 转为 float 后计算 x * scale + bias
+inline void
+convert16(__m128i values, __m128 scale, __m128 bias, float* output)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i low = _mm_unpacklo_epi8(values, zero);
+  __m128i high = _mm_unpackhi_epi8(values, zero);
+  __m128i words[4] = {_mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero), _mm_unpacklo_epi16(high, zero),
+      _mm_unpackhi_epi16(high, zero)};
+  for (int k = 0; k < 4; ++k) {
+    _mm_storeu_ps(output + 4 * k, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(words[k]), scale), bias));
+  }
+}
+
+// 48 字节交错的 BGR 拆成 3 个通道各 16 个像素
+inline void
+deinterleave16(const uint8_t* src, __m128i channels[3])
+{
+#ifdef __SSSE3__
+  static const int8_t kShuffle[3][3][16] = {
+    {{0, 3, 6, 9, 12, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {1, 4, 7, 10, 13, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128},
+     {2, 5, 8, 11, 14, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128}},
+    {{-128, -128, -128, -128, -128, -128, 2, 5, 8, 11, 14, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, 0, 3, 6, 9, 12, 15, -128, -128, -128, -128, -128},
+     {-128, -128, -128, -128, -128, 1, 4, 7, 10, 13, -128, -128, -128, -128, -128, -128}},
+    {{-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 1, 4, 7, 10, 13},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 2, 5, 8, 11, 14},
+     {-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 0, 3, 6, 9, 12, 15}}
+  };
+  __m128i blocks[3];
+  for (int r = 0; r < 3; ++r) {
+    blocks[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * r));
+  }
+  for (int c = 0; c < 3; ++c) {
+    __m128i value = _mm_setzero_si128();
+    for (int r = 0; r < 3; ++r) {
+      value = _mm_or_si128(value,
+          _mm_shuffle_epi8(blocks[r], _mm_loadu_si128(reinterpret_cast<const __m128i*>(kShuffle[r][c]))));
+    }
+    channels[c] = value;
+  }
+#else
+  alignas(16) uint8_t lanes[3][16];
+  for (int i = 0; i < 16; ++i) {
+    lanes[0][i] = src[3 * i];
+    lanes[1][i] = src[3 * i + 1];
+    lanes[2][i] = src[3 * i + 2];
+  }
+  for (int c = 0; c < 3; ++c) {
+    channels[c] = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes[c]));
+  }
+#endif
+}
+#endif
+
+#ifdef PACK_NEON
+inline void
+convert16(uint8x16_t values, float scale, float32x4_t bias, float* output)
+{
+  uint16x8_t low = vmovl_u8(vget_low_u8(values));
+  uint16x8_t high = vmovl_u8(vget_high_u8(values));
+  vst1q_f32(output, vmlaq_n_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_low_u16(low))), scale));
+  vst1q_f32(output + 4, vmlaq_n_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_high_u16(low))), scale));
+  vst1q_f32(output + 8, vmlaq_n_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_low_u16(high))), scale));
+  vst1q_f32(output + 12, vmlaq_n_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_high_u16(high))), scale));
+}
+#endif
+
+// 一行 count 个像素：输入通道 source[c] 写到 outputs[c]
+void
+convertRow(const uint8_t* src, int count, int channels, const int* source, float scale, const float* bias,
+    float* const* outputs)
+{
+  int x = 0;
+#if defined(PACK_SSE2)
+  __m128 scaleVector = _mm_set1_ps(scale);
+  if (channels == 3) {
+    for (; x + 16 <= count; x += 16) {
+      __m128i values[3];
+      deinterleave16(src + 3 * x, values);
+      for (int c = 0; c < 3; ++c) {
+        convert16(values[source[c]], scaleVector, _mm_set1_ps(bias[c]), outputs[c] + x);
+      }
+    }
+  }
+  else if (channels == 1) {
+    for (; x + 16 <= count; x += 16) {
+      convert16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x)), scaleVector, _mm_set1_ps(bias[0]),
+          outputs[0] + x);
+    }
+  }
+#elif defined(PACK_NEON)
+  if (channels == 3) {
+    for (; x + 16 <= count; x += 16) {
+      uint8x16x3_t values = vld3q_u8(src + 3 * x);
+      for (int c = 0; c < 3; ++c) {
+        convert16(values.val[source[c]], scale, vdupq_n_f32(bias[c]), outputs[c] + x);
+      }
+    }
+  }
+  else if (channels == 1) {
+    for (; x + 16 <= count; x += 16) {
+      convert16(vld1q_u8(src + x), scale, vdupq_n_f32(bias[0]), outputs[0] + x);
+    }
+  }
+#endif
+  for (; x < count; ++x) {
+    for (int c = 0; c < channels; ++c) {
+      outputs[c][x] = src[channels * x + source[c]] * scale + bias[c];
+    }
+  }
+}
+
+}
+
+ImagePlacement
+letterboxPlacement(int imageW, int imageH, int inputW, int inputH, bool symmetricPadding)
+{
+  ImagePlacement placement;
+  double scaledH = (double) inputW * imageH / imageW;
+  if (scaledH <= inputH) {
+    placement.width = inputW;
+    placement.height = std::max(1, (int) scaledH);
+  }
+  else {
+    placement.width = std::max(1, (int) ((double) inputH * imageW / imageH));
+    placement.height = inputH;
+  }
+  if (symmetricPadding) {
+    placement.x = (inputW - placement.width) / 2;
+    placement.y = (inputH - placement.height) / 2;
+  }
+  return placement;
+}
+
+void
+packImagePlanar(const uint8_t* image, size_t stride, int channels, bool swapRB, int inputW, int inputH,
+    const ImagePlacement& placement, float scale, const float* offsets, float* output)
+{
+  // scale * (x - offset) = x * scale + bias，填充为 bias
+  int source[3] = {0, 1, 2};
+  float bias[3] = {0, 0, 0};
+  for (int c = 0; c < channels; ++c) {
+    if (swapRB && channels == 3) {
+      source[c] = 2 - c;
+    }
+    bias[c] = -offsets[c] * scale;
+  }
+
+  size_t planeSize = (size_t) inputW * inputH;
+  for (int y = 0; y < inputH; ++y) {
+    float* outputs[3];
+    for (int c = 0; c < channels; ++c) {
+      outputs[c] = output + c * planeSize + (size_t) y * inputW;
+    }
+    int row = y - placement.y;
+    if (row < 0 || row >= placement.height) {
+      for (int c = 0; c < channels; ++c) {
+        std::fill(outputs[c], outputs[c] + inputW, bias[c]);
+      }
+      continue;
+    }
+    int right = placement.x + placement.width;
+    for (int c = 0; c < channels; ++c) {
+      std::fill(outputs[c], outputs[c] + placement.x, bias[c]);
+      std::fill(outputs[c] + right, outputs[c] + inputW, bias[c]);
+      outputs[c] += placement.x;
+    }
+    convertRow(image + row * stride, placement.width, channels, source, scale, bias, outputs);
+  }
+}
@@ -0,0 +1,26 @@
+#ifndef __IMAGE_PACKING_H__
+#define __IMAGE_PACKING_H__
+
+#include <cstddef>
+#include <cstdint>
+
+// 缩放后的图片在网络输入中的位置，其余部分为填充
+struct ImagePlacement
+{
+  int x {0};
+  int y {0};
+  int width {0};
+  int height {0};
+};
+
+// 与 nvinfer 的 maintain-aspect-ratio=1 相同：等比缩放到输入内（宽高取整），symmetric-padding=1 时居中，
+// 否则图片在左上角，填充在右侧和下方
+ImagePlacement letterboxPlacement(int imageW, int imageH, int inputW, int inputH, bool symmetricPadding);
+
+// 一次遍历把已缩放的 8 位交错图（BGR 或灰度，每行 stride 字节，大小为 placement 的宽高）写成 inputW x inputH 的
+// CHW float：swapRB 时交换 R/B，每个像素为 scale * (x - offsets[c])（与 nvinfer 相同），填充按像素值 0 计算。
+// x86 使用 SSE2（编译时打开 SSSE3 则通道拆分也向量化），ARM 使用 NEON，其余平台逐像素计算
+void packImagePlanar(const uint8_t* image, size_t stride, int channels, bool swapRB, int inputW, int inputH,
+    const ImagePlacement& placement, float scale, const float* offsets, float* output);
+
+#endif
@@ -0,0 +1,99 @@
+#include "int8_quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+void
+perChannelWeightScales(const float* kernel, int filters, int64_t filterVolume, float* scales)
+{
+  for (int f = 0; f < filters; ++f) {
+    const float* filter = kernel + f * filterVolume;
+    float amax = 0.0f;
+    for (int64_t k = 0; k < filterVolume; ++k) {
+      amax = std::max(amax, std::fabs(filter[k]));
+    }
+    scales[f] = amax > 0.0f ? amax / 127.0f : 1.0f;
+  }
+}
+
+float
+fakeQuantize(float value, float scale)
+{
+  // 与 TensorRT 相同，就近舍入、中间值取偶数
+  float q = std::nearbyint(value / scale);
+  return std::min(127.0f, std::max(-127.0f, q)) * scale;
+}
+
+bool
+loadActivationScales(const std::string& filePath, std::map<std::string, float>& scales, std::string& error)
+{
+  std::ifstream file(filePath);
+  if (!file.good()) {
+    error = "could not open " + filePath;
+    return false;
+  }
+
+  std::string line;
+  int lineNumber = 0;
+  bool tensorRtTable = false;
+  while (std::getline(file, line)) {
+    ++lineNumber;
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (lineNumber == 1 && line.compare(0, 4, "TRT-") == 0) {
+      tensorRtTable = true;
+      continue;
+    }
+    if (!tensorRtTable) {
+      line = line.substr(0, line.find('#'));
+    }
+    if (line.find_first_not_of(" \t") == std::string::npos) {
+      continue;
+    }
+
+    // 张量名中可能含有空格和冒号，按最后一个分隔符切分
+    size_t separator = tensorRtTable ? line.rfind(": ") : line.find_last_of(" \t", line.find_last_not_of(" \t"));
+    std::string name = separator == std::string::npos ? "" : line.substr(0, separator);
+    name.erase(name.find_last_not_of(" \t") + 1);
+    name.erase(0, name.find_first_not_of(" \t"));
+    std::string value = separator == std::string::npos ? "" : line.substr(separator + 1);
+    value.erase(0, value.find_first_not_of(" \t"));
+    value.erase(value.find_last_not_of(" \t") + 1);
+
+    char* end = nullptr;
+    float scale = 0.0f;
+    if (tensorRtTable) {
+      uint32_t bits = strtoul(value.c_str(), &end, 16);
+      memcpy(&scale, &bits, sizeof(scale));
+    }
+    else {
+      scale = strtof(value.c_str(), &end) / 127.0f;
+    }
+    if (name.empty() || value.empty() || *end != '\0' || !std::isfinite(scale) || scale <= 0.0f) {
+      error = filePath + ", line " + std::to_string(lineNumber) + ": invalid entry '" + line + "'";
+      return false;
+    }
+    scales[name] = scale;
+  }
+
+  if (scales.empty()) {
+    error = filePath + " has no activation scales";
+    return false;
+  }
+  return true;
+}
+
+bool
+hasUnnamedTensors(const std::map<std::string, float>& scales)
+{
+  for (const auto& entry : scales) {
+    if (entry.first.compare(0, 15, "(Unnamed Layer*") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,25 @@
+#ifndef __INT8_QUANTIZATION_H__
+#define __INT8_QUANTIZATION_H__
+
+#include <map>
+#include <string>
+#include <cstdint>
+
+// 显式量化（Q/DQ）用的对称 INT8 量化：q = clamp(round(x / scale), -127, 127)，x' = q * scale
+
+// 每个输出通道 scale = max|w| / 127，全为 0 的通道 scale 取 1（TensorRT 要求 scale 为正）；
+// kernel 布局为 [filters][filterVolume]
+void perChannelWeightScales(const float* kernel, int filters, int64_t filterVolume, float* scales);
+
+float fakeQuantize(float value, float scale);
+
+// 读取激活 scale，键为张量名（darknet 层输出命名为 <type>_<cfg 块序号>，与 yolo_N 相同；网络输入为输入 blob 名）：
+//   TensorRT 校准表：首行 TRT-...，之后每行 "张量名: scale"，scale 为 float 位的十六进制
+//   简单格式：每行 "张量名 amax"，scale = amax / 127，# 开头为注释
+bool loadActivationScales(const std::string& filePath, std::map<std::string, float>& scales, std::string& error);
+
+// 是否含有 TensorRT 的默认张量名 "(Unnamed Layer* N) [...]_output"：darknet 层输出按 cfg 块命名之前生成的校准表，
+// 其中的层与现在的网络对应不上
+bool hasUnnamedTensors(const std::map<std::string, float>& scales);
+
+#endif
@@ -10,7 +10,9 @@
 
 #include "NvInfer.h"
 
-nvinfer1::ITensor* activationLayer(int layerIdx, std::string activation, nvinfer1::ITensor* input,
+#include "../network_ir.h"
+
+nvinfer1::ITensor* activationLayer(int layerIdx, ActivationKind activation, nvinfer1::ITensor* input,
     nvinfer1::INetworkDefinition* network, std::string layerName = "");
 
 #endif
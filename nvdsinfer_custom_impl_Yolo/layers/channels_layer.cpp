@@ -8,14 +8,14 @@
 #include <cassert>
 
 nvinfer1::ITensor*
-channelsLayer(int layerIdx, std::map<std::string, std::string>& block, nvinfer1::ITensor* input,
+channelsLayer(int layerIdx, const LayerDesc& layer, nvinfer1::ITensor* input,
     nvinfer1::ITensor* implicitTensor, nvinfer1::INetworkDefinition* network)
 {
   nvinfer1::ITensor* output;
 
-  assert(block.at("type") == "shift_channels" || block.at("type") == "control_channels");
+  assert(layer.kind == LayerKind::kShiftChannels || layer.kind == LayerKind::kControlChannels);
 
-  if (block.at("type") == "shift_channels") {
+  if (layer.kind == LayerKind::kShiftChannels) {
     nvinfer1::IElementWiseLayer* shift = network->addElementWise(*input, *implicitTensor,
         nvinfer1::ElementWiseOperation::kSUM);
     assert(shift != nullptr);
@@ -23,7 +23,7 @@ channelsLayer(int layerIdx, std::map<std::string, std::string>& block, nvinfer1:
     shift->setName(shiftLayerName.c_str());
     output = shift->getOutput(0);
   }
-  else if (block.at("type") == "control_channels") {
+  else {
     nvinfer1::IElementWiseLayer* control = network->addElementWise(*input, *implicitTensor,
         nvinfer1::ElementWiseOperation::kPROD);
     assert(control != nullptr);
@@ -6,15 +6,15 @@
 #ifndef __CONVOLUTIONAL_LAYER_H__
 #define __CONVOLUTIONAL_LAYER_H__
 
-#include <map>
-#include <vector>
-
 #include "NvInfer.h"
 
 #include "activation_layer.h"
+#include "../network_ir.h"
+#include "../network_weights.h"
 
-nvinfer1::ITensor* convolutionalLayer(int layerIdx, std::map<std::string, std::string>& block,
-    std::vector<float>& weights, std::vector<nvinfer1::Weights>& trtWeights, int& weightPtr, int& inputChannels,
-    nvinfer1::ITensor* input, nvinfer1::INetworkDefinition* network, std::string layerName = "");
+// kernel 不为空时（显式量化）卷积核由该张量给出，weights 只提供偏置
+nvinfer1::ITensor* convolutionalLayer(int layerIdx, const LayerDesc& layer, const LayerWeights& weights,
+    nvinfer1::ITensor* input, nvinfer1::INetworkDefinition* network, std::string layerName = "",
+    nvinfer1::ITensor* kernel = nullptr);
 
 #endif
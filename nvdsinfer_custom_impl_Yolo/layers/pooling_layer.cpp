@@ -9,20 +9,14 @@
 #include <iostream>
 
 nvinfer1::ITensor*
-poolingLayer(int layerIdx, std::map<std::string, std::string>& block, nvinfer1::ITensor* input,
+poolingLayer(int layerIdx, const LayerDesc& layer, nvinfer1::ITensor* input,
     nvinfer1::INetworkDefinition* network)
 {
   nvinfer1::ITensor* output;
 
-  assert(block.at("type") == "max" || block.at("type") == "maxpool" || block.at("type") == "avg" ||
-      block.at("type") == "avgpool");
-
-  if (block.at("type") == "max" || block.at("type") == "maxpool") {
-    assert(block.find("size") != block.end());
-    assert(block.find("stride") != block.end());
-
-    int size = std::stoi(block.at("size"));
-    int stride = std::stoi(block.at("stride"));
+  if (layer.kind == LayerKind::kMaxpool) {
+    int size = layer.size;
+    int stride = layer.stride;
 
     nvinfer1::IPoolingLayer* maxpool = network->addPoolingNd(*input, nvinfer1::PoolingType::kMAX,
         nvinfer1::Dims{2, {size, size}});
@@ -37,17 +31,17 @@ poolingLayer(int layerIdx, std::map<std::string, std::string>& block, nvinfer1::
     }
     output = maxpool->getOutput(0);
   }
-  else if (block.at("type") == "avg" || block.at("type") == "avgpool") {
+  else if (layer.kind == LayerKind::kAvgpool) {
     nvinfer1::Dims inputDims = input->getDimensions();
     nvinfer1::IPoolingLayer* avgpool = network->addPoolingNd(*input, nvinfer1::PoolingType::kAVERAGE,
-        nvinfer1::Dims{2, {inputDims.d[1], inputDims.d[2]}});
+        nvinfer1::Dims{2, {inputDims.d[2], inputDims.d[3]}});
     assert(avgpool != nullptr);
     std::string avgpoolLayerName = "avgpool_" + std::to_string(layerIdx);
     avgpool->setName(avgpoolLayerName.c_str());
     output = avgpool->getOutput(0);
   }
   else {
-    std::cerr << "Pooling not supported: " << block.at("type") << std::endl;
+    std::cerr << "Pooling not supported: " << layer.type << std::endl;
     assert(0);
   }
 
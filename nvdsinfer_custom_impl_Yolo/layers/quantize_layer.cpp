@@ -0,0 +1,65 @@
+#include "quantize_layer.h"
+
+#include <cassert>
+
+#if NV_TENSORRT_MAJOR >= 8
+nvinfer1::ITensor*
+quantizeActivationLayer(int layerIdx, nvinfer1::ITensor* input, const float* scale,
+    nvinfer1::INetworkDefinition* network)
+{
+  nvinfer1::Weights scaleWt {nvinfer1::DataType::kFLOAT, scale, 1};
+  nvinfer1::IConstantLayer* constant = network->addConstant(nvinfer1::Dims{0, {}}, scaleWt);
+  assert(constant != nullptr);
+  std::string constantLayerName = "input_scale_" + std::to_string(layerIdx);
+  constant->setName(constantLayerName.c_str());
+
+  nvinfer1::IQuantizeLayer* quantize = network->addQuantize(*input, *constant->getOutput(0));
+  assert(quantize != nullptr);
+  std::string quantizeLayerName = "input_quantize_" + std::to_string(layerIdx);
+  quantize->setName(quantizeLayerName.c_str());
+
+  nvinfer1::IDequantizeLayer* dequantize = network->addDequantize(*quantize->getOutput(0), *constant->getOutput(0));
+  assert(dequantize != nullptr);
+  std::string dequantizeLayerName = "input_dequantize_" + std::to_string(layerIdx);
+  dequantize->setName(dequantizeLayerName.c_str());
+
+  return dequantize->getOutput(0);
+}
+
+nvinfer1::ITensor*
+quantizedKernelLayer(int layerIdx, const LayerDesc& layer, const LayerWeights& weights, int channels,
+    const float* scales, nvinfer1::INetworkDefinition* network)
+{
+  assert(layer.kind == LayerKind::kConvolutional);
+
+  int filters = layer.filters;
+  int kernelSize = layer.size;
+
+  nvinfer1::Weights kernelWt {nvinfer1::DataType::kFLOAT, weights.kernel, weights.kernelCount};
+  nvinfer1::IConstantLayer* kernel = network->addConstant(nvinfer1::Dims{4, {filters, channels / layer.groups,
+      kernelSize, kernelSize}}, kernelWt);
+  assert(kernel != nullptr);
+  std::string kernelLayerName = "kernel_" + std::to_string(layerIdx);
+  kernel->setName(kernelLayerName.c_str());
+
+  nvinfer1::Weights scaleWt {nvinfer1::DataType::kFLOAT, scales, filters};
+  nvinfer1::IConstantLayer* scale = network->addConstant(nvinfer1::Dims{1, {filters}}, scaleWt);
+  assert(scale != nullptr);
+  std::string scaleLayerName = "kernel_scale_" + std::to_string(layerIdx);
+  scale->setName(scaleLayerName.c_str());
+
+  nvinfer1::IQuantizeLayer* quantize = network->addQuantize(*kernel->getOutput(0), *scale->getOutput(0));
+  assert(quantize != nullptr);
+  quantize->setAxis(0);
+  std::string quantizeLayerName = "kernel_quantize_" + std::to_string(layerIdx);
+  quantize->setName(quantizeLayerName.c_str());
+
+  nvinfer1::IDequantizeLayer* dequantize = network->addDequantize(*quantize->getOutput(0), *scale->getOutput(0));
+  assert(dequantize != nullptr);
+  dequantize->setAxis(0);
+  std::string dequantizeLayerName = "kernel_dequantize_" + std::to_string(layerIdx);
+  dequantize->setName(dequantizeLayerName.c_str());
+
+  return dequantize->getOutput(0);
+}
+#endif
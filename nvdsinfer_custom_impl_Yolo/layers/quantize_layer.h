@@ -0,0 +1,21 @@
+#ifndef __QUANTIZE_LAYER_H__
+#define __QUANTIZE_LAYER_H__
+
+#include "NvInfer.h"
+
+#include <string>
+
+#include "../network_ir.h"
+#include "../network_weights.h"
+
+#if NV_TENSORRT_MAJOR >= 8
+// 激活的逐张量 Q/DQ，scale 为 1 个元素的常量
+nvinfer1::ITensor* quantizeActivationLayer(int layerIdx, nvinfer1::ITensor* input, const float* scale,
+    nvinfer1::INetworkDefinition* network);
+
+// 卷积核常量经过逐输出通道（axis 0）的 Q/DQ，作为卷积的第二个输入；scales 为 filters 个，需在构建完成前保持有效
+nvinfer1::ITensor* quantizedKernelLayer(int layerIdx, const LayerDesc& layer, const LayerWeights& weights,
+    int channels, const float* scales, nvinfer1::INetworkDefinition* network);
+#endif
+
+#endif
@@ -9,21 +9,18 @@
 #include <cassert>
 
 nvinfer1::ITensor*
-reorgLayer(int layerIdx, std::map<std::string, std::string>& block, nvinfer1::ITensor* input,
+reorgLayer(int layerIdx, const LayerDesc& layer, nvinfer1::ITensor* input,
     nvinfer1::INetworkDefinition* network)
 {
   nvinfer1::ITensor* output;
 
-  assert(block.at("type") == "reorg" || block.at("type") == "reorg3d");
+  assert(layer.kind == LayerKind::kReorg || layer.kind == LayerKind::kReorg3d);
 
-  int stride = 1;
-  if(block.find("stride") != block.end()) {
-    stride = std::stoi(block.at("stride"));
-  }
+  int stride = layer.stride;
 
   nvinfer1::Dims inputDims = input->getDimensions();
 
-  if (block.at("type") == "reorg3d") {
+  if (layer.kind == LayerKind::kReorg3d) {
     std::string name1 = "slice1";
     std::string name2 = "slice2";
     std::string name3 = "slice3";
@@ -57,10 +54,12 @@ reorgLayer(int layerIdx, std::map<std::string, std::string>& block, nvinfer1::IT
     assert(concat != nullptr);
     std::string concatLayerName = "concat_" + std::to_string(layerIdx);
     concat->setName(concatLayerName.c_str());
-    concat->setAxis(0);
+    concat->setAxis(1);
     output = concat->getOutput(0);
   }
   else {
+    // darknet reorg 原先由 4 个 shuffle（3 次转置）实现，3 次转置合成一次：输入视为 [C / s², H, s, W, s]，
+    // 转置为 [s, s, C / s², H, W] 后按 [C * s², H / s, W / s] 解释，第二个 shuffle 只改形状，不移动数据
     nvinfer1::IShuffleLayer* shuffle1 = network->addShuffle(*input);
     assert(shuffle1 != nullptr);
     std::string shuffle1LayerName = "shuffle1_" + std::to_string(layerIdx);
@@ -68,7 +67,7 @@ reorgLayer(int layerIdx, std::map<std::string, std::string>& block, nvinfer1::IT
     nvinfer1::Dims reshapeDims1{6, {inputDims.d[0], inputDims.d[1] / (stride * stride), inputDims.d[2], stride,
         inputDims.d[3], stride}};
     shuffle1->setReshapeDimensions(reshapeDims1);
-    nvinfer1::Permutation permutation1{{0, 1, 2, 4, 3, 5}};
+    nvinfer1::Permutation permutation1{{0, 3, 5, 1, 2, 4}};
     shuffle1->setSecondTranspose(permutation1);
     output = shuffle1->getOutput(0);
 
@@ -76,32 +75,10 @@ reorgLayer(int layerIdx, std::map<std::string, std::string>& block, nvinfer1::IT
     assert(shuffle2 != nullptr);
     std::string shuffle2LayerName = "shuffle2_" + std::to_string(layerIdx);
     shuffle2->setName(shuffle2LayerName.c_str());
-    nvinfer1::Dims reshapeDims2{4, {inputDims.d[0], inputDims.d[1] / (stride * stride), inputDims.d[2] * inputDims.d[3],
-        stride * stride}};
+    nvinfer1::Dims reshapeDims2{4, {inputDims.d[0], inputDims.d[1] * stride * stride, inputDims.d[2] / stride,
+        inputDims.d[3] / stride}};
     shuffle2->setReshapeDimensions(reshapeDims2);
-    nvinfer1::Permutation permutation2{{0, 1, 3, 2}};
-    shuffle2->setSecondTranspose(permutation2);
     output = shuffle2->getOutput(0);
-
-    nvinfer1::IShuffleLayer* shuffle3 = network->addShuffle(*output);
-    assert(shuffle3 != nullptr);
-    std::string shuffle3LayerName = "shuffle3_" + std::to_string(layerIdx);
-    shuffle3->setName(shuffle3LayerName.c_str());
-    nvinfer1::Dims reshapeDims3{4, {inputDims.d[0], inputDims.d[1] / (stride * stride), stride * stride,
-        inputDims.d[2] * inputDims.d[3]}};
-    shuffle3->setReshapeDimensions(reshapeDims3);
-    nvinfer1::Permutation permutation3{{0, 2, 1, 3}};
-    shuffle3->setSecondTranspose(permutation3);
-    output = shuffle3->getOutput(0);
-
-    nvinfer1::IShuffleLayer* shuffle4 = network->addShuffle(*output);
-    assert(shuffle4 != nullptr);
-    std::string shuffle4LayerName = "shuffle4_" + std::to_string(layerIdx);
-    shuffle4->setName(shuffle4LayerName.c_str());
-    nvinfer1::Dims reshapeDims4{4, {inputDims.d[0], inputDims.d[1] * stride * stride, inputDims.d[2] / stride,
-        inputDims.d[3] / stride}};
-    shuffle4->setReshapeDimensions(reshapeDims4);
-    output = shuffle4->getOutput(0);
   }
 
   return output;
@@ -6,50 +6,29 @@
 #include "route_layer.h"
 
 nvinfer1::ITensor*
-routeLayer(int layerIdx, std::string& layers, std::map<std::string, std::string>& block,
-    std::vector<nvinfer1::ITensor*> tensorOutputs, nvinfer1::INetworkDefinition* network)
+routeLayer(int layerIdx, std::string& layers, const LayerDesc& layer,
+    const std::vector<nvinfer1::ITensor*>& tensorOutputs, nvinfer1::INetworkDefinition* network)
 {
   nvinfer1::ITensor* output;
 
-  assert(block.at("type") == "route");
-  assert(block.find("layers") != block.end());
+  assert(layer.kind == LayerKind::kRoute);
+  assert(!layer.inputs.empty());
 
-  std::string strLayers = block.at("layers");
-  std::vector<int> idxLayers;
-  size_t lastPos = 0, pos = 0;
-  while ((pos = strLayers.find(',', lastPos)) != std::string::npos) {
-    int vL = std::stoi(trim(strLayers.substr(lastPos, pos - lastPos)));
-    idxLayers.push_back(vL);
-    lastPos = pos + 1;
-  }
-  if (lastPos < strLayers.length()) {
-    std::string lastV = trim(strLayers.substr(lastPos));
-    if (!lastV.empty()) {
-      idxLayers.push_back(std::stoi(lastV));
-    }
-  }
-  assert(!idxLayers.empty());
   std::vector<nvinfer1::ITensor*> concatInputs;
-  for (uint i = 0; i < idxLayers.size(); ++i) {
-    if (idxLayers[i] < 0) {
-      idxLayers[i] = tensorOutputs.size() + idxLayers[i];
-    }
-    assert(idxLayers[i] >= 0 && idxLayers[i] < (int)tensorOutputs.size());
-    concatInputs.push_back(tensorOutputs[idxLayers[i]]);
-    if (i < idxLayers.size() - 1) {
-      layers += std::to_string(idxLayers[i]) + ", ";
+  for (uint i = 0; i < layer.inputs.size(); ++i) {
+    assert(layer.inputs[i] >= 0 && layer.inputs[i] < (int) tensorOutputs.size());
+    concatInputs.push_back(tensorOutputs[layer.inputs[i]]);
+    if (i < layer.inputs.size() - 1) {
+      layers += std::to_string(layer.inputs[i]) + ", ";
     }
   }
-  layers += std::to_string(idxLayers[idxLayers.size() - 1]);
+  layers += std::to_string(layer.inputs.back());
 
   if (concatInputs.size() == 1) {
     output = concatInputs[0];
   }
   else {
-    int axis = 1;
-    if (block.find("axis") != block.end()) {
-      axis += std::stoi(block.at("axis"));
-    }
+    int axis = layer.axis;
     if (axis < 0) {
       axis += concatInputs[0]->getDimensions().nbDims;
     }
@@ -62,10 +41,10 @@ routeLayer(int layerIdx, std::string& layers, std::map<std::string, std::string>
     output = concat->getOutput(0);
   }
 
-  if (block.find("groups") != block.end()) {
+  if (layer.routeGroups > 1) {
     nvinfer1::Dims prevTensorDims = output->getDimensions();
-    int groups = stoi(block.at("groups"));
-    int group_id = stoi(block.at("group_id"));
+    int groups = layer.routeGroups;
+    int group_id = layer.groupId;
     int startSlice = (prevTensorDims.d[1] / groups) * group_id;
     int channelSlice = (prevTensorDims.d[1] / groups);
 
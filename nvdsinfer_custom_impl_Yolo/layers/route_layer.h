@@ -9,8 +9,9 @@
 #include "../utils.h"
 
 #include "slice_layer.h"
+#include "../network_ir.h"
 
-nvinfer1::ITensor* routeLayer(int layerIdx, std::string& layers, std::map<std::string, std::string>& block,
-    std::vector<nvinfer1::ITensor*> tensorOutputs, nvinfer1::INetworkDefinition* network);
+nvinfer1::ITensor* routeLayer(int layerIdx, std::string& layers, const LayerDesc& layer,
+    const std::vector<nvinfer1::ITensor*>& tensorOutputs, nvinfer1::INetworkDefinition* network);
 
 #endif
@@ -8,12 +8,12 @@
 #include <cassert>
 
 nvinfer1::ITensor*
-samLayer(int layerIdx, std::string activation, std::map<std::string, std::string>& block, nvinfer1::ITensor* input,
-    nvinfer1::ITensor* samInput, nvinfer1::INetworkDefinition* network)
+samLayer(int layerIdx, const LayerDesc& layer, nvinfer1::ITensor* input, nvinfer1::ITensor* samInput,
+    nvinfer1::INetworkDefinition* network)
 {
   nvinfer1::ITensor* output;
 
-  assert(block.at("type") == "sam");
+  assert(layer.kind == LayerKind::kSam);
 
   nvinfer1::IElementWiseLayer* sam = network->addElementWise(*input, *samInput, nvinfer1::ElementWiseOperation::kPROD);
   assert(sam != nullptr);
@@ -21,7 +21,7 @@ samLayer(int layerIdx, std::string activation, std::map<std::string, std::string
   sam->setName(samLayerName.c_str());
   output = sam->getOutput(0);
 
-  output = activationLayer(layerIdx, activation, output, network);
+  output = activationLayer(layerIdx, layer.activation, output, network);
   assert(output != nullptr);
 
   return output;
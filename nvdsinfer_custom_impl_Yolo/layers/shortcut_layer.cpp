@@ -8,13 +8,12 @@
 #include <cassert>
 
 nvinfer1::ITensor*
-shortcutLayer(int layerIdx, std::string activation, std::string inputVol, std::string shortcutVol,
-    std::map<std::string, std::string>& block, nvinfer1::ITensor* input, nvinfer1::ITensor* shortcutInput,
-    nvinfer1::INetworkDefinition* network)
+shortcutLayer(int layerIdx, const LayerDesc& layer, std::string inputVol, std::string shortcutVol,
+    nvinfer1::ITensor* input, nvinfer1::ITensor* shortcutInput, nvinfer1::INetworkDefinition* network)
 {
   nvinfer1::ITensor* output;
 
-  assert(block.at("type") == "shortcut");
+  assert(layer.kind == LayerKind::kShortcut);
 
   if (inputVol != shortcutVol) {
     std::string name = "slice";
@@ -36,7 +35,7 @@ shortcutLayer(int layerIdx, std::string activation, std::string inputVol, std::s
   shortcut->setName(shortcutLayerName.c_str());
   output = shortcut->getOutput(0);
 
-  output = activationLayer(layerIdx, activation, output, network);
+  output = activationLayer(layerIdx, layer.activation, output, network);
   assert(output != nullptr);
 
   return output;
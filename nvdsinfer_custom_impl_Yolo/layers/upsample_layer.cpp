@@ -8,15 +8,14 @@
 #include <cassert>
 
 nvinfer1::ITensor*
-upsampleLayer(int layerIdx, std::map<std::string, std::string>& block, nvinfer1::ITensor* input,
+upsampleLayer(int layerIdx, const LayerDesc& layer, nvinfer1::ITensor* input,
     nvinfer1::INetworkDefinition* network)
 {
   nvinfer1::ITensor* output;
 
-  assert(block.at("type") == "upsample");
-  assert(block.find("stride") != block.end());
+  assert(layer.kind == LayerKind::kUpsample);
 
-  int stride = std::stoi(block.at("stride"));
+  int stride = layer.stride;
 
   float scale[4] = {1, 1, static_cast<float>(stride), static_cast<float>(stride)};
 
@@ -0,0 +1,427 @@
+#include "model_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "engine_cache.h"
+
+static_assert(sizeof(ModelPackHeader) == 64, "ModelPackHeader must be 64 bytes");
+
+namespace {
+
+const char MODEL_PACK_MAGIC[8] = {'D', 'S', 'Y', 'O', 'L', 'O', 'P', 'K'};
+const uint64_t MODEL_PACK_ALIGNMENT = 64;
+
+uint64_t
+alignUp(uint64_t value)
+{
+  return (value + MODEL_PACK_ALIGNMENT - 1) / MODEL_PACK_ALIGNMENT * MODEL_PACK_ALIGNMENT;
+}
+
+class PackWriter {
+  public:
+    void bytes(const void* data, size_t size) { m_Buffer.append(static_cast<const char*>(data), size); }
+
+    void i32(int32_t value) { bytes(&value, sizeof(value)); }
+
+    void i64(int64_t value) { bytes(&value, sizeof(value)); }
+
+    void f32(float value) { bytes(&value, sizeof(value)); }
+
+    void str(const std::string& value)
+    {
+      i32(value.size());
+      bytes(value.data(), value.size());
+    }
+
+    void ints(const std::vector<int>& values)
+    {
+      i32(values.size());
+      for (int value : values) {
+        i32(value);
+      }
+    }
+
+    void floats(const std::vector<float>& values)
+    {
+      i32(values.size());
+      bytes(values.data(), values.size() * sizeof(float));
+    }
+
+    const std::string& buffer() const { return m_Buffer; }
+
+  private:
+    std::string m_Buffer;
+};
+
+// 带越界检查的读取，任何一次越界后 failed() 为 true，之后的读取都返回 0
+class PackReader {
+  public:
+    PackReader(const char* data, uint64_t size) : m_Data(data), m_Size(size), m_Position(0), m_Failed(false) {}
+
+    bool bytes(void* out, uint64_t size)
+    {
+      if (m_Failed || size > m_Size - m_Position) {
+        m_Failed = true;
+        memset(out, 0, size);
+        return false;
+      }
+      memcpy(out, m_Data + m_Position, size);
+      m_Position += size;
+      return true;
+    }
+
+    int32_t i32()
+    {
+      int32_t value;
+      bytes(&value, sizeof(value));
+      return value;
+    }
+
+    int64_t i64()
+    {
+      int64_t value;
+      bytes(&value, sizeof(value));
+      return value;
+    }
+
+    float f32()
+    {
+      float value;
+      bytes(&value, sizeof(value));
+      return value;
+    }
+
+    // 长度先与剩余字节数比较，避免损坏的长度字段导致巨大的分配
+    bool length(int32_t& count, uint64_t elementBytes)
+    {
+      count = i32();
+      if (count < 0 || (uint64_t) count * elementBytes > m_Size - m_Position) {
+        m_Failed = true;
+        count = 0;
+      }
+      return !m_Failed;
+    }
+
+    std::string str()
+    {
+      int32_t count;
+      if (!length(count, 1)) {
+        return "";
+      }
+      std::string value(m_Data + m_Position, count);
+      m_Position += count;
+      return value;
+    }
+
+    std::vector<int> ints()
+    {
+      int32_t count;
+      std::vector<int> values;
+      if (length(count, sizeof(int32_t))) {
+        for (int32_t i = 0; i < count; ++i) {
+          values.push_back(i32());
+        }
+      }
+      return values;
+    }
+
+    std::vector<float> floats()
+    {
+      int32_t count;
+      std::vector<float> values;
+      if (length(count, sizeof(float))) {
+        values.resize(count);
+        bytes(values.data(), count * sizeof(float));
+      }
+      return values;
+    }
+
+    bool failed() const { return m_Failed; }
+
+  private:
+    const char* m_Data;
+    uint64_t m_Size;
+    uint64_t m_Position;
+    bool m_Failed;
+};
+
+void
+writeLayer(PackWriter& writer, const LayerDesc& layer)
+{
+  writer.i32(static_cast<int32_t>(layer.kind));
+  writer.str(layer.type);
+  writer.i32(layer.line);
+  writer.ints(layer.inputs);
+  writer.i32(layer.foldedInto);
+  writer.i32(layer.aliasOf);
+  writer.i32(layer.dead);
+  writer.i32(layer.filters);
+  writer.i32(layer.size);
+  writer.i32(layer.stride);
+  writer.i32(layer.pad);
+  writer.i32(layer.groups);
+  writer.i32(layer.batchNormalize);
+  writer.i32(layer.bias);
+  writer.f32(layer.eps);
+  writer.i32(static_cast<int32_t>(layer.activation));
+  writer.str(layer.activationName);
+  writer.i32(layer.axis);
+  writer.i32(layer.routeGroups);
+  writer.i32(layer.groupId);
+  writer.i32(layer.classes);
+  writer.i32(layer.num);
+  writer.i32(layer.newCoords);
+  writer.f32(layer.scaleXY);
+  writer.floats(layer.anchors);
+  writer.ints(layer.mask);
+}
+
+void
+readLayer(PackReader& reader, LayerDesc& layer)
+{
+  layer.kind = static_cast<LayerKind>(reader.i32());
+  layer.type = reader.str();
+  layer.line = reader.i32();
+  layer.inputs = reader.ints();
+  layer.foldedInto = reader.i32();
+  layer.aliasOf = reader.i32();
+  layer.dead = reader.i32() != 0;
+  layer.filters = reader.i32();
+  layer.size = reader.i32();
+  layer.stride = reader.i32();
+  layer.pad = reader.i32();
+  layer.groups = reader.i32();
+  layer.batchNormalize = reader.i32() != 0;
+  layer.bias = reader.i32() != 0;
+  layer.eps = reader.f32();
+  layer.activation = static_cast<ActivationKind>(reader.i32());
+  layer.activationName = reader.str();
+  layer.axis = reader.i32();
+  layer.routeGroups = reader.i32();
+  layer.groupId = reader.i32();
+  layer.classes = reader.i32();
+  layer.num = reader.i32();
+  layer.newCoords = reader.i32();
+  layer.scaleXY = reader.f32();
+  layer.anchors = reader.floats();
+  layer.mask = reader.ints();
+}
+
+}
+
+bool
+isModelPack(const std::string& filePath)
+{
+  std::ifstream file(filePath, std::ios::binary);
+  char magic[sizeof(MODEL_PACK_MAGIC)];
+  return file.read(magic, sizeof(magic)) && memcmp(magic, MODEL_PACK_MAGIC, sizeof(magic)) == 0;
+}
+
+bool
+writeModelPack(const std::string& filePath, const NetworkDesc& network, const std::vector<LayerWeights>& layerWeights,
+    std::string& error)
+{
+  if (layerWeights.size() != network.layers.size()) {
+    error = "layer weights do not match the network";
+    return false;
+  }
+
+  uint64_t weightsBytes = 0;
+  std::vector<uint64_t> kernelOffsets(layerWeights.size(), 0);
+  std::vector<uint64_t> biasOffsets(layerWeights.size(), 0);
+  for (size_t i = 0; i < layerWeights.size(); ++i) {
+    kernelOffsets[i] = weightsBytes;
+    weightsBytes = alignUp(weightsBytes + layerWeights[i].kernelCount * sizeof(float));
+    biasOffsets[i] = weightsBytes;
+    weightsBytes = alignUp(weightsBytes + layerWeights[i].biasCount * sizeof(float));
+  }
+
+  PackWriter writer;
+  writer.i32(network.channels);
+  writer.i32(network.height);
+  writer.i32(network.width);
+  writer.i32(network.letterBox);
+  writer.i32(network.layers.size());
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    writeLayer(writer, network.layers[i]);
+    writer.i64(kernelOffsets[i]);
+    writer.i64(layerWeights[i].kernelCount);
+    writer.i64(biasOffsets[i]);
+    writer.i64(layerWeights[i].biasCount);
+  }
+
+  ModelPackHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MODEL_PACK_MAGIC, sizeof(header.magic));
+  header.version = MODEL_PACK_VERSION;
+  header.headerBytes = sizeof(header);
+  header.networkOffset = sizeof(header);
+  header.networkBytes = writer.buffer().size();
+  header.weightsOffset = alignUp(header.networkOffset + header.networkBytes);
+  header.weightsBytes = weightsBytes;
+  header.fileBytes = header.weightsOffset + header.weightsBytes;
+
+  std::vector<char> data(header.fileBytes, 0);
+  memcpy(data.data() + header.networkOffset, writer.buffer().data(), header.networkBytes);
+  char* weights = data.data() + header.weightsOffset;
+  for (size_t i = 0; i < layerWeights.size(); ++i) {
+    if (layerWeights[i].kernelCount > 0) {
+      memcpy(weights + kernelOffsets[i], layerWeights[i].kernel, layerWeights[i].kernelCount * sizeof(float));
+    }
+    if (layerWeights[i].biasCount > 0) {
+      memcpy(weights + biasOffsets[i], layerWeights[i].bias, layerWeights[i].biasCount * sizeof(float));
+    }
+  }
+
+  Hasher64 hasher;
+  hasher.update(data.data() + sizeof(header), data.size() - sizeof(header));
+  header.checksum = hasher.digest();
+  memcpy(data.data(), &header, sizeof(header));
+
+  if (!writeFileAtomic(filePath, data.data(), data.size())) {
+    error = "could not write " + filePath;
+    return false;
+  }
+  return true;
+}
+
+ModelPack::ModelPack() : m_Mapping(nullptr), m_MappingSize(0), m_WeightsBytes(0)
+{
+}
+
+ModelPack::~ModelPack()
+{
+  close();
+}
+
+bool
+ModelPack::open(const std::string& filePath, std::string& error)
+{
+  close();
+
+  int fd = ::open(filePath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = "could not open " + filePath;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < sizeof(ModelPackHeader)) {
+    error = filePath + " is not a model pack";
+    ::close(fd);
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    error = "could not map " + filePath;
+    return false;
+  }
+  madvise(mapping, st.st_size, MADV_WILLNEED);
+
+  m_Mapping = mapping;
+  m_MappingSize = st.st_size;
+
+  const char* bytes = static_cast<const char*>(mapping);
+  ModelPackHeader header;
+  memcpy(&header, bytes, sizeof(header));
+
+  if (memcmp(header.magic, MODEL_PACK_MAGIC, sizeof(header.magic)) != 0) {
+    error = filePath + " is not a model pack";
+  }
+  else if (header.version != MODEL_PACK_VERSION) {
+    error = filePath + " has model pack version " + std::to_string(header.version) + ", expected " +
+        std::to_string(MODEL_PACK_VERSION) + ", rebuild it with yolo_tool pack";
+  }
+  else if (header.headerBytes != sizeof(header) || header.fileBytes != m_MappingSize ||
+      header.networkOffset < sizeof(header) || header.networkBytes > m_MappingSize - header.networkOffset ||
+      header.weightsOffset % MODEL_PACK_ALIGNMENT != 0 || header.weightsOffset > m_MappingSize ||
+      header.weightsBytes > m_MappingSize - header.weightsOffset) {
+    error = filePath + " is truncated or has an invalid header";
+  }
+  else {
+    Hasher64 hasher;
+    hasher.update(bytes + sizeof(header), m_MappingSize - sizeof(header));
+    if (hasher.digest() != header.checksum) {
+      error = filePath + " checksum mismatch";
+    }
+  }
+  if (!error.empty()) {
+    close();
+    return false;
+  }
+
+  PackReader reader(bytes + header.networkOffset, header.networkBytes);
+  m_Network.channels = reader.i32();
+  m_Network.height = reader.i32();
+  m_Network.width = reader.i32();
+  m_Network.letterBox = reader.i32();
+  int32_t layerCount = reader.i32();
+  if (layerCount < 0 || (uint64_t) layerCount > header.networkBytes) {
+    layerCount = 0;
+    error = filePath + " has an invalid layer count";
+  }
+
+  m_Network.layers.resize(layerCount);
+  m_LayerWeights.resize(layerCount);
+  const char* weights = bytes + header.weightsOffset;
+  for (int32_t i = 0; i < layerCount && error.empty(); ++i) {
+    LayerDesc& layer = m_Network.layers[i];
+    readLayer(reader, layer);
+
+    int64_t offsets[2];
+    int64_t counts[2];
+    for (int j = 0; j < 2; ++j) {
+      offsets[j] = reader.i64();
+      counts[j] = reader.i64();
+      if (counts[j] < 0 || offsets[j] < 0 || offsets[j] % MODEL_PACK_ALIGNMENT != 0 ||
+          (uint64_t) counts[j] * sizeof(float) > header.weightsBytes - std::min<uint64_t>(offsets[j],
+          header.weightsBytes)) {
+        error = filePath + ": invalid weights of layer " + std::to_string(i);
+      }
+    }
+    m_LayerWeights[i].kernel = counts[0] > 0 ? reinterpret_cast<const float*>(weights + offsets[0]) : nullptr;
+    m_LayerWeights[i].kernelCount = counts[0];
+    m_LayerWeights[i].bias = counts[1] > 0 ? reinterpret_cast<const float*>(weights + offsets[1]) : nullptr;
+    m_LayerWeights[i].biasCount = counts[1];
+
+    bool validKind = static_cast<int>(layer.kind) >= 0 && layer.kind <= LayerKind::kDropout &&
+        static_cast<int>(layer.activation) >= 0 && layer.activation <= ActivationKind::kHardSwish;
+    for (int input : layer.inputs) {
+      validKind &= input >= -1 && input < i;
+    }
+    validKind &= layer.aliasOf >= -1 && layer.aliasOf < i;
+    if (reader.failed() || !validKind) {
+      error = filePath + ": invalid description of layer " + std::to_string(i);
+    }
+  }
+
+  if (!error.empty()) {
+    close();
+    return false;
+  }
+
+  m_WeightsBytes = header.weightsBytes;
+  return true;
+}
+
+void
+ModelPack::close()
+{
+  if (m_Mapping != nullptr) {
+    munmap(m_Mapping, m_MappingSize);
+  }
+  m_Mapping = nullptr;
+  m_MappingSize = 0;
+  m_WeightsBytes = 0;
+  m_Network = NetworkDesc();
+  m_LayerWeights.clear();
+}
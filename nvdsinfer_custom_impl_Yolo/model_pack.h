@@ -0,0 +1,64 @@
+#ifndef __MODEL_PACK_H__
+#define __MODEL_PACK_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "network_ir.h"
+#include "network_weights.h"
+
+// 模型包文件头，64 字节；network 段为序列化的网络描述和每层权重表，weights 段为转换好的 float 权重，
+// 两段及其中每个数组都按 64 字节对齐。checksum 为文件头之后全部内容的 XXH64
+struct ModelPackHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t headerBytes;
+  uint64_t fileBytes;
+  uint64_t networkOffset;
+  uint64_t networkBytes;
+  uint64_t weightsOffset;
+  uint64_t weightsBytes;
+  uint64_t checksum;
+};
+
+// 网络描述或权重转换规则变化时递增，旧的模型包会被拒绝
+static const uint32_t MODEL_PACK_VERSION = 2;
+
+bool isModelPack(const std::string& filePath);
+
+bool writeModelPack(const std::string& filePath, const NetworkDesc& network,
+    const std::vector<LayerWeights>& layerWeights, std::string& error);
+
+// 以只读内存映射方式打开模型包，校验文件头和 checksum 后直接得到网络描述和每层权重（指向映射，不做拷贝）
+class ModelPack {
+  public:
+    ModelPack();
+
+    ~ModelPack();
+
+    bool open(const std::string& filePath, std::string& error);
+
+    void close();
+
+    bool isOpen() const { return m_Mapping != nullptr; }
+
+    const NetworkDesc& network() const { return m_Network; }
+
+    const std::vector<LayerWeights>& layerWeights() const { return m_LayerWeights; }
+
+    uint64_t weightsBytes() const { return m_WeightsBytes; }
+
+  private:
+    ModelPack(const ModelPack&);
+    ModelPack& operator=(const ModelPack&);
+
+    void* m_Mapping;
+    uint64_t m_MappingSize;
+    uint64_t m_WeightsBytes;
+    NetworkDesc m_Network;
+    std::vector<LayerWeights> m_LayerWeights;
+};
+
+#endif
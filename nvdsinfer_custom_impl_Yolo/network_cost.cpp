@@ -0,0 +1,279 @@
+#include "network_cost.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+
+namespace {
+
+// 每个元素的大致运算次数
+int
+activationFlops(ActivationKind activation)
+{
+  switch (activation) {
+    case ActivationKind::kLinear:
+      return 0;
+    case ActivationKind::kRelu:
+    case ActivationKind::kLeaky:
+      return 1;
+    case ActivationKind::kHardSigmoid:
+      return 2;
+    case ActivationKind::kHardSwish:
+      return 3;
+    case ActivationKind::kLogistic:
+    case ActivationKind::kTanh:
+    case ActivationKind::kSoftplus:
+      return 4;
+    case ActivationKind::kSilu:
+      return 5;
+    case ActivationKind::kMish:
+      return 9;
+  }
+  return 0;
+}
+
+std::string
+trim(const std::string& s)
+{
+  size_t begin = s.find_first_not_of(" \t\r");
+  size_t end = s.find_last_not_of(" \t\r");
+  return begin == std::string::npos ? "" : s.substr(begin, end - begin + 1);
+}
+
+}
+
+void
+computeLayerCosts(const NetworkDesc& network, const std::vector<TensorShape>& shapes, int elementBytes,
+    std::vector<LayerCost>& costs)
+{
+  costs.assign(network.layers.size(), LayerCost());
+
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerDesc& layer = network.layers[i];
+    LayerCost& cost = costs[i];
+    if (layer.dead || layer.aliasOf >= 0) {
+      continue;
+    }
+
+    int inputIndex = layer.inputs.empty() ? -1 : layer.inputs[0];
+    int64_t inputElements = inputIndex < 0 ? (int64_t) network.channels * network.height * network.width :
+        shapes[inputIndex].volume();
+    int inputChannels = inputIndex < 0 ? network.channels : shapes[inputIndex].c;
+    int64_t outputElements = shapes[i].volume();
+    int64_t kernelArea = (int64_t) layer.size * layer.size;
+
+    switch (layer.kind) {
+      case LayerKind::kConvolutional:
+        cost.macs = outputElements * (inputChannels / layer.groups) * kernelArea;
+        cost.flops = 2 * cost.macs + outputElements * activationFlops(layer.activation);
+        cost.paramBytes = ((int64_t) layer.filters * (inputChannels / layer.groups) * kernelArea + layer.filters) *
+            elementBytes;
+        break;
+      case LayerKind::kDeconvolutional:
+        cost.macs = inputElements * (layer.filters / layer.groups) * kernelArea;
+        cost.flops = 2 * cost.macs + outputElements * activationFlops(layer.activation);
+        cost.paramBytes = ((int64_t) layer.filters * (inputChannels / layer.groups) * kernelArea + layer.filters) *
+            elementBytes;
+        break;
+      case LayerKind::kBatchnorm:
+        // 并入卷积后只剩激活
+        cost.flops = outputElements * ((layer.foldedInto >= 0 ? 0 : 2) + activationFlops(layer.activation));
+        cost.paramBytes = layer.foldedInto >= 0 ? 0 : 2 * layer.filters * elementBytes;
+        break;
+      case LayerKind::kImplicit:
+        cost.paramBytes = layer.foldedInto >= 0 ? 0 : layer.filters * elementBytes;
+        break;
+      case LayerKind::kShiftChannels:
+      case LayerKind::kControlChannels:
+        if (layer.foldedInto >= 0) {
+          continue;
+        }
+        cost.flops = outputElements;
+        break;
+      case LayerKind::kShortcut:
+      case LayerKind::kSam:
+        cost.flops = outputElements * (1 + activationFlops(layer.activation));
+        inputElements += shapes[layer.inputs[1]].volume();
+        break;
+      case LayerKind::kMaxpool:
+        cost.flops = outputElements * kernelArea;
+        break;
+      case LayerKind::kAvgpool:
+        cost.flops = inputElements;
+        break;
+      case LayerKind::kReorg3d:
+        if (layer.foldedInto >= 0) {
+          continue;
+        }
+        break;
+      case LayerKind::kRoute:
+        // 多输入拼接通常由 TensorRT 直接写入目标位置，只有分组切片需要拷贝
+        if (layer.routeGroups == 1) {
+          continue;
+        }
+        break;
+      case LayerKind::kYolo:
+      case LayerKind::kRegion:
+      case LayerKind::kDropout:
+        continue;
+      default:
+        break;
+    }
+
+    cost.activationBytes = (inputElements + outputElements) * elementBytes;
+  }
+}
+
+bool
+loadDeviceProfile(const std::string& filePath, DeviceProfile& device, std::string& error)
+{
+  std::ifstream file(filePath);
+  if (!file.good()) {
+    error = "could not open " + filePath;
+    return false;
+  }
+
+  std::map<std::string, double*> numbers = {
+    {"fp32_tflops", &device.fp32Flops}, {"fp16_tflops", &device.fp16Flops}, {"int8_tops", &device.int8Ops},
+    {"bandwidth_gbs", &device.bandwidth}, {"efficiency", &device.efficiency}, {"memory_gb", &device.memoryBytes}
+  };
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    ++lineNumber;
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty()) {
+      continue;
+    }
+    size_t eq = line.find('=');
+    std::string key = trim(line.substr(0, eq));
+    std::string value = eq == std::string::npos ? "" : trim(line.substr(eq + 1));
+    if (key == "name") {
+      device.name = value;
+      continue;
+    }
+    auto it = numbers.find(key);
+    char* end = nullptr;
+    double number = strtod(value.c_str(), &end);
+    if (it == numbers.end() || value.empty() || *end != '\0' || number <= 0) {
+      error = filePath + ", line " + std::to_string(lineNumber) + ": invalid entry '" + line + "'";
+      return false;
+    }
+    *it->second = number;
+  }
+
+  device.fp32Flops *= 1e12;
+  device.fp16Flops *= 1e12;
+  device.int8Ops *= 1e12;
+  device.bandwidth *= 1e9;
+  device.memoryBytes *= 1024.0 * 1024.0 * 1024.0;
+
+  if (device.fp32Flops <= 0 || device.bandwidth <= 0 || device.efficiency > 1) {
+    error = filePath + " needs fp32_tflops and bandwidth_gbs, and efficiency <= 1";
+    return false;
+  }
+  return true;
+}
+
+int
+precisionBytes(const std::string& precision)
+{
+  return precision == "INT8" ? 1 : precision == "FP16" ? 2 : 4;
+}
+
+double
+devicePeakFlops(const DeviceProfile& device, const std::string& precision)
+{
+  // 没有给出低精度峰值时按 FP32 计算
+  if (precision == "INT8" && device.int8Ops > 0) {
+    return device.int8Ops;
+  }
+  if (precision != "FP32" && device.fp16Flops > 0) {
+    return device.fp16Flops;
+  }
+  return device.fp32Flops;
+}
+
+double
+estimateLatencyMs(const std::vector<LayerCost>& costs, const DeviceProfile& device, const std::string& precision,
+    int batch)
+{
+  double flops = devicePeakFlops(device, precision) * device.efficiency;
+  double bandwidth = device.bandwidth * device.efficiency;
+
+  double seconds = 0;
+  for (const LayerCost& cost : costs) {
+    double compute = (double) cost.flops * batch / flops;
+    double memory = ((double) cost.paramBytes + (double) cost.activationBytes * batch) / bandwidth;
+    seconds += std::max(compute, memory);
+  }
+  return seconds * 1000.0;
+}
+
+bool
+recommendInputSize(const NetworkDesc& network, const DeviceProfile& device, const std::string& precision,
+    double budgetMs, int maxBatch, std::vector<SizeCandidate>& candidates, SizeCandidate& best, std::string& error)
+{
+  const int kStep = 32;
+  int elementBytes = precisionBytes(precision);
+  double aspect = (double) network.width / network.height;
+  int minHeight = std::max(kStep, (network.height / 2) / kStep * kStep);
+  int maxHeight = std::max(minHeight, (network.height * 3 / 2) / kStep * kStep);
+
+  candidates.clear();
+  best = SizeCandidate();
+
+  for (int height = minHeight; height <= maxHeight; height += kStep) {
+    NetworkDesc resized = network;
+    resized.height = height;
+    resized.width = std::max(kStep, (int) (height * aspect / kStep + 0.5) * kStep);
+
+    std::vector<TensorShape> shapes;
+    std::string shapeError;
+    if (!inferLayerShapes(resized, shapes, shapeError)) {
+      continue;
+    }
+
+    std::vector<LayerCost> costs;
+    computeLayerCosts(resized, shapes, elementBytes, costs);
+    int64_t paramBytes = 0;
+    for (const LayerCost& cost : costs) {
+      paramBytes += cost.paramBytes;
+    }
+    int64_t peakBytes = planActivationMemory(resized, shapes).peakElements * elementBytes;
+
+    SizeCandidate candidate;
+    candidate.width = resized.width;
+    candidate.height = resized.height;
+    candidate.batch1LatencyMs = estimateLatencyMs(costs, device, precision, 1);
+    for (int batch = 1; batch <= maxBatch; ++batch) {
+      double latency = estimateLatencyMs(costs, device, precision, batch);
+      bool fitsMemory = device.memoryBytes <= 0 || paramBytes + peakBytes * batch <= device.memoryBytes;
+      if (latency > budgetMs || !fitsMemory) {
+        break;
+      }
+      candidate.batch = batch;
+      candidate.latencyMs = latency;
+    }
+    candidates.push_back(candidate);
+
+    if (candidate.batch > 0) {
+      best = candidate;
+    }
+  }
+
+  if (candidates.empty()) {
+    error = "no input size between " + std::to_string(minHeight) + " and " + std::to_string(maxHeight) +
+        " gives valid layer shapes";
+    return false;
+  }
+  if (best.batch == 0) {
+    error = "no input size fits a " + std::to_string(budgetMs) + " ms budget, the smallest (" +
+        std::to_string(candidates[0].width) + "x" + std::to_string(candidates[0].height) + ") needs " +
+        std::to_string(candidates[0].batch1LatencyMs) + " ms";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,67 @@
+#ifndef __NETWORK_COST_H__
+#define __NETWORK_COST_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "network_ir.h"
+#include "network_shapes.h"
+
+// 单个样本（batch 1）一层的计算量和访存量；参数只在每个 batch 读一次，激活按 batch 线性增长
+struct LayerCost
+{
+  int64_t macs {0};               // 卷积/反卷积的乘加次数
+  int64_t flops {0};              // 2 * macs 加上逐元素运算（激活、池化、相加等）
+  int64_t paramBytes {0};         // 融合后的权重
+  int64_t activationBytes {0};    // 读输入 + 写输出
+};
+
+// 按网络精度（"FP32"、"FP16"、"INT8"）的元素大小计算每层开销，恒等、删除和融合掉的层开销为 0
+void computeLayerCosts(const NetworkDesc& network, const std::vector<TensorShape>& shapes, int elementBytes,
+    std::vector<LayerCost>& costs);
+
+// 设备描述文件（key=value，# 开头为注释）：
+//   name=orin-nx
+//   fp32_tflops=1.9
+//   fp16_tflops=3.8
+//   int8_tops=7.6
+//   bandwidth_gbs=102
+//   efficiency=0.5        可选，实际能达到的峰值比例
+//   memory_gb=8           可选，用于限制 batch
+struct DeviceProfile
+{
+  std::string name;
+  double fp32Flops {0};
+  double fp16Flops {0};
+  double int8Ops {0};
+  double bandwidth {0};           // 字节/秒
+  double efficiency {0.5};
+  double memoryBytes {0};
+};
+
+bool loadDeviceProfile(const std::string& filePath, DeviceProfile& device, std::string& error);
+
+int precisionBytes(const std::string& precision);
+
+double devicePeakFlops(const DeviceProfile& device, const std::string& precision);
+
+// roofline 模型：每层取计算时间和访存时间中较大者，返回整个 batch 的延迟（毫秒）
+double estimateLatencyMs(const std::vector<LayerCost>& costs, const DeviceProfile& device,
+    const std::string& precision, int batch);
+
+struct SizeCandidate
+{
+  int width {0};
+  int height {0};
+  int batch {0};                  // 延迟预算和显存内最大的 batch，0 表示 batch 1 也超出预算
+  double latencyMs {0};           // 该 batch 的延迟
+  double batch1LatencyMs {0};
+};
+
+// 保持 [net] 的宽高比，以 32 为步长在 cfg 输入尺寸的 0.5~1.5 倍之间搜索，推算形状失败的尺寸跳过；
+// 推荐 batch 1 满足预算的最大尺寸，以及该尺寸下满足预算的最大 batch（不超过 maxBatch）
+bool recommendInputSize(const NetworkDesc& network, const DeviceProfile& device, const std::string& precision,
+    double budgetMs, int maxBatch, std::vector<SizeCandidate>& candidates, SizeCandidate& best, std::string& error);
+
+#endif
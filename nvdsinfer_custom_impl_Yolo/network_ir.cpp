@@ -0,0 +1,514 @@
+#include "network_ir.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+// 构建网络用到的 cfg 键，读入时即映射为下标，其余训练参数直接忽略
+enum CfgKey
+{
+  kKeyFilters,
+  kKeySize,
+  kKeyStride,
+  kKeyPad,
+  kKeyPadding,
+  kKeyGroups,
+  kKeyActivation,
+  kKeyBatchNormalize,
+  kKeyBias,
+  kKeyEps,
+  kKeyFrom,
+  kKeyLayers,
+  kKeyAxis,
+  kKeyGroupId,
+  kKeyChannels,
+  kKeyHeight,
+  kKeyWidth,
+  kKeyLetterBox,
+  kKeyClasses,
+  kKeyNum,
+  kKeyAnchors,
+  kKeyMask,
+  kKeyScaleXY,
+  kKeyNewCoords,
+  kKeyCount
+};
+
+const char* kKeyNames[kKeyCount] = {"filters", "size", "stride", "pad", "padding", "groups", "activation",
+    "batch_normalize", "bias", "eps", "from", "layers", "axis", "group_id", "channels", "height", "width", "letter_box",
+    "classes", "num", "anchors", "mask", "scale_x_y", "new_coords"};
+
+struct CfgBlock
+{
+  std::string type;
+  int line {0};
+  uint32_t present {0};
+  std::string values[kKeyCount];
+
+  bool has(CfgKey key) const { return (present >> key) & 1; }
+};
+
+const std::unordered_map<std::string, int>&
+cfgKeys()
+{
+  static std::unordered_map<std::string, int> keys;
+  if (keys.empty()) {
+    for (int i = 0; i < kKeyCount; ++i) {
+      keys[kKeyNames[i]] = i;
+    }
+  }
+  return keys;
+}
+
+const std::unordered_map<std::string, LayerKind>&
+layerKinds()
+{
+  static const std::unordered_map<std::string, LayerKind> kinds = {
+    {"conv", LayerKind::kConvolutional}, {"convolutional", LayerKind::kConvolutional},
+    {"deconv", LayerKind::kDeconvolutional}, {"deconvolutional", LayerKind::kDeconvolutional},
+    {"batchnorm", LayerKind::kBatchnorm},
+    {"implicit", LayerKind::kImplicit}, {"implicit_add", LayerKind::kImplicit}, {"implicit_mul", LayerKind::kImplicit},
+    {"shift_channels", LayerKind::kShiftChannels}, {"control_channels", LayerKind::kControlChannels},
+    {"shortcut", LayerKind::kShortcut}, {"sam", LayerKind::kSam}, {"route", LayerKind::kRoute},
+    {"upsample", LayerKind::kUpsample},
+    {"max", LayerKind::kMaxpool}, {"maxpool", LayerKind::kMaxpool},
+    {"avg", LayerKind::kAvgpool}, {"avgpool", LayerKind::kAvgpool},
+    {"reorg", LayerKind::kReorg}, {"reorg3d", LayerKind::kReorg3d},
+    {"yolo", LayerKind::kYolo}, {"region", LayerKind::kRegion}, {"dropout", LayerKind::kDropout}
+  };
+  return kinds;
+}
+
+const std::unordered_map<std::string, ActivationKind>&
+activationKinds()
+{
+  static const std::unordered_map<std::string, ActivationKind> kinds = {
+    {"linear", ActivationKind::kLinear}, {"relu", ActivationKind::kRelu},
+    {"sigmoid", ActivationKind::kLogistic}, {"logistic", ActivationKind::kLogistic},
+    {"tanh", ActivationKind::kTanh}, {"leaky", ActivationKind::kLeaky}, {"softplus", ActivationKind::kSoftplus},
+    {"mish", ActivationKind::kMish}, {"silu", ActivationKind::kSilu}, {"swish", ActivationKind::kSilu},
+    {"hardsigmoid", ActivationKind::kHardSigmoid}, {"hardswish", ActivationKind::kHardSwish}
+  };
+  return kinds;
+}
+
+std::string
+trimValue(const std::string& s)
+{
+  size_t begin = s.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  size_t end = s.find_last_not_of(" \t\r\n");
+  return s.substr(begin, end - begin + 1);
+}
+
+bool
+toInt(const std::string& value, int& result)
+{
+  if (value.empty()) {
+    return false;
+  }
+  char* end = nullptr;
+  errno = 0;
+  long parsed = std::strtol(value.c_str(), &end, 10);
+  if (errno != 0 || *end != '\0' || parsed < INT32_MIN || parsed > INT32_MAX) {
+    return false;
+  }
+  result = static_cast<int>(parsed);
+  return true;
+}
+
+bool
+toFloat(const std::string& value, float& result)
+{
+  if (value.empty()) {
+    return false;
+  }
+  char* end = nullptr;
+  errno = 0;
+  float parsed = std::strtof(value.c_str(), &end);
+  if (errno != 0 || *end != '\0') {
+    return false;
+  }
+  result = parsed;
+  return true;
+}
+
+std::vector<std::string>
+splitList(const std::string& value)
+{
+  std::vector<std::string> items;
+  size_t lastPos = 0;
+  while (lastPos <= value.size()) {
+    size_t pos = value.find(',', lastPos);
+    std::string item = trimValue(value.substr(lastPos, pos == std::string::npos ? pos : pos - lastPos));
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+    if (pos == std::string::npos) {
+      break;
+    }
+    lastPos = pos + 1;
+  }
+  return items;
+}
+
+// 读取一个块的键值，出错时写入带行号的错误信息
+class BlockReader
+{
+  public:
+    BlockReader(const CfgBlock& block, int layerIdx, std::string& error) : m_Block(block), m_LayerIdx(layerIdx),
+        m_Error(error) {}
+
+    bool fail(const std::string& message)
+    {
+      std::ostringstream os;
+      os << "line " << m_Block.line << ": [" << m_Block.type << "]";
+      if (m_LayerIdx >= 0) {
+        os << " (layer " << m_LayerIdx << ")";
+      }
+      os << " " << message;
+      m_Error = os.str();
+      return false;
+    }
+
+    bool readInt(CfgKey key, int& value, bool required = false)
+    {
+      if (!m_Block.has(key)) {
+        return required ? missing(key) : true;
+      }
+      if (!toInt(m_Block.values[key], value)) {
+        return invalid(key);
+      }
+      return true;
+    }
+
+    bool readPositive(CfgKey key, int& value, bool required = false)
+    {
+      if (!readInt(key, value, required)) {
+        return false;
+      }
+      return value > 0 ? true : invalid(key);
+    }
+
+    bool readFloat(CfgKey key, float& value, bool required = false)
+    {
+      if (!m_Block.has(key)) {
+        return required ? missing(key) : true;
+      }
+      if (!toFloat(m_Block.values[key], value)) {
+        return invalid(key);
+      }
+      return true;
+    }
+
+    bool readIntList(CfgKey key, std::vector<int>& values, bool required = false)
+    {
+      if (!m_Block.has(key)) {
+        return required ? missing(key) : true;
+      }
+      values.clear();
+      for (const std::string& item : splitList(m_Block.values[key])) {
+        int value;
+        if (!toInt(item, value)) {
+          return invalid(key);
+        }
+        values.push_back(value);
+      }
+      return !values.empty() || !required ? true : invalid(key);
+    }
+
+    bool readFloatList(CfgKey key, std::vector<float>& values, bool required = false)
+    {
+      if (!m_Block.has(key)) {
+        return required ? missing(key) : true;
+      }
+      values.clear();
+      for (const std::string& item : splitList(m_Block.values[key])) {
+        float value;
+        if (!toFloat(item, value)) {
+          return invalid(key);
+        }
+        values.push_back(value);
+      }
+      return !values.empty() || !required ? true : invalid(key);
+    }
+
+    bool readActivation(const std::string& defaultName, LayerDesc& layer)
+    {
+      layer.activationName = m_Block.has(kKeyActivation) ? m_Block.values[kKeyActivation] : defaultName;
+      auto it = activationKinds().find(layer.activationName);
+      if (it == activationKinds().end()) {
+        return fail("activation not supported: " + layer.activationName);
+      }
+      layer.activation = it->second;
+      return true;
+    }
+
+    // darknet 的相对/绝对层号转换为绝对层号，只能引用之前的层
+    bool resolveLayer(CfgKey key, int index, int& resolved)
+    {
+      resolved = index < 0 ? m_LayerIdx + index : index;
+      if (resolved < 0 || resolved >= m_LayerIdx) {
+        return fail("'" + std::string(kKeyNames[key]) + "' references layer " + std::to_string(index) +
+            ", expected one of the previous layers");
+      }
+      return true;
+    }
+
+  private:
+    bool missing(CfgKey key) { return fail("missing '" + std::string(kKeyNames[key]) + "'"); }
+
+    bool invalid(CfgKey key)
+    {
+      return fail("invalid '" + std::string(kKeyNames[key]) + "' value: " + m_Block.values[key]);
+    }
+
+    const CfgBlock& m_Block;
+    const int m_LayerIdx;
+    std::string& m_Error;
+};
+
+bool
+parseConvolution(BlockReader& reader, LayerDesc& layer)
+{
+  int padFlag = 0;
+  int batchNormalize = 0;
+  if (!reader.readPositive(kKeyFilters, layer.filters, true) || !reader.readPositive(kKeySize, layer.size, true) ||
+      !reader.readPositive(kKeyStride, layer.stride, true) || !reader.readInt(kKeyPad, padFlag) ||
+      !reader.readInt(kKeyPadding, layer.pad) || !reader.readPositive(kKeyGroups, layer.groups) ||
+      !reader.readInt(kKeyBatchNormalize, batchNormalize) || !reader.readFloat(kKeyEps, layer.eps) ||
+      !reader.readActivation("logistic", layer)) {
+    return false;
+  }
+
+  if (padFlag != 0) {
+    layer.pad = (layer.size - 1) / 2;
+  }
+  if (layer.pad < 0) {
+    return reader.fail("invalid padding " + std::to_string(layer.pad));
+  }
+  if (layer.filters % layer.groups != 0) {
+    return reader.fail("filters " + std::to_string(layer.filters) + " not divisible by groups " +
+        std::to_string(layer.groups));
+  }
+
+  layer.batchNormalize = batchNormalize != 0;
+  int bias = layer.batchNormalize ? 0 : 1;
+  if (!reader.readInt(kKeyBias, bias)) {
+    return false;
+  }
+  layer.bias = bias != 0;
+  return true;
+}
+
+bool
+parseDetection(BlockReader& reader, LayerDesc& layer)
+{
+  if (!reader.readPositive(kKeyClasses, layer.classes, true) || !reader.readPositive(kKeyNum, layer.num, true) ||
+      !reader.readFloatList(kKeyAnchors, layer.anchors, true) || !reader.readIntList(kKeyMask, layer.mask) ||
+      !reader.readFloat(kKeyScaleXY, layer.scaleXY) || !reader.readInt(kKeyNewCoords, layer.newCoords)) {
+    return false;
+  }
+
+  int numAnchors = layer.anchors.size() / 2;
+  for (int mask : layer.mask) {
+    if (mask < 0 || mask >= numAnchors) {
+      return reader.fail("mask " + std::to_string(mask) + " out of range for " + std::to_string(numAnchors) +
+          " anchors");
+    }
+  }
+  return true;
+}
+
+bool
+parseLayer(const CfgBlock& block, int layerIdx, LayerDesc& layer, std::string& error)
+{
+  BlockReader reader(block, layerIdx, error);
+
+  auto kind = layerKinds().find(block.type);
+  if (kind == layerKinds().end()) {
+    return reader.fail("unsupported layer type");
+  }
+
+  layer.kind = kind->second;
+  layer.type = block.type;
+  layer.line = block.line;
+  layer.inputs.assign(1, layerIdx - 1);
+
+  switch (layer.kind) {
+    case LayerKind::kConvolutional:
+    case LayerKind::kDeconvolutional:
+      return parseConvolution(reader, layer);
+    case LayerKind::kBatchnorm:
+      return reader.readPositive(kKeyFilters, layer.filters, true) && reader.readFloat(kKeyEps, layer.eps) &&
+          reader.readActivation("linear", layer);
+    case LayerKind::kImplicit:
+      layer.inputs.clear();
+      return reader.readPositive(kKeyFilters, layer.filters, true);
+    case LayerKind::kShiftChannels:
+    case LayerKind::kControlChannels:
+    case LayerKind::kShortcut:
+    case LayerKind::kSam: {
+      int from = 0;
+      int resolved = 0;
+      if (!reader.readInt(kKeyFrom, from, true) || !reader.resolveLayer(kKeyFrom, from, resolved)) {
+        return false;
+      }
+      layer.inputs.push_back(resolved);
+      bool channels = layer.kind == LayerKind::kShiftChannels || layer.kind == LayerKind::kControlChannels;
+      return channels || reader.readActivation("linear", layer);
+    }
+    case LayerKind::kRoute: {
+      std::vector<int> indices;
+      int axis = 0;
+      if (!reader.readIntList(kKeyLayers, indices, true) || !reader.readInt(kKeyAxis, axis) ||
+          !reader.readPositive(kKeyGroups, layer.routeGroups) || !reader.readInt(kKeyGroupId, layer.groupId)) {
+        return false;
+      }
+      layer.inputs.clear();
+      for (int index : indices) {
+        int resolved = 0;
+        if (!reader.resolveLayer(kKeyLayers, index, resolved)) {
+          return false;
+        }
+        layer.inputs.push_back(resolved);
+      }
+      layer.axis = 1 + axis;
+      if (layer.groupId < 0 || layer.groupId >= layer.routeGroups) {
+        return reader.fail("group_id " + std::to_string(layer.groupId) + " out of range for " +
+            std::to_string(layer.routeGroups) + " groups");
+      }
+      return true;
+    }
+    case LayerKind::kUpsample:
+      return reader.readPositive(kKeyStride, layer.stride, true);
+    case LayerKind::kMaxpool:
+      return reader.readPositive(kKeySize, layer.size, true) && reader.readPositive(kKeyStride, layer.stride, true);
+    case LayerKind::kReorg:
+    case LayerKind::kReorg3d:
+      return reader.readPositive(kKeyStride, layer.stride);
+    case LayerKind::kYolo:
+    case LayerKind::kRegion:
+      return parseDetection(reader, layer);
+    case LayerKind::kAvgpool:
+    case LayerKind::kDropout:
+      return true;
+  }
+  return true;
+}
+
+bool
+parseNet(const CfgBlock& block, NetworkDesc& network, std::string& error)
+{
+  BlockReader reader(block, -1, error);
+  if (block.type != "net" && block.type != "network") {
+    return reader.fail("expected [net] as the first block");
+  }
+  return reader.readPositive(kKeyChannels, network.channels, true) &&
+      reader.readPositive(kKeyHeight, network.height, true) && reader.readPositive(kKeyWidth, network.width, true) &&
+      reader.readInt(kKeyLetterBox, network.letterBox);
+}
+
+}
+
+bool
+parseNetworkConfig(std::istream& stream, NetworkDesc& network, std::string& error)
+{
+  network = NetworkDesc();
+
+  const std::unordered_map<std::string, int>& keys = cfgKeys();
+  std::vector<CfgBlock> blocks;
+  std::string line;
+  int lineNumber = 0;
+
+  while (std::getline(stream, line)) {
+    ++lineNumber;
+    line = trimValue(line);
+    if (line.empty() || line.front() == '#' || line.front() == ';') {
+      continue;
+    }
+
+    if (line.front() == '[') {
+      if (line.back() != ']') {
+        error = "line " + std::to_string(lineNumber) + ": invalid block header " + line;
+        return false;
+      }
+      blocks.push_back(CfgBlock());
+      blocks.back().type = trimValue(line.substr(1, line.size() - 2));
+      blocks.back().line = lineNumber;
+      continue;
+    }
+
+    size_t cpos = line.find('=');
+    if (cpos == std::string::npos || blocks.empty()) {
+      error = "line " + std::to_string(lineNumber) + ": unexpected line " + line;
+      return false;
+    }
+
+    auto key = keys.find(trimValue(line.substr(0, cpos)));
+    if (key == keys.end()) {
+      continue;
+    }
+    CfgBlock& block = blocks.back();
+    if (!block.has(static_cast<CfgKey>(key->second))) {
+      block.present |= 1u << key->second;
+      block.values[key->second] = trimValue(line.substr(cpos + 1));
+    }
+  }
+
+  if (blocks.empty()) {
+    error = "empty cfg";
+    return false;
+  }
+  if (!parseNet(blocks.front(), network, error)) {
+    return false;
+  }
+
+  network.layers.resize(blocks.size() - 1);
+  int detectionLayers = 0;
+  for (size_t i = 1; i < blocks.size(); ++i) {
+    LayerDesc& layer = network.layers[i - 1];
+    if (!parseLayer(blocks[i], i - 1, layer, error)) {
+      return false;
+    }
+    if (layer.kind == LayerKind::kYolo || layer.kind == LayerKind::kRegion) {
+      ++detectionLayers;
+    }
+  }
+
+  if (detectionLayers == 0) {
+    error = "no [yolo] or [region] layer in cfg";
+    return false;
+  }
+
+  return true;
+}
+
+bool
+parseNetworkConfigFile(const std::string& cfgFilePath, NetworkDesc& network, std::string& error)
+{
+  std::ifstream file(cfgFilePath);
+  if (!file.good()) {
+    error = "could not open " + cfgFilePath;
+    return false;
+  }
+  if (!parseNetworkConfig(file, network, error)) {
+    error = cfgFilePath + ", " + error;
+    return false;
+  }
+  return true;
+}
+
+std::string
+layerError(const LayerDesc& layer, int index, const std::string& message)
+{
+  return "layer " + std::to_string(index) + " [" + layer.type + "] (cfg line " + std::to_string(layer.line) + "): " +
+      message;
+}
@@ -0,0 +1,99 @@
+#ifndef __NETWORK_IR_H__
+#define __NETWORK_IR_H__
+
+#include <istream>
+#include <string>
+#include <vector>
+
+// cfg 中支持的层类型，解析时一次确定，构建网络时按枚举分派
+enum class LayerKind
+{
+  kConvolutional,
+  kDeconvolutional,
+  kBatchnorm,
+  kImplicit,
+  kShiftChannels,
+  kControlChannels,
+  kShortcut,
+  kSam,
+  kRoute,
+  kUpsample,
+  kMaxpool,
+  kAvgpool,
+  kReorg,
+  kReorg3d,
+  kYolo,
+  kRegion,
+  kDropout
+};
+
+enum class ActivationKind
+{
+  kLinear,
+  kRelu,
+  kLogistic,
+  kTanh,
+  kLeaky,
+  kSoftplus,
+  kMish,
+  kSilu,
+  kHardSigmoid,
+  kHardSwish
+};
+
+// 一个 darknet 层的类型化描述，所有数值在解析时校验并转换好
+struct LayerDesc
+{
+  LayerKind kind {LayerKind::kDropout};
+  std::string type;                 // cfg 中的原始类型名，用于打印和层命名
+  int line {0};                     // 块在 cfg 文件中的行号
+  std::vector<int> inputs;          // 已解析的输入层下标（darknet 层号），-1 表示网络输入
+  int foldedInto {-1};              // 已融合进该层的权重时不再单独构建，输出即为输入
+  int aliasOf {-1};                 // 图优化后输出即为该层的输出（恒等 route、dropout、重复的计算）
+  bool dead {false};                // 图优化后不影响任何 yolo/region 输出，不再构建
+
+  // convolutional / deconvolutional / batchnorm / implicit
+  int filters {0};
+  int size {1};
+  int stride {1};
+  int pad {0};                      // 实际 padding 像素数
+  int groups {1};
+  bool batchNormalize {false};
+  bool bias {true};
+  float eps {1.0e-5f};
+
+  ActivationKind activation {ActivationKind::kLinear};
+  std::string activationName {"linear"};
+
+  // route
+  int axis {1};                     // 含 batch 维的拼接维度
+  int routeGroups {1};
+  int groupId {0};
+
+  // yolo / region
+  int classes {0};
+  int num {0};
+  int newCoords {0};
+  float scaleXY {1.0f};
+  std::vector<float> anchors;
+  std::vector<int> mask;
+};
+
+struct NetworkDesc
+{
+  int channels {0};
+  int height {0};
+  int width {0};
+  int letterBox {0};
+  std::vector<LayerDesc> layers;    // layers[i] 即 darknet 第 i 层（不含 [net]）
+};
+
+// 解析并校验 cfg，失败时返回 false 并在 error 中给出行号和原因
+bool parseNetworkConfig(std::istream& stream, NetworkDesc& network, std::string& error);
+
+bool parseNetworkConfigFile(const std::string& cfgFilePath, NetworkDesc& network, std::string& error);
+
+// 解析之后的检查（形状、权重）统一的错误格式："layer N [type] (cfg line L): message"
+std::string layerError(const LayerDesc& layer, int index, const std::string& message);
+
+#endif
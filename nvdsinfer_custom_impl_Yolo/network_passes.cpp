@@ -0,0 +1,262 @@
+#include "network_passes.h"
+
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+// 只有无权重、结果只由输入和参数决定的层才能合并
+bool
+isMergeable(LayerKind kind)
+{
+  switch (kind) {
+    case LayerKind::kShortcut:
+    case LayerKind::kSam:
+    case LayerKind::kRoute:
+    case LayerKind::kUpsample:
+    case LayerKind::kMaxpool:
+    case LayerKind::kAvgpool:
+    case LayerKind::kReorg:
+    case LayerKind::kReorg3d:
+      return true;
+    default:
+      return false;
+  }
+}
+
+std::string
+layerKey(const NetworkDesc& network, const LayerDesc& layer)
+{
+  std::string key = std::to_string(static_cast<int>(layer.kind)) + ":";
+  for (int input : layer.inputs) {
+    key += std::to_string(resolveLayerOutput(network, input)) + ",";
+  }
+  int params[] = {layer.size, layer.stride, layer.pad, layer.groups, layer.axis, layer.routeGroups, layer.groupId,
+      static_cast<int>(layer.activation)};
+  for (int param : params) {
+    key += ":" + std::to_string(param);
+  }
+  return key;
+}
+
+// 每层的输出被多少个未删除的层使用（按 aliasOf 归到实际提供输出的层）
+std::vector<int>
+countConsumers(const NetworkDesc& network)
+{
+  std::vector<int> consumers(network.layers.size(), 0);
+  for (const LayerDesc& layer : network.layers) {
+    if (layer.dead || layer.aliasOf >= 0) {
+      continue;
+    }
+    for (int input : layer.inputs) {
+      int output = resolveLayerOutput(network, input);
+      if (output >= 0) {
+        ++consumers[output];
+      }
+    }
+  }
+  return consumers;
+}
+
+}
+
+int
+resolveLayerOutput(const NetworkDesc& network, int index)
+{
+  while (index >= 0 && network.layers[index].aliasOf >= 0) {
+    index = network.layers[index].aliasOf;
+  }
+  return index;
+}
+
+void
+removeIdentityLayers(NetworkDesc& network, NetworkPassStats& stats)
+{
+  for (LayerDesc& layer : network.layers) {
+    bool identity = (layer.kind == LayerKind::kRoute && layer.inputs.size() == 1 && layer.routeGroups == 1) ||
+        layer.kind == LayerKind::kDropout;
+    if (identity && layer.aliasOf < 0 && layer.inputs[0] >= 0) {
+      layer.aliasOf = resolveLayerOutput(network, layer.inputs[0]);
+      ++stats.identityLayers;
+    }
+  }
+}
+
+void
+cascadeSppPools(NetworkDesc& network, NetworkPassStats& stats)
+{
+  std::vector<LayerDesc>& layers = network.layers;
+  // 每个输入上已有的 maxpool 及其相对该输入的等效窗口
+  std::unordered_map<int, std::vector<std::pair<int, int>>> pools;
+
+  for (size_t i = 0; i < layers.size(); ++i) {
+    LayerDesc& layer = layers[i];
+    if (layer.kind != LayerKind::kMaxpool || layer.stride != 1 || layer.size % 2 == 0 || layer.aliasOf >= 0) {
+      continue;
+    }
+    int input = resolveLayerOutput(network, layer.inputs[0]);
+    std::vector<std::pair<int, int>>& previous = pools[input];
+
+    int best = -1;
+    int bestSize = 1;
+    for (const std::pair<int, int>& pool : previous) {
+      if (pool.second < layer.size && pool.second > bestSize) {
+        best = pool.first;
+        bestSize = pool.second;
+      }
+    }
+    previous.push_back(std::make_pair((int) i, layer.size));
+
+    if (best >= 0) {
+      layer.inputs[0] = best;
+      layer.size -= bestSize - 1;
+      ++stats.cascadedPools;
+    }
+  }
+}
+
+void
+mergeCommonLayers(NetworkDesc& network, NetworkPassStats& stats)
+{
+  std::unordered_map<std::string, int> seen;
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    LayerDesc& layer = network.layers[i];
+    if (!isMergeable(layer.kind) || layer.aliasOf >= 0) {
+      continue;
+    }
+    auto inserted = seen.insert(std::make_pair(layerKey(network, layer), (int) i));
+    if (!inserted.second) {
+      layer.aliasOf = inserted.first->second;
+      ++stats.mergedLayers;
+    }
+  }
+}
+
+void
+eliminateDeadLayers(NetworkDesc& network, NetworkPassStats& stats)
+{
+  std::vector<LayerDesc>& layers = network.layers;
+  std::vector<bool> live(layers.size(), false);
+
+  // 输入层号总是小于当前层，倒序一遍即可传播完
+  for (int i = layers.size() - 1; i >= 0; --i) {
+    LayerDesc& layer = layers[i];
+    if ((layer.kind == LayerKind::kYolo || layer.kind == LayerKind::kRegion) && !layer.dead) {
+      live[i] = true;
+    }
+    if (!live[i]) {
+      if (!layer.dead) {
+        layer.dead = true;
+        ++stats.deadLayers;
+      }
+      continue;
+    }
+    if (layer.aliasOf >= 0) {
+      live[layer.aliasOf] = true;
+      continue;
+    }
+    for (int input : layer.inputs) {
+      if (input >= 0) {
+        live[input] = true;
+      }
+    }
+  }
+}
+
+void
+foldActivationChains(NetworkDesc& network, NetworkPassStats& stats)
+{
+  std::vector<LayerDesc>& layers = network.layers;
+  std::vector<int> consumers = countConsumers(network);
+
+  for (size_t i = 0; i < layers.size(); ++i) {
+    LayerDesc& layer = layers[i];
+    if (layer.kind != LayerKind::kBatchnorm || layer.dead || layer.foldedInto >= 0) {
+      continue;
+    }
+    int conv = resolveLayerOutput(network, layer.inputs[0]);
+    if (conv < 0 || layers[conv].kind != LayerKind::kConvolutional || layers[conv].dead ||
+        layers[conv].activation != ActivationKind::kLinear || consumers[conv] != 1) {
+      continue;
+    }
+    layer.foldedInto = conv;
+    ++stats.foldedBatchnorms;
+  }
+}
+
+void
+optimizeNetwork(NetworkDesc& network, NetworkPassStats& stats)
+{
+  for (LayerDesc& layer : network.layers) {
+    layer.aliasOf = -1;
+    layer.dead = false;
+    if (layer.kind == LayerKind::kBatchnorm) {
+      layer.foldedInto = -1;
+    }
+  }
+
+  removeIdentityLayers(network, stats);
+  cascadeSppPools(network, stats);
+  mergeCommonLayers(network, stats);
+  eliminateDeadLayers(network, stats);
+  foldActivationChains(network, stats);
+}
+
+bool
+pruneYoloHeads(NetworkDesc& network, const std::string& heads, NetworkPassStats& stats, std::string& error)
+{
+  std::vector<LayerDesc>& layers = network.layers;
+  std::unordered_map<std::string, int> outputs;
+  std::string available;
+  for (size_t i = 0; i < layers.size(); ++i) {
+    if ((layers[i].kind == LayerKind::kYolo || layers[i].kind == LayerKind::kRegion) && !layers[i].dead) {
+      std::string name = layers[i].type + "_" + std::to_string(i + 1);
+      outputs[name] = i;
+      available += (available.empty() ? "" : ", ") + name;
+    }
+  }
+
+  int pruned = 0;
+  std::istringstream list(heads);
+  std::string name;
+  while (std::getline(list, name, ',')) {
+    name.erase(0, name.find_first_not_of(" \t"));
+    name.erase(name.find_last_not_of(" \t") + 1);
+    if (name.empty()) {
+      continue;
+    }
+    auto it = outputs.find(name);
+    if (it == outputs.end()) {
+      error = "no output head named '" + name + "' (available: " + available + ")";
+      return false;
+    }
+    if (!layers[it->second].dead) {
+      layers[it->second].dead = true;
+      ++pruned;
+    }
+  }
+  stats.prunedHeads += pruned;
+
+  if (pruned == (int) outputs.size()) {
+    error = "cannot prune every output head (" + available + ")";
+    return false;
+  }
+
+  eliminateDeadLayers(network, stats);
+
+  // 剩余各层的输入必须都还在构建
+  for (size_t i = 0; i < layers.size(); ++i) {
+    const LayerDesc& layer = layers[i];
+    if (layer.dead) {
+      continue;
+    }
+    std::vector<int> inputs = layer.aliasOf >= 0 ? std::vector<int>(1, layer.aliasOf) : layer.inputs;
+    for (int input : inputs) {
+      if (input >= 0 && layers[input].dead) {
+        error = layerError(layer, i, "input layer " + std::to_string(input) + " was pruned");
+        return false;
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,48 @@
+#ifndef __NETWORK_PASSES_H__
+#define __NETWORK_PASSES_H__
+
+#include <string>
+#include <vector>
+
+#include "network_ir.h"
+
+// 构建 TensorRT 网络前在网络描述上执行的图优化。层号和权重顺序保持不变，结果记录在
+// LayerDesc::aliasOf / dead / foldedInto 中，buildYoloNetwork 据此跳过相应的层
+struct NetworkPassStats
+{
+  int identityLayers {0};     // 单输入 route、dropout
+  int mergedLayers {0};       // 与前面某层计算完全相同（如重复的通道切片）
+  int cascadedPools {0};      // SPP 的大窗口 maxpool 改为串接在小窗口 maxpool 之后（SPPF）
+  int foldedBatchnorms {0};   // 线性卷积后的 [batchnorm] 并入卷积，激活也移到卷积上
+  int deadLayers {0};         // 输出不影响任何 yolo/region 层
+  int prunedHeads {0};        // pruneYoloHeads 删除的 yolo/region 层
+};
+
+// 按 aliasOf 找到实际提供输出的层
+int resolveLayerOutput(const NetworkDesc& network, int index);
+
+// 单输入且不分组的 route 和 dropout 为恒等映射，直接复用输入层的输出
+void removeIdentityLayers(NetworkDesc& network, NetworkPassStats& stats);
+
+// 步长 1 的奇数窗口 maxpool 两次串接等价于一个窗口为 a + b - 1 的 maxpool（填充值不参与取最大值）。
+// 同一输入上的多个 maxpool（SPP 的 5/9/13）改为依次串接在前一个 maxpool 之后（SPPF 的三个 5x5）
+void cascadeSppPools(NetworkDesc& network, NetworkPassStats& stats);
+
+// 与前面某层类型、输入和参数都相同的无权重层（route 切片、池化、上采样等）直接复用其输出
+void mergeCommonLayers(NetworkDesc& network, NetworkPassStats& stats);
+
+// 从未删除的 yolo/region 层反向标记用到的层，其余层标记为 dead
+void eliminateDeadLayers(NetworkDesc& network, NetworkPassStats& stats);
+
+// 只被 [batchnorm] 使用的线性卷积：BN 的 scale/shift 在 prepareNetworkWeights 中融合进卷积权重，
+// BN 层只剩激活，直接作用在卷积输出上（卷积 + scale + 激活变为卷积 + 激活）
+void foldActivationChains(NetworkDesc& network, NetworkPassStats& stats);
+
+// 依次执行以上全部 pass，可对同一网络描述重复执行
+void optimizeNetwork(NetworkDesc& network, NetworkPassStats& stats);
+
+// 删除按输出名（构建日志中的 "yolo_<层号+1>"，逗号分隔）指定的 yolo/region 层，以及只为它们计算的分支，
+// 其余输出头的网络不变；名称不存在或删除全部输出头时返回 false。在 optimizeNetwork 之后执行
+bool pruneYoloHeads(NetworkDesc& network, const std::string& heads, NetworkPassStats& stats, std::string& error);
+
+#endif
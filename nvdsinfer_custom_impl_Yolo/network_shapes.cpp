@@ -0,0 +1,294 @@
+#include "network_shapes.h"
+
+#include <algorithm>
+
+namespace {
+
+std::string
+shapeToString(const TensorShape& shape)
+{
+  return std::to_string(shape.c) + "x" + std::to_string(shape.h) + "x" + std::to_string(shape.w);
+}
+
+// 与 buildYoloNetwork 中各层的 TensorRT 构建方式保持一致
+bool
+inferLayerShape(const NetworkDesc& network, const std::vector<TensorShape>& shapes, int index, TensorShape& output,
+    std::string& error)
+{
+  const LayerDesc& layer = network.layers[index];
+  int inputIndex = layer.inputs.empty() ? -1 : layer.inputs[0];
+  TensorShape netInput;
+  netInput.c = network.channels;
+  netInput.h = network.height;
+  netInput.w = network.width;
+  const TensorShape& input = inputIndex < 0 ? netInput : shapes[inputIndex];
+
+  output = input;
+
+  switch (layer.kind) {
+    case LayerKind::kConvolutional:
+    case LayerKind::kDeconvolutional:
+      if (input.c % layer.groups != 0) {
+        error = layerError(layer, index, std::to_string(input.c) + " input channels not divisible by groups " +
+            std::to_string(layer.groups));
+        return false;
+      }
+      output.c = layer.filters;
+      if (layer.kind == LayerKind::kConvolutional) {
+        output.h = (input.h + 2 * layer.pad - layer.size) / layer.stride + 1;
+        output.w = (input.w + 2 * layer.pad - layer.size) / layer.stride + 1;
+      }
+      else {
+        output.h = (input.h - 1) * layer.stride + layer.size - 2 * layer.pad;
+        output.w = (input.w - 1) * layer.stride + layer.size - 2 * layer.pad;
+      }
+      break;
+    case LayerKind::kBatchnorm:
+      if (layer.filters != input.c) {
+        error = layerError(layer, index, "filters " + std::to_string(layer.filters) + " do not match " +
+            std::to_string(input.c) + " input channels");
+        return false;
+      }
+      break;
+    case LayerKind::kImplicit:
+      output.c = layer.filters;
+      output.h = 1;
+      output.w = 1;
+      break;
+    case LayerKind::kShiftChannels:
+    case LayerKind::kControlChannels: {
+      const TensorShape& implicit = shapes[layer.inputs[1]];
+      if (implicit.c != input.c || (implicit.h != 1 && implicit.h != input.h) ||
+          (implicit.w != 1 && implicit.w != input.w)) {
+        error = layerError(layer, index, "layer " + std::to_string(layer.inputs[1]) + " is " +
+            shapeToString(implicit) + ", cannot broadcast to " + shapeToString(input));
+        return false;
+      }
+      break;
+    }
+    case LayerKind::kShortcut: {
+      // 形状不同时从 from 层切出与输入相同的部分
+      const TensorShape& from = shapes[layer.inputs[1]];
+      if (from.c < input.c || from.h < input.h || from.w < input.w) {
+        error = layerError(layer, index, "layer " + std::to_string(layer.inputs[1]) + " is " + shapeToString(from) +
+            ", smaller than the input " + shapeToString(input));
+        return false;
+      }
+      break;
+    }
+    case LayerKind::kSam: {
+      const TensorShape& from = shapes[layer.inputs[1]];
+      if (from.c != input.c || from.h != input.h || from.w != input.w) {
+        error = layerError(layer, index, "layer " + std::to_string(layer.inputs[1]) + " is " + shapeToString(from) +
+            ", expected " + shapeToString(input));
+        return false;
+      }
+      break;
+    }
+    case LayerKind::kRoute: {
+      output = shapes[layer.inputs[0]];
+      for (size_t j = 1; j < layer.inputs.size(); ++j) {
+        const TensorShape& next = shapes[layer.inputs[j]];
+        bool matches = (layer.axis == 1 || next.c == output.c) && (layer.axis == 2 || next.h == output.h) &&
+            (layer.axis == 3 || next.w == output.w);
+        if (!matches || layer.axis < 1 || layer.axis > 3) {
+          error = layerError(layer, index, "layer " + std::to_string(layer.inputs[j]) + " is " + shapeToString(next) +
+              ", cannot concatenate with layer " + std::to_string(layer.inputs[0]) + " (" +
+              shapeToString(shapes[layer.inputs[0]]) + ") on axis " + std::to_string(layer.axis));
+          return false;
+        }
+        output.c += layer.axis == 1 ? next.c : 0;
+        output.h += layer.axis == 2 ? next.h : 0;
+        output.w += layer.axis == 3 ? next.w : 0;
+      }
+      if (output.c % layer.routeGroups != 0) {
+        error = layerError(layer, index, std::to_string(output.c) + " channels not divisible by groups " +
+            std::to_string(layer.routeGroups));
+        return false;
+      }
+      output.c /= layer.routeGroups;
+      break;
+    }
+    case LayerKind::kUpsample:
+      output.h = input.h * layer.stride;
+      output.w = input.w * layer.stride;
+      break;
+    case LayerKind::kMaxpool:
+      if (layer.size == 2 && layer.stride == 1) {
+        // 只在右下方补一行一列，尺寸不变
+        break;
+      }
+      output.h = (input.h + 2 * ((layer.size - 1) / 2) - layer.size) / layer.stride + 1;
+      output.w = (input.w + 2 * ((layer.size - 1) / 2) - layer.size) / layer.stride + 1;
+      break;
+    case LayerKind::kAvgpool:
+      output.h = 1;
+      output.w = 1;
+      break;
+    case LayerKind::kReorg:
+      if (input.c % (layer.stride * layer.stride) != 0 || input.h % layer.stride != 0 ||
+          input.w % layer.stride != 0) {
+        error = layerError(layer, index, shapeToString(input) + " input not divisible by stride " +
+            std::to_string(layer.stride));
+        return false;
+      }
+      output.c = input.c * layer.stride * layer.stride;
+      output.h = input.h / layer.stride;
+      output.w = input.w / layer.stride;
+      break;
+    case LayerKind::kReorg3d:
+      output.c = input.c * 4;
+      output.h = input.h / layer.stride;
+      output.w = input.w / layer.stride;
+      break;
+    case LayerKind::kYolo:
+    case LayerKind::kRegion: {
+      int expected = layer.kind == LayerKind::kYolo ?
+          (layer.mask.empty() ? layer.num : (int) layer.mask.size()) * (4 + 1 + layer.classes) :
+          layer.num * (4 + 1 + layer.classes);
+      if (input.c != expected) {
+        error = layerError(layer, index, "input has " + std::to_string(input.c) + " channels, expected " +
+            std::to_string(expected) + " (boxes * (5 + classes))");
+        return false;
+      }
+      break;
+    }
+    case LayerKind::kDropout:
+      break;
+  }
+
+  if (output.c <= 0 || output.h <= 0 || output.w <= 0) {
+    error = layerError(layer, index, "output shape " + shapeToString(output) + " from input " +
+        shapeToString(input) + " is empty");
+    return false;
+  }
+  return true;
+}
+
+}
+
+bool
+inferLayerShapes(const NetworkDesc& network, std::vector<TensorShape>& shapes, std::string& error)
+{
+  shapes.assign(network.layers.size(), TensorShape());
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    if (!inferLayerShape(network, shapes, i, shapes[i], error)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int64_t
+layerWeightCount(const LayerDesc& layer, int inputChannels)
+{
+  switch (layer.kind) {
+    case LayerKind::kConvolutional:
+    case LayerKind::kDeconvolutional: {
+      int64_t count = (int64_t) layer.filters * inputChannels * layer.size * layer.size / layer.groups;
+      count += layer.batchNormalize ? 4 * layer.filters : 0;
+      count += layer.bias ? layer.filters : 0;
+      return count;
+    }
+    case LayerKind::kBatchnorm:
+      return 4 * layer.filters;
+    case LayerKind::kImplicit:
+      return layer.filters;
+    default:
+      return 0;
+  }
+}
+
+int64_t
+expectedWeightCount(const NetworkDesc& network, const std::vector<TensorShape>& shapes)
+{
+  int64_t count = 0;
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerDesc& layer = network.layers[i];
+    int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+    count += layerWeightCount(layer, input < 0 ? network.channels : shapes[input].c);
+  }
+  return count;
+}
+
+ActivationPlan
+planActivationMemory(const NetworkDesc& network, const std::vector<TensorShape>& shapes)
+{
+  const std::vector<LayerDesc>& layers = network.layers;
+  int n = layers.size();
+
+  // 按 aliasOf / foldedInto 找到实际持有输出的层；融合进卷积输出端的 channels 层输出即为卷积输出，
+  // 融合进下一层卷积输入端的 channels 层输出即为其输入
+  const int kNetworkInput = -2;
+  std::vector<int> owner(n);
+  std::vector<bool> allocates(n, false);
+  for (int i = 0; i < n; ++i) {
+    const LayerDesc& layer = layers[i];
+    int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+    bool passThrough = layer.kind == LayerKind::kDropout || layer.kind == LayerKind::kYolo ||
+        layer.kind == LayerKind::kRegion || (layer.foldedInto >= 0 && layer.kind != LayerKind::kBatchnorm);
+    if (layer.dead) {
+      owner[i] = -1;
+    }
+    else if (layer.aliasOf >= 0) {
+      owner[i] = owner[layer.aliasOf];
+    }
+    else if (passThrough) {
+      owner[i] = input < 0 ? kNetworkInput : owner[input];
+    }
+    else {
+      owner[i] = i;
+      allocates[i] = layer.kind != LayerKind::kImplicit;
+    }
+  }
+
+  // 每个输出最后一次被使用的层；yolo/region 的输入一直保留到插件执行
+  std::vector<int> lastUse(n, -1);
+  int inputLastUse = 0;
+  for (int i = 0; i < n; ++i) {
+    const LayerDesc& layer = layers[i];
+    if (layer.dead || layer.aliasOf >= 0) {
+      continue;
+    }
+    int use = (layer.kind == LayerKind::kYolo || layer.kind == LayerKind::kRegion) ? n : i;
+    for (int input : layer.inputs) {
+      int source = input < 0 ? kNetworkInput : owner[input];
+      if (source == kNetworkInput) {
+        inputLastUse = std::max(inputLastUse, use);
+      }
+      else if (source >= 0) {
+        lastUse[source] = std::max(lastUse[source], use);
+      }
+    }
+  }
+
+  ActivationPlan plan;
+  int64_t inputElements = (int64_t) network.channels * network.height * network.width;
+  int64_t live = inputElements;
+  std::vector<std::vector<int>> freeAfter(n + 1);
+  for (int i = 0; i < n; ++i) {
+    if (allocates[i]) {
+      int64_t elements = shapes[i].volume();
+      live += elements;
+      plan.totalElements += elements;
+      if (elements > plan.largestElements) {
+        plan.largestElements = elements;
+        plan.largestLayer = i;
+      }
+      // 没有使用者的输出在本层结束后即可释放
+      freeAfter[std::max(lastUse[i], i)].push_back(i);
+    }
+    if (live > plan.peakElements) {
+      plan.peakElements = live;
+      plan.peakLayer = i;
+    }
+    if (i == inputLastUse) {
+      live -= inputElements;
+    }
+    for (int freed : freeAfter[i]) {
+      live -= shapes[freed].volume();
+    }
+  }
+
+  return plan;
+}
@@ -0,0 +1,43 @@
+#ifndef __NETWORK_SHAPES_H__
+#define __NETWORK_SHAPES_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "network_ir.h"
+
+// 单个样本（batch 1）的 CHW 形状
+struct TensorShape
+{
+  int c {0};
+  int h {0};
+  int w {0};
+
+  int64_t volume() const { return (int64_t) c * h * w; }
+};
+
+// 按 [net] 的输入尺寸和 TensorRT 中各层的构建方式推算每层的输出形状，不需要权重和 GPU；
+// 通道、尺寸不匹配等 cfg 错误在 error 中给出层号和 cfg 行号
+bool inferLayerShapes(const NetworkDesc& network, std::vector<TensorShape>& shapes, std::string& error);
+
+// 一层在 darknet 权重文件中占用的 float 个数（BN 参数、偏置和卷积核）
+int64_t layerWeightCount(const LayerDesc& layer, int inputChannels);
+
+// 整个 cfg 需要的权重个数，应等于权重文件中文件头之后的 float 个数
+int64_t expectedWeightCount(const NetworkDesc& network, const std::vector<TensorShape>& shapes);
+
+// 按层的执行顺序和每个输出的最后使用者计算同时存在的激活元素数（batch 1），
+// 恒等、删除和融合掉的层不占用内存；不含 TensorRT 内部融合的临时张量
+struct ActivationPlan
+{
+  int64_t peakElements {0};       // 同时存在的元素数峰值
+  int peakLayer {-1};             // 出现峰值的层
+  int64_t totalElements {0};      // 不复用内存时所有输出的元素数
+  int64_t largestElements {0};    // 最大的单个输出
+  int largestLayer {-1};
+};
+
+ActivationPlan planActivationMemory(const NetworkDesc& network, const std::vector<TensorShape>& shapes);
+
+#endif
@@ -0,0 +1,428 @@
+#include "network_weights.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "half_float.h"
+#include "weight_folding.h"
+#include "worker_pool.h"
+
+namespace {
+
+// darknet 权重文件中一层的原始权重，直接指向权重文件的内存
+struct RawLayerWeights
+{
+  const float* bnBiases {nullptr};
+  const float* bnWeights {nullptr};
+  const float* bnRunningMean {nullptr};
+  const float* bnRunningVar {nullptr};
+  const float* bias {nullptr};
+  const float* kernel {nullptr};
+  int64_t kernelCount {0};
+};
+
+typedef std::vector<std::vector<std::pair<ChannelFoldOp, int>>> ConvFolds;
+
+// 一层卷积融合后的权重在 arena 中的位置
+struct ConvFoldBuffers
+{
+  float* kernel {nullptr};
+  float* bias {nullptr};
+  float* bnScale {nullptr};       // 并入的 [batchnorm]
+  float* bnShift {nullptr};
+  bool spaceToDepth {false};      // 前一层 reorg3d 已并入
+};
+
+bool
+takeWeights(WeightCursor& weights, int64_t count, const float*& span, const LayerDesc& layer, int index,
+    std::string& error)
+{
+  if (count < 0 || (uint64_t) count > weights.remaining()) {
+    error = layerError(layer, index, "needs " + std::to_string(count) + " weights at position " +
+        std::to_string(weights.position()) + ", " + std::to_string(weights.remaining()) + " left");
+    return false;
+  }
+  span = weights.take(count);
+  return true;
+}
+
+// 按已解析的输入统计每层的输出被哪些层使用，再决定哪些 shift_channels/control_channels 可以融合：
+// 前一层是只被它使用的线性卷积时融合进该卷积的输出端；shift_channels 只被下一层无 padding 的卷积使用时融合进其输入端。
+// 所有使用者都已融合的 implicit 层也标记为已融合
+ConvFolds
+planImplicitFolds(NetworkDesc& network)
+{
+  std::vector<LayerDesc>& layers = network.layers;
+  int n = layers.size();
+
+  std::vector<std::vector<int>> consumers(n);
+  for (int i = 0; i < n; ++i) {
+    // batchnorm 的融合由 foldActivationChains 决定
+    if (layers[i].kind != LayerKind::kBatchnorm) {
+      layers[i].foldedInto = -1;
+    }
+    for (int input : layers[i].inputs) {
+      if (input >= 0) {
+        consumers[input].push_back(i);
+      }
+    }
+  }
+
+  ConvFolds convFolds(n);
+
+  for (int i = 1; i < n; ++i) {
+    LayerDesc& layer = layers[i];
+    bool shift = layer.kind == LayerKind::kShiftChannels;
+    if (!shift && layer.kind != LayerKind::kControlChannels) {
+      continue;
+    }
+
+    int implicit = layer.inputs[1];
+    if (layers[implicit].kind != LayerKind::kImplicit) {
+      continue;
+    }
+
+    int root = -1;
+    LayerKind previousKind = layers[i - 1].kind;
+    bool chained = previousKind == LayerKind::kShiftChannels || previousKind == LayerKind::kControlChannels;
+    if (layers[i - 1].kind == LayerKind::kConvolutional && layers[i - 1].activation == ActivationKind::kLinear) {
+      root = i - 1;
+    }
+    else if (chained && layers[i - 1].foldedInto >= 0 && layers[i - 1].foldedInto < i - 1) {
+      root = layers[i - 1].foldedInto;
+    }
+
+    if (root >= 0 && consumers[i - 1].size() == 1 && layers[root].filters == layers[implicit].filters) {
+      layer.foldedInto = root;
+      convFolds[root].push_back(std::make_pair(shift ? ChannelFoldOp::kOutputShift : ChannelFoldOp::kOutputScale,
+          implicit));
+      continue;
+    }
+
+    if (shift && i + 1 < n && layers[i + 1].kind == LayerKind::kConvolutional && consumers[i].size() == 1 &&
+        consumers[i][0] == i + 1 && layers[i + 1].pad == 0) {
+      layer.foldedInto = i + 1;
+      convFolds[i + 1].push_back(std::make_pair(ChannelFoldOp::kInputShift, implicit));
+    }
+  }
+
+  for (int i = 0; i < n; ++i) {
+    if (layers[i].kind != LayerKind::kImplicit || consumers[i].empty()) {
+      continue;
+    }
+    bool folded = true;
+    for (int consumer : consumers[i]) {
+      folded &= layers[consumer].foldedInto >= 0;
+    }
+    if (folded) {
+      layers[i].foldedInto = layers[consumers[i][0]].foldedInto;
+    }
+  }
+
+  return convFolds;
+}
+
+}
+
+bool
+prepareNetworkWeights(NetworkDesc& network, WeightCursor& weights, WeightArena& arena,
+    std::vector<LayerWeights>& layerWeights, std::string& error, int threads)
+{
+  std::vector<TensorShape> shapes;
+  if (!inferLayerShapes(network, shapes, error)) {
+    return false;
+  }
+
+  int n = network.layers.size();
+  std::vector<RawLayerWeights> raw(n);
+
+  // 先按 darknet 的顺序切分出每层的原始权重，融合时可能用到后面层的权重
+  for (int i = 0; i < n; ++i) {
+    const LayerDesc& layer = network.layers[i];
+    int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+    int inputChannels = input < 0 ? network.channels : shapes[input].c;
+    RawLayerWeights& r = raw[i];
+
+    switch (layer.kind) {
+      case LayerKind::kConvolutional:
+      case LayerKind::kDeconvolutional: {
+        int filters = layer.filters;
+        r.kernelCount = (int64_t) filters * inputChannels * layer.size * layer.size / layer.groups;
+        if (layer.batchNormalize && (!takeWeights(weights, filters, r.bnBiases, layer, i, error) ||
+            !takeWeights(weights, filters, r.bnWeights, layer, i, error) ||
+            !takeWeights(weights, filters, r.bnRunningMean, layer, i, error) ||
+            !takeWeights(weights, filters, r.bnRunningVar, layer, i, error))) {
+          return false;
+        }
+        if (layer.bias && !takeWeights(weights, filters, r.bias, layer, i, error)) {
+          return false;
+        }
+        if (!takeWeights(weights, r.kernelCount, r.kernel, layer, i, error)) {
+          return false;
+        }
+        break;
+      }
+      case LayerKind::kBatchnorm:
+        if (!takeWeights(weights, layer.filters, r.bnBiases, layer, i, error) ||
+            !takeWeights(weights, layer.filters, r.bnWeights, layer, i, error) ||
+            !takeWeights(weights, layer.filters, r.bnRunningMean, layer, i, error) ||
+            !takeWeights(weights, layer.filters, r.bnRunningVar, layer, i, error)) {
+          return false;
+        }
+        break;
+      case LayerKind::kImplicit:
+        r.kernelCount = layer.filters;
+        if (!takeWeights(weights, r.kernelCount, r.kernel, layer, i, error)) {
+          return false;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  if (weights.remaining() != 0) {
+    error = "number of unused weights left: " + std::to_string(weights.remaining());
+    return false;
+  }
+
+  ConvFolds convFolds = planImplicitFolds(network);
+  for (int i = 0; i < n; ++i) {
+    if (canFoldSpaceToDepth(network, shapes, i)) {
+      network.layers[i].foldedInto = i + 1;
+    }
+  }
+
+  // 并入卷积的 [batchnorm] 在卷积的全部融合之后再作用到输出端
+  std::vector<int> batchnormFolds(n, -1);
+  for (int i = 0; i < n; ++i) {
+    const LayerDesc& layer = network.layers[i];
+    if (layer.kind == LayerKind::kBatchnorm && layer.foldedInto >= 0) {
+      batchnormFolds[layer.foldedInto] = i;
+    }
+  }
+
+  // arena 不是线程安全的：先按层串行分配好卷积的输出缓冲区，再在线程池中并行计算
+  std::vector<ConvFoldBuffers> convBuffers(n);
+  std::vector<int> convJobs;
+
+  layerWeights.assign(n, LayerWeights());
+  for (int i = 0; i < n; ++i) {
+    const LayerDesc& layer = network.layers[i];
+    int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+    const RawLayerWeights& r = raw[i];
+    LayerWeights& w = layerWeights[i];
+    if (layer.dead) {
+      continue;
+    }
+
+    switch (layer.kind) {
+      case LayerKind::kConvolutional:
+      case LayerKind::kDeconvolutional: {
+        int filters = layer.filters;
+        w.kernel = r.kernel;
+        w.kernelCount = r.kernelCount;
+        w.bias = r.bias;
+        w.biasCount = r.bias != nullptr ? filters : 0;
+        ConvFoldBuffers& buffers = convBuffers[i];
+        buffers.spaceToDepth = input >= 0 && network.layers[input].kind == LayerKind::kReorg3d &&
+            network.layers[input].foldedInto == i;
+        if (!layer.batchNormalize && convFolds[i].empty() && batchnormFolds[i] < 0 && !buffers.spaceToDepth) {
+          break;
+        }
+
+        buffers.kernel = arena.alloc<float>(r.kernelCount);
+        buffers.bias = arena.alloc<float>(filters);
+        if (batchnormFolds[i] >= 0) {
+          buffers.bnScale = arena.alloc<float>(filters);
+          buffers.bnShift = arena.alloc<float>(filters);
+        }
+        convJobs.push_back(i);
+
+        w.kernel = buffers.kernel;
+        w.bias = buffers.bias;
+        w.biasCount = filters;
+        break;
+      }
+      case LayerKind::kBatchnorm: {
+        if (layer.foldedInto >= 0) {
+          break;
+        }
+        float* scale = arena.alloc<float>(layer.filters);
+        float* shift = arena.alloc<float>(layer.filters);
+        batchNormScaleShift(r.bnBiases, r.bnWeights, r.bnRunningMean, r.bnRunningVar, layer.eps, layer.filters,
+            scale, shift);
+        w.kernel = scale;
+        w.kernelCount = layer.filters;
+        w.bias = shift;
+        w.biasCount = layer.filters;
+        break;
+      }
+      case LayerKind::kImplicit:
+        if (layer.foldedInto < 0) {
+          w.kernel = r.kernel;
+          w.kernelCount = r.kernelCount;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  // 大层先开始，减少最后只剩一个线程在算的时间
+  std::sort(convJobs.begin(), convJobs.end(), [&](int a, int b) { return raw[a].kernelCount > raw[b].kernelCount; });
+  parallelFor(convJobs.size(), threads, [&](size_t job) {
+    int i = convJobs[job];
+    const LayerDesc& layer = network.layers[i];
+    int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+    int inputChannels = input < 0 ? network.channels : shapes[input].c;
+    const RawLayerWeights& r = raw[i];
+    const ConvFoldBuffers& buffers = convBuffers[i];
+    int filters = layer.filters;
+
+    // reorg3d 融合时先在临时缓冲区中完成其余融合，最后重排到输出缓冲区
+    std::vector<float> unpermuted(buffers.spaceToDepth ? r.kernelCount : 0);
+    float* kernel = buffers.spaceToDepth ? unpermuted.data() : buffers.kernel;
+    float* bias = buffers.bias;
+
+    std::vector<float> scale(filters, 1.0f);
+    std::vector<float> shift(filters, 0.0f);
+    if (layer.batchNormalize) {
+      // BN 融合进卷积核和偏置，网络中不再需要单独的 scale 层
+      batchNormScaleShift(r.bnBiases, r.bnWeights, r.bnRunningMean, r.bnRunningVar, layer.eps, filters,
+          scale.data(), shift.data());
+    }
+
+    if (layer.kind == LayerKind::kDeconvolutional) {
+      foldScaleShiftDeconv(scale.data(), shift.data(), inputChannels, filters, layer.groups,
+          layer.size * layer.size, r.kernel, r.bias, kernel, bias);
+    }
+    else if (layer.batchNormalize) {
+      foldScaleShiftConv(scale.data(), shift.data(), filters, r.kernelCount / filters, r.kernel, r.bias, kernel,
+          bias);
+    }
+    else {
+      memcpy(kernel, r.kernel, r.kernelCount * sizeof(float));
+      for (int f = 0; f < filters; ++f) {
+        bias[f] = r.bias != nullptr ? r.bias[f] : 0.0f;
+      }
+    }
+
+    std::vector<ChannelFold> folds;
+    for (const std::pair<ChannelFoldOp, int>& fold : convFolds[i]) {
+      folds.push_back(ChannelFold{fold.first, raw[fold.second].kernel});
+    }
+    if (batchnormFolds[i] >= 0) {
+      const LayerDesc& batchnorm = network.layers[batchnormFolds[i]];
+      const RawLayerWeights& b = raw[batchnormFolds[i]];
+      batchNormScaleShift(b.bnBiases, b.bnWeights, b.bnRunningMean, b.bnRunningVar, batchnorm.eps, filters,
+          buffers.bnScale, buffers.bnShift);
+      folds.push_back(ChannelFold{ChannelFoldOp::kOutputScale, buffers.bnScale});
+      folds.push_back(ChannelFold{ChannelFoldOp::kOutputShift, buffers.bnShift});
+    }
+    foldChannelsConv(folds, filters, inputChannels, layer.groups, layer.size * layer.size, kernel, bias);
+
+    if (buffers.spaceToDepth) {
+      foldSpaceToDepthConv(kernel, filters, inputChannels / 4, layer.size, buffers.kernel);
+    }
+  });
+
+  return true;
+}
+
+void
+convertWeightsToHalf(const NetworkDesc& network, std::vector<LayerWeights>& layerWeights, WeightArena& arena,
+    int threads)
+{
+  std::vector<int> convLayers;
+  std::vector<std::pair<uint16_t*, uint16_t*>> halves(layerWeights.size());
+  for (size_t i = 0; i < layerWeights.size(); ++i) {
+    LayerWeights& w = layerWeights[i];
+    LayerKind kind = network.layers[i].kind;
+    if (kind == LayerKind::kConvolutional || kind == LayerKind::kDeconvolutional) {
+      if (w.kernel != nullptr) {
+        halves[i].first = arena.alloc<uint16_t>(w.kernelCount);
+        halves[i].second = w.biasCount > 0 ? arena.alloc<uint16_t>(w.biasCount) : nullptr;
+        convLayers.push_back(i);
+      }
+      continue;
+    }
+    // 其余层的权重很小，仍为 float，复制一份以便释放原来的缓冲区
+    float* kernel = w.kernelCount > 0 ? arena.alloc<float>(w.kernelCount) : nullptr;
+    float* bias = w.biasCount > 0 ? arena.alloc<float>(w.biasCount) : nullptr;
+    if (kernel != nullptr) {
+      memcpy(kernel, w.kernel, w.kernelCount * sizeof(float));
+    }
+    if (bias != nullptr) {
+      memcpy(bias, w.bias, w.biasCount * sizeof(float));
+    }
+    w.kernel = kernel;
+    w.bias = bias;
+  }
+
+  std::sort(convLayers.begin(), convLayers.end(), [&](int a, int b) {
+    return layerWeights[a].kernelCount > layerWeights[b].kernelCount;
+  });
+  parallelFor(convLayers.size(), threads, [&](size_t job) {
+    LayerWeights& w = layerWeights[convLayers[job]];
+    const std::pair<uint16_t*, uint16_t*>& half = halves[convLayers[job]];
+    convertToHalf(w.kernel, w.kernelCount, half.first);
+    if (half.second != nullptr) {
+      convertToHalf(w.bias, w.biasCount, half.second);
+    }
+    w.kernelHalf = half.first;
+    w.biasHalf = half.second;
+    w.kernel = nullptr;
+    w.bias = nullptr;
+  });
+}
+
+bool
+canFoldSpaceToDepth(const NetworkDesc& network, const std::vector<TensorShape>& shapes, int index)
+{
+  const std::vector<LayerDesc>& layers = network.layers;
+  const LayerDesc& layer = layers[index];
+  if (layer.kind != LayerKind::kReorg3d || layer.stride != 2 || layer.dead || layer.aliasOf >= 0 ||
+      index + 1 >= (int) layers.size()) {
+    return false;
+  }
+
+  int input = layer.inputs[0];
+  int height = input < 0 ? network.height : shapes[input].h;
+  int width = input < 0 ? network.width : shapes[input].w;
+  const LayerDesc& conv = layers[index + 1];
+  if (height % 2 != 0 || width % 2 != 0 || conv.kind != LayerKind::kConvolutional || conv.dead ||
+      conv.inputs[0] != index || conv.groups != 1) {
+    return false;
+  }
+
+  for (size_t i = index + 2; i < layers.size(); ++i) {
+    if (layers[i].dead) {
+      continue;
+    }
+    if (layers[i].aliasOf == index) {
+      return false;
+    }
+    for (int other : layers[i].inputs) {
+      if (other == index) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+LayerDesc
+effectiveConvolution(const NetworkDesc& network, int index)
+{
+  LayerDesc layer = network.layers[index];
+  int input = layer.inputs[0];
+  if (input >= 0 && network.layers[input].kind == LayerKind::kReorg3d && network.layers[input].foldedInto == index) {
+    layer.inputs[0] = network.layers[input].inputs[0];
+    layer.size *= 2;
+    layer.stride *= 2;
+    layer.pad *= 2;
+  }
+  return layer;
+}
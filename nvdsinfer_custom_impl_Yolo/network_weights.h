@@ -0,0 +1,42 @@
+#ifndef __NETWORK_WEIGHTS_H__
+#define __NETWORK_WEIGHTS_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "network_ir.h"
+#include "network_shapes.h"
+#include "weight_cursor.h"
+
+// 一层转换好的权重：卷积/反卷积为融合后的卷积核与偏置，batchnorm 为 scale（kernel）与 shift（bias），
+// implicit 为常量值（kernel）；其余层为空
+struct LayerWeights
+{
+  const float* kernel {nullptr};
+  int64_t kernelCount {0};
+  const float* bias {nullptr};
+  int64_t biasCount {0};
+  const uint16_t* kernelHalf {nullptr};   // convertWeightsToHalf 之后卷积/反卷积只有 FP16 权重，kernel/bias 为空
+  const uint16_t* biasHalf {nullptr};
+};
+
+// 从 darknet 权重中取出每层的权重并完成全部转换（BN 融合、implicit 融合），融合掉的层在 network 中标记 foldedInto；
+// 未转换的权重直接指向 weights 的内存，转换后的权重分配在 arena 中。各卷积的融合在 threads 个线程上并行计算
+bool prepareNetworkWeights(NetworkDesc& network, WeightCursor& weights, WeightArena& arena,
+    std::vector<LayerWeights>& layerWeights, std::string& error, int threads = 1);
+
+// FP16 引擎用：卷积/反卷积的权重在 threads 个线程上转换为 FP16（就近舍入到偶数），其余层的 float 权重复制一份，
+// 全部分配在 arena 中。转换后不再引用原来的权重，权重文件/模型包和原 arena 可以释放
+void convertWeightsToHalf(const NetworkDesc& network, std::vector<LayerWeights>& layerWeights, WeightArena& arena,
+    int threads);
+
+// reorg3d（YOLOv5 Focus）只被下一层不分组的卷积使用、步长为 2 且输入宽高为偶数时，可以融合进该卷积，
+// 省去全分辨率输入上的 4 次切片和拼接
+bool canFoldSpaceToDepth(const NetworkDesc& network, const std::vector<TensorShape>& shapes, int index);
+
+// 卷积实际构建时的参数：前一层 reorg3d 已融合进该卷积（foldedInto 指向该卷积）时，卷积直接作用在 reorg3d 的输入上，
+// 卷积核、步长和 padding 都放大 2 倍
+LayerDesc effectiveConvolution(const NetworkDesc& network, int index);
+
+#endif
@@ -1,9 +1,15 @@
 #include <algorithm>
+#include <cerrno>
+#include <mutex>
+#include <memory>
+#include <cuda_runtime_api.h>
 
 #include "nvdsinfer_custom_impl.h"
 #include "nvdsinfer_context.h"
 
 #include "yolo.h"
+#include "engine_builder.h"
+#include "calibration_cache.h"
 
 #define USE_CUDA_ENGINE_GET_API 1  // 选择是否使用 CUDA 引擎 API
 
@@ -21,9 +27,12 @@ static bool getYoloNetworkInfo(NetworkInfo& networkInfo, const NvDsInferContextI
 
     // 判断模型类型（ONNX 或 Darknet）
     std::string yoloType = !onnxFilePath.empty() ? "onnx" : "darknet";
+    // Darknet 模型的 model-file 可以是 yolo_tool 生成的模型包，此时不需要 cfg
+    bool modelPack = yoloType == "darknet" && isModelPack(wtsFilePath);
     // 提取模型名称
     std::string modelName = yoloType == "onnx" ?
         onnxFilePath.substr(0, onnxFilePath.find(".onnx")).substr(onnxFilePath.rfind("/") + 1) :
+        modelPack ? wtsFilePath.substr(0, wtsFilePath.rfind(".")).substr(wtsFilePath.rfind("/") + 1) :
         cfgFilePath.substr(0, cfgFilePath.find(".cfg")).substr(cfgFilePath.rfind("/") + 1);
 
     // 转换模型名称为小写
@@ -48,6 +57,8 @@ static bool getYoloNetworkInfo(NetworkInfo& networkInfo, const NvDsInferContextI
     networkInfo.offsets = initParams->offsets;
     networkInfo.workspaceSize = initParams->workspaceSize;
     networkInfo.inputFormat = initParams->networkInputFormat;
+    networkInfo.maintainAspectRatio = initParams->maintainAspectRatio;
+    networkInfo.symmetricPadding = initParams->symmetricPadding;
 
     // 设置网络计算精度（FP32、FP16、INT8）
     if (initParams->networkMode == NvDsInferNetworkMode_FP32) {
@@ -69,7 +80,7 @@ static bool getYoloNetworkInfo(NetworkInfo& networkInfo, const NvDsInferContextI
             std::cerr << "Darknet weights file does not exist\n" << std::endl;
             return false;
         }
-        if (!fileExists(networkInfo.cfgFilePath)) {
+        if (!modelPack && !fileExists(networkInfo.cfgFilePath)) {
             std::cerr << "Darknet cfg file does not exist\n" << std::endl;
             return false;
         }
@@ -77,6 +88,268 @@ static bool getYoloNetworkInfo(NetworkInfo& networkInfo, const NvDsInferContextI
     return true;
 }
 
+/**
+ * @brief 计算模型键：模型文件内容、TensorRT/CUDA 版本及 GPU 型号，同一模型键下的引擎可以互相作为回退引擎。
+ * @param networkInfo 网络信息。
+ * @param initParams  初始化参数。
+ * @return 16 位十六进制的模型键。
+ */
+static std::string getModelCacheKey(const NetworkInfo& networkInfo, const NvDsInferContextInitParams* initParams) {
+    Hasher64 hasher;
+
+    hasher.update(std::string("yolo-engine-cache-v1"));
+    int networkVersion = YOLO_NETWORK_VERSION;
+    hasher.update(&networkVersion, sizeof(networkVersion));
+    hasher.update(networkInfo.networkType);
+    if (networkInfo.networkType == "onnx") {
+        hasher.updateFile(networkInfo.onnxFilePath);
+    } else {
+        // 模型包自带网络描述，即使配置中仍写着 cfg 也不参与计算
+        if (!isModelPack(networkInfo.wtsFilePath)) {
+            hasher.updateFile(networkInfo.cfgFilePath);
+        }
+        hasher.updateFile(networkInfo.wtsFilePath);
+    }
+
+    int versions[4] = {NV_TENSORRT_MAJOR, NV_TENSORRT_MINOR, NV_TENSORRT_PATCH, CUDART_VERSION};
+    hasher.update(versions, sizeof(versions));
+
+    cudaDeviceProp prop;
+    if (cudaGetDeviceProperties(&prop, initParams->gpuID) == 0) {
+        hasher.update(std::string(prop.name));
+        hasher.update(&prop.major, sizeof(prop.major));
+        hasher.update(&prop.minor, sizeof(prop.minor));
+    }
+
+    return hashToString(hasher.digest());
+}
+
+/**
+ * @brief 计入隐式 INT8 校准的输入：列表中每张图片的路径、修改时间和大小，以及预处理参数（与校准输入缓存的键相同）。
+ * 原地替换图片后键会变化；列表中有读不到的图片时只计入列表本身。
+ */
+static void hashCalibrationImages(Hasher64& hasher, const NetworkInfo& networkInfo, const std::string& listPath) {
+    std::vector<std::string> imagePaths;
+    std::ifstream list(listPath);
+    std::string line;
+    while (std::getline(list, line)) {
+        imagePaths.push_back(line);
+    }
+
+    // 网络输入尺寸已经由模型键中的 cfg 决定
+    uint64_t key = 0;
+    if (calibrationCacheKey(imagePaths, 0, 0, 0, networkInfo.scaleFactor, networkInfo.offsets, networkInfo.inputFormat,
+        networkInfo.maintainAspectRatio, networkInfo.symmetricPadding, key)) {
+        hasher.update(&key, sizeof(key));
+    } else {
+        hasher.updateFile(listPath);
+    }
+}
+
+/**
+ * @brief 计算引擎缓存键：在模型键的基础上加入 INT8 校准输入、精度、batch 和 workspace 等构建参数。
+ * @param modelKey    模型键。
+ * @param networkInfo 网络信息。
+ * @return 16 位十六进制的缓存键。
+ */
+static std::string getEngineCacheKey(const std::string& modelKey, const NetworkInfo& networkInfo) {
+    Hasher64 hasher;
+
+    hasher.update(modelKey);
+    hasher.update(networkInfo.networkMode);
+    if (networkInfo.networkMode == "INT8") {
+        bool explicitInt8 = networkInfo.networkType == "darknet" && getenv("INT8_QDQ") &&
+            std::string(getenv("INT8_QDQ")) == "1";
+        if (explicitInt8) {
+            // INT8_QDQ 的激活 scale 由用户提供，只读不写
+            hasher.updateFile(networkInfo.int8CalibPath);
+        } else {
+            // 已有的校准表会被构建直接读取，计入键；没有时由构建校准并写出，构建后按写出的表重新计算键再存入缓存，
+            // 第二次启动时得到相同的键。另外计入生成校准表的输入：图片、batch、子集大小和预处理参数
+            if (!networkInfo.int8CalibPath.empty() && fileExists(networkInfo.int8CalibPath, false)) {
+                hasher.updateFile(networkInfo.int8CalibPath);
+            }
+            if (getenv("INT8_CALIB_IMG_PATH")) {
+                hashCalibrationImages(hasher, networkInfo, getenv("INT8_CALIB_IMG_PATH"));
+            }
+            if (getenv("INT8_CALIB_BATCH_SIZE")) {
+                hasher.update(std::string(getenv("INT8_CALIB_BATCH_SIZE")));
+            }
+            if (getenv("INT8_CALIB_IMAGES")) {
+                hasher.update(std::string(getenv("INT8_CALIB_IMAGES")));
+            }
+            hasher.update(&networkInfo.maintainAspectRatio, sizeof(networkInfo.maintainAspectRatio));
+            hasher.update(&networkInfo.symmetricPadding, sizeof(networkInfo.symmetricPadding));
+        }
+        hasher.update(&networkInfo.scaleFactor, sizeof(networkInfo.scaleFactor));
+        hasher.update(networkInfo.offsets, 4 * sizeof(float));
+        hasher.update(&networkInfo.inputFormat, sizeof(networkInfo.inputFormat));
+        if (getenv("INT8_QDQ")) {
+            hasher.update(std::string(getenv("INT8_QDQ")));
+        }
+    }
+
+    hasher.update(&networkInfo.batchSize, sizeof(networkInfo.batchSize));
+    hasher.update(&networkInfo.implicitBatch, sizeof(networkInfo.implicitBatch));
+    hasher.update(&networkInfo.workspaceSize, sizeof(networkInfo.workspaceSize));
+    hasher.update(networkInfo.deviceType);
+    if (getenv("BATCH_OPT")) {
+        hasher.update(std::string(getenv("BATCH_OPT")));
+    }
+    if (getenv("SPARSE_WEIGHTS")) {
+        hasher.update(std::string(getenv("SPARSE_WEIGHTS")));
+    }
+    if (networkInfo.networkType == "darknet" && getenv("PRUNE_YOLO_HEADS")) {
+        hasher.update(std::string(getenv("PRUNE_YOLO_HEADS")));
+    }
+    if (networkInfo.networkType == "darknet" && networkInfo.networkMode == "FP16" && getenv("WEIGHTS_FP16")) {
+        hasher.update(std::string(getenv("WEIGHTS_FP16")));
+    }
+
+    return hashToString(hasher.digest());
+}
+
+/**
+ * @brief 后台构建线程使用的 TensorRT 日志，DeepStream 传入的 builder 在后台构建结束前就会被销毁。
+ */
+static class AsyncBuildLogger : public nvinfer1::ILogger {
+    void log(nvinfer1::ILogger::Severity severity, const char* msg) noexcept override {
+        if (severity <= nvinfer1::ILogger::Severity::kWARNING)
+            std::cout << msg << std::endl;
+    }
+} asyncBuildLogger;
+
+/**
+ * @brief 在后台线程中使用独立的 builder 构建并序列化引擎。
+ * @param networkInfo 网络信息（offsets 指向调用方持有的副本）。
+ * @param gpuId       GPU 编号。
+ * @param blob        输出的序列化引擎。
+ * @return 若成功返回 true，否则返回 false。
+ */
+static bool buildSerializedEngine(const NetworkInfo& networkInfo, int gpuId, std::vector<char>& blob) {
+    if (cudaSetDevice(gpuId) != 0) {
+        std::cerr << "Could not set CUDA device " << gpuId << " for background build" << std::endl;
+        return false;
+    }
+
+    nvinfer1::IBuilder* builder = nvinfer1::createInferBuilder(asyncBuildLogger);
+    if (builder == nullptr) {
+        return false;
+    }
+
+    Yolo yolo(networkInfo);
+
+    #if NV_TENSORRT_MAJOR >= 8
+    nvinfer1::IBuilderConfig* config = builder->createBuilderConfig();
+    if (networkInfo.workspaceSize > 0) {
+        #if NV_TENSORRT_MAJOR > 8 || (NV_TENSORRT_MAJOR == 8 && NV_TENSORRT_MINOR >= 4)
+        config->setMemoryPoolLimit(nvinfer1::MemoryPoolType::kWORKSPACE,
+            (size_t) networkInfo.workspaceSize * 1024 * 1024);
+        #else
+        config->setMaxWorkspaceSize((size_t) networkInfo.workspaceSize * 1024 * 1024);
+        #endif
+    }
+    nvinfer1::IHostMemory* serializedEngine = yolo.createSerializedEngine(builder, config);
+    #else
+    nvinfer1::IHostMemory* serializedEngine = yolo.createSerializedEngine(builder);
+    #endif
+
+    if (serializedEngine != nullptr) {
+        const char* data = static_cast<const char*>(serializedEngine->data());
+        blob.assign(data, data + serializedEngine->size());
+    }
+
+    #if NV_TENSORRT_MAJOR >= 8
+    delete serializedEngine;
+    delete config;
+    delete builder;
+    #else
+    if (serializedEngine != nullptr) {
+        serializedEngine->destroy();
+    }
+    builder->destroy();
+    #endif
+
+    return !blob.empty();
+}
+
+/**
+ * @brief 获取进程内共享的引擎缓存与后台构建调度器，每个缓存目录一个。
+ * 调度器创建后不会被替换或销毁（后台构建线程一直在使用它），进程退出时等待未完成的构建。
+ * @param cacheDir  缓存目录（ENGINE_CACHE_DIR）。
+ * @return EngineBuildScheduler* 调度器实例。
+ */
+static EngineBuildScheduler* getBuildScheduler(const std::string& cacheDir) {
+    static std::mutex mutex;
+    static std::map<std::string, std::unique_ptr<EngineBuildScheduler>> schedulers;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<EngineBuildScheduler>& scheduler = schedulers[cacheDir];
+    if (!scheduler) {
+        // ENGINE_CACHE_SIZE 为缓存上限（MB），ENGINE_FALLBACK_FILES 为以冒号分隔的回退引擎文件，
+        // ENGINE_HOTSWAP_PATH 为后台构建完成后引擎的输出路径，供支持热替换的应用监听
+        uint64_t cacheSize = 4096;
+        if (getenv("ENGINE_CACHE_SIZE")) {
+            char* end = nullptr;
+            errno = 0;
+            unsigned long long value = strtoull(getenv("ENGINE_CACHE_SIZE"), &end, 10);
+            if (errno != 0 || end == getenv("ENGINE_CACHE_SIZE") || *end != '\0' || value == 0 ||
+                value > UINT64_MAX / (1024 * 1024)) {
+                std::cerr << "Invalid ENGINE_CACHE_SIZE \"" << getenv("ENGINE_CACHE_SIZE") << "\", using " <<
+                    cacheSize << " MB" << std::endl;
+            } else {
+                cacheSize = value;
+            }
+        }
+
+        std::vector<std::string> fallbackFiles;
+        if (getenv("ENGINE_FALLBACK_FILES")) {
+            std::string files = getenv("ENGINE_FALLBACK_FILES");
+            size_t lastPos = 0, pos = 0;
+            while ((pos = files.find(':', lastPos)) != std::string::npos) {
+                fallbackFiles.push_back(files.substr(lastPos, pos - lastPos));
+                lastPos = pos + 1;
+            }
+            fallbackFiles.push_back(files.substr(lastPos));
+        }
+
+        std::string hotSwapPath = getenv("ENGINE_HOTSWAP_PATH") ? getenv("ENGINE_HOTSWAP_PATH") : "";
+
+        scheduler.reset(new EngineBuildScheduler(EngineCache(cacheDir, cacheSize * 1024 * 1024), fallbackFiles,
+            hotSwapPath));
+    }
+    return scheduler.get();
+}
+
+/**
+ * @brief 读取整个引擎文件。
+ */
+static bool readEngineFile(const std::string& enginePath, std::vector<char>& blob) {
+    std::ifstream file(enginePath, std::ios::binary | std::ios::ate);
+    if (!file.good()) {
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    if (size <= 0) {
+        return false;
+    }
+    file.seekg(0, std::ios::beg);
+    blob.resize(size);
+    return static_cast<bool>(file.read(blob.data(), size));
+}
+
+/**
+ * @brief 反序列化引擎，runtime 与 Yolo::createEngine 中一样在进程生命周期内保留。
+ */
+static nvinfer1::ICudaEngine* deserializeEngine(nvinfer1::IBuilder* const builder, const std::vector<char>& blob) {
+    #if NV_TENSORRT_MAJOR > 8 || (NV_TENSORRT_MAJOR == 8 && NV_TENSORRT_MINOR > 0)
+    nvinfer1::IRuntime* runtime = nvinfer1::createInferRuntime(*builder->getLogger());
+    #else
+    nvinfer1::IRuntime* runtime = nvinfer1::createInferRuntime(logger);
+    #endif
+    return runtime->deserializeCudaEngine(blob.data(), blob.size());
+}
+
 #if !USE_CUDA_ENGINE_GET_API
 /**
  * @brief 旧版本 TensorRT 使用的模型解析器。
@@ -114,26 +387,101 @@ extern "C" bool NvDsInferYoloCudaEngineGet(
 #endif
 
 /**
- * @brief 创建 YOLO 的 TensorRT CUDA 引擎。
- * @param builder       TensorRT Builder。
- * @param builderConfig TensorRT BuilderConfig（仅适用于 TensorRT 8+）。
- * @param initParams    传入的初始化参数。
- * @param dataType      指定的数据类型（FP32、FP16、INT8）。
- * @param cudaEngine    输出的 CUDA 引擎指针。
- * @return 若成功返回 true，否则返回 false。
+ * @brief 启动性能报告的输出路径：引擎文件旁的 <engine>.startup.json，未指定引擎文件时放在模型文件旁。
  */
-extern "C" bool NvDsInferYoloCudaEngineGet(
-    #if NV_TENSORRT_MAJOR >= 8
+static std::string getStartupProfilePath(const NvDsInferContextInitParams* initParams) {
+    std::string basePath = initParams->modelEngineFilePath;
+    if (basePath.empty()) {
+        basePath = initParams->onnxFilePath[0] != '\0' ? initParams->onnxFilePath : initParams->modelFilePath;
+    }
+    return basePath + ".startup.json";
+}
+
+/**
+ * @brief 创建 YOLO 的 TensorRT CUDA 引擎（缓存查找、回退引擎与同步构建）。
+ * @param profiler 启动性能统计，为空时不记录。
+ */
+static bool createYoloCudaEngine(
     nvinfer1::IBuilder* const builder,
+    #if NV_TENSORRT_MAJOR >= 8
     nvinfer1::IBuilderConfig* const builderConfig,
     #endif
     const NvDsInferContextInitParams* const initParams,
-    nvinfer1::DataType dataType,
-    nvinfer1::ICudaEngine*& cudaEngine) {
-    
+    nvinfer1::ICudaEngine*& cudaEngine,
+    StartupProfiler* profiler) {
+
     NetworkInfo networkInfo;
-    if (!getYoloNetworkInfo(networkInfo, initParams)) {
-        return false;
+    {
+        ScopedPhase phase(profiler, "getYoloNetworkInfo");
+        if (!getYoloNetworkInfo(networkInfo, initParams)) {
+            return false;
+        }
+    }
+    networkInfo.profiler = profiler;
+
+    // ENGINE_CACHE_DIR 设置时启用按内容寻址的引擎缓存
+    const char* cacheDir = getenv("ENGINE_CACHE_DIR");
+    EngineBuildScheduler* scheduler = nullptr;
+    EngineRequest request;
+    if (cacheDir && cacheDir[0] != '\0') {
+        scheduler = getBuildScheduler(cacheDir);
+        request.modelKey = getModelCacheKey(networkInfo, initParams);
+        request.key = getEngineCacheKey(request.modelKey, networkInfo);
+        request.networkMode = networkInfo.networkMode;
+        request.batchSize = networkInfo.batchSize;
+
+        std::vector<char> blob;
+        if (scheduler->cache().lookup(request.key, blob)) {
+            {
+                ScopedPhase phase(profiler, "deserializeCudaEngine");
+                cudaEngine = deserializeEngine(builder, blob);
+            }
+            if (cudaEngine != nullptr) {
+                std::cout << "Loaded cached engine " << scheduler->cache().enginePath(request.key) << std::endl;
+                return true;
+            }
+            std::cerr << "Could not deserialize cached engine " << scheduler->cache().enginePath(request.key)
+                << ", rebuilding" << std::endl;
+        }
+
+        // ENGINE_ASYNC_BUILD=1 时先用回退引擎启动管线，目标引擎在后台构建，下次启动时生效
+        bool asyncBuild = getenv("ENGINE_ASYNC_BUILD") && std::string(getenv("ENGINE_ASYNC_BUILD")) == "1";
+        if (asyncBuild && networkInfo.deviceType == "kDLA") {
+            std::cout << "ENGINE_ASYNC_BUILD is not supported with DLA, building synchronously" << std::endl;
+            asyncBuild = false;
+        }
+
+        std::string fallbackPath;
+        if (asyncBuild && scheduler->findFallback(request, fallbackPath) && readEngineFile(fallbackPath, blob)) {
+            {
+                ScopedPhase phase(profiler, "deserializeCudaEngine");
+                cudaEngine = deserializeEngine(builder, blob);
+            }
+            if (cudaEngine != nullptr) {
+                std::cout << "Using fallback engine " << fallbackPath << " while the requested engine is built"
+                    << std::endl;
+
+                std::vector<float> offsets(networkInfo.offsets, networkInfo.offsets + 4);
+                int gpuId = initParams->gpuID;
+                std::string modelKey = request.modelKey;
+                request.storeKey = [networkInfo, offsets, modelKey]() {
+                    NetworkInfo info = networkInfo;
+                    info.offsets = offsets.data();
+                    return getEngineCacheKey(modelKey, info);
+                };
+                scheduler->buildAsync(request, [networkInfo, offsets, gpuId](std::vector<char>& engineBlob) {
+                    NetworkInfo info = networkInfo;
+                    info.offsets = offsets.data();
+                    info.profiler = nullptr;
+                    return buildSerializedEngine(info, gpuId, engineBlob);
+                });
+                return true;
+            }
+            std::cerr << "Could not deserialize fallback engine " << fallbackPath << std::endl;
+        }
+        else if (asyncBuild) {
+            std::cout << "No fallback engine available, building synchronously" << std::endl;
+        }
     }
 
     Yolo yolo(networkInfo);
@@ -149,7 +497,66 @@ extern "C" bool NvDsInferYoloCudaEngineGet(
         std::cerr << "Failed to build CUDA engine" << std::endl;
         return false;
     }
+
+    if (scheduler) {
+        // 隐式 INT8 的构建可能刚写出校准表，按构建后的输入重新计算键
+        request.key = getEngineCacheKey(request.modelKey, networkInfo);
+        nvinfer1::IHostMemory* serializedEngine = cudaEngine->serialize();
+        if (serializedEngine != nullptr) {
+            if (scheduler->cache().store(request.key, serializedEngine->data(), serializedEngine->size(),
+                EngineBuildScheduler::describe(request))) {
+                std::cout << "Cached engine " << scheduler->cache().enginePath(request.key) << std::endl;
+            }
+            #if NV_TENSORRT_MAJOR >= 8
+            delete serializedEngine;
+            #else
+            serializedEngine->destroy();
+            #endif
+        }
+    }
     return true;
 }
-#endif
 
+/**
+ * @brief 创建 YOLO 的 TensorRT CUDA 引擎。
+ * @param builder       TensorRT Builder。
+ * @param builderConfig TensorRT BuilderConfig（仅适用于 TensorRT 8+）。
+ * @param initParams    传入的初始化参数。
+ * @param dataType      指定的数据类型（FP32、FP16、INT8）。
+ * @param cudaEngine    输出的 CUDA 引擎指针。
+ * @return 若成功返回 true，否则返回 false。
+ */
+extern "C" bool NvDsInferYoloCudaEngineGet(
+    nvinfer1::IBuilder* const builder,
+    #if NV_TENSORRT_MAJOR >= 8
+    nvinfer1::IBuilderConfig* const builderConfig,
+    #endif
+    const NvDsInferContextInitParams* const initParams,
+    nvinfer1::DataType dataType,
+    nvinfer1::ICudaEngine*& cudaEngine) {
+
+    // STARTUP_PROFILE=1 时记录各阶段耗时和内存占用，并写入 JSON 报告
+    std::unique_ptr<StartupProfiler> profiler;
+    if (getenv("STARTUP_PROFILE") && std::string(getenv("STARTUP_PROFILE")) == "1") {
+        profiler.reset(new StartupProfiler());
+    }
+
+    bool success;
+    {
+        ScopedPhase phase(profiler.get(), "NvDsInferYoloCudaEngineGet");
+        #if NV_TENSORRT_MAJOR >= 8
+        success = createYoloCudaEngine(builder, builderConfig, initParams, cudaEngine, profiler.get());
+        #else
+        success = createYoloCudaEngine(builder, initParams, cudaEngine, profiler.get());
+        #endif
+    }
+
+    if (profiler) {
+        std::string reportPath = getStartupProfilePath(initParams);
+        if (profiler->writeJson(reportPath)) {
+            std::cout << "Startup profile saved to " << reportPath << std::endl;
+        }
+    }
+    return success;
+}
+#endif
@@ -6,7 +6,11 @@
 #include "nvds_obj_encode.h"
 #include <algorithm>
 #include "utils.h"
+#include "detection_publisher.h"
+#include "detection_ring.h"
+#include <time.h>
 #include <ros/ros.h>
+#include <vision_msgs/Detection2DArray.h>
 
 // 声明一个外部 C 风格的函数，用于解析 YOLO 推理的输出，填充检测到的目标列表
 extern "C" bool NvDsInferParseYolo(
@@ -146,15 +150,42 @@ extern "C" bool NvDsInferParseYolo(std::vector<NvDsInferLayerInfo> const& output
 // 检查解析函数的声明是否符合要求
 CHECK_CUSTOM_PARSE_FUNC_PROTOTYPE(NvDsInferParseYolo);
 
-// OSD 显示检测框及类别标签
+// 发布线程最多积压的帧数，发布跟不上时丢弃最旧的帧
+static const size_t kDetectionQueueDepth = 8;
+
+// 共享内存环默认的记录数
+static const uint64_t kDetectionRingRecords = 4096;
+
+// OSD probe 的 user_data：发布线程，以及设置了 DETECTION_SHM 时同进程外读取方共享的环
+struct OsdProbeContext {
+    DetectionPublisher *publisher;
+    DetectionRingWriter *ring;
+};
+
+// OSD 显示检测框及类别标签，并把每帧的全部检测结果写入共享内存环、交给发布线程。
+// 这里只写预先分配的 FrameDetections 和共享内存，不访问参数服务器也不打印日志，不会阻塞 GStreamer 流线程
 static GstPadProbeReturn osd_sink_pad_buffer_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    OsdProbeContext *context = (OsdProbeContext *)user_data;
+    DetectionPublisher *publisher = context->publisher;
     GstBuffer *buf = (GstBuffer *)info->data;
     NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
     NvDsObjectMeta *obj_meta = NULL;
 
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
     for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL; l_frame = l_frame->next) {
         NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
 
+        // 取不到空闲的帧缓冲时本帧只绘制不发布
+        FrameDetections *detections = publisher->begin();
+        if (detections != NULL) {
+            detections->frameNumber = frame_meta->frame_num;
+            detections->timestamp = frame_meta->buf_pts;
+            detections->systemTime = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+            detections->sourceId = frame_meta->source_id;
+        }
+
         for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL; l_obj = l_obj->next) {
             obj_meta = (NvDsObjectMeta *)(l_obj->data);
 
@@ -175,27 +206,110 @@ static GstPadProbeReturn osd_sink_pad_buffer_probe(GstPad *pad, GstPadProbeInfo
             NvOSD_DrawText(frame_meta->frame, label, obj_meta->rect_params.left, obj_meta->rect_params.top,
                            obj_meta->text_params.font_color, obj_meta->text_params.font_size);
 
-            // 计算边界框的中心点坐标
-            float center_x = (obj_meta->rect_params.left + obj_meta->rect_params.left + obj_meta->rect_params.width) / 2.0;
-            float center_y = (obj_meta->rect_params.top + obj_meta->rect_params.top + obj_meta->rect_params.height) / 2.0;
-            
-            // 发送中心点坐标
-            ros::param::set("target_pixel_x", center_x);
-            ros::param::set("target_pixel_y", center_y);
-            ros::param::set("target_label", std::string(label));
-            
-            ROS_INFO("Object center: x = %f, y = %f, label = %s", center_x, center_y, label);
+            if (detections == NULL) {
+                continue;
+            }
+            DetectionRecord *record = detections->add();
+            if (record == NULL) {
+                continue;
+            }
+            record->classId = obj_meta->class_id;
+            record->confidence = obj_meta->confidence;
+            record->left = obj_meta->rect_params.left;
+            record->top = obj_meta->rect_params.top;
+            record->width = obj_meta->rect_params.width;
+            record->height = obj_meta->rect_params.height;
+            g_strlcpy(record->label, obj_meta->obj_label, sizeof(record->label));
+        }
+
+        if (detections != NULL) {
+            // 先写共享内存环，同机的控制进程不经过发布线程和 ROS 即可读到
+            if (context->ring != NULL) {
+                context->ring->write(*detections);
+            }
+            publisher->commit(detections);
         }
     }
 
     return GST_PAD_PROBE_OK;
 }
 
-// 在 DeepStream Pipeline 中，绑定 OSD 处理的函数
+// 在发布线程中执行：每帧发布一条 vision_msgs/Detection2DArray（header.seq 为帧号，stamp 为 probe 时的系统时间），
+// 并为兼容原来的读取方式把最后一个目标的中心点和标签写入参数服务器
+static void publishDetections(const ros::Publisher &topic, vision_msgs::Detection2DArray &message,
+                              const FrameDetections &frame) {
+    message.header.seq = frame.frameNumber;
+    message.header.stamp.fromNSec(frame.systemTime);
+    message.header.frame_id = "source_" + std::to_string(frame.sourceId);
+    message.detections.resize(frame.count);
+
+    for (uint32_t i = 0; i < frame.count; ++i) {
+        const DetectionRecord &record = frame.objects[i];
+        vision_msgs::Detection2D &detection = message.detections[i];
+        detection.header = message.header;
+        detection.bbox.center.x = record.left + record.width / 2.0;
+        detection.bbox.center.y = record.top + record.height / 2.0;
+        detection.bbox.size_x = record.width;
+        detection.bbox.size_y = record.height;
+        detection.results.resize(1);
+        detection.results[0].id = record.classId;
+        detection.results[0].score = record.confidence;
+    }
+    topic.publish(message);
+
+    if (frame.count > 0) {
+        const DetectionRecord &last = frame.objects[frame.count - 1];
+        char label[128];
+        snprintf(label, sizeof(label), "%s %.2f", last.label, last.confidence);
+        ros::param::set("target_pixel_x", last.left + last.width / 2.0f);
+        ros::param::set("target_pixel_y", last.top + last.height / 2.0f);
+        ros::param::set("target_label", std::string(label));
+    }
+}
+
+static void destroyOsdProbeContext(gpointer user_data) {
+    OsdProbeContext *context = (OsdProbeContext *)user_data;
+    delete context->publisher;
+    delete context->ring;
+    delete context;
+}
+
+// 环境变量 DETECTION_SHM 为共享内存名（如 /yolo_detections）时创建检测结果的共享内存环，
+// DETECTION_SHM_RECORDS 为环的记录数。失败时只打印错误，检测结果仍通过 ROS 发布
+static DetectionRingWriter *createDetectionRing() {
+    const char *name = getenv("DETECTION_SHM");
+    if (name == NULL || name[0] == '\0') {
+        return NULL;
+    }
+    uint64_t records = kDetectionRingRecords;
+    if (getenv("DETECTION_SHM_RECORDS")) {
+        records = std::max(atoll(getenv("DETECTION_SHM_RECORDS")), 2LL);
+    }
+
+    DetectionRingWriter *ring = new DetectionRingWriter();
+    std::string error;
+    if (!ring->open(name, records, error)) {
+        std::cerr << "Detection ring disabled: " << error << std::endl;
+        delete ring;
+        return NULL;
+    }
+    return ring;
+}
+
+// 在 DeepStream Pipeline 中，绑定 OSD 处理的函数；发布线程和共享内存环随 probe 一起创建，probe 移除时结束
 void setup_osd(GstElement* pipeline) {
     GstElement *osd = gst_bin_get_by_name(GST_BIN(pipeline), "nvosd");
     GstPad *osd_sink_pad = gst_element_get_static_pad(osd, "sink");
 
-    gst_pad_add_probe(osd_sink_pad, GST_PAD_PROBE_TYPE_BUFFER, osd_sink_pad_buffer_probe, NULL, NULL);
+    ros::NodeHandle node;
+    ros::Publisher topic = node.advertise<vision_msgs::Detection2DArray>("yolo/detections", kDetectionQueueDepth);
+    vision_msgs::Detection2DArray message;
+    OsdProbeContext *context = new OsdProbeContext;
+    context->publisher = new DetectionPublisher(kDetectionQueueDepth,
+        [topic, message](const FrameDetections &frame) mutable { publishDetections(topic, message, frame); });
+    context->ring = createDetectionRing();
+
+    gst_pad_add_probe(osd_sink_pad, GST_PAD_PROBE_TYPE_BUFFER, osd_sink_pad_buffer_probe, context,
+                      destroyOsdProbeContext);
     gst_object_unref(osd_sink_pad);
-}
\ No newline at end of file
+}
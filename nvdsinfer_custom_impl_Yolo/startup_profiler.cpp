@@ -0,0 +1,167 @@
+#include "startup_profiler.h"
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+static double
+wallTimeMs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static double
+cpuTimeMs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// 当前常驻内存，读取 /proc/self/statm 的第二个字段（页数）
+uint64_t
+getCurrentRss()
+{
+  FILE* file = fopen("/proc/self/statm", "r");
+  if (file == nullptr) {
+    return 0;
+  }
+  unsigned long long size = 0;
+  unsigned long long resident = 0;
+  int count = fscanf(file, "%llu %llu", &size, &resident);
+  fclose(file);
+  if (count != 2) {
+    return 0;
+  }
+  return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+// 进程峰值常驻内存，Linux 上 ru_maxrss 的单位为 KB
+uint64_t
+getPeakRss()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+static std::string
+jsonEscape(const std::string& s)
+{
+  std::string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    }
+    else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+void
+StartupProfiler::begin(const std::string& name)
+{
+  PhaseRecord record;
+  record.name = name;
+  record.depth = m_Open.size();
+  m_Phases.push_back(record);
+
+  OpenPhase phase;
+  phase.record = m_Phases.size() - 1;
+  phase.wallStart = wallTimeMs();
+  phase.cpuStart = cpuTimeMs();
+  m_Open.push_back(phase);
+}
+
+void
+StartupProfiler::end()
+{
+  if (m_Open.empty()) {
+    return;
+  }
+
+  OpenPhase phase = m_Open.back();
+  m_Open.pop_back();
+
+  PhaseRecord& record = m_Phases[phase.record];
+  record.wallMs = wallTimeMs() - phase.wallStart;
+  record.cpuMs = cpuTimeMs() - phase.cpuStart;
+  record.rssBytes = getCurrentRss();
+  record.peakRssBytes = getPeakRss();
+}
+
+void
+StartupProfiler::addLayerWeights(int index, const std::string& type, uint64_t weightBytes)
+{
+  LayerWeightRecord record;
+  record.index = index;
+  record.type = type;
+  record.weightBytes = weightBytes;
+  m_Layers.push_back(record);
+}
+
+std::string
+StartupProfiler::toJson() const
+{
+  std::ostringstream s;
+  s << "{\n  \"phases\": [";
+  for (size_t i = 0; i < m_Phases.size(); ++i) {
+    const PhaseRecord& p = m_Phases[i];
+    s << (i ? ",\n" : "\n") << "    {\"name\": \"" << jsonEscape(p.name) << "\", \"depth\": " << p.depth
+        << ", \"wall_ms\": " << p.wallMs << ", \"cpu_ms\": " << p.cpuMs << ", \"rss_bytes\": " << p.rssBytes
+        << ", \"peak_rss_bytes\": " << p.peakRssBytes << "}";
+  }
+  s << "\n  ],\n  \"layers\": [";
+  uint64_t totalWeightBytes = 0;
+  for (size_t i = 0; i < m_Layers.size(); ++i) {
+    const LayerWeightRecord& l = m_Layers[i];
+    s << (i ? ",\n" : "\n") << "    {\"index\": " << l.index << ", \"type\": \"" << jsonEscape(l.type)
+        << "\", \"weight_bytes\": " << l.weightBytes << "}";
+    totalWeightBytes += l.weightBytes;
+  }
+  s << "\n  ],\n  \"total_weight_bytes\": " << totalWeightBytes << "\n}\n";
+  return s.str();
+}
+
+bool
+StartupProfiler::writeJson(const std::string& filePath) const
+{
+  std::ofstream file(filePath);
+  if (!file.good()) {
+    std::cerr << "Could not write startup profile " << filePath << std::endl;
+    return false;
+  }
+  file << toJson();
+  return file.good();
+}
+
+ScopedPhase::ScopedPhase(StartupProfiler* profiler, const std::string& name) : m_Profiler(profiler)
+{
+  if (m_Profiler != nullptr) {
+    m_Profiler->begin(name);
+  }
+}
+
+ScopedPhase::~ScopedPhase()
+{
+  if (m_Profiler != nullptr) {
+    m_Profiler->end();
+  }
+}
@@ -0,0 +1,70 @@
+#ifndef __STARTUP_PROFILER_H__
+#define __STARTUP_PROFILER_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct PhaseRecord
+{
+  std::string name;
+  int depth {0};
+  double wallMs {0};
+  double cpuMs {0};
+  uint64_t rssBytes {0};
+  uint64_t peakRssBytes {0};
+};
+
+struct LayerWeightRecord
+{
+  int index {0};
+  std::string type;
+  uint64_t weightBytes {0};
+};
+
+// 记录引擎创建各阶段的墙钟时间、CPU 时间和内存占用（当前/峰值 RSS），可嵌套
+class StartupProfiler {
+  public:
+    void begin(const std::string& name);
+
+    void end();
+
+    void addLayerWeights(int index, const std::string& type, uint64_t weightBytes);
+
+    const std::vector<PhaseRecord>& phases() const { return m_Phases; }
+
+    const std::vector<LayerWeightRecord>& layers() const { return m_Layers; }
+
+    std::string toJson() const;
+
+    bool writeJson(const std::string& filePath) const;
+
+  private:
+    struct OpenPhase
+    {
+      size_t record;
+      double wallStart;
+      double cpuStart;
+    };
+
+    std::vector<PhaseRecord> m_Phases;
+    std::vector<LayerWeightRecord> m_Layers;
+    std::vector<OpenPhase> m_Open;
+};
+
+// 作用域内的阶段计时，profiler 为空时不做任何事
+class ScopedPhase {
+  public:
+    ScopedPhase(StartupProfiler* profiler, const std::string& name);
+
+    ~ScopedPhase();
+
+  private:
+    StartupProfiler* m_Profiler;
+};
+
+uint64_t getCurrentRss();
+
+uint64_t getPeakRss();
+
+#endif
@@ -0,0 +1,284 @@
+#include "reference_ops.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace {
+
+// 按 perm 转置行优先存储的多维数组：输出第 i 维为输入第 perm[i] 维
+std::vector<float>
+transpose(const std::vector<float>& data, const std::vector<int>& dims, const std::vector<int>& perm)
+{
+  int rank = dims.size();
+  std::vector<int64_t> strides(rank, 1);
+  for (int i = rank - 2; i >= 0; --i) {
+    strides[i] = strides[i + 1] * dims[i + 1];
+  }
+
+  std::vector<float> output(data.size());
+  std::vector<int> index(rank, 0);
+  for (size_t o = 0; o < output.size(); ++o) {
+    int64_t source = 0;
+    for (int i = 0; i < rank; ++i) {
+      source += index[i] * strides[perm[i]];
+    }
+    output[o] = data[source];
+    for (int i = rank - 1; i >= 0 && ++index[i] == dims[perm[i]]; --i) {
+      index[i] = 0;
+    }
+  }
+  return output;
+}
+
+}
+
+HostTensor
+randomTensor(const TensorShape& shape, unsigned seed)
+{
+  HostTensor tensor;
+  tensor.shape = shape;
+  tensor.data.resize(shape.volume());
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  for (float& value : tensor.data) {
+    value = distribution(generator);
+  }
+  return tensor;
+}
+
+HostTensor
+referenceMaxpool(const HostTensor& input, int size, int stride)
+{
+  const TensorShape& in = input.shape;
+  int pad = (size - 1) / 2;
+
+  HostTensor output;
+  output.shape.c = in.c;
+  output.shape.h = (in.h + 2 * pad - size) / stride + 1;
+  output.shape.w = (in.w + 2 * pad - size) / stride + 1;
+  output.data.resize(output.shape.volume());
+
+  for (int c = 0; c < in.c; ++c) {
+    const float* plane = input.data.data() + (int64_t) c * in.h * in.w;
+    for (int y = 0; y < output.shape.h; ++y) {
+      for (int x = 0; x < output.shape.w; ++x) {
+        float value = -std::numeric_limits<float>::infinity();
+        for (int ky = y * stride - pad; ky < y * stride - pad + size; ++ky) {
+          for (int kx = x * stride - pad; kx < x * stride - pad + size; ++kx) {
+            if (ky >= 0 && ky < in.h && kx >= 0 && kx < in.w) {
+              value = std::max(value, plane[ky * in.w + kx]);
+            }
+          }
+        }
+        output.data[((int64_t) c * output.shape.h + y) * output.shape.w + x] = value;
+      }
+    }
+  }
+  return output;
+}
+
+HostTensor
+referenceConv(const HostTensor& input, const float* kernel, const float* bias, int filters, int size, int stride,
+    int pad)
+{
+  const TensorShape& in = input.shape;
+
+  HostTensor output;
+  output.shape.c = filters;
+  output.shape.h = (in.h + 2 * pad - size) / stride + 1;
+  output.shape.w = (in.w + 2 * pad - size) / stride + 1;
+  output.data.assign(output.shape.volume(), 0.0f);
+
+  for (int f = 0; f < filters; ++f) {
+    float* plane = output.data.data() + (int64_t) f * output.shape.h * output.shape.w;
+    for (int c = 0; c < in.c; ++c) {
+      const float* source = input.data.data() + (int64_t) c * in.h * in.w;
+      const float* k = kernel + ((int64_t) f * in.c + c) * size * size;
+      for (int y = 0; y < output.shape.h; ++y) {
+        for (int x = 0; x < output.shape.w; ++x) {
+          float sum = 0;
+          for (int ky = 0; ky < size; ++ky) {
+            int sy = y * stride - pad + ky;
+            if (sy < 0 || sy >= in.h) {
+              continue;
+            }
+            for (int kx = 0; kx < size; ++kx) {
+              int sx = x * stride - pad + kx;
+              if (sx >= 0 && sx < in.w) {
+                sum += k[ky * size + kx] * source[sy * in.w + sx];
+              }
+            }
+          }
+          plane[y * output.shape.w + x] += sum;
+        }
+      }
+    }
+    if (bias != nullptr) {
+      for (int64_t i = 0; i < (int64_t) output.shape.h * output.shape.w; ++i) {
+        plane[i] += bias[f];
+      }
+    }
+  }
+  return output;
+}
+
+void
+referenceBatchnorm(HostTensor& tensor, const float* params, float eps)
+{
+  int filters = tensor.shape.c;
+  int64_t area = (int64_t) tensor.shape.h * tensor.shape.w;
+  for (int f = 0; f < filters; ++f) {
+    double bias = params[f];
+    double scale = params[filters + f];
+    double mean = params[2 * filters + f];
+    double stddev = std::sqrt((double) params[3 * filters + f] + eps);
+    float* plane = tensor.data.data() + f * area;
+    for (int64_t i = 0; i < area; ++i) {
+      plane[i] = (plane[i] - mean) / stddev * scale + bias;
+    }
+  }
+}
+
+void
+referenceChannels(HostTensor& tensor, const float* values, bool multiply)
+{
+  int64_t area = (int64_t) tensor.shape.h * tensor.shape.w;
+  for (int c = 0; c < tensor.shape.c; ++c) {
+    float* plane = tensor.data.data() + c * area;
+    for (int64_t i = 0; i < area; ++i) {
+      plane[i] = multiply ? plane[i] * values[c] : plane[i] + values[c];
+    }
+  }
+}
+
+void
+referenceActivation(HostTensor& tensor, ActivationKind activation)
+{
+  for (float& value : tensor.data) {
+    double x = value;
+    double softplus = x > 20 ? x : std::log1p(std::exp(x));
+    double sigmoid = 1.0 / (1.0 + std::exp(-x));
+    double hardSigmoid = std::min(1.0, std::max(0.0, x / 6 + 0.5));
+    switch (activation) {
+      case ActivationKind::kLinear:
+        break;
+      case ActivationKind::kRelu:
+        value = std::max(0.0, x);
+        break;
+      case ActivationKind::kLogistic:
+        value = sigmoid;
+        break;
+      case ActivationKind::kTanh:
+        value = std::tanh(x);
+        break;
+      case ActivationKind::kLeaky:
+        value = x > 0 ? x : 0.1 * x;
+        break;
+      case ActivationKind::kSoftplus:
+        value = softplus;
+        break;
+      case ActivationKind::kMish:
+        value = x * std::tanh(softplus);
+        break;
+      case ActivationKind::kSilu:
+        value = x * sigmoid;
+        break;
+      case ActivationKind::kHardSigmoid:
+        value = hardSigmoid;
+        break;
+      case ActivationKind::kHardSwish:
+        value = x * hardSigmoid;
+        break;
+    }
+  }
+}
+
+HostTensor
+referenceUpsample(const HostTensor& input, int stride)
+{
+  const TensorShape& in = input.shape;
+
+  HostTensor output;
+  output.shape.c = in.c;
+  output.shape.h = in.h * stride;
+  output.shape.w = in.w * stride;
+  output.data.resize(output.shape.volume());
+
+  for (int c = 0; c < in.c; ++c) {
+    for (int y = 0; y < output.shape.h; ++y) {
+      for (int x = 0; x < output.shape.w; ++x) {
+        output.data[((int64_t) c * output.shape.h + y) * output.shape.w + x] =
+            input.data[((int64_t) c * in.h + y / stride) * in.w + x / stride];
+      }
+    }
+  }
+  return output;
+}
+
+HostTensor
+referenceReorg3d(const HostTensor& input, int stride)
+{
+  const TensorShape& in = input.shape;
+
+  HostTensor output;
+  output.shape.c = in.c * 4;
+  output.shape.h = in.h / stride;
+  output.shape.w = in.w / stride;
+  output.data.resize(output.shape.volume());
+
+  for (int q = 0; q < 4; ++q) {
+    for (int c = 0; c < in.c; ++c) {
+      for (int y = 0; y < output.shape.h; ++y) {
+        for (int x = 0; x < output.shape.w; ++x) {
+          output.data[(((int64_t) q * in.c + c) * output.shape.h + y) * output.shape.w + x] =
+              input.data[((int64_t) c * in.h + y * stride + q / 2) * in.w + x * stride + q % 2];
+        }
+      }
+    }
+  }
+  return output;
+}
+
+HostTensor
+referenceReorg(const HostTensor& input, int stride)
+{
+  const TensorShape& in = input.shape;
+  int groups = in.c / (stride * stride);
+
+  HostTensor output;
+  output.shape.c = in.c * stride * stride;
+  output.shape.h = in.h / stride;
+  output.shape.w = in.w / stride;
+  output.data = transpose(input.data, {groups, in.h, stride, in.w, stride}, {0, 1, 3, 2, 4});
+  output.data = transpose(output.data, {groups, in.h * in.w, stride * stride}, {0, 2, 1});
+  output.data = transpose(output.data, {groups, stride * stride, in.h * in.w}, {1, 0, 2});
+  return output;
+}
+
+HostTensor
+referenceSpaceToDepth(const HostTensor& input, int stride)
+{
+  const TensorShape& in = input.shape;
+
+  HostTensor output;
+  output.shape.c = in.c * stride * stride;
+  output.shape.h = in.h / stride;
+  output.shape.w = in.w / stride;
+  output.data = transpose(input.data, {in.c / (stride * stride), in.h, stride, in.w, stride}, {2, 4, 0, 1, 3});
+  return output;
+}
+
+float
+maxAbsDifference(const HostTensor& a, const HostTensor& b)
+{
+  if (a.shape.c != b.shape.c || a.shape.h != b.shape.h || a.shape.w != b.shape.w) {
+    return -1;
+  }
+  float difference = 0;
+  for (size_t i = 0; i < a.data.size(); ++i) {
+    difference = std::max(difference, std::fabs(a.data[i] - b.data[i]));
+  }
+  return difference;
+}
@@ -0,0 +1,50 @@
+#ifndef __REFERENCE_OPS_H__
+#define __REFERENCE_OPS_H__
+
+#include <vector>
+
+#include "network_shapes.h"
+
+// 单样本 CHW 张量上的 CPU 参考实现，按 TensorRT 中各层的构建方式计算，用于在没有 GPU 时检查图改写是否等价
+struct HostTensor
+{
+  TensorShape shape;
+  std::vector<float> data;
+};
+
+// 按层号生成的 [-1, 1) 随机张量
+HostTensor randomTensor(const TensorShape& shape, unsigned seed);
+
+// 与 poolingLayer 相同：两侧各填充 (size - 1) / 2，填充位置不参与取最大值
+HostTensor referenceMaxpool(const HostTensor& input, int size, int stride);
+
+// 与 convolutionalLayer 相同的不分组卷积（不含激活），卷积核布局为 [filters][C][size][size]，bias 可为空
+HostTensor referenceConv(const HostTensor& input, const float* kernel, const float* bias, int filters, int size,
+    int stride, int pad);
+
+// darknet 定义的 batch-norm：(x - mean) / sqrt(var + eps) * scale + bias，params 依次为 filters 个
+// bias、scale、mean、var（与 .weights 文件中的顺序相同），原地计算
+void referenceBatchnorm(HostTensor& tensor, const float* params, float eps);
+
+// 与 shift_channels/control_channels 相同：每个通道加上（multiply 为 true 时乘以）implicit 层的值，原地计算
+void referenceChannels(HostTensor& tensor, const float* values, bool multiply);
+
+// 与 activationLayer 相同的逐元素激活（leaky 的斜率为 0.1，hard_sigmoid 为 x / 6 + 0.5 截断到 [0, 1]），原地计算
+void referenceActivation(HostTensor& tensor, ActivationKind activation);
+
+// 与 upsampleLayer 相同的最近邻上采样
+HostTensor referenceUpsample(const HostTensor& input, int stride);
+
+// 与 reorgLayer 中的 reorg3d 相同：按 (0,0)、(0,1)、(1,0)、(1,1) 取 4 个步长为 stride 的切片后按通道拼接
+HostTensor referenceReorg3d(const HostTensor& input, int stride);
+
+// darknet reorg 原先的 4 个 shuffle（逐步 reshape + 转置）
+HostTensor referenceReorg(const HostTensor& input, int stride);
+
+// reorgLayer 中合并后的 reorg：一次 [C / s², H, s, W, s] -> [s, s, C / s², H, W] 的转置
+HostTensor referenceSpaceToDepth(const HostTensor& input, int stride);
+
+// 两个张量形状相同时返回逐元素差的最大绝对值，否则返回 -1
+float maxAbsDifference(const HostTensor& a, const HostTensor& b);
+
+#endif
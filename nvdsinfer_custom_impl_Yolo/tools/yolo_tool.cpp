@@ -0,0 +1,3379 @@
+// 离线模型工具：把 Darknet cfg + weights 打包成模型包（解析好的网络描述 + 转换好的权重），并检查/校验模型包。
+// 不依赖 TensorRT，在 CPU 上运行
+//
+//   yolo_tool pack   <cfg> <weights> <out.pack>
+//   yolo_tool check  <pack>
+//   yolo_tool verify <cfg> <weights> <pack>
+//   yolo_tool optimize <cfg>
+//   yolo_tool dryrun <cfg> [weights] [batch,batch,...]
+//   yolo_tool cost   <cfg> [device.txt budget_ms [FP32|FP16|INT8] [max_batch]]
+//   yolo_tool prune  <cfg> <yolo_N,...>
+//   yolo_tool fp16check [cfg weights]
+//   yolo_tool sparsity <cfg> <weights> [out.weights|out.pack [convolutional_N,...]]
+//   yolo_tool qdqcheck <cfg> <weights> [activation scales]
+//   yolo_tool ringbench [readers frames objects interval_us spin_us]
+//   yolo_tool cachecheck
+//   yolo_tool buildcheck
+//   yolo_tool profilecheck
+//   yolo_tool passcheck
+//   yolo_tool subsetcheck
+//   yolo_tool prefetchcheck
+//   yolo_tool packcheck
+//   yolo_tool calibcachecheck
+//   yolo_tool publishcheck
+
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <experimental/filesystem>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "network_ir.h"
+#include "network_weights.h"
+#include "network_passes.h"
+#include "network_shapes.h"
+#include "network_cost.h"
+#include "reference_ops.h"
+#include "weight_folding.h"
+#include "weights_file.h"
+#include "model_pack.h"
+#include "half_float.h"
+#include "worker_pool.h"
+#include "weight_sparsity.h"
+#include "int8_quantization.h"
+#include "detection_ring.h"
+#include "detection_publisher.h"
+#include "engine_cache.h"
+#include "engine_builder.h"
+#include "batch_profiles.h"
+#include "startup_profiler.h"
+#include "calibration_subset.h"
+#include "batch_prefetcher.h"
+#include "image_packing.h"
+#include "calibration_cache.h"
+
+static void
+printUsage()
+{
+  std::cerr << "Usage:\n"
+      "  yolo_tool pack   <cfg> <weights> <out.pack>\n"
+      "  yolo_tool check  <pack>\n"
+      "  yolo_tool verify <cfg> <weights> <pack>\n"
+      "  yolo_tool optimize <cfg>\n"
+      "  yolo_tool dryrun <cfg> [weights] [batch,batch,...]\n"
+      "  yolo_tool cost   <cfg> [device.txt budget_ms [FP32|FP16|INT8] [max_batch]]\n"
+      "  yolo_tool prune  <cfg> <yolo_N,...>\n"
+      "  yolo_tool fp16check [cfg weights]\n"
+      "  yolo_tool sparsity <cfg> <weights> [out.weights|out.pack [convolutional_N,...]]\n"
+      "  yolo_tool qdqcheck <cfg> <weights> [activation scales]\n"
+      "  yolo_tool ringbench [readers frames objects interval_us spin_us]\n"
+      "  yolo_tool cachecheck\n"
+      "  yolo_tool buildcheck\n"
+      "  yolo_tool profilecheck\n"
+      "  yolo_tool passcheck\n"
+      "  yolo_tool subsetcheck\n"
+      "  yolo_tool prefetchcheck\n"
+      "  yolo_tool packcheck\n"
+      "  yolo_tool calibcachecheck\n"
+      "  yolo_tool publishcheck" << std::endl;
+}
+
+static void
+printPassStats(const NetworkPassStats& stats)
+{
+  std::cout << "Network passes: " << stats.identityLayers << " identity, " << stats.mergedLayers << " merged, " <<
+      stats.cascadedPools << " cascaded maxpool, " << stats.foldedBatchnorms << " folded batchnorm, " <<
+      stats.deadLayers << " unused layers" << std::endl;
+}
+
+static std::string
+formatMiB(int64_t bytes)
+{
+  std::ostringstream stream;
+  stream << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MiB";
+  return stream.str();
+}
+
+// STARTUP_PROFILE=1 时与插件相同，记录 check/dryrun 中解析 cfg、读取权重等阶段的耗时和内存占用
+static std::unique_ptr<StartupProfiler>
+createStartupProfiler()
+{
+  std::unique_ptr<StartupProfiler> profiler;
+  if (getenv("STARTUP_PROFILE") && std::string(getenv("STARTUP_PROFILE")) == "1") {
+    profiler.reset(new StartupProfiler());
+  }
+  return profiler;
+}
+
+static void
+addLayerWeights(StartupProfiler* profiler, const NetworkDesc& network, const std::vector<LayerWeights>& layerWeights)
+{
+  for (size_t i = 0; profiler != nullptr && i < layerWeights.size(); ++i) {
+    const LayerWeights& weights = layerWeights[i];
+    if (weights.kernelCount + weights.biasCount > 0) {
+      size_t elementSize = weights.kernelHalf != nullptr ? sizeof(uint16_t) : sizeof(float);
+      profiler->addLayerWeights(i, network.layers[i].type, (weights.kernelCount + weights.biasCount) * elementSize);
+    }
+  }
+}
+
+// 打印各阶段的统计并写入 <模型文件>.startup.json，格式与插件的报告相同
+static void
+reportStartupProfile(const StartupProfiler* profiler, const std::string& modelPath)
+{
+  if (profiler == nullptr) {
+    return;
+  }
+  std::cout << "\nStartup profile:" << std::endl;
+  std::cout << std::left << std::setw(24) << "Phase" << std::setw(12) << "Wall ms" << std::setw(12) << "CPU ms" <<
+      std::setw(14) << "RSS" << "Peak RSS" << std::endl;
+  for (const PhaseRecord& phase : profiler->phases()) {
+    std::ostringstream wall, cpu;
+    wall << std::fixed << std::setprecision(1) << phase.wallMs;
+    cpu << std::fixed << std::setprecision(1) << phase.cpuMs;
+    std::cout << std::setw(24) << std::string(phase.depth * 2, ' ') + phase.name << std::setw(12) << wall.str() <<
+        std::setw(12) << cpu.str() << std::setw(14) << formatMiB(phase.rssBytes) << formatMiB(phase.peakRssBytes) <<
+        std::endl;
+  }
+  std::string reportPath = modelPath + ".startup.json";
+  if (profiler->writeJson(reportPath)) {
+    std::cout << "Startup profile saved to " << reportPath << std::endl;
+  }
+}
+
+// 解析 cfg、执行图优化并按插件构建时相同的规则转换权重
+static bool
+prepareDarknetModel(const std::string& cfgPath, const std::string& weightsPath, WeightsFile& weightsFile,
+    WeightArena& arena, NetworkDesc& network, std::vector<LayerWeights>& layerWeights)
+{
+  std::string error;
+  if (!parseNetworkConfigFile(cfgPath, network, error)) {
+    std::cerr << "Could not parse the cfg file: " << error << std::endl;
+    return false;
+  }
+  NetworkPassStats stats;
+  optimizeNetwork(network, stats);
+  printPassStats(stats);
+  if (!weightsFile.open(weightsPath)) {
+    std::cerr << "Could not open the weights file " << weightsPath << std::endl;
+    return false;
+  }
+  WeightCursor weights(weightsFile.data(), weightsFile.size());
+  if (!prepareNetworkWeights(network, weights, arena, layerWeights, error, weightThreads())) {
+    std::cerr << "Could not prepare the weights: " << error << std::endl;
+    return false;
+  }
+  return true;
+}
+
+static int
+packModel(const std::string& cfgPath, const std::string& weightsPath, const std::string& packPath)
+{
+  WeightsFile weightsFile;
+  WeightArena arena;
+  NetworkDesc network;
+  std::vector<LayerWeights> layerWeights;
+  if (!prepareDarknetModel(cfgPath, weightsPath, weightsFile, arena, network, layerWeights)) {
+    return 1;
+  }
+
+  std::string error;
+  if (!writeModelPack(packPath, network, layerWeights, error)) {
+    std::cerr << "Could not write the model pack: " << error << std::endl;
+    return 1;
+  }
+
+  uint64_t count = 0;
+  for (const LayerWeights& weights : layerWeights) {
+    count += weights.kernelCount + weights.biasCount;
+  }
+  std::cout << "Packed " << network.layers.size() << " layers, " << count << " weights (" << weightsFile.size() <<
+      " in " << weightsPath << ") into " << packPath << std::endl;
+  return 0;
+}
+
+static void
+printLayerNote(const LayerDesc& layer)
+{
+  if (layer.dead) {
+    std::cout << "unused";
+  }
+  else if (layer.aliasOf >= 0) {
+    std::cout << "= " << layer.aliasOf;
+  }
+  else if (layer.foldedInto >= 0) {
+    std::cout << "folded into " << layer.foldedInto;
+  }
+}
+
+static int
+checkPack(const std::string& packPath)
+{
+  std::unique_ptr<StartupProfiler> profiler = createStartupProfiler();
+  ModelPack pack;
+  std::string error;
+  {
+    ScopedPhase phase(profiler.get(), "loadModelPack");
+    if (!pack.open(packPath, error)) {
+      std::cerr << "Invalid model pack: " << error << std::endl;
+      return 1;
+    }
+  }
+
+  const NetworkDesc& network = pack.network();
+  std::cout << "Input: " << network.channels << "x" << network.height << "x" << network.width << ", letter_box: " <<
+      network.letterBox << std::endl;
+  std::cout << std::left << std::setw(7) << "Layer" << std::setw(22) << "Type" << std::setw(14) << "Kernel" <<
+      std::setw(10) << "Bias" << "Note" << std::endl;
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerDesc& layer = network.layers[i];
+    const LayerWeights& weights = pack.layerWeights()[i];
+    std::cout << std::setw(7) << i << std::setw(22) << layer.type << std::setw(14) << weights.kernelCount <<
+        std::setw(10) << weights.biasCount;
+    printLayerNote(layer);
+    std::cout << std::endl;
+  }
+  std::cout << "Weights: " << pack.weightsBytes() << " bytes, checksum OK" << std::endl;
+  addLayerWeights(profiler.get(), network, pack.layerWeights());
+  reportStartupProfile(profiler.get(), packPath);
+  return 0;
+}
+
+static bool
+sameLayer(const LayerDesc& a, const LayerDesc& b)
+{
+  return a.kind == b.kind && a.type == b.type && a.inputs == b.inputs && a.foldedInto == b.foldedInto &&
+      a.aliasOf == b.aliasOf && a.dead == b.dead && a.filters == b.filters && a.size == b.size &&
+      a.stride == b.stride && a.pad == b.pad && a.groups == b.groups && a.batchNormalize == b.batchNormalize &&
+      a.bias == b.bias && a.activation == b.activation &&
+      a.axis == b.axis && a.routeGroups == b.routeGroups && a.groupId == b.groupId && a.classes == b.classes &&
+      a.num == b.num && a.newCoords == b.newCoords && a.scaleXY == b.scaleXY && a.anchors == b.anchors &&
+      a.mask == b.mask;
+}
+
+static bool
+sameWeights(const float* a, int64_t aCount, const float* b, int64_t bCount)
+{
+  return aCount == bCount && (aCount == 0 || memcmp(a, b, aCount * sizeof(float)) == 0);
+}
+
+// 从 cfg + weights 重新转换一遍，与模型包逐层比较网络描述，并逐位比较权重
+static int
+verifyPack(const std::string& cfgPath, const std::string& weightsPath, const std::string& packPath)
+{
+  WeightsFile weightsFile;
+  WeightArena arena;
+  NetworkDesc network;
+  std::vector<LayerWeights> layerWeights;
+  if (!prepareDarknetModel(cfgPath, weightsPath, weightsFile, arena, network, layerWeights)) {
+    return 1;
+  }
+
+  ModelPack pack;
+  std::string error;
+  if (!pack.open(packPath, error)) {
+    std::cerr << "Invalid model pack: " << error << std::endl;
+    return 1;
+  }
+
+  const NetworkDesc& packed = pack.network();
+  if (packed.channels != network.channels || packed.height != network.height || packed.width != network.width ||
+      packed.letterBox != network.letterBox || packed.layers.size() != network.layers.size()) {
+    std::cerr << "[net] or layer count differs" << std::endl;
+    return 1;
+  }
+
+  int mismatches = 0;
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerWeights& expected = layerWeights[i];
+    const LayerWeights& actual = pack.layerWeights()[i];
+    if (!sameLayer(network.layers[i], packed.layers[i])) {
+      std::cerr << "Layer " << i << " [" << network.layers[i].type << "]: description differs" << std::endl;
+      ++mismatches;
+    }
+    else if (!sameWeights(expected.kernel, expected.kernelCount, actual.kernel, actual.kernelCount) ||
+        !sameWeights(expected.bias, expected.biasCount, actual.bias, actual.biasCount)) {
+      std::cerr << "Layer " << i << " [" << network.layers[i].type << "]: weights differ" << std::endl;
+      ++mismatches;
+    }
+  }
+
+  if (mismatches > 0) {
+    std::cerr << mismatches << " layers differ" << std::endl;
+    return 1;
+  }
+  std::cout << "Model pack matches " << cfgPath << " + " << weightsPath << " (" << network.layers.size() <<
+      " layers)" << std::endl;
+  return 0;
+}
+
+// 在 CPU 上计算 maxpool 和恒等层组成的子图，其他层的输出用按层号生成的随机张量代替
+static const HostTensor&
+evaluatePools(const NetworkDesc& network, const std::vector<TensorShape>& shapes, int index,
+    std::map<int, HostTensor>& values)
+{
+  auto it = values.find(index);
+  if (it != values.end()) {
+    return it->second;
+  }
+
+  HostTensor value;
+  const LayerDesc* layer = index < 0 ? nullptr : &network.layers[index];
+  bool identity = layer != nullptr && ((layer->kind == LayerKind::kRoute && layer->inputs.size() == 1 &&
+      layer->routeGroups == 1) || layer->kind == LayerKind::kDropout);
+  if (layer != nullptr && layer->aliasOf >= 0) {
+    value = evaluatePools(network, shapes, layer->aliasOf, values);
+  }
+  else if (identity) {
+    value = evaluatePools(network, shapes, layer->inputs[0], values);
+  }
+  else if (layer != nullptr && layer->kind == LayerKind::kMaxpool && layer->stride == 1 && layer->size % 2 == 1) {
+    value = referenceMaxpool(evaluatePools(network, shapes, layer->inputs[0], values), layer->size, layer->stride);
+  }
+  else {
+    TensorShape shape = index >= 0 ? shapes[index] : TensorShape();
+    if (index < 0) {
+      shape.c = network.channels;
+      shape.h = network.height;
+      shape.w = network.width;
+    }
+    value = randomTensor(shape, index + 2);
+  }
+  return values[index] = value;
+}
+
+// 在 CPU 上比较构建时的输入端改写与原 cfg 的结果：reorg3d 融合进卷积（随机卷积核），reorg 合并为一次转置。
+// 与输入尺寸无关，宽高超过 64 时只取 64x64 以加快计算；返回最大误差，不适用时返回 -1
+static float
+checkInputRewrite(const NetworkDesc& network, const std::vector<TensorShape>& shapes, int index)
+{
+  const LayerDesc& layer = network.layers[index];
+  int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+  TensorShape shape = input >= 0 ? shapes[input] : TensorShape();
+  if (input < 0) {
+    shape.c = network.channels;
+    shape.h = network.height;
+    shape.w = network.width;
+  }
+
+  if (layer.kind == LayerKind::kReorg && !layer.dead && layer.aliasOf < 0) {
+    HostTensor x = randomTensor(shape, index + 2);
+    return maxAbsDifference(referenceReorg(x, layer.stride), referenceSpaceToDepth(x, layer.stride));
+  }
+  if (!canFoldSpaceToDepth(network, shapes, index)) {
+    return -1;
+  }
+
+  shape.h = std::min(shape.h, 64);
+  shape.w = std::min(shape.w, 64);
+  HostTensor x = randomTensor(shape, index + 2);
+  const LayerDesc& conv = network.layers[index + 1];
+  TensorShape kernelShape;
+  kernelShape.c = conv.filters;
+  kernelShape.h = 4 * shape.c;
+  kernelShape.w = conv.size * conv.size;
+  TensorShape biasShape;
+  biasShape.c = conv.filters;
+  biasShape.h = 1;
+  biasShape.w = 1;
+  HostTensor kernel = randomTensor(kernelShape, index + 3);
+  HostTensor bias = randomTensor(biasShape, index + 4);
+
+  NetworkDesc folded = network;
+  folded.layers[index].foldedInto = index + 1;
+  LayerDesc foldedConv = effectiveConvolution(folded, index + 1);
+  std::vector<float> foldedKernel(kernel.data.size());
+  foldSpaceToDepthConv(kernel.data.data(), conv.filters, shape.c, conv.size, foldedKernel.data());
+
+  HostTensor expected = referenceConv(referenceReorg3d(x, layer.stride), kernel.data.data(), bias.data.data(),
+      conv.filters, conv.size, conv.stride, conv.pad);
+  HostTensor actual = referenceConv(x, foldedKernel.data(), bias.data.data(), conv.filters, foldedConv.size,
+      foldedConv.stride, foldedConv.pad);
+  return maxAbsDifference(expected, actual);
+}
+
+// 按 cfg 的顺序生成随机的 darknet 权重，BN 的 running_var 取正值；offsets 为每层权重的起始位置
+static std::vector<float>
+randomDarknetWeights(const NetworkDesc& network, const std::vector<TensorShape>& shapes,
+    std::vector<int64_t>& offsets)
+{
+  std::vector<float> weights(expectedWeightCount(network, shapes));
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  for (float& value : weights) {
+    value = distribution(generator);
+  }
+
+  offsets.assign(network.layers.size(), 0);
+  int64_t offset = 0;
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerDesc& layer = network.layers[i];
+    int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+    offsets[i] = offset;
+    bool batchnorm = layer.kind == LayerKind::kBatchnorm || ((layer.kind == LayerKind::kConvolutional ||
+        layer.kind == LayerKind::kDeconvolutional) && layer.batchNormalize);
+    for (int f = 0; batchnorm && f < layer.filters; ++f) {
+      float& variance = weights[offset + 3 * layer.filters + f];
+      variance = std::fabs(variance) + 0.1f;
+    }
+    offset += layerWeightCount(layer, input < 0 ? network.channels : shapes[input].c);
+  }
+  return weights;
+}
+
+// 用随机权重执行与插件相同的权重转换，把转换后的每个卷积与原 cfg 中的卷积 + BN（以及并入的 [batchnorm]、
+// implicit 层）在 CPU 上逐元素比较。结果与输入尺寸无关，宽高只取 6x6 以加快计算；返回不一致的层数
+static int
+checkWeightFolds(const NetworkDesc& network, const std::vector<TensorShape>& shapes)
+{
+  std::vector<int64_t> offsets;
+  std::vector<float> darknetWeights = randomDarknetWeights(network, shapes, offsets);
+  NetworkDesc folded = network;
+  WeightCursor cursor(darknetWeights.data(), darknetWeights.size());
+  WeightArena arena;
+  std::vector<LayerWeights> layerWeights;
+  std::string error;
+  if (!prepareNetworkWeights(folded, cursor, arena, layerWeights, error)) {
+    std::cerr << "Could not prepare random weights: " << error << std::endl;
+    return 1;
+  }
+
+  // darknet 权重中第 index 层卷积的卷积核和偏置（BN 参数在最前面）
+  auto rawConv = [&](int index, const float*& kernel, const float*& bias) {
+    const LayerDesc& layer = folded.layers[index];
+    const float* raw = darknetWeights.data() + offsets[index] + (layer.batchNormalize ? 4 * layer.filters : 0);
+    bias = layer.bias ? raw : nullptr;
+    kernel = raw + (layer.bias ? layer.filters : 0);
+  };
+
+  int checked = 0;
+  int batchnorms = 0;
+  int failures = 0;
+  float maxDifference = 0;
+  for (size_t i = 0; i < folded.layers.size(); ++i) {
+    const LayerDesc& layer = folded.layers[i];
+    if (layer.kind != LayerKind::kConvolutional || layer.dead) {
+      continue;
+    }
+    const float* rawKernel;
+    const float* rawBias;
+    rawConv(i, rawKernel, rawBias);
+    // 分组卷积没有 CPU 参考实现
+    if (layer.groups != 1 || layerWeights[i].kernel == rawKernel) {
+      continue;
+    }
+
+    // 前一层 reorg3d 或 shift_channels 融合进输入端时，卷积直接作用在它们的输入上
+    int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+    bool inputFolded = input >= 0 && folded.layers[input].foldedInto == (int) i;
+    bool spaceToDepth = inputFolded && folded.layers[input].kind == LayerKind::kReorg3d;
+    int source = inputFolded ? folded.layers[input].inputs[0] : input;
+    TensorShape shape = source >= 0 ? shapes[source] : TensorShape();
+    if (source < 0) {
+      shape.c = network.channels;
+    }
+    shape.h = spaceToDepth ? 12 : 6;
+    shape.w = shape.h;
+    HostTensor x = randomTensor(shape, i + 2);
+
+    std::string implicitFolds;
+    HostTensor convInput = x;
+    if (spaceToDepth) {
+      convInput = referenceReorg3d(x, 2);
+    }
+    else if (inputFolded) {
+      referenceChannels(convInput, darknetWeights.data() + offsets[folded.layers[input].inputs[1]], false);
+      implicitFolds = folded.layers[input].type + " " + std::to_string(input) + " (input)";
+    }
+    HostTensor expected = referenceConv(convInput, rawKernel, rawBias, layer.filters, layer.size, layer.stride,
+        layer.pad);
+    if (layer.batchNormalize) {
+      referenceBatchnorm(expected, darknetWeights.data() + offsets[i], layer.eps);
+    }
+    // 输出端按 cfg 中的顺序依次作用并入的 shift_channels/control_channels 和 [batchnorm]
+    for (size_t j = i + 1; j < folded.layers.size(); ++j) {
+      const LayerDesc& next = folded.layers[j];
+      if (next.foldedInto != (int) i) {
+        continue;
+      }
+      if (next.kind == LayerKind::kBatchnorm) {
+        referenceBatchnorm(expected, darknetWeights.data() + offsets[j], next.eps);
+        ++batchnorms;
+      }
+      else if (next.kind == LayerKind::kShiftChannels || next.kind == LayerKind::kControlChannels) {
+        referenceChannels(expected, darknetWeights.data() + offsets[next.inputs[1]],
+            next.kind == LayerKind::kControlChannels);
+        implicitFolds += (implicitFolds.empty() ? "" : ", ") + next.type + " " + std::to_string(j);
+      }
+    }
+
+    LayerDesc conv = effectiveConvolution(folded, i);
+    HostTensor actual = referenceConv(x, layerWeights[i].kernel, layerWeights[i].bias, layer.filters, conv.size,
+        conv.stride, conv.pad);
+    float scale = 0;
+    for (float value : expected.data) {
+      scale = std::max(scale, std::fabs(value));
+    }
+    float difference = maxAbsDifference(expected, actual);
+    maxDifference = std::max(maxDifference, difference);
+    ++checked;
+    if (!implicitFolds.empty()) {
+      std::cout << std::left << std::setw(7) << i << std::setw(22) << layer.type << "folded " << implicitFolds <<
+          ", max difference on CPU " << difference << std::endl;
+    }
+    if (difference < 0 || difference > 1e-4 * (1 + scale)) {
+      std::cerr << "Layer " << i << " folded weights differ from the cfg on CPU (max difference " << difference <<
+          ")" << std::endl;
+      ++failures;
+    }
+  }
+
+  // shift_channels 后面的卷积有 padding 时不能融合：填充的 0 没有加上 implicit 的值，边缘的输出会不同
+  for (size_t i = 0; i + 1 < folded.layers.size(); ++i) {
+    const LayerDesc& layer = folded.layers[i];
+    const LayerDesc& conv = folded.layers[i + 1];
+    if (layer.kind != LayerKind::kShiftChannels || layer.dead || layer.foldedInto >= 0 ||
+        folded.layers[layer.inputs[1]].kind != LayerKind::kImplicit || conv.kind != LayerKind::kConvolutional ||
+        conv.dead || conv.groups != 1 || conv.pad == 0 || conv.inputs[0] != (int) i) {
+      continue;
+    }
+    const float* rawKernel;
+    const float* rawBias;
+    rawConv(i + 1, rawKernel, rawBias);
+    const float* shift = darknetWeights.data() + offsets[layer.inputs[1]];
+    TensorShape shape = shapes[i];
+    shape.h = 6;
+    shape.w = 6;
+    HostTensor x = randomTensor(shape, i + 2);
+    HostTensor shifted = x;
+    referenceChannels(shifted, shift, false);
+    std::vector<float> bias(conv.filters, 0.0f);
+    if (rawBias != nullptr) {
+      bias.assign(rawBias, rawBias + conv.filters);
+    }
+    foldInputShiftConv(shift, conv.filters, shape.c, 1, conv.size * conv.size, rawKernel, bias.data());
+    float difference = maxAbsDifference(
+        referenceConv(shifted, rawKernel, rawBias, conv.filters, conv.size, conv.stride, conv.pad),
+        referenceConv(x, rawKernel, bias.data(), conv.filters, conv.size, conv.stride, conv.pad));
+    std::cout << std::left << std::setw(7) << i << std::setw(22) << layer.type << "not folded into " << i + 1 <<
+        " (pad " << conv.pad << ", folding would differ by " << difference << " on CPU)" << std::endl;
+  }
+
+  std::cout << "Folded weights of " << checked << " convolutions (" << batchnorms << " with [batchnorm]), " <<
+      "max difference on CPU " << maxDifference << std::endl;
+  return failures;
+}
+
+// 只解析 cfg 并执行图优化，逐层打印每个 pass 的结果；改写过的 maxpool、构建时融合的 reorg3d 和合并的 reorg
+// 以及融合了 BN 和 implicit 层的卷积在 CPU 上与原 cfg 的结果逐元素比较
+static int
+optimizeConfig(const std::string& cfgPath)
+{
+  NetworkDesc network;
+  std::string error;
+  if (!parseNetworkConfigFile(cfgPath, network, error)) {
+    std::cerr << "Could not parse the cfg file: " << error << std::endl;
+    return 1;
+  }
+
+  NetworkDesc original = network;
+  NetworkPassStats stats;
+  optimizeNetwork(network, stats);
+
+  std::vector<TensorShape> shapes;
+  if (!inferLayerShapes(original, shapes, error)) {
+    std::cerr << "Invalid cfg file: " << error << std::endl;
+    return 1;
+  }
+
+  std::map<int, HostTensor> originalValues;
+  std::map<int, HostTensor> optimizedValues;
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerDesc& layer = network.layers[i];
+    bool cascaded = layer.kind == LayerKind::kMaxpool && layer.size != original.layers[i].size;
+    if (!layer.dead && layer.aliasOf < 0 && !(layer.kind == LayerKind::kBatchnorm && layer.foldedInto >= 0) &&
+        !cascaded) {
+      continue;
+    }
+    std::cout << std::left << std::setw(7) << i << std::setw(22) << layer.type;
+    printLayerNote(layer);
+    if (cascaded && !layer.dead) {
+      std::cout << "size " << original.layers[i].size << " -> " << layer.size << " after layer " << layer.inputs[0];
+      float difference = maxAbsDifference(evaluatePools(original, shapes, i, originalValues),
+          evaluatePools(network, shapes, i, optimizedValues));
+      if (difference != 0) {
+        std::cout << std::endl;
+        std::cerr << "Layer " << i << " differs from the cfg on CPU (max difference " << difference << ")" <<
+            std::endl;
+        return 1;
+      }
+      std::cout << ", same output on CPU";
+    }
+    std::cout << std::endl;
+  }
+
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerDesc& layer = network.layers[i];
+    float difference = checkInputRewrite(network, shapes, i);
+    if (difference < 0) {
+      continue;
+    }
+    std::cout << std::left << std::setw(7) << i << std::setw(22) << layer.type;
+    if (layer.kind == LayerKind::kReorg3d) {
+      LayerDesc conv = network.layers[i + 1];
+      std::cout << "folded into " << i + 1 << " (" << conv.size << "x" << conv.size << " -> " << 2 * conv.size <<
+          "x" << 2 * conv.size << ", stride " << 2 * conv.stride << ")";
+    }
+    else {
+      std::cout << "single transpose";
+    }
+    std::cout << ", max difference on CPU " << difference << std::endl;
+    if (difference > 1e-4) {
+      std::cerr << "Layer " << i << " differs from the cfg on CPU" << std::endl;
+      return 1;
+    }
+  }
+
+  if (checkWeightFolds(network, shapes) != 0) {
+    return 1;
+  }
+
+  printPassStats(stats);
+  return 0;
+}
+
+static bool
+sameShape(const TensorShape& a, const TensorShape& b)
+{
+  return a.c == b.c && a.h == b.h && a.w == b.w;
+}
+
+// 在 CPU 上逐层计算整个网络，返回各 yolo/region 层的输入。converted 为空时按原 cfg 计算：不做图优化，卷积的 BN 和
+// [batchnorm] 直接用 darknet 权重计算；否则按图优化和权重转换的结果计算：跳过 dead 层，复用 aliasOf 的输出，
+// 融合进卷积的层直接传递输入，卷积使用转换后的权重。遇到没有 CPU 参考实现的层时返回 false
+static bool
+evaluateNetwork(const NetworkDesc& network, const std::vector<TensorShape>& shapes,
+    const std::vector<float>& darknetWeights, const std::vector<int64_t>& offsets,
+    const std::vector<LayerWeights>* converted, std::map<int, HostTensor>& outputs, std::string& error)
+{
+  TensorShape inputShape;
+  inputShape.c = network.channels;
+  inputShape.h = network.height;
+  inputShape.w = network.width;
+  HostTensor networkInput = randomTensor(inputShape, 1);
+  std::vector<HostTensor> values(network.layers.size());
+  auto valueOf = [&](int index) -> const HostTensor& { return index < 0 ? networkInput : values[index]; };
+
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerDesc& layer = network.layers[i];
+    HostTensor& value = values[i];
+    if (converted != nullptr && layer.dead) {
+      continue;
+    }
+    if (converted != nullptr && layer.aliasOf >= 0) {
+      value = values[layer.aliasOf];
+      continue;
+    }
+    const HostTensor& input = valueOf(layer.inputs.empty() ? -1 : layer.inputs[0]);
+    if (converted != nullptr && layer.foldedInto >= 0 && layer.kind != LayerKind::kBatchnorm) {
+      value = input;
+      continue;
+    }
+
+    const float* raw = darknetWeights.data() + offsets[i];
+    switch (layer.kind) {
+      case LayerKind::kConvolutional: {
+        if (layer.groups != 1) {
+          error = layerError(layer, i, "grouped convolution has no CPU reference");
+          return false;
+        }
+        if (converted != nullptr) {
+          LayerDesc conv = effectiveConvolution(network, i);
+          value = referenceConv(input, (*converted)[i].kernel, (*converted)[i].bias, layer.filters, conv.size,
+              conv.stride, conv.pad);
+          break;
+        }
+        const float* bias = raw + (layer.batchNormalize ? 4 * layer.filters : 0);
+        const float* kernel = bias + (layer.bias ? layer.filters : 0);
+        value = referenceConv(input, kernel, layer.bias ? bias : nullptr, layer.filters, layer.size, layer.stride,
+            layer.pad);
+        if (layer.batchNormalize) {
+          referenceBatchnorm(value, raw, layer.eps);
+        }
+        break;
+      }
+      case LayerKind::kBatchnorm:
+        value = input;
+        if (converted == nullptr) {
+          referenceBatchnorm(value, raw, layer.eps);
+        }
+        else if (layer.foldedInto < 0) {
+          referenceChannels(value, (*converted)[i].kernel, true);
+          referenceChannels(value, (*converted)[i].bias, false);
+        }
+        break;
+      case LayerKind::kShortcut: {
+        const HostTensor& from = valueOf(layer.inputs[1]);
+        if (!sameShape(input.shape, from.shape)) {
+          error = layerError(layer, i, "shortcut between different shapes has no CPU reference");
+          return false;
+        }
+        value = input;
+        for (size_t k = 0; k < value.data.size(); ++k) {
+          value.data[k] += from.data[k];
+        }
+        break;
+      }
+      case LayerKind::kRoute: {
+        // CHW 按通道拼接即依次追加，分组时再取第 groupId 组通道
+        value.shape = input.shape;
+        value.shape.c = 0;
+        for (int source : layer.inputs) {
+          const HostTensor& part = valueOf(source);
+          value.shape.c += part.shape.c;
+          value.data.insert(value.data.end(), part.data.begin(), part.data.end());
+        }
+        if (layer.routeGroups > 1) {
+          int64_t groupSize = value.data.size() / layer.routeGroups;
+          value.data = std::vector<float>(value.data.begin() + layer.groupId * groupSize,
+              value.data.begin() + (layer.groupId + 1) * groupSize);
+          value.shape.c /= layer.routeGroups;
+        }
+        break;
+      }
+      case LayerKind::kUpsample:
+        value = referenceUpsample(input, layer.stride);
+        break;
+      case LayerKind::kMaxpool:
+        value = referenceMaxpool(input, layer.size, layer.stride);
+        break;
+      case LayerKind::kDropout:
+      case LayerKind::kYolo:
+      case LayerKind::kRegion:
+        value = input;
+        break;
+      default:
+        error = layerError(layer, i, "has no CPU reference");
+        return false;
+    }
+
+    if (layer.kind == LayerKind::kConvolutional || layer.kind == LayerKind::kBatchnorm ||
+        layer.kind == LayerKind::kShortcut) {
+      referenceActivation(value, layer.activation);
+    }
+    if (!sameShape(value.shape, shapes[i])) {
+      error = layerError(layer, i, "CPU reference output does not match the inferred shape");
+      return false;
+    }
+    if (layer.kind == LayerKind::kYolo || layer.kind == LayerKind::kRegion) {
+      outputs[i] = value;
+    }
+  }
+  return true;
+}
+
+// yolov4 / yolov7 结构的缩小版 cfg（CSP 与 ELAN 块、SPP、MP 块、FPN 上采样、[batchnorm]、多余的尾部层），
+// 以及每个 pass 在其上应改写的层数
+struct PassCheckCase
+{
+  const char* name;
+  const char* cfg;
+  int identityLayers;
+  int cascadedPools;
+  int mergedLayers;
+  int deadLayers;
+  int foldedBatchnorms;
+};
+
+static const PassCheckCase kPassCheckCases[] = {
+  {"yolov4-style", R"(
+[net]
+width=32
+height=32
+channels=3
+
+# 0-8: CSP 块
+[convolutional]
+batch_normalize=1
+filters=8
+size=3
+stride=1
+pad=1
+activation=mish
+
+[convolutional]
+batch_normalize=1
+filters=16
+size=3
+stride=2
+pad=1
+activation=mish
+
+[convolutional]
+batch_normalize=1
+filters=8
+size=1
+stride=1
+pad=1
+activation=mish
+
+[route]
+layers=-2
+
+[convolutional]
+batch_normalize=1
+filters=8
+size=1
+stride=1
+pad=1
+activation=mish
+
+[convolutional]
+batch_normalize=1
+filters=8
+size=3
+stride=1
+pad=1
+activation=mish
+
+[shortcut]
+from=-2
+activation=linear
+
+[route]
+layers=-1,-5
+
+[convolutional]
+batch_normalize=1
+filters=16
+size=1
+stride=1
+pad=1
+activation=leaky
+
+# 9-14: SPP
+[maxpool]
+stride=1
+size=5
+
+[route]
+layers=-2
+
+[maxpool]
+stride=1
+size=9
+
+[route]
+layers=-4
+
+[maxpool]
+stride=1
+size=13
+
+[route]
+layers=-1,-3,-5,-6
+
+# 15-24: 两个输出头
+[convolutional]
+batch_normalize=1
+filters=16
+size=1
+stride=1
+pad=1
+activation=leaky
+
+[convolutional]
+size=1
+stride=1
+pad=1
+filters=18
+activation=linear
+
+[yolo]
+mask=3,4,5
+anchors=10,13,16,30,33,23,30,61,62,45,59,119
+classes=1
+num=6
+
+[route]
+layers=-3
+
+[convolutional]
+batch_normalize=1
+filters=8
+size=1
+stride=1
+pad=1
+activation=leaky
+
+[upsample]
+stride=2
+
+[route]
+layers=0
+
+[route]
+layers=-1,-2
+
+[convolutional]
+size=1
+stride=1
+pad=1
+filters=18
+activation=linear
+
+[yolo]
+mask=0,1,2
+anchors=10,13,16,30,33,23,30,61,62,45,59,119
+classes=1
+num=6
+
+# 25-26: 不影响输出（SPP 中的 route 10 和 12 在 maxpool 串接后也不再被使用）
+[route]
+layers=-2
+
+[convolutional]
+batch_normalize=1
+filters=8
+size=1
+stride=1
+pad=1
+activation=leaky
+)", 6, 2, 0, 4, 0},
+  {"yolov7-style", R"(
+[net]
+width=32
+height=32
+channels=3
+
+[convolutional]
+batch_normalize=1
+filters=8
+size=3
+stride=1
+pad=1
+activation=silu
+
+[convolutional]
+batch_normalize=1
+filters=16
+size=3
+stride=2
+pad=1
+activation=silu
+
+# 2-9: ELAN 块，线性卷积 + [batchnorm]
+[convolutional]
+batch_normalize=1
+filters=8
+size=1
+stride=1
+pad=1
+activation=silu
+
+[route]
+layers=-2
+
+[convolutional]
+batch_normalize=1
+filters=8
+size=1
+stride=1
+pad=1
+activation=silu
+
+[convolutional]
+batch_normalize=1
+filters=8
+size=3
+stride=1
+pad=1
+activation=silu
+
+[convolutional]
+batch_normalize=1
+filters=8
+size=3
+stride=1
+pad=1
+activation=silu
+
+[route]
+layers=-1,-3,-5,-6
+
+[convolutional]
+filters=16
+size=1
+stride=1
+pad=1
+activation=linear
+
+[batchnorm]
+filters=16
+activation=silu
+
+# 10-15: MP 块，两个分支对同一输入做相同的 maxpool
+[maxpool]
+size=2
+stride=2
+
+[convolutional]
+batch_normalize=1
+filters=8
+size=1
+stride=1
+pad=1
+activation=silu
+
+[route]
+layers=-3
+
+[maxpool]
+size=2
+stride=2
+
+[convolutional]
+batch_normalize=1
+filters=8
+size=1
+stride=1
+pad=1
+activation=silu
+
+[route]
+layers=-1,-4
+
+# 16: 输入不是卷积，不能融合
+[batchnorm]
+filters=16
+activation=leaky
+
+[convolutional]
+size=1
+stride=1
+pad=1
+filters=18
+activation=linear
+
+[yolo]
+mask=3,4,5
+anchors=12,16,19,36,40,28,36,75,76,55,72,146
+classes=1
+num=6
+
+[route]
+layers=-4
+
+[upsample]
+stride=2
+
+[route]
+layers=-1,-12
+
+[convolutional]
+size=1
+stride=1
+pad=1
+filters=18
+activation=linear
+
+[yolo]
+mask=0,1,2
+anchors=12,16,19,36,40,28,36,75,76,55,72,146
+classes=1
+num=6
+
+# 24-25: 不影响输出（route 12 在 maxpool 13 合并后也不再被使用）
+[convolutional]
+batch_normalize=1
+filters=8
+size=1
+stride=1
+pad=1
+activation=silu
+
+[dropout]
+probability=0.1
+)", 4, 0, 1, 3, 1},
+};
+
+// 在上面的 cfg 上逐个执行图优化 pass，检查每个 pass 改写的层数；再用随机权重在 CPU 上计算原 cfg 和
+// 优化并融合权重后的网络，比较每个 yolo 层的输入
+static int
+checkNetworkPasses()
+{
+  int failures = 0;
+  auto expect = [&](bool condition, const std::string& what) {
+    if (!condition) {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  };
+
+  for (const PassCheckCase& check : kPassCheckCases) {
+    std::string name = check.name;
+    std::istringstream stream(check.cfg);
+    NetworkDesc parsed;
+    std::string error;
+    if (!parseNetworkConfig(stream, parsed, error)) {
+      expect(false, name + " parses: " + error);
+      continue;
+    }
+
+    NetworkDesc network = parsed;
+    NetworkPassStats identity, cascaded, merged, dead, folded;
+    removeIdentityLayers(network, identity);
+    cascadeSppPools(network, cascaded);
+    mergeCommonLayers(network, merged);
+    eliminateDeadLayers(network, dead);
+    foldActivationChains(network, folded);
+    expect(identity.identityLayers == check.identityLayers, name + " removeIdentityLayers: " +
+        std::to_string(identity.identityLayers) + " identity layers, expected " + std::to_string(check.identityLayers));
+    expect(cascaded.cascadedPools == check.cascadedPools, name + " cascadeSppPools: " +
+        std::to_string(cascaded.cascadedPools) + " cascaded maxpool, expected " + std::to_string(check.cascadedPools));
+    expect(merged.mergedLayers == check.mergedLayers, name + " mergeCommonLayers: " +
+        std::to_string(merged.mergedLayers) + " merged layers, expected " + std::to_string(check.mergedLayers));
+    expect(dead.deadLayers == check.deadLayers, name + " eliminateDeadLayers: " + std::to_string(dead.deadLayers) +
+        " unused layers, expected " + std::to_string(check.deadLayers));
+    expect(folded.foldedBatchnorms == check.foldedBatchnorms, name + " foldActivationChains: " +
+        std::to_string(folded.foldedBatchnorms) + " folded batchnorm, expected " +
+        std::to_string(check.foldedBatchnorms));
+
+    // optimizeNetwork 与逐个执行的结果相同，并且可以重复执行
+    NetworkDesc optimized = parsed;
+    NetworkPassStats stats;
+    optimizeNetwork(optimized, stats);
+    NetworkDesc again = optimized;
+    NetworkPassStats againStats;
+    optimizeNetwork(again, againStats);
+    bool same = true;
+    for (size_t i = 0; i < network.layers.size(); ++i) {
+      same &= sameLayer(network.layers[i], optimized.layers[i]) && sameLayer(optimized.layers[i], again.layers[i]);
+    }
+    expect(same, name + " optimizeNetwork matches the passes run one by one and is repeatable");
+
+    std::vector<TensorShape> shapes;
+    if (!inferLayerShapes(parsed, shapes, error)) {
+      expect(false, name + " shapes: " + error);
+      continue;
+    }
+    std::vector<int64_t> offsets;
+    std::vector<float> darknetWeights = randomDarknetWeights(parsed, shapes, offsets);
+    WeightCursor cursor(darknetWeights.data(), darknetWeights.size());
+    WeightArena arena;
+    std::vector<LayerWeights> layerWeights;
+    if (!prepareNetworkWeights(optimized, cursor, arena, layerWeights, error)) {
+      expect(false, name + " weights: " + error);
+      continue;
+    }
+
+    std::map<int, HostTensor> expected;
+    std::map<int, HostTensor> actual;
+    if (!evaluateNetwork(parsed, shapes, darknetWeights, offsets, nullptr, expected, error) ||
+        !evaluateNetwork(optimized, shapes, darknetWeights, offsets, &layerWeights, actual, error)) {
+      expect(false, name + " CPU reference: " + error);
+      continue;
+    }
+    expect(!expected.empty() && expected.size() == actual.size(), name + " outputs: " +
+        std::to_string(actual.size()) + " yolo layers, expected " + std::to_string(expected.size()));
+    float maxDifference = 0;
+    for (const std::pair<const int, HostTensor>& output : expected) {
+      float scale = 0;
+      for (float value : output.second.data) {
+        scale = std::max(scale, std::fabs(value));
+      }
+      float difference = actual.count(output.first) ? maxAbsDifference(output.second, actual[output.first]) : -1;
+      maxDifference = std::max(maxDifference, difference);
+      expect(difference >= 0 && difference <= 1e-4 * (1 + scale), name + " yolo layer " +
+          std::to_string(output.first) + " differs from the cfg on CPU (max difference " + std::to_string(difference) +
+          ")");
+    }
+
+    std::cout << name << ": ";
+    printPassStats(stats);
+    std::cout << name << ": " << expected.size() << " yolo outputs match the unoptimized cfg on CPU (max difference " <<
+        maxDifference << ")" << std::endl;
+  }
+
+  if (failures != 0) {
+    std::cerr << failures << " network pass checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Network pass checks OK" << std::endl;
+  return 0;
+}
+
+// 不读取权重、不需要 GPU 的快速检查：推算每层形状，比较 cfg 需要的权重个数与权重文件大小，
+// 并按 batch 估算激活内存的峰值。任何错误都给出层号，返回非 0
+static int
+dryRun(const std::string& cfgPath, const std::string& weightsPath, const std::string& batchList)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::unique_ptr<StartupProfiler> profiler = createStartupProfiler();
+
+  NetworkDesc network;
+  std::string error;
+  std::vector<TensorShape> shapes;
+  {
+    ScopedPhase phase(profiler.get(), "parseConfigFile");
+    if (!parseNetworkConfigFile(cfgPath, network, error)) {
+      std::cerr << "Could not parse the cfg file: " << error << std::endl;
+      return 1;
+    }
+
+    if (!getenv("NETWORK_PASSES") || std::string(getenv("NETWORK_PASSES")) != "0") {
+      ScopedPhase passes(profiler.get(), "optimizeNetwork");
+      NetworkPassStats stats;
+      optimizeNetwork(network, stats);
+    }
+
+    ScopedPhase inference(profiler.get(), "inferLayerShapes");
+    if (!inferLayerShapes(network, shapes, error)) {
+      std::cerr << "Invalid cfg file: " << error << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << std::left << std::setw(7) << "Layer" << std::setw(22) << "Type" << std::setw(18) << "Output" <<
+      "Weights" << std::endl;
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerDesc& layer = network.layers[i];
+    int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+    std::string shape = std::to_string(shapes[i].c) + "x" + std::to_string(shapes[i].h) + "x" +
+        std::to_string(shapes[i].w);
+    std::cout << std::setw(7) << i << std::setw(22) << layer.type << std::setw(18) << shape <<
+        layerWeightCount(layer, input < 0 ? network.channels : shapes[input].c) << std::endl;
+  }
+
+  int64_t expected = expectedWeightCount(network, shapes);
+  std::cout << "\nExpected weights: " << expected << std::endl;
+  if (!weightsPath.empty()) {
+    // 统计启动阶段时与插件一样预读并转换权重，否则只检查权重个数
+    WeightsFile weightsFile;
+    {
+      ScopedPhase phase(profiler.get(), "loadWeights");
+      if (!weightsFile.open(weightsPath, profiler != nullptr)) {
+        return 1;
+      }
+    }
+    if ((int64_t) weightsFile.size() != expected) {
+      std::cerr << weightsPath << " has " << weightsFile.size() << " weights, " << cfgPath << " expects " << expected <<
+          std::endl;
+      return 1;
+    }
+    std::cout << weightsPath << " matches" << std::endl;
+
+    if (profiler) {
+      ScopedPhase phase(profiler.get(), "prepareWeights");
+      WeightArena arena;
+      std::vector<LayerWeights> layerWeights;
+      WeightCursor weights(weightsFile.data(), weightsFile.size());
+      if (!prepareNetworkWeights(network, weights, arena, layerWeights, error, weightThreads())) {
+        std::cerr << "Could not prepare the weights: " << error << std::endl;
+        return 1;
+      }
+      addLayerWeights(profiler.get(), network, layerWeights);
+    }
+  }
+
+  ActivationPlan plan = planActivationMemory(network, shapes);
+  std::cout << "\nActivation memory (peak at layer " << plan.peakLayer << ", largest output at layer " <<
+      plan.largestLayer << "):" << std::endl;
+  std::cout << std::setw(8) << "Batch" << std::setw(14) << "FP32" << std::setw(14) << "FP16" << std::setw(14) <<
+      "INT8" << "Without reuse (FP32)" << std::endl;
+  std::istringstream batches(batchList);
+  std::string item;
+  while (std::getline(batches, item, ',')) {
+    int batch = atoi(item.c_str());
+    if (batch <= 0) {
+      std::cerr << "Invalid batch size: " << item << std::endl;
+      return 1;
+    }
+    std::cout << std::setw(8) << batch << std::setw(14) << formatMiB(plan.peakElements * batch * 4) <<
+        std::setw(14) << formatMiB(plan.peakElements * batch * 2) << std::setw(14) <<
+        formatMiB(plan.peakElements * batch) << formatMiB(plan.totalElements * batch * 4) << std::endl;
+  }
+
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "\nDry run OK (" << ms << " ms)" << std::endl;
+  reportStartupProfile(profiler.get(), cfgPath);
+  return 0;
+}
+
+// 逐层打印计算量和访存量；给出设备描述文件和延迟预算时，搜索输入尺寸和 batch 并输出推荐的 [net] 配置
+static int
+costModel(const std::string& cfgPath, const std::string& devicePath, double budgetMs, const std::string& precision,
+    int maxBatch)
+{
+  NetworkDesc network;
+  std::string error;
+  if (!parseNetworkConfigFile(cfgPath, network, error)) {
+    std::cerr << "Could not parse the cfg file: " << error << std::endl;
+    return 1;
+  }
+
+  if (!getenv("NETWORK_PASSES") || std::string(getenv("NETWORK_PASSES")) != "0") {
+    NetworkPassStats stats;
+    optimizeNetwork(network, stats);
+  }
+
+  std::vector<TensorShape> shapes;
+  if (!inferLayerShapes(network, shapes, error)) {
+    std::cerr << "Invalid cfg file: " << error << std::endl;
+    return 1;
+  }
+
+  std::vector<LayerCost> costs;
+  computeLayerCosts(network, shapes, precisionBytes(precision), costs);
+
+  std::cout << "Costs per image at " << network.width << "x" << network.height << ", " << precision << ":" <<
+      std::endl;
+  std::cout << std::left << std::setw(7) << "Layer" << std::setw(22) << "Type" << std::setw(14) << "MMACs" <<
+      std::setw(14) << "Params" << std::setw(14) << "Activations" << "FLOP/byte" << std::endl;
+  LayerCost total;
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerCost& cost = costs[i];
+    total.macs += cost.macs;
+    total.flops += cost.flops;
+    total.paramBytes += cost.paramBytes;
+    total.activationBytes += cost.activationBytes;
+    if (cost.flops == 0 && cost.activationBytes == 0 && cost.paramBytes == 0) {
+      continue;
+    }
+    double bytes = cost.paramBytes + cost.activationBytes;
+    std::cout << std::setw(7) << i << std::setw(22) << network.layers[i].type << std::fixed << std::setprecision(1) <<
+        std::setw(14) << cost.macs / 1e6 << std::setw(14) << formatMiB(cost.paramBytes) << std::setw(14) <<
+        formatMiB(cost.activationBytes) << (bytes > 0 ? cost.flops / bytes : 0) << std::endl;
+  }
+  std::cout << "\nTotal: " << std::setprecision(2) << total.macs / 1e9 << " GMACs, " << total.flops / 1e9 <<
+      " GFLOPs, params " << formatMiB(total.paramBytes) << ", activation traffic " <<
+      formatMiB(total.activationBytes) << ", " << std::setprecision(1) <<
+      (double) total.flops / (total.paramBytes + total.activationBytes) << " FLOP/byte" << std::endl;
+
+  if (devicePath.empty()) {
+    return 0;
+  }
+
+  DeviceProfile device;
+  if (!loadDeviceProfile(devicePath, device, error)) {
+    std::cerr << "Invalid device file: " << error << std::endl;
+    return 1;
+  }
+
+  std::cout << "\nEstimated latency on " << (device.name.empty() ? devicePath : device.name) << " at " <<
+      network.width << "x" << network.height << ", batch 1: " << std::setprecision(2) <<
+      estimateLatencyMs(costs, device, precision, 1) << " ms" << std::endl;
+
+  std::vector<SizeCandidate> candidates;
+  SizeCandidate best;
+  bool found = recommendInputSize(network, device, precision, budgetMs, maxBatch, candidates, best, error);
+
+  std::cout << "\n" << std::setw(12) << "Size" << std::setw(16) << "Batch 1 (ms)" << std::setw(12) << "Max batch" <<
+      "Latency (ms)" << std::endl;
+  for (const SizeCandidate& candidate : candidates) {
+    std::cout << std::setw(12) << std::to_string(candidate.width) + "x" + std::to_string(candidate.height) <<
+        std::setw(16) << candidate.batch1LatencyMs << std::setw(12) << candidate.batch << candidate.latencyMs <<
+        std::endl;
+  }
+
+  if (!found) {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  std::cout << "\nRecommended for a " << budgetMs << " ms budget (" << precision << "):\n"
+      "  [net]\n"
+      "  width=" << best.width << "\n"
+      "  height=" << best.height << "\n"
+      "  batch=" << best.batch << "\n"
+      "  config_infer: batch-size=" << best.batch << std::endl;
+  return 0;
+}
+
+// 删除指定的输出头后检查剩余网络：剩余输出头的形状和它们依赖的每一层都与删除前相同，并比较删除前后的开销
+static int
+pruneHeads(const std::string& cfgPath, const std::string& heads)
+{
+  NetworkDesc network;
+  std::string error;
+  if (!parseNetworkConfigFile(cfgPath, network, error)) {
+    std::cerr << "Could not parse the cfg file: " << error << std::endl;
+    return 1;
+  }
+
+  if (!getenv("NETWORK_PASSES") || std::string(getenv("NETWORK_PASSES")) != "0") {
+    NetworkPassStats stats;
+    optimizeNetwork(network, stats);
+  }
+
+  std::vector<TensorShape> shapes;
+  if (!inferLayerShapes(network, shapes, error)) {
+    std::cerr << "Invalid cfg file: " << error << std::endl;
+    return 1;
+  }
+
+  NetworkDesc pruned = network;
+  NetworkPassStats stats;
+  if (!pruneYoloHeads(pruned, heads, stats, error)) {
+    std::cerr << "Could not prune the output heads: " << error << std::endl;
+    return 1;
+  }
+
+  std::vector<TensorShape> prunedShapes;
+  if (!inferLayerShapes(pruned, prunedShapes, error)) {
+    std::cerr << "Invalid pruned network: " << error << std::endl;
+    return 1;
+  }
+
+  // 剩余输出头依赖的层都必须保留，且逐层参数和形状不变
+  std::vector<bool> needed(network.layers.size(), false);
+  for (int i = network.layers.size() - 1; i >= 0; --i) {
+    const LayerDesc& layer = pruned.layers[i];
+    needed[i] = needed[i] || ((layer.kind == LayerKind::kYolo || layer.kind == LayerKind::kRegion) && !layer.dead);
+    if (!needed[i]) {
+      continue;
+    }
+    if (layer.dead || !sameLayer(layer, network.layers[i]) || prunedShapes[i].c != shapes[i].c ||
+        prunedShapes[i].h != shapes[i].h || prunedShapes[i].w != shapes[i].w) {
+      std::cerr << "Layer " << i << " (" << layer.type << ") changed after pruning" << std::endl;
+      return 1;
+    }
+    if (layer.aliasOf >= 0) {
+      needed[layer.aliasOf] = true;
+    }
+    for (int input : layer.inputs) {
+      if (input >= 0) {
+        needed[input] = true;
+      }
+    }
+  }
+
+  std::cout << std::left << std::setw(7) << "Layer" << std::setw(22) << "Type" << "Removed" << std::endl;
+  for (size_t i = 0; i < pruned.layers.size(); ++i) {
+    if (pruned.layers[i].dead && !network.layers[i].dead) {
+      std::cout << std::setw(7) << i << std::setw(22) << pruned.layers[i].type << "x" << std::endl;
+    }
+  }
+
+  std::cout << "\nRemaining output heads:" << std::endl;
+  for (size_t i = 0; i < pruned.layers.size(); ++i) {
+    const LayerDesc& layer = pruned.layers[i];
+    if ((layer.kind == LayerKind::kYolo || layer.kind == LayerKind::kRegion) && !layer.dead) {
+      std::cout << "  " << layer.type << "_" << i + 1 << "  " << prunedShapes[i].c << "x" << prunedShapes[i].h <<
+          "x" << prunedShapes[i].w << std::endl;
+    }
+  }
+
+  std::vector<LayerCost> before;
+  std::vector<LayerCost> after;
+  computeLayerCosts(network, shapes, 4, before);
+  computeLayerCosts(pruned, prunedShapes, 4, after);
+  LayerCost totals[2];
+  for (size_t i = 0; i < before.size(); ++i) {
+    totals[0].flops += before[i].flops;
+    totals[0].activationBytes += before[i].activationBytes;
+    totals[1].flops += after[i].flops;
+    totals[1].activationBytes += after[i].activationBytes;
+  }
+  int64_t peak[2] = {planActivationMemory(network, shapes).peakElements * 4,
+      planActivationMemory(pruned, prunedShapes).peakElements * 4};
+
+  std::cout << "\nPruned " << stats.prunedHeads << " output heads and " << stats.deadLayers << " layers" << std::endl;
+  std::cout << std::fixed << std::setprecision(2) << "GFLOPs: " << totals[0].flops / 1e9 << " -> " <<
+      totals[1].flops / 1e9 << "\nActivation traffic (FP32): " << formatMiB(totals[0].activationBytes) << " -> " <<
+      formatMiB(totals[1].activationBytes) << "\nPeak activation memory (FP32): " << formatMiB(peak[0]) << " -> " <<
+      formatMiB(peak[1]) << std::endl;
+  std::cout << "\nBuild with PRUNE_YOLO_HEADS=" << heads << std::endl;
+  return 0;
+}
+
+// 与 floatToHalf 无关的参考实现：在全部有限 FP16 值（单调递增）中二分查找最接近的一个，距离相同时取尾数为偶数者。
+// 0x7c00 按 65536 参与比较，即超过 65520 时舍入为无穷大
+static uint16_t
+referenceHalf(float value, const std::vector<double>& magnitudes)
+{
+  uint16_t sign = std::signbit(value) ? 0x8000 : 0;
+  double magnitude = std::fabs((double) value);
+  if (magnitude >= magnitudes.back()) {
+    return sign | 0x7c00;
+  }
+  size_t upper = std::upper_bound(magnitudes.begin(), magnitudes.end(), magnitude) - magnitudes.begin();
+  size_t lower = upper - 1;
+  double below = magnitude - magnitudes[lower];
+  double above = magnitudes[upper] - magnitude;
+  size_t code = below < above ? lower : above < below ? upper : (lower % 2 == 0 ? lower : upper);
+  return sign | (uint16_t) code;
+}
+
+// 检查 floatToHalf 的舍入：全部 FP16 值往返不变，边界值和随机值与参考实现逐位相同；
+// 给出 cfg + weights 时比较串行和并行转换的结果，并统计 FP16 权重的误差和内存
+static int
+checkHalfWeights(const std::string& cfgPath, const std::string& weightsPath)
+{
+  std::vector<double> magnitudes(0x7c01);
+  for (uint32_t code = 0; code < 0x7c00; ++code) {
+    magnitudes[code] = halfToFloat(code);
+  }
+  magnitudes[0x7c00] = 65536.0;
+
+  int failures = 0;
+  for (uint32_t code = 0; code < 0x10000; ++code) {
+    bool nan = (code & 0x7c00) == 0x7c00 && (code & 0x3ff) != 0;
+    uint16_t roundTrip = floatToHalf(halfToFloat(code));
+    if (nan ? (roundTrip & 0x7c00) != 0x7c00 || (roundTrip & 0x3ff) == 0 : roundTrip != code) {
+      ++failures;
+    }
+  }
+
+  std::vector<float> values = {0.0f, -0.0f, 65504.0f, 65519.99f, 65520.0f, 65536.0f, 1e10f, 5.96046448e-8f,
+      2.98023224e-8f, 2.98023254e-8f, 1e-8f, 6.10351562e-5f, 6.09755516e-5f, 1.00048828f, 1.00146484f, 0.333333343f};
+  // 相邻 FP16 值之间的中点（平局）以及中点两侧最近的 float
+  for (uint32_t code = 0; code < 0x7c00; ++code) {
+    float midpoint = (float) ((magnitudes[code] + magnitudes[code + 1]) / 2);
+    values.push_back(midpoint);
+    values.push_back(std::nextafter(midpoint, 0.0f));
+    values.push_back(std::nextafter(midpoint, 1e30f));
+  }
+  std::mt19937 random(42);
+  std::uniform_real_distribution<float> exponent(-30.0f, 17.0f);
+  for (int i = 0; i < 1000000; ++i) {
+    values.push_back((i % 2 ? -1.0f : 1.0f) * std::exp2(exponent(random)));
+  }
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    for (float value : {values[i], -values[i]}) {
+      uint16_t expected = referenceHalf(value, magnitudes);
+      if (floatToHalf(value) != expected) {
+        if (failures < 10) {
+          std::cerr << std::setprecision(9) << value << ": 0x" << std::hex << floatToHalf(value) << ", expected 0x" <<
+              expected << std::dec << std::endl;
+        }
+        ++failures;
+      }
+    }
+  }
+  if (failures > 0) {
+    std::cerr << failures << " FP16 conversions differ from the reference" << std::endl;
+    return 1;
+  }
+  std::cout << "FP16 rounding matches the reference (65536 codes, " << values.size() * 2 << " values)" << std::endl;
+  if (cfgPath.empty()) {
+    return 0;
+  }
+
+  NetworkDesc parsed;
+  std::string error;
+  if (!parseNetworkConfigFile(cfgPath, parsed, error)) {
+    std::cerr << "Could not parse the cfg file: " << error << std::endl;
+    return 1;
+  }
+  NetworkPassStats stats;
+  optimizeNetwork(parsed, stats);
+  WeightsFile weightsFile;
+  if (!weightsFile.open(weightsPath)) {
+    std::cerr << "Could not open the weights file " << weightsPath << std::endl;
+    return 1;
+  }
+
+  // 串行和并行各转换一次，结果必须逐位相同
+  int threadCounts[2] = {1, weightThreads()};
+  NetworkDesc networks[2] = {parsed, parsed};
+  WeightArena arenas[2];
+  std::vector<LayerWeights> layerWeights[2];
+  double prepareMs[2];
+  for (int run = 0; run < 2; ++run) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    WeightCursor weights(weightsFile.data(), weightsFile.size());
+    if (!prepareNetworkWeights(networks[run], weights, arenas[run], layerWeights[run], error, threadCounts[run])) {
+      std::cerr << "Could not prepare the weights: " << error << std::endl;
+      return 1;
+    }
+    prepareMs[run] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+  for (size_t i = 0; i < layerWeights[0].size(); ++i) {
+    const LayerWeights& a = layerWeights[0][i];
+    const LayerWeights& b = layerWeights[1][i];
+    if (!sameWeights(a.kernel, a.kernelCount, b.kernel, b.kernelCount) ||
+        !sameWeights(a.bias, a.biasCount, b.bias, b.biasCount)) {
+      std::cerr << "Layer " << i << ": parallel weights differ from serial" << std::endl;
+      return 1;
+    }
+  }
+  std::cout << std::fixed << std::setprecision(1) << "Prepare weights: " << prepareMs[0] << " ms serial, " <<
+      prepareMs[1] << " ms with WEIGHT_THREADS=" << threadCounts[1] << ", identical" << std::endl;
+
+  std::vector<LayerWeights> halfWeights = layerWeights[0];
+  WeightArena halfArena;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  convertWeightsToHalf(networks[0], halfWeights, halfArena, threadCounts[1]);
+  double convertMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  int64_t floatBytes = 0;
+  int64_t halfBytes = 0;
+  int64_t overflows = 0;
+  int64_t underflows = 0;
+  double maxRelative = 0;
+  for (size_t i = 0; i < halfWeights.size(); ++i) {
+    const LayerWeights& original = layerWeights[0][i];
+    const LayerWeights& half = halfWeights[i];
+    floatBytes += (original.kernelCount + original.biasCount) * sizeof(float);
+    if (half.kernelHalf == nullptr) {
+      halfBytes += (half.kernelCount + half.biasCount) * sizeof(float);
+      continue;
+    }
+    halfBytes += (half.kernelCount + half.biasCount) * sizeof(uint16_t);
+    for (int part = 0; part < 2; ++part) {
+      const float* values = part == 0 ? original.kernel : original.bias;
+      const uint16_t* halves = part == 0 ? half.kernelHalf : half.biasHalf;
+      int64_t count = part == 0 ? original.kernelCount : original.biasCount;
+      for (int64_t k = 0; k < count; ++k) {
+        float converted = halfToFloat(halves[k]);
+        if (halves[k] != referenceHalf(values[k], magnitudes)) {
+          std::cerr << "Layer " << i << ": FP16 weight " << k << " differs from the reference" << std::endl;
+          return 1;
+        }
+        if (std::isinf(converted)) {
+          ++overflows;
+        }
+        else if (converted == 0.0f && values[k] != 0.0f) {
+          ++underflows;
+        }
+        else if (std::fabs(values[k]) >= 6.10351562e-5f) {
+          maxRelative = std::max(maxRelative, std::fabs((double) converted - values[k]) / std::fabs(values[k]));
+        }
+      }
+    }
+  }
+  std::cout << std::setprecision(1) << "FP16 weights: " << formatMiB(floatBytes) << " -> " <<
+      formatMiB(halfBytes) << ", converted in " << convertMs << " ms" << std::endl;
+  std::cout << std::scientific << std::setprecision(2) << "Max relative error (normal range): " << maxRelative <<
+      ", " << overflows << " overflow to inf, " << underflows << " flush to zero" << std::endl;
+  return overflows > 0 ? 1 : 0;
+}
+
+// 逐层检查卷积核是否满足 2:4 稀疏；给出输出文件时把指定的卷积（默认为全部可用的卷积）按绝对值剪枝为 2:4，
+// 写出新的 .weights 或模型包，并确认按插件规则融合后的卷积核仍满足 2:4
+static int
+sparsityReport(const std::string& cfgPath, const std::string& weightsPath, const std::string& outPath,
+    const std::string& layerList)
+{
+  NetworkDesc network;
+  std::string error;
+  if (!parseNetworkConfigFile(cfgPath, network, error)) {
+    std::cerr << "Could not parse the cfg file: " << error << std::endl;
+    return 1;
+  }
+  NetworkPassStats stats;
+  optimizeNetwork(network, stats);
+
+  std::vector<TensorShape> shapes;
+  if (!inferLayerShapes(network, shapes, error)) {
+    std::cerr << "Invalid cfg file: " << error << std::endl;
+    return 1;
+  }
+  WeightsFile weightsFile;
+  if (!weightsFile.open(weightsPath)) {
+    return 1;
+  }
+  if ((int64_t) weightsFile.size() != expectedWeightCount(network, shapes)) {
+    std::cerr << weightsPath << " has " << weightsFile.size() << " weights, " << cfgPath << " expects " <<
+        expectedWeightCount(network, shapes) << std::endl;
+    return 1;
+  }
+
+  std::vector<int64_t> offsets = convolutionKernelOffsets(network, shapes);
+  std::vector<LayerCost> costs;
+  computeLayerCosts(network, shapes, 4, costs);
+  int64_t totalMacs = 0;
+  for (const LayerCost& cost : costs) {
+    totalMacs += cost.macs;
+  }
+
+  std::map<std::string, int> names;
+  int64_t eligibleMacs = 0;
+  int64_t compliantMacs = 0;
+  std::cout << std::left << std::setw(7) << "Layer" << std::setw(22) << "Name" << std::setw(20) << "Kernel" <<
+      std::setw(10) << "2:4 (%)" << std::setw(10) << "Zeros (%)" << std::setw(10) << "MACs (%)" << "Status" <<
+      std::endl;
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerDesc& layer = network.layers[i];
+    if (layer.kind != LayerKind::kConvolutional || layer.dead) {
+      continue;
+    }
+    int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+    int channels = (input < 0 ? network.channels : shapes[input].c) / layer.groups;
+    int kernelArea = layer.size * layer.size;
+    SparsityStats sparsity = analyzeTwoOfFour(weightsFile.data() + offsets[i], layer.filters, channels, kernelArea);
+    int64_t weights = (int64_t) layer.filters * channels * kernelArea;
+    bool eligible = canUseTwoOfFour(network, shapes, i);
+    std::string name = layer.type + "_" + std::to_string(i + 1);
+    names[name] = i;
+    eligibleMacs += eligible ? costs[i].macs : 0;
+    compliantMacs += eligible && sparsity.compliant() ? costs[i].macs : 0;
+
+    std::string kernel = std::to_string(layer.filters) + "x" + std::to_string(channels) + "x" +
+        std::to_string(layer.size) + "x" + std::to_string(layer.size);
+    std::cout << std::setw(7) << i << std::setw(22) << name << std::setw(20) << kernel << std::fixed <<
+        std::setprecision(1) << std::setw(10) << 100.0 * sparsity.compliantGroups / sparsity.groups << std::setw(10) <<
+        100.0 * sparsity.zeros / weights << std::setw(10) << 100.0 * costs[i].macs / totalMacs <<
+        (!eligible ? "not supported" : sparsity.compliant() ? "2:4" : "dense") << std::endl;
+  }
+  std::cout << "\nConvolutions that can use 2:4: " << 100.0 * eligibleMacs / totalMacs << "% of MACs, already 2:4: " <<
+      100.0 * compliantMacs / totalMacs << "% of MACs" << std::endl;
+  if (outPath.empty()) {
+    return 0;
+  }
+
+  std::vector<int> selected;
+  if (layerList.empty()) {
+    for (size_t i = 0; i < network.layers.size(); ++i) {
+      if (canUseTwoOfFour(network, shapes, i)) {
+        selected.push_back(i);
+      }
+    }
+  }
+  std::istringstream list(layerList);
+  std::string name;
+  while (std::getline(list, name, ',')) {
+    auto it = names.find(name);
+    if (it == names.end() || !canUseTwoOfFour(network, shapes, it->second)) {
+      std::cerr << name << " is not a convolution that can use 2:4 sparsity" << std::endl;
+      return 1;
+    }
+    selected.push_back(it->second);
+  }
+
+  std::vector<float> data(weightsFile.data(), weightsFile.data() + weightsFile.size());
+  int64_t pruned = 0;
+  int64_t prunedMacs = compliantMacs;
+  for (int i : selected) {
+    const LayerDesc& layer = network.layers[i];
+    int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+    int channels = (input < 0 ? network.channels : shapes[input].c) / layer.groups;
+    SparsityStats before = analyzeTwoOfFour(data.data() + offsets[i], layer.filters, channels, layer.size * layer.size);
+    if (!before.compliant()) {
+      pruned += pruneTwoOfFour(data.data() + offsets[i], layer.filters, channels, layer.size * layer.size);
+      prunedMacs += costs[i].macs;
+    }
+  }
+
+  // 融合 BN/implicit 只逐输出通道缩放卷积核，不会改变 0 的位置；这里按插件的规则重新转换一遍确认
+  NetworkDesc prepared = network;
+  WeightArena arena;
+  std::vector<LayerWeights> layerWeights;
+  WeightCursor cursor(data.data(), data.size());
+  if (!prepareNetworkWeights(prepared, cursor, arena, layerWeights, error, weightThreads())) {
+    std::cerr << "Could not prepare the pruned weights: " << error << std::endl;
+    return 1;
+  }
+  for (int i : selected) {
+    const LayerDesc& layer = prepared.layers[i];
+    int channels = (int) (layerWeights[i].kernelCount / ((int64_t) layer.filters * layer.size * layer.size));
+    if (!analyzeTwoOfFour(layerWeights[i].kernel, layer.filters, channels, layer.size * layer.size).compliant()) {
+      std::cerr << "Layer " << i << " is not 2:4 after folding" << std::endl;
+      return 1;
+    }
+  }
+
+  bool pack = outPath.find(".weights") == std::string::npos;
+  bool written = pack ? writeModelPack(outPath, prepared, layerWeights, error) :
+      writeWeightsFile(outPath, weightsFile.major(), weightsFile.minor(), weightsFile.revision(), weightsFile.seen(),
+      data.data(), data.size(), error);
+  if (!written) {
+    std::cerr << "Could not write " << outPath << ": " << error << std::endl;
+    return 1;
+  }
+  std::cout << "Pruned " << pruned << " weights in " << selected.size() << " convolutions, " <<
+      100.0 * prunedMacs / totalMacs << "% of MACs are now 2:4, written to " << outPath << std::endl;
+  std::cout << "Fine-tune or re-validate the accuracy of the pruned model, then build with SPARSE_WEIGHTS=1" <<
+      std::endl;
+  return 0;
+}
+
+// 信号与量化噪声之比（dB）
+static double
+quantizationSnr(double signal, double noise)
+{
+  return noise > 0 ? 10.0 * std::log10(signal / noise) : 999.0;
+}
+
+// 检查 INT8_QDQ 使用的逐通道卷积核 scale：每个通道绝对值最大的权重量化为 ±127，其余权重的误差不超过 scale / 2；
+// 打印逐通道和逐张量量化的信噪比。给出激活 scale 文件时检查其格式
+static int
+checkQuantization(const std::string& cfgPath, const std::string& weightsPath, const std::string& scalesPath)
+{
+  WeightsFile weightsFile;
+  WeightArena arena;
+  NetworkDesc network;
+  std::vector<LayerWeights> layerWeights;
+  if (!prepareDarknetModel(cfgPath, weightsPath, weightsFile, arena, network, layerWeights)) {
+    return 1;
+  }
+
+  int failures = 0;
+  std::cout << std::left << std::setw(7) << "Layer" << std::setw(22) << "Name" << std::setw(10) << "Filters" <<
+      std::setw(22) << "Per-channel SNR (dB)" << "Per-tensor SNR (dB)" << std::endl;
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerDesc& layer = network.layers[i];
+    const LayerWeights& weights = layerWeights[i];
+    if (layer.kind != LayerKind::kConvolutional || layer.dead || weights.kernel == nullptr) {
+      continue;
+    }
+    int64_t volume = weights.kernelCount / layer.filters;
+    std::vector<float> scales(layer.filters);
+    perChannelWeightScales(weights.kernel, layer.filters, volume, scales.data());
+    float tensorScale = *std::max_element(scales.begin(), scales.end());
+
+    double signal = 0;
+    double channelNoise = 0;
+    double tensorNoise = 0;
+    for (int f = 0; f < layer.filters; ++f) {
+      const float* filter = weights.kernel + f * volume;
+      float amax = 0.0f;
+      for (int64_t k = 0; k < volume; ++k) {
+        float value = filter[k];
+        float quantized = fakeQuantize(value, scales[f]);
+        amax = std::max(amax, std::fabs(value));
+        signal += (double) value * value;
+        channelNoise += ((double) quantized - value) * ((double) quantized - value);
+        double tensorError = (double) fakeQuantize(value, tensorScale) - value;
+        tensorNoise += tensorError * tensorError;
+        if (std::fabs(quantized - value) > scales[f] * (0.5f + 1e-5f)) {
+          ++failures;
+        }
+      }
+      if (amax > 0.0f && std::fabs(std::fabs(std::nearbyint(amax / scales[f])) - 127.0f) > 0.0f) {
+        ++failures;
+      }
+    }
+
+    std::cout << std::setw(7) << i << std::setw(22) << layer.type + "_" + std::to_string(i + 1) << std::setw(10) <<
+        layer.filters << std::fixed << std::setprecision(1) << std::setw(22) <<
+        quantizationSnr(signal, channelNoise) << quantizationSnr(signal, tensorNoise) << std::endl;
+  }
+  if (failures > 0) {
+    std::cerr << failures << " weights exceed the quantization error bound" << std::endl;
+    return 1;
+  }
+  std::cout << "\nPer-channel weight scales OK" << std::endl;
+
+  if (!scalesPath.empty()) {
+    std::map<std::string, float> scales;
+    std::string error;
+    if (!loadActivationScales(scalesPath, scales, error)) {
+      std::cerr << "Invalid activation scales: " << error << std::endl;
+      return 1;
+    }
+    if (hasUnnamedTensors(scales)) {
+      std::cerr << scalesPath << " uses unnamed tensors from an older build, regenerate it" << std::endl;
+      return 1;
+    }
+    std::cout << scalesPath << ": " << scales.size() << " activation scales" << std::endl;
+  }
+  return 0;
+}
+
+// ringbench 写入的记录内容由帧号和帧内序号决定，读取方据此检查记录是否完整
+static void
+fillBenchmarkObject(uint64_t frameNumber, uint32_t index, DetectionRecord& object)
+{
+  object.classId = (int32_t) ((frameNumber + index) % 80);
+  object.confidence = (float) index / 256.0f;
+  object.left = (float) (frameNumber % 1000000);
+  object.top = (float) index;
+  object.width = (float) (frameNumber % 1000 + 1);
+  object.height = (float) (index + 1);
+  snprintf(object.label, sizeof(object.label), "obj_%llu_%u", (unsigned long long) frameNumber, index);
+}
+
+static bool
+checkBenchmarkRecord(const DetectionShmRecord& record)
+{
+  if (record.count == 0) {
+    return record.index == 0 && record.systemTime != 0;
+  }
+  DetectionRecord object;
+  fillBenchmarkObject(record.frameNumber, record.index, object);
+  return record.index < record.count && record.classId == object.classId && record.confidence == object.confidence &&
+      record.left == object.left && record.top == object.top && record.width == object.width &&
+      record.height == object.height && strncmp(record.label, object.label, sizeof(record.label)) == 0 &&
+      record.timestamp == record.frameNumber * 1000;
+}
+
+static uint64_t
+realtimeNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// ringbench 的读取方进程：读到最后一帧为止，统计每帧最后一条记录从写入到读到的延迟
+static int
+benchmarkReader(const std::string& name, int reader, uint64_t frames, int spinUs)
+{
+  DetectionRingReader ring;
+  std::string error;
+  if (!ring.open(name, error, true)) {
+    std::cerr << "reader " << reader << ": " << error << std::endl;
+    return 1;
+  }
+
+  std::vector<double> latencies;
+  latencies.reserve(frames);
+  uint64_t records = 0;
+  uint64_t torn = 0;
+  uint64_t disorder = 0;
+  uint64_t lastFrame = 0;
+  bool first = true;
+  DetectionShmRecord record;
+  while (true) {
+    if (!ring.read(record, 2000000, spinUs)) {
+      std::cerr << "reader " << reader << ": timed out after " << records << " records" << std::endl;
+      return 1;
+    }
+    uint64_t now = realtimeNs();
+    ++records;
+    if (!checkBenchmarkRecord(record)) {
+      ++torn;
+    }
+    if (!first && record.frameNumber < lastFrame) {
+      ++disorder;
+    }
+    first = false;
+    lastFrame = record.frameNumber;
+    if (record.count == 0 || record.index + 1 == record.count) {
+      latencies.push_back((double) (int64_t) (now - record.systemTime) / 1000.0);
+      if (record.frameNumber + 1 == frames) {
+        break;
+      }
+    }
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  std::ostringstream line;
+  line << "  reader " << reader << ": " << records << " records, " << latencies.size() << " frames, lost " <<
+      ring.lost() << ", torn " << torn << ", out of order " << disorder << std::fixed << std::setprecision(1) <<
+      ", latency us p50 " << latencies[latencies.size() / 2] << " p99 " << latencies[latencies.size() * 99 / 100] <<
+      " max " << latencies.back() << "\n";
+  std::cout << line.str() << std::flush;
+  return torn == 0 && disorder == 0 ? 0 : 1;
+}
+
+// 写入方不等待读取方：读取方落后超过一圈时跳到最旧的记录，并把跳过的记录计入 lost
+static bool
+checkRingOverwrite(const std::string& name)
+{
+  DetectionRingWriter writer;
+  DetectionRingReader reader;
+  std::string error;
+  if (!writer.open(name, 64, error) || !reader.open(name, error)) {
+    std::cerr << error << std::endl;
+    return false;
+  }
+
+  std::vector<DetectionShmRecord> records(1000);
+  for (size_t i = 0; i < records.size(); ++i) {
+    DetectionRecord object;
+    fillBenchmarkObject(i, 0, object);
+    DetectionShmRecord& record = records[i];
+    memset(&record, 0, sizeof(record));
+    record.frameNumber = i;
+    record.timestamp = i * 1000;
+    record.count = 1;
+    record.classId = object.classId;
+    record.confidence = object.confidence;
+    record.left = object.left;
+    record.top = object.top;
+    record.width = object.width;
+    record.height = object.height;
+    memcpy(record.label, object.label, sizeof(record.label));
+  }
+  writer.write(records.data(), records.size());
+
+  DetectionShmRecord record;
+  uint64_t expected = records.size() - 64;
+  bool ok = reader.lost() == 0;
+  while (reader.tryRead(record)) {
+    ok = ok && record.frameNumber == expected++ && checkBenchmarkRecord(record);
+  }
+  ok = ok && expected == records.size() && reader.lost() == records.size() - 64;
+  std::vector<std::pair<int, uint64_t>> readers = writer.readers();
+  ok = ok && readers.size() == 1 && readers[0].first == getpid() && readers[0].second == records.size();
+  std::cout << "Overwrite: read " << records.size() - reader.lost() << " of " << records.size() << " records, lost " <<
+      reader.lost() << (ok ? ", OK" : ", FAILED") << std::endl;
+  reader.close();
+  writer.close(true);
+  return ok;
+}
+
+// 共享内存检测环的 CPU 基准：probe 侧每隔 intervalUs 写一帧（objects 个目标），readers 个读取方进程读取并
+// 检查记录，打印从写入到读到的延迟。spinUs 为读取方在 futex 上等待之前自旋的时间
+static int
+ringBenchmark(int readers, uint64_t frames, uint32_t objects, int intervalUs, int spinUs)
+{
+  std::string name = "/yolo_ringbench_" + std::to_string(getpid());
+  if (!checkRingOverwrite(name)) {
+    return 1;
+  }
+
+  DetectionRingWriter writer;
+  std::string error;
+  if (!writer.open(name, 4096, error)) {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+  std::vector<pid_t> children;
+  for (int i = 0; i < readers; ++i) {
+    pid_t child = fork();
+    if (child == 0) {
+      _exit(benchmarkReader(name, i, frames, spinUs));
+    }
+    children.push_back(child);
+  }
+
+  // 所有读取方注册后再开始写入
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while ((int) writer.readers().size() < readers && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  std::cout << "Ring " << name << ": " << readers << " readers, " << frames << " frames x " << objects <<
+      " objects, every " << intervalUs << " us, reader spin " << spinUs << " us" << std::endl;
+  std::unique_ptr<FrameDetections> frame(new FrameDetections());
+  double writeUs = 0;
+  for (uint64_t f = 0; f < frames; ++f) {
+    frame->frameNumber = f;
+    frame->timestamp = f * 1000;
+    frame->sourceId = 0;
+    frame->count = objects;
+    frame->truncated = 0;
+    for (uint32_t i = 0; i < frame->count; ++i) {
+      fillBenchmarkObject(f, i, frame->objects[i]);
+    }
+    frame->systemTime = realtimeNs();
+    writer.write(*frame);
+    writeUs += (double) (realtimeNs() - frame->systemTime) / 1000.0;
+    if (intervalUs > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(intervalUs));
+    }
+  }
+
+  int failures = 0;
+  for (pid_t child : children) {
+    int status = 0;
+    if (waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      ++failures;
+    }
+  }
+  writer.close(true);
+  std::cout << "Writer: " << std::fixed << std::setprecision(2) << writeUs / frames << " us per frame" << std::endl;
+  if (failures > 0) {
+    std::cerr << failures << " readers failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// 临时目录，检查结束后删除
+class TempDir {
+  public:
+    TempDir()
+    {
+      char path[] = "/tmp/yolo_tool_XXXXXX";
+      m_Path = mkdtemp(path) != nullptr ? path : "";
+    }
+
+    ~TempDir()
+    {
+      if (!m_Path.empty()) {
+        std::error_code ec;
+        std::experimental::filesystem::remove_all(m_Path, ec);
+      }
+    }
+
+    const std::string& path() const { return m_Path; }
+
+  private:
+    std::string m_Path;
+};
+
+static int
+countTempFiles(const std::string& dir)
+{
+  int count = 0;
+  for (const auto& entry : std::experimental::filesystem::directory_iterator(dir)) {
+    if (entry.path().filename().string().find(".tmp.") != std::string::npos) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+static bool
+setFileTime(const std::string& path, int64_t seconds)
+{
+  struct timespec times[2];
+  times[0].tv_sec = times[1].tv_sec = seconds;
+  times[0].tv_nsec = times[1].tv_nsec = 0;
+  return utimensat(AT_FDCWD, path.c_str(), times, 0) == 0;
+}
+
+// 检查 XXH64（与参考实现的结果比较，分块输入与一次输入相同）以及引擎缓存的写入、读取、LRU 淘汰和原子写入
+static int
+checkEngineCache()
+{
+  int failures = 0;
+  auto expect = [&failures](bool ok, const std::string& what) {
+    if (!ok) {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  };
+
+  std::vector<unsigned char> bytes(100);
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    bytes[i] = (unsigned char) i;
+  }
+  struct { const void* data; size_t length; uint64_t seed; uint64_t expected; } vectors[] = {
+    {"", 0, 0, 0xef46db3751d8e999ULL},
+    {"a", 1, 0, 0xd24ec4f1a98c6e5bULL},
+    {"abc", 3, 0, 0x44bc2cf5ad770999ULL},
+    {bytes.data(), bytes.size(), 0, 0x6ac1e58032166597ULL},
+    {bytes.data(), bytes.size(), 42, 0x819d2b726001d507ULL},
+  };
+  for (const auto& vector : vectors) {
+    Hasher64 hasher(vector.seed);
+    hasher.update(vector.data, vector.length);
+    expect(hasher.digest() == vector.expected, "XXH64 of " + std::to_string(vector.length) + " bytes, seed " +
+        std::to_string(vector.seed) + " is " + hashToString(hasher.digest()));
+  }
+  std::mt19937 random(42);
+  for (int run = 0; run < 100; ++run) {
+    Hasher64 hasher;
+    size_t offset = 0;
+    while (offset < bytes.size()) {
+      size_t length = std::min<size_t>(random() % 40, bytes.size() - offset);
+      hasher.update(bytes.data() + offset, length);
+      offset += length;
+    }
+    expect(hasher.digest() == 0x6ac1e58032166597ULL, "XXH64 fed in chunks");
+  }
+  Hasher64 ab;
+  ab.update(std::string("ab"));
+  ab.update(std::string("c"));
+  Hasher64 bc;
+  bc.update(std::string("a"));
+  bc.update(std::string("bc"));
+  expect(ab.digest() != bc.digest(), "string fields are length prefixed");
+  expect(hashToString(0x0123456789abcdefULL) == "0123456789abcdef", "hashToString");
+
+  TempDir dir;
+  if (dir.path().empty()) {
+    std::cerr << "Could not create a temporary directory" << std::endl;
+    return 1;
+  }
+  std::vector<char> large(3 << 20);
+  for (char& c : large) {
+    c = (char) random();
+  }
+  Hasher64 memoryHash;
+  memoryHash.update(large.data(), large.size());
+  Hasher64 fileHash;
+  expect(writeFileAtomic(dir.path() + "/large.bin", large.data(), large.size()) &&
+      fileHash.updateFile(dir.path() + "/large.bin") && fileHash.digest() == memoryHash.digest(),
+      "updateFile hashes a multi-chunk file like the same bytes in memory");
+  expect(!fileHash.updateFile(dir.path() + "/missing.bin"), "updateFile of a missing file fails");
+
+  // 原子写入：覆盖已有文件，失败时不留下临时文件
+  expect(writeFileAtomic(dir.path() + "/large.bin", "new", 3) &&
+      std::experimental::filesystem::file_size(dir.path() + "/large.bin") == 3, "writeFileAtomic replaces a file");
+  std::experimental::filesystem::create_directory(dir.path() + "/occupied");
+  expect(!writeFileAtomic(dir.path() + "/occupied", "x", 1), "writeFileAtomic onto a directory fails");
+  expect(!writeFileAtomic(dir.path() + "/missing/file", "x", 1), "writeFileAtomic into a missing directory fails");
+  expect(countTempFiles(dir.path()) == 0, "failed writes leave no temporary files");
+
+  std::string cacheDir = dir.path() + "/engines";
+  EngineCache cache(cacheDir, 3000);
+  std::map<std::string, std::string> meta;
+  meta["model"] = "model";
+  meta["batch"] = "4";
+  std::vector<char> blob(1000, 'a');
+  std::vector<char> read;
+  expect(!cache.lookup("a", read) && !cache.contains("a"), "lookup of a missing engine");
+  expect(cache.store("a", blob.data(), blob.size(), meta) && cache.contains("a") && cache.lookup("a", read) &&
+      read == blob, "store and lookup");
+  std::vector<EngineCacheEntry> entries = cache.list();
+  expect(entries.size() == 1 && entries[0].key == "a" && entries[0].size == 1000 && entries[0].meta == meta,
+      "list returns the entry with its metadata");
+  expect(writeFileAtomic(cache.enginePath("empty"), "", 0) && !cache.lookup("empty", read), "empty engine is a miss");
+  unlink(cache.enginePath("empty").c_str());
+
+  // b 和 c 比 a 旧，读取 a 后 a 成为最近使用；写入 d 超出上限时淘汰最旧的 b
+  blob.assign(1000, 'b');
+  expect(cache.store("b", blob.data(), blob.size(), meta), "store b");
+  blob.assign(1000, 'c');
+  expect(cache.store("c", blob.data(), blob.size(), meta), "store c");
+  expect(setFileTime(cache.enginePath("a"), 1000) && setFileTime(cache.enginePath("b"), 2000) &&
+      setFileTime(cache.enginePath("c"), 3000), "set engine times");
+  expect(cache.lookup("a", read) && read == std::vector<char>(1000, 'a'), "lookup a");
+  blob.assign(1000, 'd');
+  expect(cache.store("d", blob.data(), blob.size(), meta), "store d");
+  expect(cache.contains("a") && !cache.contains("b") && cache.contains("c") && cache.contains("d"),
+      "the least recently used engine is evicted");
+  struct stat st;
+  expect(stat((cacheDir + "/b.meta").c_str(), &st) != 0, "eviction removes the metadata");
+
+  // 刚写入的引擎即使单独超出上限也保留
+  blob.assign(4000, 'e');
+  expect(cache.store("e", blob.data(), blob.size()), "store e");
+  entries = cache.list();
+  expect(entries.size() == 1 && entries[0].key == "e" && entries[0].meta.empty(),
+      "an oversized new engine evicts the others but is kept");
+  expect(countTempFiles(cacheDir) == 0, "the cache has no temporary files");
+
+  if (failures > 0) {
+    std::cerr << failures << " engine cache checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Hasher64 and EngineCache OK (XXH64 vectors, chunked input, store/lookup, LRU eviction, "
+      "atomic writes)" << std::endl;
+  return 0;
+}
+
+static bool
+fileContents(const std::string& path, std::string& contents)
+{
+  std::ifstream file(path, std::ios::binary);
+  std::ostringstream buffer;
+  buffer << file.rdbuf();
+  contents = buffer.str();
+  return file.good();
+}
+
+// 用模拟的构建函数检查后台构建调度：回退引擎的选择（包括损坏的 .meta）、同一引擎只构建一次（进程内和文件锁）、
+// 只有构建成功才写入缓存和热替换路径、锁文件的删除，以及销毁调度器时等待构建结束
+static int
+checkEngineBuilder()
+{
+  int failures = 0;
+  auto expect = [&failures](bool ok, const std::string& what) {
+    if (!ok) {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  };
+
+  TempDir dir;
+  if (dir.path().empty()) {
+    std::cerr << "Could not create a temporary directory" << std::endl;
+    return 1;
+  }
+  std::string cacheDir = dir.path() + "/engines";
+  EngineCache cache(cacheDir, 1ULL << 30);
+  auto seed = [&cache](const std::string& key, const std::string& model, const std::string& precision,
+      const std::string& batch) {
+    std::map<std::string, std::string> meta;
+    meta["model"] = model;
+    meta["precision"] = precision;
+    meta["batch"] = batch;
+    return cache.store(key, key.data(), key.size(), meta);
+  };
+  expect(seed("m_b4_fp32", "M", "FP32", "4") && seed("m_b8_fp32", "M", "FP32", "8") &&
+      seed("m_b8_fp16", "M", "FP16", "8") && seed("m_b16_fp16", "M", "FP16", "16") &&
+      seed("n_b4_fp16", "N", "FP16", "4") && seed("q_corrupt", "Q", "FP16", "x8") &&
+      seed("q_empty", "Q", "FP16", "") && seed("q_negative", "Q", "FP16", "-4") &&
+      cache.store("no_meta", "x", 1), "seed the cache");
+  expect(writeFileAtomic(dir.path() + "/fallback.engine", "fallback", 8), "write the fallback engine");
+
+  EngineBuildScheduler scheduler(cache, {dir.path() + "/missing.engine", dir.path() + "/fallback.engine"},
+      dir.path() + "/hotswap.engine");
+  EngineRequest request;
+  request.key = "m_b4_fp16";
+  request.modelKey = "M";
+  request.networkMode = "FP16";
+  struct { uint32_t batch; std::string model; std::string expected; } fallbacks[] = {
+    {4, "M", "m_b4_fp32.engine"},    // batch 最接近优先于精度
+    {5, "M", "m_b8_fp16.engine"},    // 同样的 batch 中精度相同的优先
+    {9, "M", "m_b16_fp16.engine"},
+    {17, "M", "fallback.engine"},    // 缓存中没有足够大的 batch，使用第一个存在的回退引擎文件
+    {1, "Q", "fallback.engine"},     // batch 无法解析的 .meta 被跳过
+  };
+  for (const auto& fallback : fallbacks) {
+    request.batchSize = fallback.batch;
+    request.modelKey = fallback.model;
+    std::string path;
+    bool found = false;
+    try {
+      found = scheduler.findFallback(request, path);
+    }
+    catch (const std::exception& e) {
+      std::cerr << "findFallback threw: " << e.what() << std::endl;
+    }
+    expect(found && path.size() >= fallback.expected.size() &&
+        path.compare(path.size() - fallback.expected.size(), fallback.expected.size(), fallback.expected) == 0,
+        "fallback for " + fallback.model + " batch " + std::to_string(fallback.batch) + " is " + fallback.expected +
+        ", got " + path);
+  }
+  EngineBuildScheduler noFallback(cache, std::vector<std::string>(), "");
+  request.batchSize = 17;
+  request.modelKey = "M";
+  std::string path;
+  expect(!noFallback.findFallback(request, path), "no fallback without a large enough engine or fallback file");
+
+  // 构建函数在 release 之前阻塞，期间同一引擎的其他构建请求都被拒绝
+  std::mutex mutex;
+  std::condition_variable released;
+  bool release = false;
+  std::atomic<int> builds(0);
+  auto blockingBuild = [&](std::vector<char>& blob) {
+    ++builds;
+    std::unique_lock<std::mutex> lock(mutex);
+    released.wait(lock, [&release]() { return release; });
+    blob.assign(1000, 'k');
+    return true;
+  };
+  request.key = "m_b4_fp16";
+  request.batchSize = 4;
+  std::string lockPath = cacheDir + "/" + request.key + ".lock";
+  EngineBuildScheduler otherProcess(cache, std::vector<std::string>(), "");
+  expect(scheduler.buildAsync(request, blockingBuild), "start the build");
+  expect(!scheduler.buildAsync(request, blockingBuild), "a second build of the same engine is rejected");
+  expect(!otherProcess.buildAsync(request, blockingBuild), "the build lock rejects another scheduler");
+  expect(scheduler.isBuilding(request.key) && !scheduler.idle() && otherProcess.idle(), "the build is running");
+  struct stat st;
+  expect(stat(lockPath.c_str(), &st) == 0, "the lock file exists while building");
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  released.notify_all();
+  scheduler.wait();
+
+  std::vector<char> blob;
+  std::string hotSwap;
+  expect(builds == 1, "the engine was built once");
+  expect(!scheduler.isBuilding(request.key) && scheduler.idle(), "the build finished");
+  expect(cache.lookup(request.key, blob) && blob == std::vector<char>(1000, 'k'), "the built engine is cached");
+  std::vector<EngineCacheEntry> entries = cache.list();
+  bool described = false;
+  for (const EngineCacheEntry& entry : entries) {
+    described = described || (entry.key == request.key && entry.meta == EngineBuildScheduler::describe(request));
+  }
+  expect(described, "the cached engine has its metadata");
+  expect(fileContents(dir.path() + "/hotswap.engine", hotSwap) && hotSwap == std::string(1000, 'k'),
+      "the engine is written to the hot-swap path");
+  expect(stat(lockPath.c_str(), &st) != 0, "the lock file is removed after the build");
+
+  // 失败、返回空引擎或抛出异常的构建不写入缓存，之后可以重新构建
+  std::vector<std::function<bool(std::vector<char>&)>> failedBuilds = {
+    [](std::vector<char>&) { return false; },
+    [](std::vector<char>& engine) { engine.clear(); return true; },
+    [](std::vector<char>&) -> bool { throw std::runtime_error("out of memory"); },
+  };
+  request.key = "m_b2_fp16";
+  for (size_t i = 0; i < failedBuilds.size(); ++i) {
+    expect(noFallback.buildAsync(request, failedBuilds[i]), "start failing build " + std::to_string(i));
+    noFallback.wait();
+    expect(!cache.contains(request.key) && stat((cacheDir + "/m_b2_fp16.lock").c_str(), &st) != 0,
+        "failing build " + std::to_string(i) + " stores nothing and removes its lock");
+  }
+
+  // 存入缓存时使用构建后计算的键（隐式 INT8 的构建写出校准表后键会变化）
+  EngineRequest rekeyed = request;
+  rekeyed.key = "m_b3_int8";
+  rekeyed.storeKey = []() { return std::string("m_b3_int8_table"); };
+  expect(noFallback.buildAsync(rekeyed, [](std::vector<char>& engine) {
+    engine.assign(10, 'c');
+    return true;
+  }), "start a build with a store key");
+  noFallback.wait();
+  expect(cache.contains("m_b3_int8_table") && !cache.contains("m_b3_int8") &&
+      stat((cacheDir + "/m_b3_int8.lock").c_str(), &st) != 0, "the engine is stored under the store key");
+
+  // 加锁后发现其他进程已构建完成时不再构建，并删除锁文件
+  builds = 0;
+  auto countedBuild = [&builds](std::vector<char>& engine) {
+    ++builds;
+    engine.assign(10, 'b');
+    return true;
+  };
+  request.key = "m_b8_fp16";
+  expect(!noFallback.buildAsync(request, countedBuild) && noFallback.idle(), "a cached engine is not rebuilt");
+  rekeyed.key = "m_b3_int8";
+  expect(!noFallback.buildAsync(rekeyed, countedBuild), "an engine cached under its store key is not rebuilt");
+  noFallback.wait();
+  expect(builds == 0 && stat((cacheDir + "/m_b8_fp16.lock").c_str(), &st) != 0 &&
+      stat((cacheDir + "/m_b3_int8.lock").c_str(), &st) != 0, "no build runs and the locks are removed");
+
+  // 崩溃的进程留下的锁文件没有被锁住，不影响构建
+  request.key = "m_b6_fp16";
+  expect(writeFileAtomic(cacheDir + "/m_b6_fp16.lock", "", 0), "leave a stale lock file");
+  expect(noFallback.buildAsync(request, countedBuild), "start a build over a stale lock file");
+  noFallback.wait();
+  expect(builds == 1 && cache.contains(request.key) && stat((cacheDir + "/m_b6_fp16.lock").c_str(), &st) != 0,
+      "the build over a stale lock file completes");
+
+  // 销毁调度器时等待构建结束
+  request.key = "m_b1_fp16";
+  std::unique_ptr<EngineBuildScheduler> shortLived(new EngineBuildScheduler(cache, std::vector<std::string>(), ""));
+  expect(shortLived->buildAsync(request, [](std::vector<char>& engine) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    engine.assign(10, 's');
+    return true;
+  }), "start the build of a short-lived scheduler");
+  shortLived.reset();
+  expect(cache.contains(request.key), "the destructor waits for the build");
+
+  if (failures > 0) {
+    std::cerr << failures << " engine build checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "EngineBuildScheduler OK (fallback selection, one build per engine, store on success, "
+      "lock files, already built engines, shutdown)" << std::endl;
+  return 0;
+}
+
+// 检查 BATCH_OPT 的解析：合法值得到 {1, opt, max}，非法值（包括超出范围和溢出）回退为 {1, max, max}
+static int
+checkBatchProfile()
+{
+  struct { std::string spec; uint32_t maxBatch; bool valid; uint32_t opt; } cases[] = {
+    {"", 8, true, 8},
+    {"4", 8, true, 4},
+    {" 2 ", 8, true, 2},
+    {"1", 1, true, 1},
+    {"max", 16, true, 16},
+    {"8", 8, true, 8},
+    {"0", 8, false, 8},
+    {"9", 8, false, 8},
+    {"-1", 8, false, 8},
+    {"4x", 8, false, 8},
+    {"2-4", 8, false, 8},
+    {"abc", 8, false, 8},
+    {"99999999999999999999999", 8, false, 8},
+  };
+
+  int failures = 0;
+  for (const auto& test : cases) {
+    uint32_t opt = 0;
+    std::string error;
+    bool valid = test.spec.empty() || parseOptBatch(test.spec, test.maxBatch, opt, error);
+    BatchProfile profile = planBatchProfile(test.spec, test.maxBatch);
+    if (valid != test.valid || profile.min != 1 || profile.opt != test.opt || profile.max != test.maxBatch ||
+        (!valid && error.empty())) {
+      std::cerr << "BATCH_OPT=\"" << test.spec << "\" with batch-size " << test.maxBatch << ": " <<
+          batchProfileToString(profile) << (valid ? "" : " (" + error + ")") << std::endl;
+      ++failures;
+    }
+  }
+  if (failures > 0) {
+    std::cerr << failures << " batch profile checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Batch profile OK (" << sizeof(cases) / sizeof(cases[0]) << " BATCH_OPT values)" << std::endl;
+  return 0;
+}
+
+// 检查校准子集的选取：最远点采样的子集大小、确定性和覆盖各个簇，以及描述子缓存按修改时间和大小命中、
+// 描述子长度变化或格式错误的条目作废
+static int
+checkCalibrationSubset()
+{
+  int failures = 0;
+  auto expect = [&failures](bool ok, const std::string& what) {
+    if (!ok) {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  };
+
+  // 4 个簇各 10 个描述子，另有 3 张读取失败的图片（空描述子）
+  std::mt19937 random(7);
+  std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+  std::vector<std::vector<float>> descriptors;
+  std::vector<int> cluster;
+  for (int i = 0; i < 43; ++i) {
+    if (i % 14 == 13) {
+      descriptors.push_back(std::vector<float>());
+      cluster.push_back(-1);
+      continue;
+    }
+    int c = descriptors.size() % 4;
+    std::vector<float> descriptor(8);
+    for (size_t k = 0; k < descriptor.size(); ++k) {
+      descriptor[k] = (k == (size_t) c * 2 ? 1.0f : 0.0f) + noise(random);
+    }
+    descriptors.push_back(descriptor);
+    cluster.push_back(c);
+  }
+
+  std::vector<size_t> subset = farthestPointSample(descriptors, 4);
+  std::vector<bool> covered(4, false);
+  for (size_t i : subset) {
+    expect(cluster[i] >= 0, "image " + std::to_string(i) + " without a descriptor is not selected");
+    if (cluster[i] >= 0) {
+      covered[cluster[i]] = true;
+    }
+  }
+  expect(subset.size() == 4 && std::count(covered.begin(), covered.end(), true) == 4,
+      "a subset of 4 takes one image from each of the 4 clusters");
+  expect(farthestPointSample(descriptors, 4) == subset, "the subset is deterministic");
+
+  for (size_t count = 0; count <= 45; ++count) {
+    std::vector<size_t> sample = farthestPointSample(descriptors, count);
+    bool sorted = std::is_sorted(sample.begin(), sample.end()) &&
+        std::adjacent_find(sample.begin(), sample.end()) == sample.end();
+    expect(sample.size() == std::min<size_t>(count, 40) && sorted, "a subset of " + std::to_string(count) +
+        " images has " + std::to_string(sample.size()) + " distinct images in list order");
+  }
+
+  TempDir dir;
+  if (dir.path().empty()) {
+    std::cerr << "Could not create a temporary directory" << std::endl;
+    return 1;
+  }
+  std::string cachePath = dir.path() + "/descriptors.txt";
+  std::vector<float> first = {0.1f, 1.0f / 3.0f, 2e-7f, -4.5f};
+  std::vector<float> second = {1.0f, 2.0f, 3.0f, 4.0f};
+  DescriptorCache cache;
+  cache.load(cachePath, 4);
+  expect(!cache.changed(), "a missing cache file loads as an empty cache");
+  cache.put("/images/a.jpg", 100, 2000, first);
+  cache.put("/images/dir with spaces/b.jpg", 200, 3000, second);
+  expect(cache.changed() && cache.save(cachePath), "save the cache");
+  expect(!cache.save(dir.path() + "/missing/descriptors.txt"), "save fails in a missing directory");
+
+  std::vector<float> descriptor;
+  DescriptorCache loaded;
+  loaded.load(cachePath, 4);
+  expect(!loaded.changed(), "a loaded cache is unchanged");
+  expect(loaded.find("/images/a.jpg", 100, 2000, descriptor) && descriptor == first,
+      "a cached descriptor is read back exactly");
+  expect(loaded.find("/images/dir with spaces/b.jpg", 200, 3000, descriptor) && descriptor == second,
+      "image paths with spaces");
+  expect(!loaded.find("/images/a.jpg", 101, 2000, descriptor), "a changed modification time misses");
+  expect(!loaded.find("/images/a.jpg", 100, 2001, descriptor), "a changed file size misses");
+  expect(!loaded.find("/images/c.jpg", 100, 2000, descriptor), "an unknown image misses");
+
+  DescriptorCache resized;
+  resized.load(cachePath, 5);
+  expect(!resized.find("/images/a.jpg", 100, 2000, descriptor) &&
+      !resized.find("/images/dir with spaces/b.jpg", 200, 3000, descriptor),
+      "entries are dropped when the descriptor length changes");
+
+  {
+    std::ofstream file(cachePath, std::ios::app);
+    file << "100 2000 1 2 3\t/images/short.jpg\n" << "100 2000 1 2 x 4\t/images/text.jpg\n" <<
+        "no tab in this line\n" << "300 4000 4 3 2 1\t/images/d.jpg\n";
+  }
+  DescriptorCache damaged;
+  damaged.load(cachePath, 4);
+  expect(damaged.find("/images/a.jpg", 100, 2000, descriptor) && damaged.find("/images/d.jpg", 300, 4000, descriptor),
+      "valid entries load around damaged lines");
+  expect(!damaged.find("/images/short.jpg", 100, 2000, descriptor) &&
+      !damaged.find("/images/text.jpg", 100, 2000, descriptor), "damaged entries are dropped");
+
+  // 与校准时相同，按 stat 得到的修改时间和大小查找；图片被改写后不再命中
+  std::string imagePath = dir.path() + "/image.jpg";
+  struct stat before;
+  expect(writeFileAtomic(imagePath, "jpeg", 4) && setFileTime(imagePath, 1000000) &&
+      stat(imagePath.c_str(), &before) == 0, "write a test image");
+  cache.put(imagePath, before.st_mtime, before.st_size, first);
+  struct stat after;
+  expect(writeFileAtomic(imagePath, "jpeg!", 5) && setFileTime(imagePath, 1000000) &&
+      stat(imagePath.c_str(), &after) == 0, "rewrite the test image with the same modification time");
+  expect(cache.find(imagePath, before.st_mtime, before.st_size, descriptor) &&
+      !cache.find(imagePath, after.st_mtime, after.st_size, descriptor), "a rewritten image of another size misses");
+  expect(setFileTime(imagePath, 2000000) && stat(imagePath.c_str(), &after) == 0, "touch the test image");
+  cache.put(imagePath, before.st_mtime, after.st_size, first);
+  expect(!cache.find(imagePath, after.st_mtime, after.st_size, descriptor), "a touched image misses");
+
+  if (failures > 0) {
+    std::cerr << failures << " calibration subset checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Calibration subset OK" << std::endl;
+  return 0;
+}
+
+// 检查校准 batch 的预取：模拟校准器的使用方式（锁页内存的分配/释放、较慢的拷贝到 GPU），检查 batch 的顺序、
+// 最多提前 ahead 个 batch、加载失败、还有 batch 未取完时析构，以及加载样本的常驻线程
+static int
+checkBatchPrefetcher()
+{
+  int failures = 0;
+  auto expect = [&failures](bool ok, const std::string& what) {
+    if (!ok) {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  };
+
+  const size_t batchSize = 4;
+  const size_t itemElements = 3;
+  std::atomic<int> allocated(0);
+  BatchPrefetcher::Allocate allocate = [&](size_t elements) {
+    ++allocated;
+    return new float[elements];
+  };
+  BatchPrefetcher::Release release = [&](float* buffer) {
+    --allocated;
+    delete[] buffer;
+  };
+
+  // 每个样本写入自己的序号；maxStarted 记录开始加载的最大 batch 序号
+  std::atomic<long> maxStarted(-1);
+  std::atomic<size_t> loaded(0);
+  std::atomic<size_t> failItem(~(size_t) 0);
+  auto load = [&](size_t item, float* data) {
+    long batch = item / batchSize;
+    long started = maxStarted;
+    while (batch > started && !maxStarted.compare_exchange_weak(started, batch)) {
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    for (size_t k = 0; k < itemElements; ++k) {
+      data[k] = item * itemElements + k;
+    }
+    ++loaded;
+    return item != failItem;
+  };
+
+  for (int ahead = 1; ahead <= 3; ++ahead) {
+    std::string name = "ahead " + std::to_string(ahead) + ": ";
+    maxStarted = -1;
+    std::vector<float> device(batchSize * itemElements);
+    bool ordered = true;
+    bool bounded = true;
+    bool reached = false;
+    size_t batches = 0;
+    {
+      // 42 个样本，最后 2 个不满一个 batch
+      BatchPrefetcher prefetcher(42, batchSize, itemElements, ahead, 2, load, allocate, release);
+      expect(allocated == ahead + 1, name + "allocates ahead + 1 host buffers");
+      expect(prefetcher.batchCount() == 10, name + "drops the incomplete last batch");
+      while (const float* batch = prefetcher.next()) {
+        // 模拟较慢的 cudaMemcpy，期间后台线程继续准备后续 batch
+        std::this_thread::sleep_for(std::chrono::milliseconds(3));
+        memcpy(device.data(), batch, device.size() * sizeof(float));
+        for (size_t k = 0; k < device.size(); ++k) {
+          ordered &= device[k] == batches * device.size() + k;
+        }
+        bounded &= maxStarted <= (long) batches + ahead;
+        reached |= maxStarted == (long) batches + ahead;
+        ++batches;
+      }
+      expect(prefetcher.next() == nullptr && prefetcher.consumed() == 10 && !prefetcher.failed(),
+          name + "stays at the end after the last batch");
+    }
+    expect(batches == 10 && ordered, name + "delivers all batches in order");
+    expect(bounded, name + "never loads more than ahead batches past the one in use");
+    expect(reached, name + "loads ahead batches while the consumer copies");
+    expect(allocated == 0, name + "releases every host buffer");
+  }
+
+  {
+    failItem = 13;
+    BatchPrefetcher prefetcher(40, batchSize, itemElements, 2, 2, load, allocate, release);
+    size_t batches = 0;
+    while (prefetcher.next() != nullptr) {
+      ++batches;
+    }
+    expect(batches == 3 && prefetcher.failed(), "a failed item ends the batches before its own batch");
+    failItem = ~(size_t) 0;
+  }
+  expect(allocated == 0, "releases every host buffer after a failure");
+
+  // 析构时后台线程还在准备 batch：等当前 batch 完成后退出，不再加载后面的 batch
+  for (int consumed = 0; consumed <= 2; ++consumed) {
+    loaded = 0;
+    {
+      BatchPrefetcher prefetcher(400, batchSize, itemElements, 2, 2, load, allocate, release);
+      for (int i = 0; i < consumed; ++i) {
+        expect(prefetcher.next() != nullptr, "take a batch before shutdown");
+      }
+    }
+    expect(loaded <= (consumed + 3) * batchSize, "shutdown after " + std::to_string(consumed) + " batches loads " +
+        std::to_string(loaded) + " items, at most " + std::to_string((consumed + 3) * batchSize));
+    expect(allocated == 0, "releases every host buffer at shutdown");
+  }
+
+  {
+    BatchPrefetcher prefetcher(3, batchSize, itemElements, 2, 2, load, nullptr, nullptr);
+    expect(prefetcher.batchCount() == 0 && prefetcher.next() == nullptr && !prefetcher.failed(),
+        "fewer items than one batch");
+  }
+
+  // 预取线程的 WorkerPool：每次 run 每个下标恰好执行一次，所有 run 都在同一组常驻线程上执行
+  {
+    WorkerPool pool(4);
+    std::mutex idsMutex;
+    std::set<std::thread::id> ids;
+    bool once = true;
+    for (size_t count = 0; count < 200; ++count) {
+      std::vector<std::atomic<int>> runs(count);
+      for (std::atomic<int>& run : runs) {
+        run = 0;
+      }
+      pool.run(count, [&](size_t i) {
+        ++runs[i];
+        std::lock_guard<std::mutex> lock(idsMutex);
+        ids.insert(std::this_thread::get_id());
+      });
+      for (const std::atomic<int>& run : runs) {
+        once = once && run == 1;
+      }
+    }
+    expect(once, "the worker pool runs every index once");
+    expect(pool.threads() == 4 && ids.size() <= 4, "the worker pool reuses its threads, got " +
+        std::to_string(ids.size()) + " threads");
+  }
+
+  if (failures > 0) {
+    std::cerr << failures << " batch prefetcher checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Batch prefetcher OK" << std::endl;
+  return 0;
+}
+
+// prepareImage 在缩放之后的计算：BGR 转 RGB（inputFormat 0）、转为 float 并乘 scale、减去 offsets * scale、
+// 拆分为 CHW；letterbox 时图片放在 placement 处，其余像素按 0 计算
+static std::vector<float>
+referencePackImage(const std::vector<uint8_t>& image, size_t stride, int channels, int inputFormat, int inputW,
+    int inputH, const ImagePlacement& placement, float scale, const float* offsets)
+{
+  std::vector<float> output((size_t) channels * inputW * inputH);
+  for (int c = 0; c < channels; ++c) {
+    int source = inputFormat == 0 && channels == 3 ? 2 - c : c;
+    for (int y = 0; y < inputH; ++y) {
+      for (int x = 0; x < inputW; ++x) {
+        int row = y - placement.y;
+        int col = x - placement.x;
+        bool inside = row >= 0 && row < placement.height && col >= 0 && col < placement.width;
+        float pixel = inside ? image[row * stride + col * channels + source] : 0;
+        output[((size_t) c * inputH + y) * inputW + x] = pixel * scale - offsets[c] * scale;
+      }
+    }
+  }
+  return output;
+}
+
+// 检查 packImagePlanar 与 prepareImage 的计算一致：各种宽度（16 像素一组的向量路径和逐像素的剩余部分）、
+// RGB/BGR/灰度、行间有空隙的图片、letterbox 的位置和填充；并检查 letterboxPlacement 与 nvinfer 相同
+static int
+checkImagePacking()
+{
+  int failures = 0;
+  auto expect = [&failures](bool ok, const std::string& what) {
+    if (!ok) {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  };
+
+  struct { int imageW, imageH, inputW, inputH; bool symmetric; int x, y, width, height; } placements[] = {
+    {1920, 1080, 640, 640, true, 0, 140, 640, 360},
+    {1920, 1080, 640, 640, false, 0, 0, 640, 360},
+    {1080, 1920, 640, 640, true, 140, 0, 360, 640},
+    {640, 640, 640, 640, true, 0, 0, 640, 640},
+    {1280, 720, 416, 416, true, 0, 91, 416, 234},
+    {100, 100, 640, 384, true, 128, 0, 384, 384},
+    {10000, 1, 64, 64, true, 0, 31, 64, 1},
+  };
+  for (const auto& test : placements) {
+    ImagePlacement placement = letterboxPlacement(test.imageW, test.imageH, test.inputW, test.inputH, test.symmetric);
+    expect(placement.x == test.x && placement.y == test.y && placement.width == test.width &&
+        placement.height == test.height, "letterbox of " + std::to_string(test.imageW) + "x" +
+        std::to_string(test.imageH) + " in " + std::to_string(test.inputW) + "x" + std::to_string(test.inputH) +
+        " is " + std::to_string(placement.width) + "x" + std::to_string(placement.height) + " at " +
+        std::to_string(placement.x) + "," + std::to_string(placement.y));
+  }
+
+  const float offsets[3] = {123.675f, 116.28f, 103.53f};
+  const float scales[2] = {1.0f / 255.0f, 0.017352074f};
+  std::mt19937 random(3);
+  int cases = 0;
+  for (int inputFormat = 0; inputFormat <= 2; ++inputFormat) {
+    int channels = inputFormat == 2 ? 1 : 3;
+    for (int width = 1; width <= 50; ++width) {
+      for (int letterbox = 0; letterbox <= 2; ++letterbox) {
+        // letterbox 0：缩放裁剪后与输入同样大小；1/2：图片宽度为输入的一部分，填充在右侧或两侧
+        int inputW = letterbox ? width + 7 : width;
+        int inputH = 5;
+        ImagePlacement placement;
+        placement.width = width;
+        placement.height = letterbox ? 3 : inputH;
+        placement.x = letterbox == 2 ? 3 : 0;
+        placement.y = letterbox == 2 ? 1 : 0;
+        size_t stride = width * channels + (width % 3) * 5;
+        std::vector<uint8_t> image(stride * placement.height);
+        for (uint8_t& value : image) {
+          value = random();
+        }
+        float scale = scales[width % 2];
+
+        std::vector<float> expected = referencePackImage(image, stride, channels, inputFormat, inputW, inputH,
+            placement, scale, offsets);
+        std::vector<float> actual(expected.size(), std::nanf(""));
+        packImagePlanar(image.data(), stride, channels, inputFormat == 0, inputW, inputH, placement, scale, offsets,
+            actual.data());
+        float difference = 0;
+        for (size_t i = 0; i < expected.size(); ++i) {
+          difference = std::isnan(actual[i]) ? INFINITY : std::max(difference, std::fabs(expected[i] - actual[i]));
+        }
+        expect(difference <= 1e-5, "input format " + std::to_string(inputFormat) + ", width " +
+            std::to_string(width) + ", letterbox " + std::to_string(letterbox) + ": max difference " +
+            std::to_string(difference));
+        ++cases;
+      }
+    }
+  }
+
+  if (failures > 0) {
+    std::cerr << failures << " image packing checks failed" << std::endl;
+    return 1;
+  }
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+  const char* path = "NEON";
+#elif defined(__SSSE3__)
+  const char* path = "SSSE3";
+#elif defined(__SSE2__)
+  const char* path = "SSE2";
+#else
+  const char* path = "scalar";
+#endif
+  std::cout << "Image packing OK (" << path << " and scalar remainder, " << cases << " images)" << std::endl;
+  return 0;
+}
+
+// 检查预处理后的校准输入缓存：按 batch 写入后重新映射读回、key 覆盖图片和全部预处理参数、图片被修改后 key
+// 改变（旧缓存不再命中）、参数或大小不一致和损坏的文件不命中、中途失败不留下文件，以及覆盖时已映射的数据不变
+static int
+checkCalibrationCache()
+{
+  int failures = 0;
+  auto expect = [&failures](bool ok, const std::string& what) {
+    if (!ok) {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  };
+
+  TempDir dir;
+  if (dir.path().empty()) {
+    std::cerr << "Could not create a temporary directory" << std::endl;
+    return 1;
+  }
+  std::vector<std::string> images;
+  for (int i = 0; i < 6; ++i) {
+    images.push_back(dir.path() + "/image" + std::to_string(i) + ".jpg");
+    expect(writeFileAtomic(images.back(), "jpeg", 4) && setFileTime(images.back(), 1000000 + i),
+        "write test image " + std::to_string(i));
+  }
+
+  // 与校准器相同的调用：3 通道 8x8 输入，batch 为 2
+  const int channels = 3, height = 8, width = 8, batchSize = 2;
+  const uint64_t itemElements = channels * height * width;
+  const uint64_t itemCount = images.size();
+  const float offsets[3] = {0.0f, 0.0f, 0.0f};
+  const float scale = 1.0f / 255.0f;
+  auto keyOf = [&](const std::vector<std::string>& paths, int h, float scaleFactor, const float* means, int format,
+      int letterBox, int symmetric, uint64_t& key) {
+    return calibrationCacheKey(paths, channels, h, width, scaleFactor, means, format, letterBox, symmetric, key);
+  };
+  uint64_t key = 0;
+  expect(keyOf(images, height, scale, offsets, 0, 1, 1, key), "compute the cache key");
+  uint64_t again = 0;
+  expect(keyOf(images, height, scale, offsets, 0, 1, 1, again) && again == key, "the cache key is deterministic");
+
+  std::vector<std::string> reordered = images;
+  std::swap(reordered[0], reordered[1]);
+  const float otherOffsets[3] = {0.0f, 0.0f, 1.0f};
+  struct { const char* what; bool ok; uint64_t key; } changes[] = {
+    {"image order", false, 0}, {"input height", false, 0}, {"scale factor", false, 0}, {"offsets", false, 0},
+    {"input format", false, 0}, {"letterbox", false, 0}, {"symmetric padding", false, 0}, {"image list", false, 0},
+  };
+  changes[0].ok = keyOf(reordered, height, scale, offsets, 0, 1, 1, changes[0].key);
+  changes[1].ok = keyOf(images, height * 2, scale, offsets, 0, 1, 1, changes[1].key);
+  changes[2].ok = keyOf(images, height, 0.5f * scale, offsets, 0, 1, 1, changes[2].key);
+  changes[3].ok = keyOf(images, height, scale, otherOffsets, 0, 1, 1, changes[3].key);
+  changes[4].ok = keyOf(images, height, scale, offsets, 1, 1, 1, changes[4].key);
+  changes[5].ok = keyOf(images, height, scale, offsets, 0, 0, 1, changes[5].key);
+  changes[6].ok = keyOf(images, height, scale, offsets, 0, 1, 0, changes[6].key);
+  changes[7].ok = keyOf(std::vector<std::string>(images.begin(), images.end() - 1), height, scale, offsets, 0, 1, 1,
+      changes[7].key);
+  for (const auto& change : changes) {
+    expect(change.ok && change.key != key, std::string("changing the ") + change.what + " changes the key");
+  }
+  std::vector<std::string> missing = images;
+  missing.push_back(dir.path() + "/missing.jpg");
+  expect(!keyOf(missing, height, scale, offsets, 0, 1, 1, again), "a missing image has no key");
+
+  // 写入：每张图片的数据为 image * 1000 + 元素序号，按 batch 追加
+  std::vector<float> inputs(itemCount * itemElements);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    inputs[i] = (float) (i / itemElements) * 1000.0f + (float) (i % itemElements) + 0.25f;
+  }
+  std::string cachePath = dir.path() + "/calib_" + hashToString(key) + ".bin";
+  {
+    CalibrationCacheWriter writer;
+    expect(writer.begin(cachePath, key, itemElements) && writer.isActive(), "begin the cache file");
+    for (uint64_t item = 0; item < itemCount; item += batchSize) {
+      expect(writer.append(inputs.data() + item * itemElements, batchSize), "append batch " +
+          std::to_string(item / batchSize));
+    }
+    CalibrationCache early;
+    expect(!early.open(cachePath, key, itemElements, itemCount) && countTempFiles(dir.path()) == 1,
+        "the cache is not visible before commit");
+    expect(writer.commit() && !writer.isActive(), "commit the cache file");
+    expect(!writer.append(inputs.data(), 1) && !writer.commit(), "append and commit fail after commit");
+  }
+  struct stat st;
+  expect(stat(cachePath.c_str(), &st) == 0 && (uint64_t) st.st_size == 64 + inputs.size() * sizeof(float) &&
+      countTempFiles(dir.path()) == 0, "the committed file has a 64-byte header and the inputs");
+
+  CalibrationCache cache;
+  expect(cache.open(cachePath, key, itemElements, itemCount) && cache.isOpen() && cache.itemCount() == itemCount,
+      "reopen the cache");
+  if (cache.isOpen()) {
+    for (uint64_t item = 0; item < itemCount; item += batchSize) {
+      expect(memcmp(cache.items(item), inputs.data() + item * itemElements, batchSize * itemElements *
+          sizeof(float)) == 0, "batch " + std::to_string(item / batchSize) + " reads back exactly");
+    }
+  }
+  cache.close();
+  expect(!cache.isOpen() && cache.itemCount() == 0, "close the cache");
+
+  expect(!cache.open(cachePath, key + 1, itemElements, itemCount), "another key misses");
+  expect(!cache.open(cachePath, key, itemElements + 1, itemCount), "another input size misses");
+  expect(!cache.open(cachePath, key, itemElements, itemCount - batchSize), "another image count misses");
+  expect(!cache.open(dir.path() + "/missing.bin", key, itemElements, itemCount), "a missing file misses");
+
+  // 图片被改写（修改时间或大小改变）后 key 改变，旧缓存不再命中
+  expect(setFileTime(images[3], 2000000), "touch an image");
+  uint64_t touchedKey = 0;
+  expect(keyOf(images, height, scale, offsets, 0, 1, 1, touchedKey) && touchedKey != key &&
+      !cache.open(cachePath, touchedKey, itemElements, itemCount), "a touched image makes the cache stale");
+  expect(writeFileAtomic(images[3], "jpeg!", 5) && setFileTime(images[3], 1000003), "rewrite an image");
+  uint64_t rewrittenKey = 0;
+  expect(keyOf(images, height, scale, offsets, 0, 1, 1, rewrittenKey) && rewrittenKey != key &&
+      !cache.open(cachePath, rewrittenKey, itemElements, itemCount), "a rewritten image makes the cache stale");
+
+  // 截断、多余数据和错误的魔数
+  std::string contents;
+  expect(fileContents(cachePath, contents) && contents.size() == (size_t) st.st_size, "read the cache file");
+  std::string damagedPath = dir.path() + "/damaged.bin";
+  std::string truncated = contents.substr(0, contents.size() - 4);
+  expect(writeFileAtomic(damagedPath, truncated.data(), truncated.size()) &&
+      !cache.open(damagedPath, key, itemElements, itemCount), "a truncated file misses");
+  std::string extended = contents + "more";
+  expect(writeFileAtomic(damagedPath, extended.data(), extended.size()) &&
+      !cache.open(damagedPath, key, itemElements, itemCount), "a file with trailing data misses");
+  std::string header = contents.substr(0, 30);
+  expect(writeFileAtomic(damagedPath, header.data(), header.size()) &&
+      !cache.open(damagedPath, key, itemElements, itemCount), "a file shorter than the header misses");
+  std::string badMagic = contents;
+  badMagic[0] = 'X';
+  expect(writeFileAtomic(damagedPath, badMagic.data(), badMagic.size()) &&
+      !cache.open(damagedPath, key, itemElements, itemCount), "a file with another magic misses");
+
+  // 校准中途失败：abort 或析构时删除临时文件，不留下缓存文件
+  std::string abortedPath = dir.path() + "/aborted.bin";
+  {
+    CalibrationCacheWriter writer;
+    expect(writer.begin(abortedPath, key, itemElements) && writer.append(inputs.data(), batchSize),
+        "begin a cache file to abort");
+    writer.abort();
+    expect(!writer.isActive() && !writer.append(inputs.data(), 1) && !writer.commit(),
+        "append and commit fail after abort");
+  }
+  {
+    CalibrationCacheWriter writer;
+    expect(writer.begin(abortedPath, key, itemElements) && writer.append(inputs.data(), batchSize),
+        "begin a cache file that is never committed");
+  }
+  expect(access(abortedPath.c_str(), F_OK) != 0 && countTempFiles(dir.path()) == 0,
+      "an aborted or uncommitted cache leaves no files");
+  CalibrationCacheWriter failing;
+  expect(!failing.begin(dir.path() + "/missing/calib.bin", key, itemElements) && !failing.isActive(),
+      "begin fails in a missing directory");
+
+  // 已映射的缓存被另一个进程重写时，rename 替换文件，映射中的数据不变
+  expect(cache.open(cachePath, key, itemElements, itemCount), "map the cache again");
+  {
+    std::vector<float> zeros(inputs.size(), 0.0f);
+    CalibrationCacheWriter writer;
+    expect(writer.begin(cachePath, key, itemElements) && writer.append(zeros.data(), itemCount) && writer.commit(),
+        "replace the mapped cache file");
+  }
+  expect(cache.isOpen() && memcmp(cache.items(0), inputs.data(), inputs.size() * sizeof(float)) == 0,
+      "the mapped inputs are unchanged by the replacement");
+  CalibrationCache replaced;
+  expect(replaced.open(cachePath, key, itemElements, itemCount) && replaced.items(itemCount - 1)[0] == 0.0f,
+      "a new mapping reads the replacement");
+
+  if (failures > 0) {
+    std::cerr << failures << " calibration cache checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Calibration cache OK" << std::endl;
+  return 0;
+}
+
+// 队列元素：生产者把 seq 写入全部字段，消费者看到不一致的字段说明元素被并发写入
+struct QueueCheckItem
+{
+  uint64_t values[8];
+};
+
+// 在一帧中填写 objects 个目标（超过 kMaxFrameDetections 的只计入 truncated），内容由帧号决定
+static void
+fillCheckFrame(FrameDetections& frame, uint64_t frameNumber, uint32_t objects)
+{
+  frame.frameNumber = frameNumber;
+  frame.timestamp = frameNumber * 33333333;
+  frame.systemTime = frameNumber;
+  frame.sourceId = frameNumber % 4;
+  for (uint32_t i = 0; i < objects; ++i) {
+    DetectionRecord* record = frame.add();
+    if (record != nullptr) {
+      record->classId = (int32_t) ((frameNumber + i) % 80);
+      record->confidence = (float) i;
+      record->left = (float) frameNumber;
+    }
+  }
+}
+
+static bool
+checkFrameContents(const FrameDetections& frame, uint32_t objects)
+{
+  uint32_t kept = objects < FrameDetections::kMaxFrameDetections ? objects : FrameDetections::kMaxFrameDetections;
+  if (frame.count != kept || frame.truncated != objects - kept || frame.timestamp != frame.frameNumber * 33333333 ||
+      frame.sourceId != frame.frameNumber % 4) {
+    return false;
+  }
+  for (uint32_t i = 0; i < frame.count; ++i) {
+    const DetectionRecord& record = frame.objects[i];
+    if (record.classId != (int32_t) ((frame.frameNumber + i) % 80) || record.confidence != (float) i ||
+        record.left != (float) frame.frameNumber) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 压力测试 DropOldestQueue 和 DetectionPublisher：生产者全速提交、消费者较慢时，发布数 + 丢弃数等于提交数，
+// 消费者看到的序号严格递增且内容完整，生产者从不需要等待空闲元素；每帧超过 256 个目标时截断并计数；
+// 逐帧提交并等待发布时不丢失唤醒；析构时发布完剩余的帧
+static int
+checkDetectionPublisher()
+{
+  int failures = 0;
+  auto expect = [&failures](bool ok, const std::string& what) {
+    if (!ok) {
+      std::cerr << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  };
+
+  // 单线程：队列满时丢弃最旧的元素，剩下最新的 capacity 个
+  {
+    DropOldestQueue<QueueCheckItem> queue(4);
+    bool acquired = true;
+    for (uint64_t seq = 0; seq < 10; ++seq) {
+      QueueCheckItem* item = queue.acquire();
+      acquired = acquired && item != nullptr;
+      if (item != nullptr) {
+        item->values[0] = seq;
+        queue.push(item);
+      }
+    }
+    expect(acquired && queue.dropped() == 6, "10 pushes into a queue of 4 drop 6 items");
+    bool ordered = true;
+    for (uint64_t seq = 6; seq < 10; ++seq) {
+      QueueCheckItem* item = queue.pop();
+      ordered = ordered && item != nullptr && item->values[0] == seq;
+      if (item != nullptr) {
+        queue.release(item);
+      }
+    }
+    expect(ordered && queue.pop() == nullptr && queue.empty(), "the newest 4 items pop in order");
+  }
+
+  // 两个线程：消费者每 64 个元素停顿一次
+  for (size_t capacity : {1, 2, 8}) {
+    const uint64_t produced = 200000;
+    DropOldestQueue<QueueCheckItem> queue(capacity);
+    std::atomic<bool> done(false);
+    uint64_t popped = 0;
+    bool increasing = true;
+    bool intact = true;
+    std::thread consumer([&]() {
+      int64_t last = -1;
+      while (true) {
+        bool finished = done.load();
+        QueueCheckItem* item = queue.pop();
+        if (item == nullptr) {
+          if (finished) {
+            break;
+          }
+          std::this_thread::yield();
+          continue;
+        }
+        uint64_t seq = item->values[0];
+        for (uint64_t value : item->values) {
+          intact = intact && value == seq;
+        }
+        increasing = increasing && (int64_t) seq > last;
+        last = seq;
+        queue.release(item);
+        if (++popped % 64 == 0) {
+          std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+      }
+    });
+    bool acquired = true;
+    for (uint64_t seq = 0; seq < produced; ++seq) {
+      QueueCheckItem* item = queue.acquire();
+      if (item == nullptr) {
+        acquired = false;
+        break;
+      }
+      std::fill(item->values, item->values + 8, seq);
+      queue.push(item);
+    }
+    done = true;
+    consumer.join();
+    std::string name = "queue of " + std::to_string(capacity) + ": ";
+    expect(acquired, name + "the producer always gets a free item");
+    expect(popped + queue.dropped() == produced, name + std::to_string(popped) + " popped + " +
+        std::to_string(queue.dropped()) + " dropped == " + std::to_string(produced) + " produced");
+    expect(queue.dropped() > 0 && popped > 0, name + "the slow consumer drops some items and receives others");
+    expect(increasing, name + "the consumer sees strictly increasing sequence numbers");
+    expect(intact, name + "no item is written while the consumer reads it");
+  }
+
+  // FrameDetections::add 的截断
+  {
+    std::unique_ptr<FrameDetections> frame(new FrameDetections());
+    for (uint32_t objects : {0u, 1u, 255u, 256u, 257u, 300u, 1000u}) {
+      frame->count = 0;
+      frame->truncated = 0;
+      fillCheckFrame(*frame, 7, objects);
+      expect(checkFrameContents(*frame, objects), std::to_string(objects) + " objects keep " +
+          std::to_string(frame->count) + " and truncate " + std::to_string(frame->truncated));
+    }
+  }
+
+  // DetectionPublisher：每帧的目标数在 0 到 300 之间，发布函数较慢
+  {
+    const uint64_t produced = 20000;
+    std::atomic<uint64_t> publishedFrames(0);
+    bool increasing = true;
+    bool intact = true;
+    int64_t last = -1;
+    uint64_t dropped = 0;
+    bool begun = true;
+    {
+      DetectionPublisher publisher(8, [&](const FrameDetections& frame) {
+        increasing = increasing && (int64_t) frame.frameNumber > last;
+        last = frame.frameNumber;
+        intact = intact && checkFrameContents(frame, frame.frameNumber * 7 % 301);
+        if (frame.frameNumber % 16 == 0) {
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        publishedFrames.fetch_add(1);
+      });
+      for (uint64_t frameNumber = 0; frameNumber < produced; ++frameNumber) {
+        FrameDetections* frame = publisher.begin();
+        if (frame == nullptr) {
+          begun = false;
+          continue;
+        }
+        fillCheckFrame(*frame, frameNumber, frameNumber * 7 % 301);
+        publisher.commit(frame);
+      }
+      dropped = publisher.dropped();
+    }
+    expect(begun, "begin always returns a frame");
+    expect(publishedFrames.load() + dropped == produced, std::to_string(publishedFrames.load()) + " published + " +
+        std::to_string(dropped) + " dropped == " + std::to_string(produced) + " produced");
+    expect(dropped > 0, "a slow publisher drops frames");
+    expect(increasing, "published frame numbers are strictly increasing");
+    expect(intact, "published frames are complete, with more than 256 objects truncated");
+  }
+
+  // 每次提交一帧并等待发布：发布线程在等待时也能被唤醒，不丢帧
+  {
+    std::mutex mutex;
+    std::condition_variable changed;
+    uint64_t lastPublished = UINT64_MAX;
+    DetectionPublisher publisher(8, [&](const FrameDetections& frame) {
+      std::lock_guard<std::mutex> lock(mutex);
+      lastPublished = frame.frameNumber;
+      changed.notify_one();
+    });
+    std::mt19937 random(5);
+    bool woken = true;
+    for (uint64_t frameNumber = 0; frameNumber < 2000 && woken; ++frameNumber) {
+      if (random() % 4 == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(random() % 100));
+      }
+      FrameDetections* frame = publisher.begin();
+      if (frame == nullptr) {
+        woken = false;
+        break;
+      }
+      fillCheckFrame(*frame, frameNumber, 1);
+      publisher.commit(frame);
+      std::unique_lock<std::mutex> lock(mutex);
+      woken = changed.wait_for(lock, std::chrono::seconds(5), [&]() { return lastPublished == frameNumber; });
+    }
+    expect(woken, "single committed frames are published without a lost wakeup");
+    expect(publisher.dropped() == 0, "a publisher that keeps up drops no frames");
+  }
+
+  // 析构时发布完队列中剩余的帧
+  {
+    std::atomic<uint64_t> publishedFrames(0);
+    uint64_t dropped = 0;
+    {
+      DetectionPublisher publisher(8, [&](const FrameDetections&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        publishedFrames.fetch_add(1);
+      });
+      for (uint64_t frameNumber = 0; frameNumber < 20; ++frameNumber) {
+        FrameDetections* frame = publisher.begin();
+        if (frame != nullptr) {
+          fillCheckFrame(*frame, frameNumber, 0);
+          publisher.commit(frame);
+        }
+      }
+      dropped = publisher.dropped();
+    }
+    expect(publishedFrames.load() + dropped == 20 && publishedFrames.load() >= 8,
+        "the destructor publishes the queued frames");
+  }
+
+  if (failures > 0) {
+    std::cerr << failures << " detection publisher checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Detection publisher OK" << std::endl;
+  return 0;
+}
+
+int
+main(int argc, char** argv)
+{
+  std::string command = argc > 1 ? argv[1] : "";
+
+  if (command == "pack" && argc == 5) {
+    return packModel(argv[2], argv[3], argv[4]);
+  }
+  if (command == "check" && argc == 3) {
+    return checkPack(argv[2]);
+  }
+  if (command == "verify" && argc == 5) {
+    return verifyPack(argv[2], argv[3], argv[4]);
+  }
+  if (command == "optimize" && argc == 3) {
+    return optimizeConfig(argv[2]);
+  }
+  if (command == "dryrun" && argc >= 3 && argc <= 5) {
+    // 第二个参数不是权重文件时视为 batch 列表
+    std::string weightsPath = argc > 3 && std::string(argv[3]).find(".weights") != std::string::npos ? argv[3] : "";
+    std::string batchList = argc > 3 && weightsPath.empty() ? argv[3] : argc > 4 ? argv[4] : "1,2,4,8,16";
+    return dryRun(argv[2], weightsPath, batchList);
+  }
+  if (command == "cost" && (argc == 3 || (argc >= 5 && argc <= 7))) {
+    std::string precision = argc > 5 ? argv[5] : "FP16";
+    int maxBatch = argc > 6 ? atoi(argv[6]) : 16;
+    double budgetMs = argc > 4 ? atof(argv[4]) : 0;
+    bool validPrecision = precision == "FP32" || precision == "FP16" || precision == "INT8";
+    if (argc > 3 && (budgetMs <= 0 || maxBatch <= 0 || !validPrecision)) {
+      printUsage();
+      return 2;
+    }
+    return costModel(argv[2], argc > 3 ? argv[3] : "", budgetMs, precision, maxBatch);
+  }
+  if (command == "prune" && argc == 4) {
+    return pruneHeads(argv[2], argv[3]);
+  }
+  if (command == "sparsity" && argc >= 4 && argc <= 6) {
+    return sparsityReport(argv[2], argv[3], argc > 4 ? argv[4] : "", argc > 5 ? argv[5] : "");
+  }
+  if (command == "qdqcheck" && (argc == 4 || argc == 5)) {
+    return checkQuantization(argv[2], argv[3], argc > 4 ? argv[4] : "");
+  }
+  if (command == "fp16check" && (argc == 2 || argc == 4)) {
+    return checkHalfWeights(argc == 4 ? argv[2] : "", argc == 4 ? argv[3] : "");
+  }
+  if (command == "ringbench" && (argc == 2 || argc == 7)) {
+    int readers = argc > 2 ? atoi(argv[2]) : 2;
+    long long frames = argc > 3 ? atoll(argv[3]) : 2000;
+    int objects = argc > 4 ? atoi(argv[4]) : 4;
+    int intervalUs = argc > 5 ? atoi(argv[5]) : 1000;
+    int spinUs = argc > 6 ? atoi(argv[6]) : 20;
+    if (readers <= 0 || readers > detection_ring::kMaxReaders || frames <= 0 || objects < 0 ||
+        objects > (int) FrameDetections::kMaxFrameDetections || intervalUs < 0 || spinUs < 0) {
+      printUsage();
+      return 2;
+    }
+    return ringBenchmark(readers, frames, objects, intervalUs, spinUs);
+  }
+  if (command == "cachecheck" && argc == 2) {
+    return checkEngineCache();
+  }
+  if (command == "buildcheck" && argc == 2) {
+    return checkEngineBuilder();
+  }
+  if (command == "profilecheck" && argc == 2) {
+    return checkBatchProfile();
+  }
+  if (command == "passcheck" && argc == 2) {
+    return checkNetworkPasses();
+  }
+  if (command == "subsetcheck" && argc == 2) {
+    return checkCalibrationSubset();
+  }
+  if (command == "prefetchcheck" && argc == 2) {
+    return checkBatchPrefetcher();
+  }
+  if (command == "packcheck" && argc == 2) {
+    return checkImagePacking();
+  }
+  if (command == "calibcachecheck" && argc == 2) {
+    return checkCalibrationCache();
+  }
+  if (command == "publishcheck" && argc == 2) {
+    return checkDetectionPublisher();
+  }
+
+  printUsage();
+  return 2;
+}
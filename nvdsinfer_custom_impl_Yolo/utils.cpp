@@ -43,49 +43,6 @@ bool fileExists(const std::string fileName, bool verbose)
   return true;
 }
 
-// 加载权重文件
-std::vector<float> loadWeights(const std::string weightsFilePath)
-{
-  assert(fileExists(weightsFilePath));
-  std::cout << "\nLoading pre-trained weights" << std::endl;
-
-  std::vector<float> weights;
-
-  // 处理 .weights 文件
-  if (weightsFilePath.find(".weights") != std::string::npos) {
-    std::ifstream file(weightsFilePath, std::ios_base::binary);
-    assert(file.good());
-    
-    // 处理不同 YOLO 版本的权重文件
-    if (weightsFilePath.find("yolov2") != std::string::npos &&
-        weightsFilePath.find("yolov2-tiny") == std::string::npos) {
-      file.ignore(4 * 4); // 忽略前 4 个 int32 头部信息
-    }
-    else {
-      file.ignore(4 * 5); // 忽略前 5 个 int32 头部信息
-    }
-
-    char floatWeight[4];
-    while (!file.eof()) {
-      file.read(floatWeight, 4);
-      assert(file.gcount() == 4);
-      weights.push_back(*reinterpret_cast<float*>(floatWeight));
-      if (file.peek() == std::istream::traits_type::eof()) {
-        break;
-      }
-    }
-  }
-  else {
-    std::cerr << "\nFile " << weightsFilePath << " is not supported" << std::endl;
-    assert(0);
-  }
-
-  std::cout << "Loading " << weightsFilePath << " complete" << std::endl;
-  std::cout << "Total weights read: " << weights.size() << std::endl;
-
-  return weights;
-}
-
 // 将 TensorRT 的维度转换为字符串格式
 std::string dimsToString(const nvinfer1::Dims d)
 {
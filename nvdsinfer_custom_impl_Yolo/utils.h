@@ -16,8 +16,6 @@ float clamp(const float val, const float minVal, const float maxVal);
 
 bool fileExists(const std::string fileName, bool verbose = true);
 
-std::vector<float> loadWeights(const std::string weightsFilePath);
-
 std::string dimsToString(const nvinfer1::Dims d);
 
 int getNumChannels(nvinfer1::ITensor* t);
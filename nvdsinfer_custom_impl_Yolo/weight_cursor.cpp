@@ -0,0 +1,79 @@
+#include "weight_cursor.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+static const size_t ARENA_ALIGNMENT = 64;
+
+WeightCursor::WeightCursor(const float* data, uint64_t size) : m_Data(data), m_Size(size), m_Position(0)
+{
+}
+
+const float*
+WeightCursor::take(int64_t count)
+{
+  if (count < 0 || (uint64_t) count > remaining()) {
+    std::cerr << "\nNot enough weights: " << count << " requested at position " << m_Position << ", " << remaining()
+        << " left" << std::endl;
+    assert(0);
+    return nullptr;
+  }
+
+  const float* span = m_Data + m_Position;
+  m_Position += count;
+  return span;
+}
+
+WeightArena::WeightArena(size_t blockSize) : m_BlockSize(blockSize), m_Current(nullptr), m_Left(0), m_Bytes(0)
+{
+}
+
+WeightArena::~WeightArena()
+{
+  clear();
+}
+
+void*
+WeightArena::allocate(size_t bytes)
+{
+  bytes = (bytes + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+  if (bytes == 0) {
+    bytes = ARENA_ALIGNMENT;
+  }
+
+  // 超过块大小的请求单独分配，不浪费当前块的剩余空间
+  if (bytes > m_Left) {
+    size_t blockBytes = bytes > m_BlockSize ? bytes : m_BlockSize;
+    void* block = nullptr;
+    if (posix_memalign(&block, ARENA_ALIGNMENT, blockBytes) != 0) {
+      std::cerr << "\nCould not allocate " << blockBytes << " bytes for weights" << std::endl;
+      assert(0);
+      return nullptr;
+    }
+    m_Blocks.push_back(block);
+    m_Bytes += blockBytes;
+    if (blockBytes > m_BlockSize) {
+      return block;
+    }
+    m_Current = static_cast<char*>(block);
+    m_Left = blockBytes;
+  }
+
+  void* ptr = m_Current;
+  m_Current += bytes;
+  m_Left -= bytes;
+  return ptr;
+}
+
+void
+WeightArena::clear()
+{
+  for (void* block : m_Blocks) {
+    free(block);
+  }
+  m_Blocks.clear();
+  m_Current = nullptr;
+  m_Left = 0;
+  m_Bytes = 0;
+}
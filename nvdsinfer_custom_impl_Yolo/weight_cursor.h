@@ -0,0 +1,54 @@
+#ifndef __WEIGHT_CURSOR_H__
+#define __WEIGHT_CURSOR_H__
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// 按顺序读取权重文件的游标，每次取出一段带越界检查的连续权重（直接指向内存映射，不做拷贝）
+class WeightCursor {
+  public:
+    WeightCursor(const float* data, uint64_t size);
+
+    const float* take(int64_t count);
+
+    uint64_t position() const { return m_Position; }
+
+    uint64_t size() const { return m_Size; }
+
+    uint64_t remaining() const { return m_Size - m_Position; }
+
+  private:
+    const float* m_Data;
+    uint64_t m_Size;
+    uint64_t m_Position;
+};
+
+// 只保存转换后的权重（如融合后的 BN 参数），按块分配、64 字节对齐，TensorRT 构建完成后整体释放
+class WeightArena {
+  public:
+    WeightArena(size_t blockSize = 1 << 20);
+
+    ~WeightArena();
+
+    template <typename T>
+    T* alloc(size_t count) { return static_cast<T*>(allocate(count * sizeof(T))); }
+
+    void clear();
+
+    size_t bytes() const { return m_Bytes; }
+
+  private:
+    WeightArena(const WeightArena&);
+    WeightArena& operator=(const WeightArena&);
+
+    void* allocate(size_t bytes);
+
+    const size_t m_BlockSize;
+    std::vector<void*> m_Blocks;
+    char* m_Current;
+    size_t m_Left;
+    size_t m_Bytes;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "weight_folding.h"
+
+#include <math.h>
+
+void
+batchNormScaleShift(const float* bnBiases, const float* bnWeights, const float* bnRunningMean,
+    const float* bnRunningVar, float eps, int filters, float* scale, float* shift)
+{
+  for (int f = 0; f < filters; ++f) {
+    float runningVar = sqrt(bnRunningVar[f] + eps);
+    scale[f] = bnWeights[f] / runningVar;
+    shift[f] = bnBiases[f] - ((bnRunningMean[f] * bnWeights[f]) / runningVar);
+  }
+}
+
+static void
+foldBias(const float* scale, const float* shift, int filters, const float* bias, float* foldedBias)
+{
+  for (int f = 0; f < filters; ++f) {
+    float b = bias != nullptr ? bias[f] : 0.0f;
+    if (scale != nullptr) {
+      b *= scale[f];
+    }
+    if (shift != nullptr) {
+      b += shift[f];
+    }
+    foldedBias[f] = b;
+  }
+}
+
+void
+foldScaleShiftConv(const float* scale, const float* shift, int filters, int filterVolume, const float* kernel,
+    const float* bias, float* foldedKernel, float* foldedBias)
+{
+  for (int f = 0; f < filters; ++f) {
+    float s = scale != nullptr ? scale[f] : 1.0f;
+    const float* src = kernel + (long) f * filterVolume;
+    float* dst = foldedKernel + (long) f * filterVolume;
+    for (int i = 0; i < filterVolume; ++i) {
+      dst[i] = src[i] * s;
+    }
+  }
+  foldBias(scale, shift, filters, bias, foldedBias);
+}
+
+void
+foldScaleShiftDeconv(const float* scale, const float* shift, int inputChannels, int filters, int groups,
+    int kernelArea, const float* kernel, const float* bias, float* foldedKernel, float* foldedBias)
+{
+  int groupChannels = inputChannels / groups;
+  int groupFilters = filters / groups;
+  for (int c = 0; c < inputChannels; ++c) {
+    int group = c / groupChannels;
+    for (int j = 0; j < groupFilters; ++j) {
+      int f = group * groupFilters + j;
+      float s = scale != nullptr ? scale[f] : 1.0f;
+      long offset = ((long) c * groupFilters + j) * kernelArea;
+      for (int i = 0; i < kernelArea; ++i) {
+        foldedKernel[offset + i] = kernel[offset + i] * s;
+      }
+    }
+  }
+  foldBias(scale, shift, filters, bias, foldedBias);
+}
+
+void
+foldInputShiftConv(const float* shift, int filters, int inputChannels, int groups, int kernelArea,
+    const float* kernel, float* bias)
+{
+  int groupChannels = inputChannels / groups;
+  int groupFilters = filters / groups;
+  for (int f = 0; f < filters; ++f) {
+    int group = f / groupFilters;
+    double sum = 0.0;
+    for (int c = 0; c < groupChannels; ++c) {
+      float a = shift[group * groupChannels + c];
+      const float* k = kernel + ((long) f * groupChannels + c) * kernelArea;
+      for (int i = 0; i < kernelArea; ++i) {
+        sum += k[i] * a;
+      }
+    }
+    bias[f] += sum;
+  }
+}
+
+void
+foldChannelsConv(const std::vector<ChannelFold>& folds, int filters, int inputChannels, int groups,
+    int kernelArea, float* kernel, float* bias)
+{
+  int filterVolume = inputChannels / groups * kernelArea;
+  for (const ChannelFold& fold : folds) {
+    if (fold.op == ChannelFoldOp::kOutputScale) {
+      foldScaleShiftConv(fold.values, nullptr, filters, filterVolume, kernel, bias, kernel, bias);
+    }
+    else if (fold.op == ChannelFoldOp::kOutputShift) {
+      foldScaleShiftConv(nullptr, fold.values, filters, filterVolume, kernel, bias, kernel, bias);
+    }
+  }
+  for (const ChannelFold& fold : folds) {
+    if (fold.op == ChannelFoldOp::kInputShift) {
+      foldInputShiftConv(fold.values, filters, inputChannels, groups, kernelArea, kernel, bias);
+    }
+  }
+}
+
+void
+foldSpaceToDepthConv(const float* kernel, int filters, int channels, int size, float* foldedKernel)
+{
+  int foldedSize = 2 * size;
+  for (int f = 0; f < filters; ++f) {
+    for (int q = 0; q < 4; ++q) {
+      int dy = q / 2;
+      int dx = q % 2;
+      for (int c = 0; c < channels; ++c) {
+        const float* k = kernel + (((long) f * 4 + q) * channels + c) * size * size;
+        float* folded = foldedKernel + ((long) f * channels + c) * foldedSize * foldedSize;
+        for (int ky = 0; ky < size; ++ky) {
+          for (int kx = 0; kx < size; ++kx) {
+            folded[(2 * ky + dy) * foldedSize + 2 * kx + dx] = k[ky * size + kx];
+          }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef __WEIGHT_FOLDING_H__
+#define __WEIGHT_FOLDING_H__
+
+#include <vector>
+
+// 可以融合进卷积的逐通道运算（YOLOR 的 implicit_add/implicit_mul 与 shift_channels/control_channels）
+enum class ChannelFoldOp
+{
+  kInputShift,
+  kOutputScale,
+  kOutputShift
+};
+
+struct ChannelFold
+{
+  ChannelFoldOp op;
+  const float* values;
+};
+
+// 由 Darknet BN 参数计算逐通道的 scale = gamma / sqrt(var + eps) 和 shift = beta - mean * scale
+void batchNormScaleShift(const float* bnBiases, const float* bnWeights, const float* bnRunningMean,
+    const float* bnRunningVar, float eps, int filters, float* scale, float* shift);
+
+// 把输出端的逐通道 y * scale + shift 融合进卷积，卷积核布局为 [filters][C / groups][k][k]；
+// bias、scale、shift 为空时分别按 0、1、0 处理
+void foldScaleShiftConv(const float* scale, const float* shift, int filters, int filterVolume, const float* kernel,
+    const float* bias, float* foldedKernel, float* foldedBias);
+
+// 同上，反卷积核布局为 [C][filters / groups][k][k]
+void foldScaleShiftDeconv(const float* scale, const float* shift, int inputChannels, int filters, int groups,
+    int kernelArea, const float* kernel, const float* bias, float* foldedKernel, float* foldedBias);
+
+// 把输入端的逐通道 x + shift 融合进卷积偏置，仅在卷积没有 padding 时等价
+void foldInputShiftConv(const float* shift, int filters, int inputChannels, int groups, int kernelArea,
+    const float* kernel, float* bias);
+
+// 依次融合输出端的 scale/shift，最后融合输入端的 shift（使用最终的卷积核），kernel 和 bias 原地更新
+void foldChannelsConv(const std::vector<ChannelFold>& folds, int filters, int inputChannels, int groups,
+    int kernelArea, float* kernel, float* bias);
+
+// reorg3d（按 (0,0)、(0,1)、(1,0)、(1,1) 顺序拼接 4 个步长 2 的切片）后的卷积改为直接作用在 reorg3d 的输入上：
+// 卷积核 [filters][4 * channels][k][k] 重排为 [filters][channels][2k][2k]，步长和 padding 同样放大 2 倍
+void foldSpaceToDepthConv(const float* kernel, int filters, int channels, int size, float* foldedKernel);
+
+#endif
@@ -0,0 +1,91 @@
+#include "weight_sparsity.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "network_weights.h"
+
+SparsityStats
+analyzeTwoOfFour(const float* kernel, int filters, int channels, int kernelArea)
+{
+  SparsityStats stats;
+  for (int f = 0; f < filters; ++f) {
+    const float* filter = kernel + (int64_t) f * channels * kernelArea;
+    for (int c = 0; c < channels; c += 4) {
+      for (int k = 0; k < kernelArea; ++k) {
+        int nonzeros = 0;
+        for (int g = c; g < c + 4 && g < channels; ++g) {
+          nonzeros += filter[(int64_t) g * kernelArea + k] != 0.0f;
+        }
+        stats.zeros += std::min(4, channels - c) - nonzeros;
+        stats.compliantGroups += nonzeros <= 2;
+        ++stats.groups;
+      }
+    }
+  }
+  return stats;
+}
+
+int64_t
+pruneTwoOfFour(float* kernel, int filters, int channels, int kernelArea)
+{
+  int64_t pruned = 0;
+  for (int f = 0; f < filters; ++f) {
+    float* filter = kernel + (int64_t) f * channels * kernelArea;
+    for (int c = 0; c < channels; c += 4) {
+      int size = std::min(4, channels - c);
+      for (int k = 0; k < kernelArea; ++k) {
+        float* values[4];
+        for (int g = 0; g < size; ++g) {
+          values[g] = &filter[(int64_t) (c + g) * kernelArea + k];
+        }
+        // 排名（比它大或相同大小但通道号更小的权重个数）不小于 2 的权重置 0
+        for (int g = 0; g < size; ++g) {
+          int rank = 0;
+          for (int other = 0; other < size; ++other) {
+            float a = std::fabs(*values[other]);
+            float b = std::fabs(*values[g]);
+            rank += a > b || (a == b && other < g);
+          }
+          if (rank >= 2 && *values[g] != 0.0f) {
+            *values[g] = 0.0f;
+            ++pruned;
+          }
+        }
+      }
+    }
+  }
+  return pruned;
+}
+
+bool
+canUseTwoOfFour(const NetworkDesc& network, const std::vector<TensorShape>& shapes, int index)
+{
+  const LayerDesc& layer = network.layers[index];
+  if (layer.kind != LayerKind::kConvolutional || layer.dead) {
+    return false;
+  }
+  int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+  int channels = input < 0 ? network.channels : shapes[input].c;
+  if (input >= 0 && network.layers[input].kind == LayerKind::kReorg3d && canFoldSpaceToDepth(network, shapes, input)) {
+    return false;
+  }
+  return channels / layer.groups % 4 == 0 && layer.groups < channels;
+}
+
+std::vector<int64_t>
+convolutionKernelOffsets(const NetworkDesc& network, const std::vector<TensorShape>& shapes)
+{
+  std::vector<int64_t> offsets(network.layers.size(), -1);
+  int64_t offset = 0;
+  for (size_t i = 0; i < network.layers.size(); ++i) {
+    const LayerDesc& layer = network.layers[i];
+    int input = layer.inputs.empty() ? -1 : layer.inputs[0];
+    if (layer.kind == LayerKind::kConvolutional || layer.kind == LayerKind::kDeconvolutional) {
+      // darknet 顺序：BN 参数（4 * filters）、偏置，最后是卷积核
+      offsets[i] = offset + (layer.batchNormalize ? 4 * layer.filters : 0) + (layer.bias ? layer.filters : 0);
+    }
+    offset += layerWeightCount(layer, input < 0 ? network.channels : shapes[input].c);
+  }
+  return offsets;
+}
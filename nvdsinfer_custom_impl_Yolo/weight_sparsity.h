@@ -0,0 +1,34 @@
+#ifndef __WEIGHT_SPARSITY_H__
+#define __WEIGHT_SPARSITY_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "network_ir.h"
+#include "network_shapes.h"
+
+// TensorRT 2:4 结构化稀疏（BuilderFlag::kSPARSE_WEIGHTS）：卷积核 [filters][C / groups][k][k] 中，
+// 每个输出通道、每个卷积核位置上沿输入通道每连续 4 个权重最多 2 个非 0
+struct SparsityStats
+{
+  int64_t groups {0};             // 4 个一组的个数
+  int64_t compliantGroups {0};    // 最多 2 个非 0 的组
+  int64_t zeros {0};
+
+  bool compliant() const { return groups > 0 && compliantGroups == groups; }
+};
+
+SparsityStats analyzeTwoOfFour(const float* kernel, int filters, int channels, int kernelArea);
+
+// 按绝对值在每组中保留最大的 2 个权重，其余置 0（绝对值相同时保留通道号小的），返回被置 0 的非 0 权重个数
+int64_t pruneTwoOfFour(float* kernel, int filters, int channels, int kernelArea);
+
+// 卷积的 2:4 稀疏可以使用 TensorRT 的稀疏实现：不分组或每组输入通道数是 4 的倍数、不是 depthwise，
+// 且输入不是会融合进该卷积的 reorg3d（融合后输入通道的顺序不同）
+bool canUseTwoOfFour(const NetworkDesc& network, const std::vector<TensorShape>& shapes, int index);
+
+// 每层卷积核在 darknet 权重（不含文件头）中的起始位置，非卷积层为 -1
+std::vector<int64_t> convolutionKernelOffsets(const NetworkDesc& network, const std::vector<TensorShape>& shapes);
+
+#endif
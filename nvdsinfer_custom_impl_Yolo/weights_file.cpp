@@ -0,0 +1,142 @@
+#include "weights_file.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "engine_cache.h"
+
+WeightsFile::WeightsFile() : m_Mapping(nullptr), m_MappingSize(0), m_Data(nullptr), m_Size(0), m_Major(0), m_Minor(0),
+    m_Revision(0), m_Seen(0), m_HeaderBytes(0)
+{
+}
+
+WeightsFile::~WeightsFile()
+{
+  close();
+}
+
+// Darknet 文件头：int32 major、minor、revision，之后的 seen 在 0.2 及以后的版本中为 uint64，更早的版本为 uint32
+bool
+WeightsFile::open(const std::string& filePath, bool prefetch)
+{
+  close();
+
+  if (filePath.find(".weights") == std::string::npos) {
+    std::cerr << "\nFile " << filePath << " is not supported" << std::endl;
+    return false;
+  }
+
+  int fd = ::open(filePath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "\nCould not open weights file " << filePath << std::endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < 3 * 4) {
+    std::cerr << "\nInvalid weights file " << filePath << std::endl;
+    ::close(fd);
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "\nCould not map weights file " << filePath << std::endl;
+    return false;
+  }
+
+  if (prefetch) {
+    madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+    madvise(mapping, st.st_size, MADV_WILLNEED);
+  }
+
+  const unsigned char* bytes = static_cast<const unsigned char*>(mapping);
+  int32_t header[3];
+  memcpy(header, bytes, sizeof(header));
+
+  uint64_t headerBytes = sizeof(header);
+  uint64_t seen = 0;
+  if ((header[0] * 10 + header[1]) >= 2 && header[0] < 1000 && header[1] < 1000) {
+    headerBytes += sizeof(uint64_t);
+    if ((uint64_t) st.st_size >= headerBytes) {
+      memcpy(&seen, bytes + sizeof(header), sizeof(uint64_t));
+    }
+  }
+  else {
+    uint32_t seen32 = 0;
+    headerBytes += sizeof(uint32_t);
+    if ((uint64_t) st.st_size >= headerBytes) {
+      memcpy(&seen32, bytes + sizeof(header), sizeof(uint32_t));
+    }
+    seen = seen32;
+  }
+
+  if ((uint64_t) st.st_size < headerBytes || (st.st_size - headerBytes) % sizeof(float) != 0) {
+    std::cerr << "\nInvalid weights file size " << st.st_size << " for header version " << header[0] << "."
+        << header[1] << "." << header[2] << ": " << filePath << std::endl;
+    munmap(mapping, st.st_size);
+    return false;
+  }
+
+  m_Mapping = mapping;
+  m_MappingSize = st.st_size;
+  m_Data = reinterpret_cast<const float*>(bytes + headerBytes);
+  m_Size = (st.st_size - headerBytes) / sizeof(float);
+  m_Major = header[0];
+  m_Minor = header[1];
+  m_Revision = header[2];
+  m_Seen = seen;
+  m_HeaderBytes = headerBytes;
+
+  return true;
+}
+
+void
+WeightsFile::close()
+{
+  if (m_Mapping != nullptr) {
+    munmap(m_Mapping, m_MappingSize);
+  }
+  m_Mapping = nullptr;
+  m_MappingSize = 0;
+  m_Data = nullptr;
+  m_Size = 0;
+  m_Major = 0;
+  m_Minor = 0;
+  m_Revision = 0;
+  m_Seen = 0;
+  m_HeaderBytes = 0;
+}
+
+bool
+writeWeightsFile(const std::string& filePath, int major, int minor, int revision, uint64_t seen, const float* data,
+    uint64_t size, std::string& error)
+{
+  int32_t header[3] = {major, minor, revision};
+  bool wideSeen = (major * 10 + minor) >= 2 && major < 1000 && minor < 1000;
+  uint64_t headerBytes = sizeof(header) + (wideSeen ? sizeof(uint64_t) : sizeof(uint32_t));
+
+  std::vector<char> bytes(headerBytes + size * sizeof(float));
+  memcpy(bytes.data(), header, sizeof(header));
+  if (wideSeen) {
+    memcpy(bytes.data() + sizeof(header), &seen, sizeof(uint64_t));
+  }
+  else {
+    uint32_t seen32 = seen;
+    memcpy(bytes.data() + sizeof(header), &seen32, sizeof(uint32_t));
+  }
+  memcpy(bytes.data() + headerBytes, data, size * sizeof(float));
+
+  if (!writeFileAtomic(filePath, bytes.data(), bytes.size())) {
+    error = "could not write " + filePath;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,55 @@
+#ifndef __WEIGHTS_FILE_H__
+#define __WEIGHTS_FILE_H__
+
+#include <string>
+#include <cstdint>
+
+// 以只读内存映射方式打开 Darknet .weights 文件，各层直接从映射中读取权重，不做拷贝
+class WeightsFile {
+  public:
+    WeightsFile();
+
+    ~WeightsFile();
+
+    // prefetch 为 true 时通过 madvise 提前异步读入，使磁盘 I/O 与 cfg 解析重叠
+    bool open(const std::string& filePath, bool prefetch = true);
+
+    void close();
+
+    bool isOpen() const { return m_Mapping != nullptr; }
+
+    const float* data() const { return m_Data; }
+
+    // 权重数量（float 个数，不含文件头）
+    uint64_t size() const { return m_Size; }
+
+    int major() const { return m_Major; }
+
+    int minor() const { return m_Minor; }
+
+    int revision() const { return m_Revision; }
+
+    uint64_t seen() const { return m_Seen; }
+
+    uint64_t headerBytes() const { return m_HeaderBytes; }
+
+  private:
+    WeightsFile(const WeightsFile&);
+    WeightsFile& operator=(const WeightsFile&);
+
+    void* m_Mapping;
+    uint64_t m_MappingSize;
+    const float* m_Data;
+    uint64_t m_Size;
+    int m_Major;
+    int m_Minor;
+    int m_Revision;
+    uint64_t m_Seen;
+    uint64_t m_HeaderBytes;
+};
+
+// 写出 Darknet .weights 文件，文件头与 WeightsFile::open 读取的格式相同（seen 的宽度由版本号决定）
+bool writeWeightsFile(const std::string& filePath, int major, int minor, int revision, uint64_t seen,
+    const float* data, uint64_t size, std::string& error);
+
+#endif
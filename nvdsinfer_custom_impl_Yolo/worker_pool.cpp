@@ -0,0 +1,120 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+void
+parallelFor(size_t count, int threads, const std::function<void(size_t)>& body)
+{
+  threads = (int) std::min<size_t>(std::max(threads, 1), count);
+  if (threads <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      body(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next++; i < count; i = next++) {
+      body(i);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int t = 1; t < threads; ++t) {
+    workers.push_back(std::thread(worker));
+  }
+  worker();
+  for (std::thread& thread : workers) {
+    thread.join();
+  }
+}
+
+WorkerPool::WorkerPool(int threads) : m_Body(nullptr), m_Count(0), m_Next(0), m_Generation(0), m_Busy(0),
+    m_Stop(false)
+{
+  for (int t = 1; t < threads; ++t) {
+    m_Workers.push_back(std::thread(&WorkerPool::work, this));
+  }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stop = true;
+  }
+  m_Started.notify_all();
+  for (std::thread& thread : m_Workers) {
+    thread.join();
+  }
+}
+
+void
+WorkerPool::run(size_t count, const std::function<void(size_t)>& body)
+{
+  if (m_Workers.empty() || count <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      body(i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Body = &body;
+    m_Count = count;
+    m_Next = 0;
+    m_Busy = m_Workers.size();
+    ++m_Generation;
+  }
+  m_Started.notify_all();
+
+  for (size_t i = m_Next++; i < count; i = m_Next++) {
+    body(i);
+  }
+
+  // 所有工作线程都领取过本次工作后才返回，body 在此之前保持有效
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  m_Finished.wait(lock, [this]() { return m_Busy == 0; });
+  m_Body = nullptr;
+}
+
+void
+WorkerPool::work()
+{
+  uint64_t done = 0;
+  while (true) {
+    const std::function<void(size_t)>* body = nullptr;
+    size_t count = 0;
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_Started.wait(lock, [&]() { return m_Stop || m_Generation != done; });
+      if (m_Stop) {
+        return;
+      }
+      done = m_Generation;
+      body = m_Body;
+      count = m_Count;
+    }
+
+    for (size_t i = m_Next++; i < count; i = m_Next++) {
+      (*body)(i);
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (--m_Busy == 0) {
+      m_Finished.notify_all();
+    }
+  }
+}
+
+int
+weightThreads()
+{
+  if (getenv("WEIGHT_THREADS")) {
+    return std::max(1, atoi(getenv("WEIGHT_THREADS")));
+  }
+  return std::max(1, std::min((int) std::thread::hardware_concurrency(), 8));
+}
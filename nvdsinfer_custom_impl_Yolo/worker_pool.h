@@ -0,0 +1,51 @@
+#ifndef __WORKER_POOL_H__
+#define __WORKER_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 在 threads 个线程（含调用线程）上执行 body(0) ... body(count - 1)，各线程按原子计数领取下标，全部完成后返回；
+// threads <= 1 时在调用线程中按顺序执行。每次调用都新建并回收线程，只用于一次性的工作（权重转换等），
+// 反复执行的工作使用 WorkerPool
+void parallelFor(size_t count, int threads, const std::function<void(size_t)>& body);
+
+// 常驻的工作线程：构造时启动 threads - 1 个线程，run 与 parallelFor 相同，但由这些线程和调用线程执行，
+// 不再每次新建线程。同一时刻只能有一个线程调用 run
+class WorkerPool {
+  public:
+    explicit WorkerPool(int threads);
+
+    ~WorkerPool();
+
+    int threads() const { return (int) m_Workers.size() + 1; }
+
+    void run(size_t count, const std::function<void(size_t)>& body);
+
+  private:
+    WorkerPool(const WorkerPool&);
+    WorkerPool& operator=(const WorkerPool&);
+
+    void work();
+
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_Started;
+    std::condition_variable m_Finished;
+    const std::function<void(size_t)>* m_Body;
+    size_t m_Count;
+    std::atomic<size_t> m_Next;
+    uint64_t m_Generation;        // 每次 run 加一，工作线程据此领取新的工作
+    size_t m_Busy;                // 尚未完成本次工作的工作线程数
+    bool m_Stop;
+};
+
+// 权重转换使用的线程数：WEIGHT_THREADS 环境变量，默认为 CPU 核数（最多 8）
+int weightThreads();
+
+#endif
@@ -1,7 +1,11 @@
 #include "NvOnnxParser.h"
 
+#include <set>
+
 #include "yolo.h"
 #include "yoloPlugins.h"
+#include "batch_profiles.h"
+#include "worker_pool.h"
 
 #ifdef OPENCV
 #include "calibrator.h"
@@ -15,8 +19,10 @@ Yolo::Yolo(const NetworkInfo& networkInfo) : m_InputBlobName(networkInfo.inputBl
     m_DeviceType(networkInfo.deviceType), m_NumDetectedClasses(networkInfo.numDetectedClasses),
     m_ClusterMode(networkInfo.clusterMode), m_NetworkMode(networkInfo.networkMode),
     m_ScaleFactor(networkInfo.scaleFactor), m_Offsets(networkInfo.offsets), m_WorkspaceSize(networkInfo.workspaceSize),
-    m_InputFormat(networkInfo.inputFormat), m_InputC(0), m_InputH(0), m_InputW(0), m_InputSize(0), m_NumClasses(0),
-    m_LetterBox(0), m_NewCoords(0), m_YoloCount(0)
+    m_InputFormat(networkInfo.inputFormat), m_MaintainAspectRatio(networkInfo.maintainAspectRatio),
+    m_SymmetricPadding(networkInfo.symmetricPadding), m_Profiler(networkInfo.profiler), m_InputC(0), m_InputH(0),
+    m_InputW(0), m_InputSize(0), m_NumClasses(0), m_LetterBox(0), m_NewCoords(0), m_YoloCount(0),
+    m_UseModelPack(isModelPack(networkInfo.wtsFilePath))
 {
 }
 
@@ -25,13 +31,79 @@ Yolo::~Yolo()
   destroyNetworkUtils();
 }
 
-nvinfer1::ICudaEngine* 
+nvinfer1::ICudaEngine*
 #if NV_TENSORRT_MAJOR >= 8
 Yolo::createEngine(nvinfer1::IBuilder* builder, nvinfer1::IBuilderConfig* config)
 #else
 Yolo::createEngine(nvinfer1::IBuilder* builder)
+#endif
+{
+#if NV_TENSORRT_MAJOR >= 8
+  nvinfer1::IHostMemory* serializedEngine = createSerializedEngine(builder, config);
+#else
+  nvinfer1::IHostMemory* serializedEngine = createSerializedEngine(builder);
+#endif
+
+  if (serializedEngine == nullptr) {
+    std::cerr << "Building engine failed\n" << std::endl;
+    return nullptr;
+  }
+
+#if NV_TENSORRT_MAJOR > 8 || (NV_TENSORRT_MAJOR == 8 && NV_TENSORRT_MINOR > 0)
+  nvinfer1::IRuntime* runtime = nvinfer1::createInferRuntime(*builder->getLogger());
+#else
+  nvinfer1::IRuntime* runtime = nvinfer1::createInferRuntime(logger);
+#endif
+
+  assert(runtime);
+
+  nvinfer1::ICudaEngine* engine;
+  {
+    ScopedPhase phase(m_Profiler, "deserializeCudaEngine");
+    engine = runtime->deserializeCudaEngine(serializedEngine->data(), serializedEngine->size());
+  }
+  if (engine) {
+    std::cout << "Building complete\n" << std::endl;
+  }
+  else {
+    std::cerr << "Building engine failed\n" << std::endl;
+  }
+
+#if NV_TENSORRT_MAJOR >= 8
+  delete serializedEngine;
+#else
+  serializedEngine->destroy();
+#endif
+
+#ifdef GRAPH
+  nvinfer1::IExecutionContext *context = engine->createExecutionContext();
+  nvinfer1::IEngineInspector *inpector = engine->createEngineInspector();
+  inpector->setExecutionContext(context);
+  std::ofstream graph;
+  graph.open("graph.json");
+  graph << inpector->getEngineInformation(nvinfer1::LayerInformationFormat::kJSON);
+  graph.close();
+  std::cout << "Network graph saved to graph.json\n" << std::endl;
+
+#if NV_TENSORRT_MAJOR >= 8
+  delete inpector;
+  delete context;
+#else
+  inpector->destroy();
+  context->destroy();
+#endif
+
 #endif
 
+  return engine;
+}
+
+nvinfer1::IHostMemory*
+#if NV_TENSORRT_MAJOR >= 8
+Yolo::createSerializedEngine(nvinfer1::IBuilder* builder, nvinfer1::IBuilderConfig* config)
+#else
+Yolo::createSerializedEngine(nvinfer1::IBuilder* builder)
+#endif
 {
   assert(builder);
 
@@ -58,7 +130,12 @@ Yolo::createEngine(nvinfer1::IBuilder* builder)
     parser = nvonnxparser::createParser(*network, logger);
 #endif
 
-    if (!parser->parseFromFile(m_OnnxFilePath.c_str(), static_cast<INT>(nvinfer1::ILogger::Severity::kWARNING))) {
+    bool parsed;
+    {
+      ScopedPhase phase(m_Profiler, "parseOnnxFile");
+      parsed = parser->parseFromFile(m_OnnxFilePath.c_str(), static_cast<INT>(nvinfer1::ILogger::Severity::kWARNING));
+    }
+    if (!parsed) {
       std::cerr << "\nCould not parse the ONNX file\n" << std::endl;
 
 #if NV_TENSORRT_MAJOR >= 8
@@ -77,9 +154,28 @@ Yolo::createEngine(nvinfer1::IBuilder* builder)
     m_InputW = network->getInput(0)->getDimensions().d[3];
   }
   else {
-    m_ConfigBlocks = parseConfigFile(m_CfgFilePath);
-    parseConfigBlocks();
-    if (parseModel(*network) != NVDSINFER_SUCCESS) {
+    NvDsInferStatus loadStatus;
+    if (m_UseModelPack) {
+      // 模型包中已是解析好的网络描述和转换好的权重，不需要 cfg
+      ScopedPhase phase(m_Profiler, "loadModelPack");
+      loadStatus = loadModelPack();
+    }
+    else {
+      // 先映射权重文件并异步预读，磁盘 I/O 与 cfg 解析重叠进行
+      bool weightsLoaded;
+      {
+        ScopedPhase phase(m_Profiler, "loadWeights");
+        weightsLoaded = loadWeights();
+      }
+      {
+        ScopedPhase phase(m_Profiler, "parseConfigFile");
+        loadStatus = parseConfigFile();
+      }
+      if (!weightsLoaded) {
+        loadStatus = NVDSINFER_CUSTOM_LIB_FAILED;
+      }
+    }
+    if (loadStatus != NVDSINFER_SUCCESS || parseModel(*network) != NVDSINFER_SUCCESS) {
 
 #if NV_TENSORRT_MAJOR >= 8
       delete network;
@@ -93,20 +189,24 @@ Yolo::createEngine(nvinfer1::IBuilder* builder)
   }
 
   if ((m_NetworkType == "darknet" && !m_ImplicitBatch) || network->getInput(0)->getDimensions().d[0] == -1) {
+    BatchProfile batchProfile = planBatchProfile(getenv("BATCH_OPT") ? getenv("BATCH_OPT") : "", m_BatchSize);
     nvinfer1::IOptimizationProfile* profile = builder->createOptimizationProfile();
     assert(profile);
     for (INT i = 0; i < network->getNbInputs(); ++i) {
       nvinfer1::ITensor* input = network->getInput(i);
       nvinfer1::Dims inputDims = input->getDimensions();
       nvinfer1::Dims dims = inputDims;
-      dims.d[0] = 1;
+      dims.d[0] = batchProfile.min;
       profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kMIN, dims);
-      dims.d[0] = m_BatchSize;
+      dims.d[0] = batchProfile.opt;
       profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kOPT, dims);
-      dims.d[0] = m_BatchSize;
+      dims.d[0] = batchProfile.max;
       profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kMAX, dims);
     }
     config->addOptimizationProfile(profile);
+    if (batchProfile.opt != batchProfile.max) {
+      std::cout << "\nOptimization profile: " << batchProfileToString(batchProfile) << std::endl;
+    }
   }
 
   std::cout << "\nBuilding the TensorRT Engine\n" << std::endl;
@@ -133,7 +233,7 @@ Yolo::createEngine(nvinfer1::IBuilder* builder)
   else if (m_NetworkMode == "INT8") {
     assert(builder->platformHasFastInt8());
     config->setFlag(nvinfer1::BuilderFlag::kINT8);
-    if (m_Int8CalibPath != "") {
+    if (m_Int8CalibPath != "" && !useExplicitInt8()) {
 
 #ifdef OPENCV
       fileExists(m_Int8CalibPath);
@@ -154,8 +254,21 @@ Yolo::createEngine(nvinfer1::IBuilder* builder)
         std::cerr << "INT8_CALIB_BATCH_SIZE not set" << std::endl;
         assert(0);
       }
+      // darknet 层输出按 cfg 块命名之前生成的校准表与网络对应不上，TensorRT 会让大部分层退回高精度，重新校准并覆盖该表
+      bool readCalibTable = true;
+      std::map<std::string, float> tableScales;
+      std::string tableError;
+      if (m_NetworkType != "onnx" && loadActivationScales(m_Int8CalibPath, tableScales, tableError) &&
+          hasUnnamedTensors(tableScales)) {
+        std::cout << "INT8 calibration table " << m_Int8CalibPath << " uses unnamed tensors from an older build, "
+            "recalibrating" << std::endl;
+        readCalibTable = false;
+      }
+
+      // 校准图片按 config_infer 的 maintain-aspect-ratio/symmetric-padding 缩放，与推理时的输入一致
       nvinfer1::IInt8EntropyCalibrator2* calibrator = new Int8EntropyCalibrator2(calib_batch_size, m_InputC, m_InputH,
-          m_InputW, m_ScaleFactor, m_Offsets, m_InputFormat, calib_image_list, m_Int8CalibPath);
+          m_InputW, m_ScaleFactor, m_Offsets, m_InputFormat, m_MaintainAspectRatio, m_SymmetricPadding,
+          calib_image_list, m_Int8CalibPath, readCalibTable);
       config->setInt8Calibrator(calibrator);
 #else
       assert(0 && "OpenCV is required to run INT8 calibrator\n");
@@ -164,53 +277,26 @@ Yolo::createEngine(nvinfer1::IBuilder* builder)
     }
   }
 
-#ifdef GRAPH
-  config->setProfilingVerbosity(nvinfer1::ProfilingVerbosity::kDETAILED);
-#endif
-
-#if NV_TENSORRT_MAJOR > 8 || (NV_TENSORRT_MAJOR == 8 && NV_TENSORRT_MINOR > 0)
-  nvinfer1::IRuntime* runtime = nvinfer1::createInferRuntime(*builder->getLogger());
-#else
-  nvinfer1::IRuntime* runtime = nvinfer1::createInferRuntime(logger);
-#endif
-
-  assert(runtime);
-
-  nvinfer1::IHostMemory* serializedEngine = builder->buildSerializedNetwork(*network, *config);
-
-  nvinfer1::ICudaEngine* engine = runtime->deserializeCudaEngine(serializedEngine->data(), serializedEngine->size());
-  if (engine) {
-    std::cout << "Building complete\n" << std::endl;
-  }
-  else {
-    std::cerr << "Building engine failed\n" << std::endl;
-  }
-
 #if NV_TENSORRT_MAJOR >= 8
-  delete serializedEngine;
-#else
-  serializedEngine->destroy();
+  // SPARSE_WEIGHTS=1 时允许 TensorRT 对满足 2:4 稀疏的卷积选用稀疏实现（Ampere 及以后的 GPU），
+  // darknet 权重可以用 yolo_tool sparsity 检查和剪枝
+  if (getenv("SPARSE_WEIGHTS") && std::string(getenv("SPARSE_WEIGHTS")) == "1") {
+    config->setFlag(nvinfer1::BuilderFlag::kSPARSE_WEIGHTS);
+  }
 #endif
 
 #ifdef GRAPH
-  nvinfer1::IExecutionContext *context = engine->createExecutionContext();
-  nvinfer1::IEngineInspector *inpector = engine->createEngineInspector();
-  inpector->setExecutionContext(context);
-  std::ofstream graph;
-  graph.open("graph.json");
-  graph << inpector->getEngineInformation(nvinfer1::LayerInformationFormat::kJSON);
-  graph.close();
-  std::cout << "Network graph saved to graph.json\n" << std::endl;
-
-#if NV_TENSORRT_MAJOR >= 8
-  delete inpector;
-  delete context;
-#else
-  inpector->destroy();
-  context->destroy();
+  config->setProfilingVerbosity(nvinfer1::ProfilingVerbosity::kDETAILED);
 #endif
 
-#endif
+  nvinfer1::IHostMemory* serializedEngine;
+  {
+    ScopedPhase phase(m_Profiler, "buildSerializedNetwork");
+    serializedEngine = builder->buildSerializedNetwork(*network, *config);
+  }
+
+  // 构建完成后 TensorRT 不再引用主机端权重，立即释放权重映射和转换后的权重
+  destroyNetworkUtils();
 
 #if NV_TENSORRT_MAJOR >= 8
   if (m_NetworkType == "onnx") {
@@ -225,16 +311,55 @@ Yolo::createEngine(nvinfer1::IBuilder* builder)
   network->destroy();
 #endif
 
-  return engine;
+  return serializedEngine;
 }
 
 NvDsInferStatus
 Yolo::parseModel(nvinfer1::INetworkDefinition& network) {
-  destroyNetworkUtils();
+  if (m_UseModelPack) {
+    if (!m_Pack.isOpen()) {
+      ScopedPhase phase(m_Profiler, "loadModelPack");
+      NvDsInferStatus status = loadModelPack();
+      if (status != NVDSINFER_SUCCESS) {
+        return status;
+      }
+    }
+  }
+  else {
+    if (!m_Weights.isOpen()) {
+      ScopedPhase phase(m_Profiler, "loadWeights");
+      if (!loadWeights()) {
+        return NVDSINFER_CUSTOM_LIB_FAILED;
+      }
+    }
+
+    if (m_Network.layers.empty()) {
+      ScopedPhase phase(m_Profiler, "parseConfigFile");
+      NvDsInferStatus status = parseConfigFile();
+      if (status != NVDSINFER_SUCCESS) {
+        return status;
+      }
+    }
+
+    ScopedPhase phase(m_Profiler, "prepareWeights");
+    NvDsInferStatus status = prepareWeights();
+    if (status != NVDSINFER_SUCCESS) {
+      return status;
+    }
+  }
+
+  // WEIGHTS_FP16=1 时 FP16 引擎的卷积权重在主机端转换为 FP16，转换后释放 float 权重
+  if (m_NetworkMode == "FP16" && getenv("WEIGHTS_FP16") && std::string(getenv("WEIGHTS_FP16")) == "1") {
+    ScopedPhase phase(m_Profiler, "convertWeights");
+    convertWeightsToHalf();
+  }
 
-  std::vector<float> weights = loadWeights(m_WtsFilePath);
   std::cout << "Building YOLO network\n" << std::endl;
-  NvDsInferStatus status = buildYoloNetwork(weights, network);
+  NvDsInferStatus status;
+  {
+    ScopedPhase phase(m_Profiler, "buildYoloNetwork");
+    status = buildYoloNetwork(network);
+  }
 
   if (status == NVDSINFER_SUCCESS) {
     std::cout << "Building YOLO network complete" << std::endl;
@@ -246,11 +371,93 @@ Yolo::parseModel(nvinfer1::INetworkDefinition& network) {
   return status;
 }
 
+bool
+Yolo::loadWeights()
+{
+  std::cout << "\nLoading pre-trained weights" << std::endl;
+
+  if (!fileExists(m_WtsFilePath) || !m_Weights.open(m_WtsFilePath)) {
+    return false;
+  }
+
+  std::cout << "Loading " << m_WtsFilePath << " complete" << std::endl;
+  std::cout << "Weights header version: " << m_Weights.major() << "." << m_Weights.minor() << "." <<
+      m_Weights.revision() << ", seen: " << m_Weights.seen() << std::endl;
+  std::cout << "Total weights read: " << m_Weights.size() << std::endl;
+
+  return true;
+}
+
+NvDsInferStatus
+Yolo::loadModelPack()
+{
+  std::cout << "\nLoading model pack" << std::endl;
+
+  std::string error;
+  if (!m_Pack.open(m_WtsFilePath, error)) {
+    std::cerr << "\nCould not load the model pack: " << error << std::endl;
+    return NVDSINFER_CUSTOM_LIB_FAILED;
+  }
+
+  m_Network = m_Pack.network();
+  m_LayerWeights = m_Pack.layerWeights();
+  if (pruneOutputHeads() != NVDSINFER_SUCCESS) {
+    m_Pack.close();
+    return NVDSINFER_CONFIG_FAILED;
+  }
+  applyNetworkDesc();
+
+  std::cout << "Loading " << m_WtsFilePath << " complete" << std::endl;
+  std::cout << "Total weights read: " << m_Pack.weightsBytes() / sizeof(float) << std::endl;
+
+  return NVDSINFER_SUCCESS;
+}
+
 NvDsInferStatus
-Yolo::buildYoloNetwork(std::vector<float>& weights, nvinfer1::INetworkDefinition& network)
+Yolo::prepareWeights()
+{
+  m_Arena.clear();
+
+  std::string error;
+  WeightCursor weights(m_Weights.data(), m_Weights.size());
+  if (!prepareNetworkWeights(m_Network, weights, m_Arena, m_LayerWeights, error, weightThreads())) {
+    std::cerr << "\nCould not prepare the weights: " << error << std::endl;
+    return NVDSINFER_CUSTOM_LIB_FAILED;
+  }
+
+  return NVDSINFER_SUCCESS;
+}
+
+void
+Yolo::convertWeightsToHalf()
 {
-  int weightPtr = 0;
+  m_HalfArena.clear();
+  ::convertWeightsToHalf(m_Network, m_LayerWeights, m_HalfArena, weightThreads());
+
+  // m_LayerWeights 只引用 m_HalfArena，再次构建时 parseModel 会重新加载权重文件或模型包
+  m_Arena.clear();
+  m_Weights.close();
+  m_Pack.close();
 
+  std::cout << "Converted weights to FP16, " << m_HalfArena.bytes() / 1024 << " KiB" << std::endl;
+}
+
+// 卷积核数量必须与 TensorRT 中的实际输入通道一致（模型包中的权重按打包时的 cfg 推算）
+static bool
+checkKernelWeights(int index, const LayerDesc& layer, const LayerWeights& weights, int channels)
+{
+  int64_t expected = (int64_t) layer.filters * channels * layer.size * layer.size / layer.groups;
+  if (weights.kernelCount != expected) {
+    std::cerr << "\nLayer " << index << " has " << weights.kernelCount << " kernel weights, expected " << expected <<
+        std::endl;
+    return false;
+  }
+  return true;
+}
+
+NvDsInferStatus
+Yolo::buildYoloNetwork(nvinfer1::INetworkDefinition& network)
+{
   uint batchSize = m_ImplicitBatch ? m_BatchSize : -1;
 
   nvinfer1::ITensor* data = network.addInput(m_InputBlobName.c_str(), nvinfer1::DataType::kFLOAT,
@@ -260,190 +467,260 @@ Yolo::buildYoloNetwork(std::vector<float>& weights, nvinfer1::INetworkDefinition
 
   nvinfer1::ITensor* previous = data;
   std::vector<nvinfer1::ITensor*> tensorOutputs;
+  tensorOutputs.reserve(m_Network.layers.size());
 
-  nvinfer1::ITensor* yoloTensorInputs[m_YoloCount];
+  std::vector<nvinfer1::ITensor*> yoloTensorInputs;
   uint yoloCountInputs = 0;
 
-  for (uint i = 0; i < m_ConfigBlocks.size(); ++i) {
-    std::string layerIndex = "(" + std::to_string(tensorOutputs.size()) + ")";
-
-    if (m_ConfigBlocks.at(i).at("type") == "net")
-        printLayerInfo("", "Layer", "Input Shape", "Output Shape", "WeightPtr");
-    else if (m_ConfigBlocks.at(i).at("type") == "conv" || m_ConfigBlocks.at(i).at("type") == "convolutional") {
-      int channels = getNumChannels(previous);
-      std::string inputVol = dimsToString(previous->getDimensions());
-      previous = convolutionalLayer(i, m_ConfigBlocks.at(i), weights, m_TrtWeights, weightPtr, channels, previous,
-          &network);
-      assert(previous != nullptr);
-      std::string outputVol = dimsToString(previous->getDimensions());
-      tensorOutputs.push_back(previous);
-      std::string layerName = "conv_" + m_ConfigBlocks.at(i).at("activation");
-      printLayerInfo(layerIndex, layerName, inputVol, outputVol, std::to_string(weightPtr));
+  uint64_t weightPtr = 0;
+
+  // INT8_QDQ=1 时卷积输入和卷积核前插入显式 Q/DQ：激活 scale 来自 int8-calib-file，卷积核按输出通道对称量化
+  std::map<std::string, float> activationScales;
+  std::map<nvinfer1::ITensor*, nvinfer1::ITensor*> quantizedInputs;
+  std::set<nvinfer1::ITensor*> namedTensors;
+  int unquantized = 0;
+  if (useExplicitInt8()) {
+    std::string error;
+    if (!loadActivationScales(m_Int8CalibPath, activationScales, error)) {
+      std::cerr << "\nCould not load the INT8 activation scales: " << error << std::endl;
+      return NVDSINFER_CONFIG_FAILED;
     }
-    else if (m_ConfigBlocks.at(i).at("type") == "deconv" || m_ConfigBlocks.at(i).at("type") == "deconvolutional") {
-      int channels = getNumChannels(previous);
-      std::string inputVol = dimsToString(previous->getDimensions());
-      previous = deconvolutionalLayer(i, m_ConfigBlocks.at(i), weights, m_TrtWeights, weightPtr, channels, previous,
-          &network);
-      assert(previous != nullptr);
-      std::string outputVol = dimsToString(previous->getDimensions());
-      tensorOutputs.push_back(previous);
-      std::string layerName = "deconv";
-      printLayerInfo(layerIndex, layerName, inputVol, outputVol, std::to_string(weightPtr));
+    if (hasUnnamedTensors(activationScales)) {
+      std::cerr << "\n" << m_Int8CalibPath << " uses unnamed tensors from an older build, the layers are now named "
+          "<type>_<index>; recalibrate without INT8_QDQ to regenerate it" << std::endl;
+      return NVDSINFER_CONFIG_FAILED;
     }
-    else if (m_ConfigBlocks.at(i).at("type") == "batchnorm") {
-      std::string inputVol = dimsToString(previous->getDimensions());
-      previous = batchnormLayer(i, m_ConfigBlocks.at(i), weights, m_TrtWeights, weightPtr, previous, &network);
-      assert(previous != nullptr);
-      std::string outputVol = dimsToString(previous->getDimensions());
-      tensorOutputs.push_back(previous);
-      std::string layerName = "batchnorm_" + m_ConfigBlocks.at(i).at("activation");
-      printLayerInfo(layerIndex, layerName, inputVol, outputVol, std::to_string(weightPtr));
+  }
+
+  printLayerInfo("", "Layer", "Input Shape", "Output Shape", "WeightPtr");
+
+  for (uint i = 0; i < m_Network.layers.size(); ++i) {
+    const LayerDesc& layer = m_Network.layers[i];
+    // TensorRT 层名沿用 cfg 块序号（[net] 为 0）
+    int layerIdx = i + 1;
+    std::string layerIndex = "(" + std::to_string(i) + ")";
+    const LayerWeights& weights = m_LayerWeights.at(i);
+    weightPtr += weights.kernelCount + weights.biasCount;
+
+    // 图优化删除的层：不影响输出的层不构建，恒等或重复的层直接复用已有的输出
+    if (layer.dead) {
+      tensorOutputs.push_back(nullptr);
+      printLayerInfo(layerIndex, layer.type + " (unused)", "-", "-", "-");
+      continue;
     }
-    else if (m_ConfigBlocks.at(i).at("type") == "implicit" || m_ConfigBlocks.at(i).at("type") == "implicit_add" ||
-        m_ConfigBlocks.at(i).at("type") == "implicit_mul") {
-      previous = implicitLayer(i, m_ConfigBlocks.at(i), weights, m_TrtWeights, weightPtr, &network);
-      assert(previous != nullptr);
-      std::string outputVol = dimsToString(previous->getDimensions());
+    if (layer.aliasOf >= 0) {
+      previous = tensorOutputs[layer.aliasOf];
       tensorOutputs.push_back(previous);
-      std::string layerName = "implicit";
-      printLayerInfo(layerIndex, layerName, "-", outputVol, std::to_string(weightPtr));
-    }
-    else if (m_ConfigBlocks.at(i).at("type") == "shift_channels" ||
-        m_ConfigBlocks.at(i).at("type") == "control_channels") {
-      assert(m_ConfigBlocks.at(i).find("from") != m_ConfigBlocks.at(i).end());
-      int from = stoi(m_ConfigBlocks.at(i).at("from"));
-      if (from > 0) {
-        from = from - i + 1;
-      }
-      assert((i - 2 >= 0) && (i - 2 < tensorOutputs.size()));
-      assert((i + from - 1 >= 0) && (i + from - 1 < tensorOutputs.size()));
-      assert(i + from - 1 < i - 2);
-
-      std::string inputVol = dimsToString(previous->getDimensions());
-      previous = channelsLayer(i, m_ConfigBlocks.at(i), previous, tensorOutputs[i + from - 1], &network);
-      assert(previous != nullptr);
       std::string outputVol = dimsToString(previous->getDimensions());
-      tensorOutputs.push_back(previous);
-      std::string layerName = m_ConfigBlocks.at(i).at("type") + ": " + std::to_string(i + from - 1);
-      printLayerInfo(layerIndex, layerName, inputVol, outputVol, "-");
+      printLayerInfo(layerIndex, layer.type + " (= " + std::to_string(layer.aliasOf) + ")", "-", outputVol, "-");
+      continue;
     }
-    else if (m_ConfigBlocks.at(i).at("type") == "shortcut") {
-      assert(m_ConfigBlocks.at(i).find("from") != m_ConfigBlocks.at(i).end());
-      int from = stoi(m_ConfigBlocks.at(i).at("from"));
-      if (from > 0) {
-        from = from - i + 1;
-      }
-      assert((i - 2 >= 0) && (i - 2 < tensorOutputs.size()));
-      assert((i + from - 1 >= 0) && (i + from - 1 < tensorOutputs.size()));
-      assert(i + from - 1 < i - 2);
 
-      std::string activation = "linear";
-      if (m_ConfigBlocks.at(i).find("activation") != m_ConfigBlocks.at(i).end()) {
-        activation = m_ConfigBlocks.at(i).at("activation");
+    switch (layer.kind) {
+      case LayerKind::kConvolutional: {
+        // 融合了前一层 reorg3d 时 previous 仍是 reorg3d 的输入
+        LayerDesc conv = effectiveConvolution(m_Network, i);
+        if (!checkKernelWeights(i, conv, weights, getNumChannels(previous))) {
+          return NVDSINFER_CONFIG_FAILED;
+        }
+        std::string inputVol = dimsToString(previous->getDimensions());
+        nvinfer1::ITensor* input = previous;
+        nvinfer1::ITensor* kernel = nullptr;
+#if NV_TENSORRT_MAJOR >= 8
+        auto scale = activationScales.find(previous->getName());
+        if (scale != activationScales.end()) {
+          // 同一个张量被多个卷积使用时共用一组 Q/DQ；scale 在构建完成前都需要有效，分配在 m_Arena 中
+          if (quantizedInputs.count(previous) == 0) {
+            float* value = m_Arena.alloc<float>(1);
+            *value = scale->second;
+            quantizedInputs[previous] = quantizeActivationLayer(layerIdx, previous, value, &network);
+          }
+          input = quantizedInputs[previous];
+          float* scales = m_Arena.alloc<float>(conv.filters);
+          perChannelWeightScales(weights.kernel, conv.filters, weights.kernelCount / conv.filters, scales);
+          kernel = quantizedKernelLayer(layerIdx, conv, weights, getNumChannels(previous), scales, &network);
+        }
+        else if (!activationScales.empty()) {
+          ++unquantized;
+        }
+#endif
+        previous = convolutionalLayer(layerIdx, conv, weights, input, &network, "", kernel);
+        assert(previous != nullptr);
+        std::string outputVol = dimsToString(previous->getDimensions());
+        tensorOutputs.push_back(previous);
+        std::string layerName = "conv_" + layer.activationName;
+        printLayerInfo(layerIndex, layerName, inputVol, outputVol, std::to_string(weightPtr));
+        break;
       }
-
-      std::string inputVol = dimsToString(previous->getDimensions());
-      std::string shortcutVol = dimsToString(tensorOutputs[i + from - 1]->getDimensions());
-      previous = shortcutLayer(i, activation, inputVol, shortcutVol, m_ConfigBlocks.at(i), previous,
-          tensorOutputs[i + from - 1], &network);
-      assert(previous != nullptr);
-      std::string outputVol = dimsToString(previous->getDimensions());
-      tensorOutputs.push_back(previous);
-      std::string layerName = "shortcut_" + activation + ": " + std::to_string(i + from - 1);
-      printLayerInfo(layerIndex, layerName, inputVol, outputVol, "-");
-
-      if (inputVol != shortcutVol) {
-        std::cout << inputVol << " +" << shortcutVol << std::endl;
+      case LayerKind::kDeconvolutional: {
+        if (!checkKernelWeights(i, layer, weights, getNumChannels(previous))) {
+          return NVDSINFER_CONFIG_FAILED;
+        }
+        std::string inputVol = dimsToString(previous->getDimensions());
+        previous = deconvolutionalLayer(layerIdx, layer, weights, previous, &network);
+        assert(previous != nullptr);
+        std::string outputVol = dimsToString(previous->getDimensions());
+        tensorOutputs.push_back(previous);
+        std::string layerName = "deconv";
+        printLayerInfo(layerIndex, layerName, inputVol, outputVol, std::to_string(weightPtr));
+        break;
       }
-    }
-    else if (m_ConfigBlocks.at(i).at("type") == "sam") {
-      assert(m_ConfigBlocks.at(i).find("from") != m_ConfigBlocks.at(i).end());
-      int from = stoi(m_ConfigBlocks.at(i).at("from"));
-      if (from > 0) {
-        from = from - i + 1;
+      case LayerKind::kBatchnorm: {
+        std::string inputVol = dimsToString(previous->getDimensions());
+        previous = batchnormLayer(layerIdx, layer, weights, previous, &network);
+        assert(previous != nullptr);
+        std::string outputVol = dimsToString(previous->getDimensions());
+        tensorOutputs.push_back(previous);
+        std::string layerName = "batchnorm_" + layer.activationName;
+        if (layer.foldedInto >= 0) {
+          layerName += " (folded into " + std::to_string(layer.foldedInto) + ")";
+        }
+        printLayerInfo(layerIndex, layerName, inputVol, outputVol, std::to_string(weightPtr));
+        break;
       }
-      assert((i - 2 >= 0) && (i - 2 < tensorOutputs.size()));
-      assert((i + from - 1 >= 0) && (i + from - 1 < tensorOutputs.size()));
-      assert(i + from - 1 < i - 2);
-
-      std::string activation = "linear";
-      if (m_ConfigBlocks.at(i).find("activation") != m_ConfigBlocks.at(i).end()) {
-        activation = m_ConfigBlocks.at(i).at("activation");
+      case LayerKind::kImplicit: {
+        if (layer.foldedInto >= 0) {
+          // 所有使用者都已融合进卷积，不再需要常量层
+          tensorOutputs.push_back(previous);
+          printLayerInfo(layerIndex, "implicit (folded)", "-", "-", std::to_string(weightPtr));
+        }
+        else {
+          previous = implicitLayer(layerIdx, layer, weights.kernel, &network);
+          assert(previous != nullptr);
+          std::string outputVol = dimsToString(previous->getDimensions());
+          tensorOutputs.push_back(previous);
+          std::string layerName = "implicit";
+          printLayerInfo(layerIndex, layerName, "-", outputVol, std::to_string(weightPtr));
+        }
+        break;
+      }
+      case LayerKind::kShiftChannels:
+      case LayerKind::kControlChannels: {
+        int from = layer.inputs[1];
+        std::string inputVol = dimsToString(previous->getDimensions());
+        std::string layerName = layer.type + ": " + std::to_string(from);
+        if (layer.foldedInto >= 0) {
+          // 已融合进卷积（输出端融合时 previous 即为融合后的卷积输出，输入端融合时由下一层卷积处理）
+          tensorOutputs.push_back(previous);
+          layerName += " (folded into " + std::to_string(layer.foldedInto) + ")";
+          printLayerInfo(layerIndex, layerName, inputVol, inputVol, "-");
+        }
+        else {
+          previous = channelsLayer(layerIdx, layer, previous, tensorOutputs[from], &network);
+          assert(previous != nullptr);
+          std::string outputVol = dimsToString(previous->getDimensions());
+          tensorOutputs.push_back(previous);
+          printLayerInfo(layerIndex, layerName, inputVol, outputVol, "-");
+        }
+        break;
+      }
+      case LayerKind::kShortcut: {
+        int from = layer.inputs[1];
+        std::string inputVol = dimsToString(previous->getDimensions());
+        std::string shortcutVol = dimsToString(tensorOutputs[from]->getDimensions());
+        previous = shortcutLayer(layerIdx, layer, inputVol, shortcutVol, previous, tensorOutputs[from], &network);
+        assert(previous != nullptr);
+        std::string outputVol = dimsToString(previous->getDimensions());
+        tensorOutputs.push_back(previous);
+        std::string layerName = "shortcut_" + layer.activationName + ": " + std::to_string(from);
+        printLayerInfo(layerIndex, layerName, inputVol, outputVol, "-");
+
+        if (inputVol != shortcutVol) {
+          std::cout << inputVol << " +" << shortcutVol << std::endl;
+        }
+        break;
+      }
+      case LayerKind::kSam: {
+        int from = layer.inputs[1];
+        std::string inputVol = dimsToString(previous->getDimensions());
+        previous = samLayer(layerIdx, layer, previous, tensorOutputs[from], &network);
+        assert(previous != nullptr);
+        std::string outputVol = dimsToString(previous->getDimensions());
+        tensorOutputs.push_back(previous);
+        std::string layerName = "sam_" + layer.activationName + ": " + std::to_string(from);
+        printLayerInfo(layerIndex, layerName, inputVol, outputVol, "-");
+        break;
+      }
+      case LayerKind::kRoute: {
+        std::string layers;
+        previous = routeLayer(layerIdx, layers, layer, tensorOutputs, &network);
+        assert(previous != nullptr);
+        std::string outputVol = dimsToString(previous->getDimensions());
+        tensorOutputs.push_back(previous);
+        std::string layerName = "route: " + layers;
+        printLayerInfo(layerIndex, layerName, "-", outputVol, "-");
+        break;
+      }
+      case LayerKind::kUpsample: {
+        std::string inputVol = dimsToString(previous->getDimensions());
+        previous = upsampleLayer(layerIdx, layer, previous, &network);
+        assert(previous != nullptr);
+        std::string outputVol = dimsToString(previous->getDimensions());
+        tensorOutputs.push_back(previous);
+        std::string layerName = "upsample";
+        printLayerInfo(layerIndex, layerName, inputVol, outputVol, "-");
+        break;
+      }
+      case LayerKind::kMaxpool:
+      case LayerKind::kAvgpool: {
+        std::string inputVol = dimsToString(previous->getDimensions());
+        previous = poolingLayer(layerIdx, layer, previous, &network);
+        assert(previous != nullptr);
+        std::string outputVol = dimsToString(previous->getDimensions());
+        tensorOutputs.push_back(previous);
+        printLayerInfo(layerIndex, layer.type, inputVol, outputVol, "-");
+        break;
+      }
+      case LayerKind::kReorg:
+      case LayerKind::kReorg3d: {
+        std::string inputVol = dimsToString(previous->getDimensions());
+        if (layer.foldedInto >= 0) {
+          tensorOutputs.push_back(previous);
+          printLayerInfo(layerIndex, layer.type + " (folded into " + std::to_string(layer.foldedInto) + ")", inputVol,
+              "-", "-");
+          break;
+        }
+        previous = reorgLayer(layerIdx, layer, previous, &network);
+        assert(previous != nullptr);
+        std::string outputVol = dimsToString(previous->getDimensions());
+        tensorOutputs.push_back(previous);
+        printLayerInfo(layerIndex, layer.type, inputVol, outputVol, "-");
+        break;
+      }
+      case LayerKind::kYolo:
+      case LayerKind::kRegion: {
+        std::string blobName = layer.type + "_" + std::to_string(layerIdx);
+        nvinfer1::Dims prevTensorDims = previous->getDimensions();
+        TensorInfo& curYoloTensor = m_YoloTensors.at(yoloCountInputs);
+        curYoloTensor.blobName = blobName;
+        curYoloTensor.gridSizeY = prevTensorDims.d[2];
+        curYoloTensor.gridSizeX = prevTensorDims.d[3];
+        std::string inputVol = dimsToString(previous->getDimensions());
+        tensorOutputs.push_back(previous);
+        yoloTensorInputs.push_back(previous);
+        ++yoloCountInputs;
+        printLayerInfo(layerIndex, layer.type, inputVol, "-", "-");
+        break;
+      }
+      case LayerKind::kDropout: {
+        // 推理时为恒等映射，仍占一个层号以保持 darknet 的层下标
+        std::string inputVol = dimsToString(previous->getDimensions());
+        tensorOutputs.push_back(previous);
+        printLayerInfo(layerIndex, layer.type, inputVol, inputVol, "-");
+        break;
       }
-
-      std::string inputVol = dimsToString(previous->getDimensions());
-      previous = samLayer(i, activation, m_ConfigBlocks.at(i), previous, tensorOutputs[i + from - 1], &network);
-      assert(previous != nullptr);
-      std::string outputVol = dimsToString(previous->getDimensions());
-      tensorOutputs.push_back(previous);
-      std::string layerName = "sam_" + activation + ": " + std::to_string(i + from - 1);
-      printLayerInfo(layerIndex, layerName, inputVol, outputVol, "-");
-    }
-    else if (m_ConfigBlocks.at(i).at("type") == "route") {
-      std::string layers;
-      previous = routeLayer(i, layers, m_ConfigBlocks.at(i), tensorOutputs, &network);
-      assert(previous != nullptr);
-      std::string outputVol = dimsToString(previous->getDimensions());
-      tensorOutputs.push_back(previous);
-      std::string layerName = "route: " + layers;
-      printLayerInfo(layerIndex, layerName, "-", outputVol, "-");
-    }
-    else if (m_ConfigBlocks.at(i).at("type") == "upsample") {
-      std::string inputVol = dimsToString(previous->getDimensions());
-      previous = upsampleLayer(i, m_ConfigBlocks[i], previous, &network);
-      assert(previous != nullptr);
-      std::string outputVol = dimsToString(previous->getDimensions());
-      tensorOutputs.push_back(previous);
-      std::string layerName = "upsample";
-      printLayerInfo(layerIndex, layerName, inputVol, outputVol, "-");
-    }
-    else if (m_ConfigBlocks.at(i).at("type") == "max" || m_ConfigBlocks.at(i).at("type") == "maxpool" ||
-        m_ConfigBlocks.at(i).at("type") == "avg" || m_ConfigBlocks.at(i).at("type") == "avgpool") {
-      std::string inputVol = dimsToString(previous->getDimensions());
-      previous = poolingLayer(i, m_ConfigBlocks.at(i), previous, &network);
-      assert(previous != nullptr);
-      std::string outputVol = dimsToString(previous->getDimensions());
-      tensorOutputs.push_back(previous);
-      std::string layerName = m_ConfigBlocks.at(i).at("type");
-      printLayerInfo(layerIndex, layerName, inputVol, outputVol, "-");
-    }
-    else if (m_ConfigBlocks.at(i).at("type") == "reorg" || m_ConfigBlocks.at(i).at("type") == "reorg3d") {
-      std::string inputVol = dimsToString(previous->getDimensions());
-      previous = reorgLayer(i, m_ConfigBlocks.at(i), previous, &network);
-      assert(previous != nullptr);
-      std::string outputVol = dimsToString(previous->getDimensions());
-      tensorOutputs.push_back(previous);
-      std::string layerName = m_ConfigBlocks.at(i).at("type");
-      printLayerInfo(layerIndex, layerName, inputVol, outputVol, "-");
-    }
-    else if (m_ConfigBlocks.at(i).at("type") == "yolo" || m_ConfigBlocks.at(i).at("type") == "region") {
-      std::string blobName = m_ConfigBlocks.at(i).at("type") == "yolo" ? "yolo_" + std::to_string(i) :
-          "region_" + std::to_string(i);
-      nvinfer1::Dims prevTensorDims = previous->getDimensions();
-      TensorInfo& curYoloTensor = m_YoloTensors.at(yoloCountInputs);
-      curYoloTensor.blobName = blobName;
-      curYoloTensor.gridSizeY = prevTensorDims.d[2];
-      curYoloTensor.gridSizeX = prevTensorDims.d[3];
-      std::string inputVol = dimsToString(previous->getDimensions());
-      tensorOutputs.push_back(previous);
-      yoloTensorInputs[yoloCountInputs] = previous;
-      ++yoloCountInputs;
-      std::string layerName = m_ConfigBlocks.at(i).at("type");
-      printLayerInfo(layerIndex, layerName, inputVol, "-", "-");
-    }
-    else if (m_ConfigBlocks.at(i).at("type") == "dropout") {
-      // pass
     }
-    else {
-      std::cerr << "\nUnsupported layer type --> \"" << m_ConfigBlocks.at(i).at("type") << "\"" << std::endl;
-      assert(0);
+
+    // 新产生的输出张量按 cfg 块命名（与 yolo_N 相同），INT8 校准表和显式量化的激活 scale 都按该名称对应
+    nvinfer1::ITensor* output = tensorOutputs.back();
+    if (output != nullptr && output != data && namedTensors.insert(output).second) {
+      output->setName((layer.type + "_" + std::to_string(layerIdx)).c_str());
     }
-  }
 
-  if ((int) weights.size() != weightPtr) {
-    std::cerr << "\nNumber of unused weights left: " << weights.size() - weightPtr << std::endl;
-    assert(0);
+    if (m_Profiler != nullptr && weights.kernelCount + weights.biasCount > 0) {
+      size_t elementSize = weights.kernelHalf != nullptr ? sizeof(uint16_t) : sizeof(float);
+      m_Profiler->addLayerWeights(i, layer.type, (weights.kernelCount + weights.biasCount) * elementSize);
+    }
   }
 
   if (m_YoloCount == yoloCountInputs) {
@@ -456,7 +733,7 @@ Yolo::buildYoloNetwork(std::vector<float>& weights, nvinfer1::INetworkDefinition
     nvinfer1::IPluginV2DynamicExt* yoloPlugin = new YoloLayer(m_InputW, m_InputH, m_NumClasses, m_NewCoords,
         m_YoloTensors, outputSize);
     assert(yoloPlugin != nullptr);
-    nvinfer1::IPluginV2Layer* yolo = network.addPluginV2(yoloTensorInputs, m_YoloCount, *yoloPlugin);
+    nvinfer1::IPluginV2Layer* yolo = network.addPluginV2(yoloTensorInputs.data(), m_YoloCount, *yoloPlugin);
     assert(yolo != nullptr);
     std::string yoloLayerName = m_WtsFilePath;
     yolo->setName(yoloLayerName.c_str());
@@ -469,7 +746,7 @@ Yolo::buildYoloNetwork(std::vector<float>& weights, nvinfer1::INetworkDefinition
   }
   else {
     std::cerr << "\nError in yolo cfg file" << std::endl;
-    assert(0);
+    return NVDSINFER_CONFIG_FAILED;
   }
 
   std::cout << "\nOutput YOLO blob names: " << std::endl;
@@ -477,140 +754,125 @@ Yolo::buildYoloNetwork(std::vector<float>& weights, nvinfer1::INetworkDefinition
     std::cout << tensor.blobName << std::endl;
   }
 
+  if (!activationScales.empty()) {
+    std::cout << "\nExplicit INT8: " << quantizedInputs.size() << " quantized inputs, " << unquantized <<
+        " convolutions without an activation scale in " << m_Int8CalibPath << " run in FP32" << std::endl;
+  }
+
   int nbLayers = network.getNbLayers();
   std::cout << "\nTotal number of YOLO layers: " << nbLayers << "\n" << std::endl;
 
   return NVDSINFER_SUCCESS;
 }
 
-std::vector<std::map<std::string, std::string>>
-Yolo::parseConfigFile(const std::string cfgFilePath)
+bool
+Yolo::useExplicitInt8() const
 {
-  assert(fileExists(cfgFilePath));
-  std::ifstream file(cfgFilePath);
-  assert(file.good());
-  std::string line;
-  std::vector<std::map<std::string, std::string>> blocks;
-  std::map<std::string, std::string> block;
-
-  while (getline(file, line)) {
-    if (line.size() == 0 || line.front() == ' ' || line.front() == '#') {
-      continue;
-    }
-
-    line = trim(line);
-    if (line.front() == '[') {
-      if (block.size() > 0) {
-        blocks.push_back(block);
-        block.clear();
-      }
-      std::string key = "type";
-      std::string value = trim(line.substr(1, line.size() - 2));
-      block.insert(std::pair<std::string, std::string>(key, value));
-    }
-    else {
-      int cpos = line.find('=');
-      std::string key = trim(line.substr(0, cpos));
-      std::string value = trim(line.substr(cpos + 1));
-      block.insert(std::pair<std::string, std::string>(key, value));
-    }
-  }
-
-  blocks.push_back(block);
-  return blocks;
+  // Q/DQ 层需要 TensorRT 8
+#if NV_TENSORRT_MAJOR >= 8
+  return m_NetworkType == "darknet" && m_NetworkMode == "INT8" && getenv("INT8_QDQ") &&
+      std::string(getenv("INT8_QDQ")) == "1";
+#else
+  return false;
+#endif
 }
 
-void
-Yolo::parseConfigBlocks()
+NvDsInferStatus
+Yolo::parseConfigFile()
 {
-  for (auto block : m_ConfigBlocks) {
-    if (block.at("type") == "net") {
-      assert((block.find("channels") != block.end()) && "Missing 'channels' param in network cfg");
-      assert((block.find("height") != block.end()) && "Missing 'height' param in network cfg");
-      assert((block.find("width") != block.end()) && "Missing 'width' param in network cfg");
+  std::string error;
+  if (!parseNetworkConfigFile(m_CfgFilePath, m_Network, error)) {
+    std::cerr << "\nCould not parse the cfg file: " << error << std::endl;
+    m_Network = NetworkDesc();
+    return NVDSINFER_CONFIG_FAILED;
+  }
 
-      m_InputC = std::stoul(block.at("channels"));
-      m_InputH = std::stoul(block.at("height"));
-      m_InputW = std::stoul(block.at("width"));
+  // NETWORK_PASSES=0 时按 cfg 逐层构建，用于排查图优化的问题
+  if (!getenv("NETWORK_PASSES") || std::string(getenv("NETWORK_PASSES")) != "0") {
+    NetworkPassStats stats;
+    optimizeNetwork(m_Network, stats);
+    std::cout << "Network passes: " << stats.identityLayers << " identity, " << stats.mergedLayers << " merged, " <<
+        stats.cascadedPools << " cascaded maxpool, " << stats.foldedBatchnorms << " folded batchnorm, " <<
+        stats.deadLayers << " unused layers" << std::endl;
+  }
 
-      m_InputSize = m_InputC * m_InputH * m_InputW;
+  if (pruneOutputHeads() != NVDSINFER_SUCCESS) {
+    m_Network = NetworkDesc();
+    return NVDSINFER_CONFIG_FAILED;
+  }
 
-      if (block.find("letter_box") != block.end()) {
-        m_LetterBox = std::stoul(block.at("letter_box"));
-      }
-    }
-    else if ((block.at("type") == "region") || (block.at("type") == "yolo")) {
-      assert((block.find("num") != block.end()) &&
-          std::string("Missing 'num' param in " + block.at("type") + " layer").c_str());
-      assert((block.find("classes") != block.end()) &&
-          std::string("Missing 'classes' param in " + block.at("type") + " layer").c_str());
-      assert((block.find("anchors") != block.end()) &&
-          std::string("Missing 'anchors' param in " + block.at("type") + " layer").c_str());
+  // 在读取权重和构建网络之前检查各层形状，cfg 错误直接给出层号和行号
+  std::vector<TensorShape> shapes;
+  if (!inferLayerShapes(m_Network, shapes, error)) {
+    std::cerr << "\nInvalid cfg file: " << error << std::endl;
+    m_Network = NetworkDesc();
+    return NVDSINFER_CONFIG_FAILED;
+  }
 
-      ++m_YoloCount;
+  applyNetworkDesc();
 
-      m_NumClasses = std::stoul(block.at("classes"));
+  return NVDSINFER_SUCCESS;
+}
 
-      if (block.find("new_coords") != block.end()) {
-        m_NewCoords = std::stoul(block.at("new_coords"));
-      }
+// PRUNE_YOLO_HEADS=yolo_139,... 时删除这些输出头和只为它们计算的分支（如固定场景中用不到的小目标检测头），
+// YoloLayer 只解码剩余的输出头，不需要重新训练
+NvDsInferStatus
+Yolo::pruneOutputHeads()
+{
+  if (!getenv("PRUNE_YOLO_HEADS") || std::string(getenv("PRUNE_YOLO_HEADS")).empty()) {
+    return NVDSINFER_SUCCESS;
+  }
 
-      TensorInfo outputTensor;
+  NetworkPassStats stats;
+  std::string error;
+  if (!pruneYoloHeads(m_Network, getenv("PRUNE_YOLO_HEADS"), stats, error)) {
+    std::cerr << "\nCould not prune the output heads: " << error << std::endl;
+    return NVDSINFER_CONFIG_FAILED;
+  }
+  std::cout << "Pruned " << stats.prunedHeads << " output heads and " << stats.deadLayers <<
+      " layers feeding only them" << std::endl;
 
-      std::string anchorString = block.at("anchors");
-      while (!anchorString.empty()) {
-        int npos = anchorString.find_first_of(',');
-        if (npos != -1) {
-          float anchor = std::stof(trim(anchorString.substr(0, npos)));
-          outputTensor.anchors.push_back(anchor);
-          anchorString.erase(0, npos + 1);
-        }
-        else {
-          float anchor = std::stof(trim(anchorString));
-          outputTensor.anchors.push_back(anchor);
-          break;
-        }
-      }
+  return NVDSINFER_SUCCESS;
+}
 
-      if (block.find("mask") != block.end()) {
-        std::string maskString = block.at("mask");
-        while (!maskString.empty()) {
-          int npos = maskString.find_first_of(',');
-          if (npos != -1) {
-            int mask = std::stoul(trim(maskString.substr(0, npos)));
-            outputTensor.mask.push_back(mask);
-            maskString.erase(0, npos + 1);
-          }
-          else {
-            int mask = std::stoul(trim(maskString));
-            outputTensor.mask.push_back(mask);
-            break;
-          }
-        }
-      }
+void
+Yolo::applyNetworkDesc()
+{
+  m_InputC = m_Network.channels;
+  m_InputH = m_Network.height;
+  m_InputW = m_Network.width;
+  m_InputSize = m_InputC * m_InputH * m_InputW;
+  m_LetterBox = m_Network.letterBox;
 
-      if (block.find("scale_x_y") != block.end()) {
-        outputTensor.scaleXY = std::stof(block.at("scale_x_y"));
-      }
-      else {
-        outputTensor.scaleXY = 1.0;
-      }
+  m_YoloTensors.clear();
+  m_YoloCount = 0;
 
-      outputTensor.numBBoxes = outputTensor.mask.size() > 0 ? outputTensor.mask.size() :
-          std::stoul(trim(block.at("num")));
-      
-      m_YoloTensors.push_back(outputTensor);
+  for (const LayerDesc& layer : m_Network.layers) {
+    if ((layer.kind != LayerKind::kYolo && layer.kind != LayerKind::kRegion) || layer.dead) {
+      continue;
     }
+
+    ++m_YoloCount;
+
+    m_NumClasses = layer.classes;
+    m_NewCoords = layer.newCoords;
+
+    TensorInfo outputTensor;
+    outputTensor.anchors = layer.anchors;
+    outputTensor.mask = layer.mask;
+    outputTensor.scaleXY = layer.scaleXY;
+    outputTensor.numBBoxes = layer.mask.size() > 0 ? layer.mask.size() : layer.num;
+
+    m_YoloTensors.push_back(outputTensor);
   }
 }
 
 void
 Yolo::destroyNetworkUtils()
 {
-  for (uint i = 0; i < m_TrtWeights.size(); ++i) {
-    if (m_TrtWeights[i].count > 0) {
-      free(const_cast<void*>(m_TrtWeights[i].values));
-    }
-  }
-  m_TrtWeights.clear();
+  m_LayerWeights.clear();
+  m_Arena.clear();
+  m_HalfArena.clear();
+  m_Weights.close();
+  m_Pack.close();
 }
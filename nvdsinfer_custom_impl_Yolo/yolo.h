@@ -29,6 +29,16 @@
 #include "NvInferPlugin.h"
 #include "nvdsinfer_custom_impl.h"
 
+#include "startup_profiler.h"
+#include "weights_file.h"
+#include "weight_cursor.h"
+#include "network_ir.h"
+#include "network_weights.h"
+#include "network_passes.h"
+#include "network_shapes.h"
+#include "model_pack.h"
+#include "int8_quantization.h"
+
 #include "layers/convolutional_layer.h"
 #include "layers/deconvolutional_layer.h"
 #include "layers/batchnorm_layer.h"
@@ -40,6 +50,7 @@
 #include "layers/upsample_layer.h"
 #include "layers/pooling_layer.h"
 #include "layers/reorg_layer.h"
+#include "layers/quantize_layer.h"
 
 #if NV_TENSORRT_MAJOR >= 8
 #define INT int32_t
@@ -47,6 +58,9 @@
 #define INT int
 #endif
 
+// cfg/权重转换为 TensorRT 网络的方式（层的实现、张量名、插件）改变时加一，使缓存的引擎失效
+#define YOLO_NETWORK_VERSION 1
+
 #if NV_TENSORRT_MAJOR < 8 || (NV_TENSORRT_MAJOR == 8 && NV_TENSORRT_MINOR == 0)
 static class Logger : public nvinfer1::ILogger {
   void log(nvinfer1::ILogger::Severity severity, const char* msg) noexcept override {
@@ -75,6 +89,9 @@ struct NetworkInfo
   const float* offsets;
   uint workspaceSize;
   int inputFormat;
+  int maintainAspectRatio;
+  int symmetricPadding;
+  StartupProfiler* profiler {nullptr};
 };
 
 struct TensorInfo
@@ -104,8 +121,12 @@ class Yolo : public IModelParser {
 
 #if NV_TENSORRT_MAJOR >= 8
     nvinfer1::ICudaEngine* createEngine(nvinfer1::IBuilder* builder, nvinfer1::IBuilderConfig* config);
+
+    nvinfer1::IHostMemory* createSerializedEngine(nvinfer1::IBuilder* builder, nvinfer1::IBuilderConfig* config);
 #else
     nvinfer1::ICudaEngine* createEngine(nvinfer1::IBuilder* builder);
+
+    nvinfer1::IHostMemory* createSerializedEngine(nvinfer1::IBuilder* builder);
 #endif
 
   protected:
@@ -126,6 +147,9 @@ class Yolo : public IModelParser {
     const float* m_Offsets;
     const uint m_WorkspaceSize;
     const int m_InputFormat;
+    const int m_MaintainAspectRatio;
+    const int m_SymmetricPadding;
+    StartupProfiler* m_Profiler;
 
     uint m_InputC;
     uint m_InputH;
@@ -137,15 +161,31 @@ class Yolo : public IModelParser {
     uint m_YoloCount;
 
     std::vector<TensorInfo> m_YoloTensors;
-    std::vector<std::map<std::string, std::string>> m_ConfigBlocks;
-    std::vector<nvinfer1::Weights> m_TrtWeights;
+    NetworkDesc m_Network;
+    std::vector<LayerWeights> m_LayerWeights;
+    WeightsFile m_Weights;
+    ModelPack m_Pack;
+    WeightArena m_Arena;
+    WeightArena m_HalfArena;
+    const bool m_UseModelPack;
 
   private:
-    NvDsInferStatus buildYoloNetwork(std::vector<float>& weights, nvinfer1::INetworkDefinition& network);
+    bool loadWeights();
+
+    NvDsInferStatus loadModelPack();
+
+    NvDsInferStatus prepareWeights();
+
+    void convertWeightsToHalf();
+
+    NvDsInferStatus buildYoloNetwork(nvinfer1::INetworkDefinition& network);
+
+    NvDsInferStatus parseConfigFile();
 
-    std::vector<std::map<std::string, std::string>> parseConfigFile(const std::string cfgFilePath);
+    NvDsInferStatus pruneOutputHeads();
 
-    void parseConfigBlocks();
+    bool useExplicitInt8() const;
+    void applyNetworkDesc();
 
     void destroyNetworkUtils();
 };